@@ -66,16 +66,6 @@ endif()
 set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -Wno-error=pedantic")
 set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -Wno-error=redundant-decls")
 set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -Wno-error=old-style-cast")
-IF (C_AVX512_FOUND OR CXX_AVX512_FOUND)
-  set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -DAVX512")
-  set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -mavx512f")
-  set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -mavx512bw")
-  set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -mavx512vl")
-  set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -mf16c")
-ENDIF()
-IF (C_AVX512_BF16_FOUND OR CXX_AVX512_BF16_FOUND)
-  set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -mavx512bf16 -DAVX512_BF16")
-ENDIF()
 set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -fopenmp")
 # These flags are not available in GCC-4.8.5. Set only when using clang.
 # Compared against https://gcc.gnu.org/onlinedocs/gcc-4.8.5/gcc/Option-Summary.html
@@ -155,6 +145,26 @@ add_subdirectory(${DPCPP_ROOT})
 add_subdirectory(${DPCPP_ROOT}/cpu)
 add_subdirectory(${DPCPP_ROOT}/jit)
 
+# The library is built for the baseline ISA so that it loads on any x86-64
+# host. Only the bf16 vector kernels are built once per ISA, with their own
+# target flags, and selected at runtime.
+include(CheckCXXCompilerFlag)
+CHECK_CXX_COMPILER_FLAG("-mavx512bf16" COMPILER_SUPPORTS_AVX512_BF16)
+set(VEC_KERNEL_DIR ${DPCPP_CPU_ROOT}/bf16/vec)
+set_source_files_properties(${VEC_KERNEL_DIR}/vec_kernel_ref.cpp
+  PROPERTIES COMPILE_FLAGS "-mno-avx")
+set_source_files_properties(${VEC_KERNEL_DIR}/vec_kernel_avx2.cpp
+  PROPERTIES COMPILE_FLAGS "-mno-avx512f -mavx2 -mfma -mf16c")
+IF (COMPILER_SUPPORTS_AVX512_BF16)
+  set_source_files_properties(${VEC_KERNEL_DIR}/vec_kernel_avx512.cpp
+    PROPERTIES COMPILE_FLAGS "-mavx512f -mavx512bw -mavx512vl -mno-avx512bf16")
+  set_source_files_properties(${VEC_KERNEL_DIR}/vec_kernel_avx512_bf16.cpp
+    PROPERTIES COMPILE_FLAGS "-mavx512f -mavx512bw -mavx512vl -mavx512bf16")
+ELSE()
+  set_source_files_properties(${VEC_KERNEL_DIR}/vec_kernel_avx512.cpp
+    PROPERTIES COMPILE_FLAGS "-mavx512f -mavx512bw -mavx512vl")
+ENDIF()
+
 # libxsmm
 include(${CMAKE_ROOT}/Modules/ExternalProject.cmake)
 ExternalProject_Add(xsmm
@@ -163,7 +173,6 @@ ExternalProject_Add(xsmm
   CONFIGURE_COMMAND ""
   BUILD_COMMAND
     make
-    "AVX=3"
     "-j"
   INSTALL_COMMAND ""
   )
@@ -12,12 +12,19 @@ core.enable_torch_ccl()
 DEVICE = 'xpu:0'
 
 class AmpConf(object):
-    def __init__(self, mixed_dtype = torch.bfloat16, configure_file = None):
+    def __init__(self, mixed_dtype = torch.bfloat16, configure_file = None, calibration_algorithm = 'min_max',
+                 activation_qscheme = 'symmetric'):
         self.dtype = mixed_dtype
         self.configure_file = configure_file
 
         if self.dtype != torch.bfloat16:
             core.clear_indicators()
+            # used by the ops the configure file does not set, one of min_max,
+            # moving_averager_min_max, kl, percentile (99.99) or percentile_<p>
+            core.set_int8_calibration_algorithm(calibration_algorithm)
+            # symmetric, or asymmetric to quantize the inputs of conv and linear
+            # to u8 with a zero point
+            core.set_int8_activation_qscheme(activation_qscheme)
         # for int8 path, if user give a exited configure file, load it.
         if self.configure_file != None and self.dtype != torch.bfloat16:
             if os.path.exists(self.configure_file) and os.stat(self.configure_file).st_size != 0:
@@ -34,6 +41,40 @@ class AmpConf(object):
         with open(configure_file, 'w') as fp:
             json.dump(configures, fp, indent = 4)
 
+def int8_op_scopes(model):
+    """Identify the int8 ops of model by their module path and their order in
+    the module, instead of their position in the whole run of the thread. Then
+    threads serving different requests, or running the model partially, find
+    the quantization parameters of their ops. Must be applied for calibration
+    and inference alike. Returns the hook handles, remove them to undo it."""
+    def push(name):
+        return lambda module, input: core.push_int8_scope(name)
+
+    def pop(module, input, output):
+        core.pop_int8_scope()
+
+    handles = []
+    for name, module in model.named_modules():
+        handles.append(module.register_forward_pre_hook(push(name)))
+        handles.append(module.register_forward_hook(pop))
+    return handles
+
+def quantize_dynamic(model, module_types = (torch.nn.Linear,)):
+    """Quantize the weights of the modules of model that are instances of
+    module_types, model included, to int8 per output channel, in place and
+    once. Their activations are quantized for every call with the scale of
+    their own min/max, so they need no calibration and suit inputs whose
+    range varies, like the variable-length inputs of NLP models. Only linear
+    layers are supported, and their jit fusions with relu and gelu. It
+    applies in inference, whatever the auto mixed precision, and the model
+    must be on the ipex device. Returns model."""
+    for module in model.modules():
+        if isinstance(module, module_types):
+            assert isinstance(module, torch.nn.Linear), 'dynamic int8 quantization only supports linear layers'
+            assert module.weight.device.type == 'xpu', 'please move the model to the ipex device first'
+            core.prepack_dynamic_int8_linear_weight(module.weight)
+    return model
+
 class _DecoratorContextManager:
     """Allow a context manager to be used as a decorator, copy form pytorch FW"""
 
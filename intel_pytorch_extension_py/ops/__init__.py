@@ -1,5 +1,8 @@
 from .interaction import interaction
 from .embeddingbag import embeddingbag
+from .embeddingbag import batched_embedding_bag
+from .embeddingbag import QuantizedEmbeddingBag
+from .embeddingbag import EmbeddingBag
 from .linear import *
 from .pooling import *
 from .mlp import * 
@@ -8,8 +11,13 @@ from .save import *
 from .to import *
 from .roi_align import ROIAlign
 from .roi_align import roi_align
+from .roi_align import MultiLevelROIAlign
+from .roi_align import multilevel_roi_align
 from .nms import *
 from .lstm import *
 from .rnn import *
 from .gru import *
 from .frozen_batch_norm import *
+from .dropout import *
+from .layer_norm import *
+from .attention import *
@@ -0,0 +1,20 @@
+import math
+import torch
+
+def scaled_dot_product_attention(query, key, value, attn_mask=None, scale=None,
+                                 dropout_p: float = 0., training: bool = False):
+    """softmax(query @ key^T * scale + attn_mask) @ value over [B, H, S, D]
+    heads, scale defaults to 1 / sqrt(D). The fused kernel tiles the scores and
+    runs in inference, training falls back to the unfused ops."""
+    if scale is None:
+        scale = 1. / math.sqrt(query.size(-1))
+    return torch.ops.torch_ipex.scaled_dot_product_attention(
+        query, key, value, attn_mask, scale, dropout_p, training)
+
+def multi_head_attention(query, key, value, num_heads, attn_mask=None, scale=None):
+    """scaled_dot_product_attention of the num_heads heads of [B, S, H * D]
+    query, key and value projections, returns the [B, S, H * D] context"""
+    if scale is None:
+        scale = 1. / math.sqrt(query.size(-1) // num_heads)
+    return torch.ops.torch_ipex.multi_head_attention(
+        query, key, value, attn_mask, num_heads, scale)
@@ -0,0 +1,18 @@
+import torch
+import torch.nn.functional as F
+
+_dropout = F.dropout
+
+def dropout(input, p: float = 0.5, training: bool = True, inplace: bool = False):
+    if p < 0. or p > 1.:
+        raise ValueError("dropout probability has to be between 0 and 1, "
+                         "but got {}".format(p))
+    if inplace or p == 1.:
+        return _dropout(input, p, training, inplace)
+    return torch.ops.torch_ipex.dropout(input, p, training)
+
+def dropout_add(input, residual, p: float = 0.5, training: bool = True):
+    """dropout(input, p, training) + residual with a single pass over the data"""
+    return torch.ops.torch_ipex.dropout_add(input, residual, p, training)
+
+F.dropout = dropout
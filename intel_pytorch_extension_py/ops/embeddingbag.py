@@ -12,3 +12,152 @@ def embeddingbag(weights, indices, offsets, scale_grad_by_freq, mode, sparse, pe
         ret += [torch.Tensor(), torch.Tensor(), torch.Tensor()]
     return ret
 torch.embedding_bag = embeddingbag
+
+
+_batched_modes = {'sum': 0, 'mean': 1}
+
+def _batched_fast_path(weights, indices, offsets, mode, per_sample_weights):
+    if mode not in _batched_modes or per_sample_weights is not None:
+        return False
+    dtype, dim = weights[0].dtype, weights[0].size(1)
+    if dtype not in (torch.float, torch.bfloat16):
+        return False
+    return all(w.dtype == dtype and w.size(1) == dim and w.stride(1) == 1 and o.numel() == offsets[0].numel()
+               for w, o in zip(weights, offsets))
+
+def batched_embedding_bag(weights, indices, offsets, mode='sum', sparse=False, include_last_offset=False, per_sample_weights=None):
+    """Looks up several embedding tables at once.
+
+    Returns a [num_bags, num_tables * dim] tensor holding the bags of every
+    table side by side, which can be passed to `interaction` as one input.
+    Tables of the same dtype and dim with the same number of bags go through
+    one fused kernel, anything else is computed table by table.
+    """
+    assert len(weights) == len(indices) == len(offsets)
+    if not _batched_fast_path(weights, indices, offsets, mode, per_sample_weights):
+        psw = per_sample_weights if per_sample_weights is not None else [None] * len(weights)
+        return torch.cat([torch.nn.functional.embedding_bag(i, w, o, mode=mode, sparse=sparse,
+                                                            per_sample_weights=p, include_last_offset=include_last_offset)
+                          for w, i, o, p in zip(weights, indices, offsets, psw)], dim=1)
+    if torch.is_grad_enabled() and any(w.requires_grad for w in weights):
+        return BatchedEmbeddingBagFunc.apply(indices, offsets, _batched_modes[mode], sparse, include_last_offset, *weights)
+    return torch.ops.torch_ipex.batched_embedding_bag_forward(weights, indices, offsets, _batched_modes[mode], include_last_offset)
+
+class BatchedEmbeddingBagFunc(Function):
+    # Same as interaction: c++ custom functions do not take vector<Tensor> inputs yet
+    @staticmethod
+    def forward(ctx, indices, offsets, mode, sparse, include_last_offset, *weights):
+        ctx.indices = indices
+        ctx.offsets = offsets
+        ctx.mode = mode
+        ctx.sparse = sparse
+        ctx.include_last_offset = include_last_offset
+        ctx.num_weights = [w.size(0) for w in weights]
+        return torch.ops.torch_ipex.batched_embedding_bag_forward(weights, indices, offsets, mode, include_last_offset)
+
+    @staticmethod
+    def backward(ctx, grad_out):
+        weight_grads = torch.ops.torch_ipex.batched_embedding_bag_backward(
+            grad_out.contiguous(), ctx.indices, ctx.offsets, ctx.num_weights, ctx.mode, ctx.sparse, ctx.include_last_offset)
+        return (None, None, None, None, None) + tuple(weight_grads)
+
+
+class QuantizedEmbeddingBag(nn.Module):
+    """Inference-only EmbeddingBag over a row-wise quantized table.
+
+    Every row is stored as 8-bit or 4-bit unsigned values followed by a fp32
+    scale and bias, and dequantized on the fly while accumulating the bags.
+    Only the 'sum' and 'mean' modes are supported, the output is fp32.
+    """
+    _modes = {'sum': 0, 'mean': 1}
+
+    def __init__(self, qweight, bit_width=8, mode='sum', include_last_offset=False):
+        super(QuantizedEmbeddingBag, self).__init__()
+        assert bit_width in (8, 4), "bit_width should be 8 or 4"
+        assert mode in self._modes, "only 'sum' and 'mean' modes are supported"
+        self.register_buffer('qweight', qweight)
+        self.bit_width = bit_width
+        self.mode = mode
+        self.include_last_offset = include_last_offset
+
+    @classmethod
+    def from_float(cls, emb, bit_width=8):
+        qweight = torch.ops.torch_ipex.embedding_bag_rowwise_quantize(emb.weight.detach(), bit_width)
+        return cls(qweight, bit_width, emb.mode, emb.include_last_offset)
+
+    def forward(self, input, offsets, per_sample_weights=None):
+        return torch.ops.torch_ipex.quantized_embedding_bag(self.qweight, input, offsets, self.bit_width,
+                                                           self._modes[self.mode], per_sample_weights,
+                                                           self.include_last_offset)
+
+    def extra_repr(self):
+        return 'bit_width={}, mode={}'.format(self.bit_width, self.mode)
+
+
+_fused_modes = {'sum': 0, 'mean': 1}
+
+class EmbeddingBag(nn.EmbeddingBag):
+    """nn.EmbeddingBag with an optional optimizer step fused into its backward.
+
+    With fused_update set to 'sgd', 'split_sgd' (bf16 weight with an extra
+    bottom half, like SplitSGD) or 'rowwise_adagrad', the backward reduces the
+    gradient of every looked up row and applies the step straight to it.
+    No weight gradient is produced, so `weight` must be left out of the
+    regular optimizer. `lr` and `eps` can be changed between steps.
+    """
+
+    def __init__(self, num_embeddings, embedding_dim, mode='mean', fused_update=None, lr=0.01, eps=1e-8, **kwargs):
+        super(EmbeddingBag, self).__init__(num_embeddings, embedding_dim, mode=mode, **kwargs)
+        assert fused_update in (None, 'sgd', 'split_sgd', 'rowwise_adagrad'), \
+            "fused_update should be None, 'sgd', 'split_sgd' or 'rowwise_adagrad'"
+        assert fused_update is None or mode in _fused_modes, "fused_update only supports 'sum' and 'mean' modes"
+        assert fused_update is None or (self.max_norm is None and not self.scale_grad_by_freq), \
+            "fused_update does not support max_norm and scale_grad_by_freq"
+        self.fused_update = fused_update
+        self.lr = lr
+        self.eps = eps
+        # created on the first fused step, once dtype and device are settled
+        self.register_buffer('bottom_half', None)
+        self.register_buffer('momentum', None)
+
+    def forward(self, input, offsets=None, per_sample_weights=None):
+        if self.fused_update is None or not (torch.is_grad_enabled() and self.weight.requires_grad):
+            return super(EmbeddingBag, self).forward(input, offsets, per_sample_weights)
+        assert per_sample_weights is None or not per_sample_weights.requires_grad, \
+            "fused_update does not compute the gradient of per_sample_weights"
+        if input.dim() == 2:
+            offsets = torch.arange(0, input.numel(), input.size(1), dtype=torch.long, device=input.device)
+            input = input.reshape(-1)
+        if self.fused_update == 'split_sgd':
+            assert self.weight.dtype == torch.bfloat16, "split_sgd expects a bfloat16 weight"
+            if self.bottom_half is None:
+                self.bottom_half = torch.zeros_like(self.weight.data)
+        if self.fused_update == 'rowwise_adagrad' and self.momentum is None:
+            self.momentum = torch.zeros(self.num_embeddings, dtype=torch.float, device=self.weight.device)
+        return FusedUpdateEmbeddingBagFunc.apply(self, input, offsets, per_sample_weights, self.weight)
+
+    def extra_repr(self):
+        s = super(EmbeddingBag, self).extra_repr()
+        if self.fused_update is not None:
+            s += ', fused_update={}, lr={}'.format(self.fused_update, self.lr)
+        return s
+
+class FusedUpdateEmbeddingBagFunc(Function):
+    @staticmethod
+    def forward(ctx, module, input, offsets, per_sample_weights, weight):
+        ctx.module = module
+        ctx.save_for_backward(input, offsets, per_sample_weights)
+        ret = torch.embedding_bag(weight, input, offsets, module.scale_grad_by_freq, _fused_modes[module.mode],
+                                  False, per_sample_weights, module.include_last_offset)
+        return ret[0]
+
+    @staticmethod
+    def backward(ctx, grad_out):
+        module = ctx.module
+        input, offsets, per_sample_weights = ctx.saved_tensors
+        core.embedding_bag_backward_update_(
+            grad_out, module.weight.data,
+            module.bottom_half if module.fused_update == 'split_sgd' else None,
+            module.momentum if module.fused_update == 'rowwise_adagrad' else None,
+            input, offsets, _fused_modes[module.mode], per_sample_weights, module.lr, module.eps)
+        return None, None, None, None, None
@@ -0,0 +1,13 @@
+import torch
+
+def add_layer_norm(input, residual, normalized_shape, weight=None, bias=None,
+                   eps: float = 1e-5, p: float = 0., training: bool = False):
+    """layer_norm(dropout(input, p, training) + residual) with a single read of
+    the hidden state, the dropout only applies in training"""
+    if p < 0. or p >= 1.:
+        raise ValueError("dropout probability has to be in [0, 1), "
+                         "but got {}".format(p))
+    if isinstance(normalized_shape, int):
+        normalized_shape = [normalized_shape]
+    return torch.ops.torch_ipex.add_layer_norm(
+        input, residual, list(normalized_shape), weight, bias, eps, p, training)
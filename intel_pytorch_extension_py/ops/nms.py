@@ -1,4 +1,5 @@
 import _torch_ipex as core
 
 nms = core.nms
-batch_score_nms = core.batch_score_nms
\ No newline at end of file
+batch_score_nms = core.batch_score_nms
+batch_score_nms_padded = core.batch_score_nms_padded
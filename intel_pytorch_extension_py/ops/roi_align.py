@@ -66,3 +66,76 @@ class ROIAlign(nn.Module):
         tmpstr += ", sampling_ratio=" + str(self.sampling_ratio)
         tmpstr += ")"
         return tmpstr
+
+
+class _MultiLevelROIAlign(Function):
+    @staticmethod
+    def forward(ctx, rois, output_size, spatial_scales, sampling_ratio, canonical_scale, canonical_level, *features):
+        ctx.save_for_backward(rois)
+        ctx.output_size = _pair(output_size)
+        ctx.spatial_scales = spatial_scales
+        ctx.sampling_ratio = sampling_ratio
+        ctx.canonical = (canonical_scale, canonical_level)
+        ctx.input_shapes = [f.size() for f in features]
+        output = core.roi_align_forward_multilevel(
+            list(features), rois, spatial_scales, ctx.output_size[0], ctx.output_size[1],
+            sampling_ratio, canonical_scale, canonical_level
+        )
+        return output
+
+    @staticmethod
+    @once_differentiable
+    def backward(ctx, grad_output):
+        rois, = ctx.saved_tensors
+        bs, ch = ctx.input_shapes[0][:2]
+        grad_inputs = core.roi_align_backward_multilevel(
+            grad_output,
+            rois,
+            ctx.spatial_scales,
+            ctx.output_size[0],
+            ctx.output_size[1],
+            bs,
+            ch,
+            [s[2] for s in ctx.input_shapes],
+            [s[3] for s in ctx.input_shapes],
+            ctx.sampling_ratio,
+            *ctx.canonical
+        )
+        return (None, None, None, None, None, None) + tuple(grad_inputs)
+
+
+def multilevel_roi_align(features, rois, output_size, spatial_scales, sampling_ratio,
+                         canonical_scale=224, canonical_level=4):
+    """ROIAlign of every roi on its FPN level, in one call.
+
+    features are the pyramid levels, finest first, and spatial_scales their
+    scales, each half the previous one. Every roi [batch_index, x1, y1, x2, y2]
+    is pooled from level floor(canonical_level + log2(sqrt(area) / canonical_scale)),
+    clamped to the pyramid, and the output keeps the order of rois.
+    """
+    return _MultiLevelROIAlign.apply(
+        rois, output_size, list(spatial_scales), sampling_ratio, canonical_scale, canonical_level, *features)
+
+
+class MultiLevelROIAlign(nn.Module):
+    def __init__(self, output_size, scales, sampling_ratio, canonical_scale=224, canonical_level=4):
+        super(MultiLevelROIAlign, self).__init__()
+        self.output_size = output_size
+        self.scales = list(scales)
+        self.sampling_ratio = sampling_ratio
+        self.canonical_scale = canonical_scale
+        self.canonical_level = canonical_level
+
+    def forward(self, features, rois):
+        return multilevel_roi_align(
+            features, rois, self.output_size, self.scales, self.sampling_ratio,
+            self.canonical_scale, self.canonical_level
+        )
+
+    def __repr__(self):
+        tmpstr = self.__class__.__name__ + "("
+        tmpstr += "output_size=" + str(self.output_size)
+        tmpstr += ", scales=" + str(self.scales)
+        tmpstr += ", sampling_ratio=" + str(self.sampling_ratio)
+        tmpstr += ")"
+        return tmpstr
@@ -67,5 +67,8 @@ class SplitSGD(Optimizer):
                     packed_add_(p.data, b_d, d_p, -group['lr'])
                 else:
                     p.data.add_(d_p, alpha=-group['lr'])
+                # the updates through .data do not bump the version of p,
+                # drop the copies of p the ops reordered for its old value
+                _torch_ipex.drop_reordered_weights(p)
 
         return loss
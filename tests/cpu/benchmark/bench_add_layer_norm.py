@@ -0,0 +1,77 @@
+"""Time of the residual add + layer norm of a BERT-base encoder layer, aten
+add and layer_norm against the fused ipex.add_layer_norm.
+
+A layer runs it twice, after the attention output and after the feed forward
+output, on batch x seq x 768 hidden states. The unfused path writes the sum
+and reads it back for the statistics and again for the normalization, the
+fused kernel reads the input and the residual once. --dropout also folds the
+hidden dropout of the training graph into the fused op.
+
+    python bench_add_layer_norm.py --batch 8 32 --seq 128 384 --dropout 0 0.1
+"""
+import argparse
+import time
+
+import torch
+import torch.nn.functional as F
+import intel_pytorch_extension as ipex
+
+HIDDEN = 768
+EPS = 1e-12
+
+
+def aten_layer(x, res, weight, bias, p):
+    return F.layer_norm(torch.dropout(x, p, p > 0) + res, [HIDDEN], weight, bias, EPS)
+
+
+def ipex_layer(x, res, weight, bias, p):
+    return ipex.add_layer_norm(x, res, [HIDDEN], weight, bias, EPS, p, p > 0)
+
+
+def make_inputs(batch, seq, dtype, device):
+    shapes = [(batch, seq, HIDDEN)] * 2 + [(HIDDEN,)] * 2
+    return [torch.randn(s).to(dtype).to(device).requires_grad_() for s in shapes]
+
+
+def bench(layer, inputs, p, backward, warmup, iters):
+    def step():
+        y = layer(*inputs, p)
+        if backward:
+            y.backward(torch.ones_like(y))
+    for _ in range(warmup):
+        step()
+    start = time.time()
+    for _ in range(iters):
+        step()
+    return (time.time() - start) / iters * 1000
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--batch', type=int, nargs='+', default=[8, 32])
+    parser.add_argument('--seq', type=int, nargs='+', default=[128, 384])
+    parser.add_argument('--dropout', type=float, nargs='+', default=[0., 0.1])
+    parser.add_argument('--warmup', type=int, default=5)
+    parser.add_argument('--iters', type=int, default=20)
+    args = parser.parse_args()
+    ipex.core.enable_auto_dnnl()
+
+    print('threads {}'.format(torch.get_num_threads()))
+    print('{:>6} {:>6} {:>6} {:>5} {:>5} {:>10} {:>10} {:>8}'.format(
+        'dtype', 'batch', 'seq', 'p', 'bwd', 'aten(ms)', 'ipex(ms)', 'speedup'))
+    for dtype in [torch.float, torch.bfloat16]:
+        for batch in args.batch:
+            for seq in args.seq:
+                for p in args.dropout:
+                    for backward in [False, True]:
+                        t_aten = bench(aten_layer, make_inputs(batch, seq, dtype, ipex.DEVICE),
+                                       p, backward, args.warmup, args.iters)
+                        t_ipex = bench(ipex_layer, make_inputs(batch, seq, dtype, ipex.DEVICE),
+                                       p, backward, args.warmup, args.iters)
+                        print('{:>6} {:>6} {:>6} {:>5} {:>5} {:>10.3f} {:>10.3f} {:>8.2f}'.format(
+                            str(dtype).split('.')[-1], batch, seq, p, str(backward),
+                            t_aten, t_ipex, t_aten / t_ipex))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,74 @@
+"""Latency of the scaled dot product attention of a BERT-base encoder layer in
+inference, the unfused ops against ipex.multi_head_attention.
+
+The query, key and value projections are batch x seq x 768 with 12 heads of
+64. The unfused path splits the heads with view and permute, materializes the
+batch x 12 x seq x seq scores through matmul, div, the mask add and softmax,
+and multiplies the probabilities by the value heads. The fused kernel reads the
+heads in place and keeps the scores in tiles of 64 x 64.
+
+    python bench_attention.py --batch 1 8 --seq 128 384 512
+"""
+import argparse
+import math
+import time
+
+import torch
+import torch.nn.functional as F
+import intel_pytorch_extension as ipex
+
+HIDDEN = 768
+HEADS = 12
+HEAD_SIZE = HIDDEN // HEADS
+
+
+def aten_attention(q, k, v, mask):
+    def heads(x):
+        return x.view(x.size(0), x.size(1), HEADS, HEAD_SIZE).permute(0, 2, 1, 3)
+    scores = torch.matmul(heads(q), heads(k).transpose(-1, -2)) / math.sqrt(HEAD_SIZE)
+    probs = F.softmax(scores + mask, dim=-1)
+    context = torch.matmul(probs, heads(v)).permute(0, 2, 1, 3).contiguous()
+    return context.view(q.size(0), q.size(1), HIDDEN)
+
+
+def ipex_attention(q, k, v, mask):
+    return ipex.multi_head_attention(q, k, v, HEADS, mask)
+
+
+def bench(fn, warmup, iters):
+    for _ in range(warmup):
+        fn()
+    start = time.time()
+    for _ in range(iters):
+        fn()
+    return (time.time() - start) / iters * 1000
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--batch', type=int, nargs='+', default=[1, 8])
+    parser.add_argument('--seq', type=int, nargs='+', default=[128, 384, 512])
+    parser.add_argument('--warmup', type=int, default=5)
+    parser.add_argument('--iters', type=int, default=50)
+    args = parser.parse_args()
+    ipex.core.enable_auto_dnnl()
+
+    print('threads {}'.format(torch.get_num_threads()))
+    print('{:>6} {:>6} {:>6} {:>10} {:>10} {:>8} {:>10}'.format(
+        'dtype', 'batch', 'seq', 'aten(ms)', 'ipex(ms)', 'speedup', 'max err'))
+    with torch.no_grad():
+        for dtype in [torch.float, torch.bfloat16]:
+            for batch in args.batch:
+                for seq in args.seq:
+                    q, k, v = [torch.randn(batch, seq, HIDDEN).to(dtype).to(ipex.DEVICE) for _ in range(3)]
+                    mask = ((1.0 - (torch.rand(batch, 1, 1, seq) > 0.1).float()) * -10000.0).to(ipex.DEVICE)
+                    ref = aten_attention(q, k, v, mask).float()
+                    err = (ipex_attention(q, k, v, mask).float() - ref).abs().max().item()
+                    t_aten = bench(lambda: aten_attention(q, k, v, mask), args.warmup, args.iters)
+                    t_ipex = bench(lambda: ipex_attention(q, k, v, mask), args.warmup, args.iters)
+                    print('{:>6} {:>6} {:>6} {:>10.3f} {:>10.3f} {:>8.2f} {:>10.4f}'.format(
+                        str(dtype).split('.')[-1], batch, seq, t_aten, t_ipex, t_aten / t_ipex, err))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,82 @@
+"""Memory and time of the dropouts of a BERT-base encoder layer in training,
+aten dropout against the bit-mask dropout of the extension.
+
+A layer runs three dropouts: on the attention probabilities (batch x 12 x
+seq x seq), and on the attention output and on the layer output (batch x seq
+x 768), each of the last two followed by the residual add. aten keeps a mask of
+the input data type for the backward, 4 bytes per element in fp32, the
+extension keeps 1 bit per element and fuses the residual adds with
+ipex.dropout_add.
+
+    python bench_dropout.py --batch 8 32 --seq 128 384
+"""
+import argparse
+import time
+
+import torch
+import torch.nn.functional as F
+import intel_pytorch_extension as ipex
+
+HIDDEN = 768
+HEADS = 12
+P = 0.1
+
+
+def aten_layer(probs, attn, attn_res, out, out_res):
+    y0 = torch.dropout(probs, P, True)
+    y1 = torch.dropout(attn, P, True) + attn_res
+    y2 = torch.dropout(out, P, True) + out_res
+    return y0, y1, y2
+
+
+def ipex_layer(probs, attn, attn_res, out, out_res):
+    y0 = F.dropout(probs, P, True)
+    y1 = ipex.dropout_add(attn, attn_res, P)
+    y2 = ipex.dropout_add(out, out_res, P)
+    return y0, y1, y2
+
+
+def make_inputs(batch, seq, dtype, device):
+    shapes = [(batch, HEADS, seq, seq)] + [(batch, seq, HIDDEN)] * 4
+    return [torch.randn(s).to(dtype).to(device).requires_grad_() for s in shapes]
+
+
+def bench(layer, inputs, warmup, iters):
+    def step():
+        outputs = layer(*inputs)
+        torch.autograd.backward(outputs, [torch.ones_like(o) for o in outputs])
+    for _ in range(warmup):
+        step()
+    start = time.time()
+    for _ in range(iters):
+        step()
+    return (time.time() - start) / iters * 1000
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--batch', type=int, nargs='+', default=[8, 32])
+    parser.add_argument('--seq', type=int, nargs='+', default=[128, 384])
+    parser.add_argument('--warmup', type=int, default=5)
+    parser.add_argument('--iters', type=int, default=20)
+    args = parser.parse_args()
+    ipex.core.enable_auto_dnnl()
+
+    print('threads {}'.format(torch.get_num_threads()))
+    print('{:>6} {:>6} {:>6} {:>12} {:>12} {:>10} {:>10} {:>8}'.format(
+        'dtype', 'batch', 'seq', 'aten mask', 'ipex mask', 'aten(ms)', 'ipex(ms)', 'speedup'))
+    for dtype in [torch.float, torch.bfloat16]:
+        for batch in args.batch:
+            for seq in args.seq:
+                numel = batch * seq * (HEADS * seq + 2 * HIDDEN)
+                aten_mask = numel * torch.tensor([], dtype=dtype).element_size()
+                ipex_mask = (batch * HEADS * seq * seq + 7) // 8 + 2 * ((batch * seq * HIDDEN + 7) // 8)
+                t_aten = bench(aten_layer, make_inputs(batch, seq, dtype, 'cpu'), args.warmup, args.iters)
+                t_ipex = bench(ipex_layer, make_inputs(batch, seq, dtype, ipex.DEVICE), args.warmup, args.iters)
+                print('{:>6} {:>6} {:>6} {:>10.1f}MB {:>10.1f}MB {:>10.3f} {:>10.3f} {:>8.2f}'.format(
+                    str(dtype).split('.')[-1], batch, seq, aten_mask / 2**20, ipex_mask / 2**20,
+                    t_aten, t_ipex, t_aten / t_ipex))
+
+
+if __name__ == '__main__':
+    main()
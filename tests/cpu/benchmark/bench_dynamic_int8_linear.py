@@ -0,0 +1,84 @@
+"""Latency of the linear layers of a BERT-base encoder layer in fp32, bf16
+auto mixed precision and dynamic int8 (ipex.quantize_dynamic).
+
+The layer runs the four 768x768 attention projections, the 768x3072
+intermediate linear fused with gelu by the jit and the 3072x768 output
+linear, on batch x seq tokens. The attention itself and the layer norms are
+left out, they are the same in the three modes.
+
+    python bench_dynamic_int8_linear.py --batch 1 8 --seq 32 128 384
+"""
+import argparse
+import copy
+import time
+
+import torch
+import torch.nn as nn
+import intel_pytorch_extension as ipex
+
+HIDDEN = 768
+INTERMEDIATE = 3072
+
+
+class BertLayerLinears(nn.Module):
+    def __init__(self):
+        super(BertLayerLinears, self).__init__()
+        self.query = nn.Linear(HIDDEN, HIDDEN)
+        self.key = nn.Linear(HIDDEN, HIDDEN)
+        self.value = nn.Linear(HIDDEN, HIDDEN)
+        self.attention_output = nn.Linear(HIDDEN, HIDDEN)
+        self.intermediate = nn.Linear(HIDDEN, INTERMEDIATE)
+        self.output = nn.Linear(INTERMEDIATE, HIDDEN)
+
+    def forward(self, x):
+        h = self.query(x) + self.key(x) + self.value(x)
+        h = self.attention_output(h)
+        return self.output(nn.functional.gelu(self.intermediate(h)))
+
+
+def bench(fn, warmup, iters):
+    for _ in range(warmup):
+        fn()
+    start = time.time()
+    for _ in range(iters):
+        fn()
+    return (time.time() - start) / iters * 1000
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--batch', type=int, nargs='+', default=[1, 8])
+    parser.add_argument('--seq', type=int, nargs='+', default=[32, 128, 384])
+    parser.add_argument('--warmup', type=int, default=5)
+    parser.add_argument('--iters', type=int, default=50)
+    args = parser.parse_args()
+
+    model = BertLayerLinears().eval().to(ipex.DEVICE)
+    fp32 = torch.jit.script(model)
+    # bf16 auto mixed precision converts the weights in place
+    bf16 = torch.jit.script(copy.deepcopy(model))
+    int8 = torch.jit.script(ipex.quantize_dynamic(copy.deepcopy(model)))
+    bf16_conf = ipex.AmpConf(torch.bfloat16)
+
+    def run_bf16(x):
+        with ipex.AutoMixPrecision(bf16_conf):
+            bf16(x)
+
+    print('threads {}'.format(torch.get_num_threads()))
+    print('{:>6} {:>6} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}'.format(
+        'batch', 'seq', 'fp32(ms)', 'bf16(ms)', 'int8(ms)', 'vs fp32', 'vs bf16', 'max err'))
+    with torch.no_grad():
+        for batch in args.batch:
+            for seq in args.seq:
+                x = torch.randn(batch, seq, HIDDEN).to(ipex.DEVICE)
+                ref = fp32(x)
+                err = (int8(x) - ref).abs().max().item() / ref.abs().max().item()
+                t_fp32 = bench(lambda: fp32(x), args.warmup, args.iters)
+                t_bf16 = bench(lambda: run_bf16(x), args.warmup, args.iters)
+                t_int8 = bench(lambda: int8(x), args.warmup, args.iters)
+                print('{:>6} {:>6} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.2f} {:>10.2f} {:>10.4f}'.format(
+                    batch, seq, t_fp32, t_bf16, t_int8, t_fp32 / t_int8, t_bf16 / t_int8, err))
+
+
+if __name__ == '__main__':
+    main()
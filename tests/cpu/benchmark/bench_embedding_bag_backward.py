@@ -0,0 +1,88 @@
+"""Benchmark of the dense embedding_bag (sum) backward.
+
+Compares, over a range of table sizes and Zipf skews of the lookup
+distribution, the forward + backward of stock PyTorch CPU and of IPEX, and
+their backward alone, run on the graph of a single forward.
+
+    python bench_embedding_bag_backward.py --batch-size 2048 --pooling 64
+"""
+import argparse
+import time
+
+import torch
+import torch.nn as nn
+import intel_pytorch_extension as ipex
+
+
+def zipf_indices(num_rows, num_lookups, alpha):
+    if alpha == 0:
+        return torch.randint(0, num_rows, (num_lookups,), dtype=torch.long)
+    ranks = torch.arange(1, num_rows + 1, dtype=torch.double)
+    probs = ranks.pow(-alpha)
+    indices = torch.multinomial(probs / probs.sum(), num_lookups, replacement=True)
+    # scatter the hot rows over the table instead of packing them at the front
+    return torch.randperm(num_rows)[indices]
+
+
+def bench(emb, indices, offsets, grad, warmup, iters):
+    for _ in range(warmup):
+        emb.weight.grad = None
+        emb(indices, offsets).backward(grad)
+    start = time.time()
+    for _ in range(iters):
+        emb.weight.grad = None
+        emb(indices, offsets).backward(grad)
+    return (time.time() - start) / iters * 1000
+
+
+def bench_backward(emb, indices, offsets, grad, warmup, iters):
+    out = emb(indices, offsets)
+    for _ in range(warmup):
+        emb.weight.grad = None
+        out.backward(grad, retain_graph=True)
+    start = time.time()
+    for _ in range(iters):
+        emb.weight.grad = None
+        out.backward(grad, retain_graph=True)
+    return (time.time() - start) / iters * 1000
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--batch-size', type=int, default=2048)
+    parser.add_argument('--pooling', type=int, default=64)
+    parser.add_argument('--dim', type=int, default=128)
+    parser.add_argument('--rows', type=int, nargs='+', default=[10000, 100000, 1000000, 10000000])
+    parser.add_argument('--alpha', type=float, nargs='+', default=[0, 0.8, 1.05, 1.2])
+    parser.add_argument('--dtype', choices=['float', 'bfloat16'], default='float')
+    parser.add_argument('--warmup', type=int, default=5)
+    parser.add_argument('--iters', type=int, default=20)
+    args = parser.parse_args()
+
+    num_lookups = args.batch_size * args.pooling
+    offsets = torch.arange(0, num_lookups, args.pooling, dtype=torch.long)
+    print('lookups {}  dim {}  dtype {}  threads {}'.format(
+        num_lookups, args.dim, args.dtype, torch.get_num_threads()))
+    print('{:>10} {:>6} {:>12} {:>12} {:>8} {:>12} {:>12} {:>8}'.format(
+        'rows', 'alpha', 'cpu(ms)', 'ipex(ms)', 'speedup', 'cpu bw(ms)', 'ipex bw(ms)', 'speedup'))
+    for rows in args.rows:
+        cpu_emb = nn.EmbeddingBag(rows, args.dim, mode='sum', sparse=False)
+        ipex_emb = nn.EmbeddingBag(rows, args.dim, mode='sum', sparse=False).to(ipex.DEVICE)
+        if args.dtype == 'bfloat16':
+            ipex_emb = ipex_emb.bfloat16()
+        for alpha in args.alpha:
+            indices = zipf_indices(rows, num_lookups, alpha)
+            grad = torch.randn(args.batch_size, args.dim)
+            cpu_ms = bench(cpu_emb, indices, offsets, grad, args.warmup, args.iters)
+            ipex_indices = indices.to(ipex.DEVICE)
+            ipex_offsets = offsets.to(ipex.DEVICE)
+            ipex_grad = grad.to(ipex.DEVICE).to(ipex_emb.weight.dtype)
+            ipex_ms = bench(ipex_emb, ipex_indices, ipex_offsets, ipex_grad, args.warmup, args.iters)
+            cpu_bw_ms = bench_backward(cpu_emb, indices, offsets, grad, args.warmup, args.iters)
+            ipex_bw_ms = bench_backward(ipex_emb, ipex_indices, ipex_offsets, ipex_grad, args.warmup, args.iters)
+            print('{:>10} {:>6} {:>12.3f} {:>12.3f} {:>8.2f} {:>12.3f} {:>12.3f} {:>8.2f}'.format(
+                rows, alpha, cpu_ms, ipex_ms, cpu_ms / ipex_ms, cpu_bw_ms, ipex_bw_ms, cpu_bw_ms / ipex_bw_ms))
+
+
+if __name__ == '__main__':
+    main()
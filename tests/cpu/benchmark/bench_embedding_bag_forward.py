@@ -0,0 +1,79 @@
+"""Benchmark of the embedding_bag (sum) forward.
+
+Sweeps the software prefetch distance of the IPEX kernel, with and without
+a hot row cache built from the lookups themselves, over table sizes and Zipf
+skews of the lookup distribution. A distance of 0 disables prefetching.
+
+    python bench_embedding_bag_forward.py --distance 0 2 4 8 16 32 --hot-rows 4096
+"""
+import argparse
+import time
+
+import torch
+import torch.nn as nn
+import intel_pytorch_extension as ipex
+
+
+def zipf_indices(num_rows, num_lookups, alpha):
+    if alpha == 0:
+        return torch.randint(0, num_rows, (num_lookups,), dtype=torch.long)
+    ranks = torch.arange(1, num_rows + 1, dtype=torch.double)
+    probs = ranks.pow(-alpha)
+    indices = torch.multinomial(probs / probs.sum(), num_lookups, replacement=True)
+    # scatter the hot rows over the table instead of packing them at the front
+    return torch.randperm(num_rows)[indices]
+
+
+def bench(emb, indices, offsets, warmup, iters):
+    with torch.no_grad():
+        for _ in range(warmup):
+            emb(indices, offsets)
+        start = time.time()
+        for _ in range(iters):
+            emb(indices, offsets)
+    return (time.time() - start) / iters * 1000
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--batch-size', type=int, default=2048)
+    parser.add_argument('--pooling', type=int, default=64)
+    parser.add_argument('--dim', type=int, default=128)
+    parser.add_argument('--rows', type=int, nargs='+', default=[100000, 1000000, 10000000])
+    parser.add_argument('--alpha', type=float, nargs='+', default=[0, 1.05, 1.2])
+    parser.add_argument('--distance', type=int, nargs='+', default=[0, 1, 2, 4, 8, 16, 32])
+    parser.add_argument('--hot-rows', type=int, default=0,
+                        help='size of the hot row cache, 0 runs without it')
+    parser.add_argument('--dtype', choices=['float', 'bfloat16'], default='float')
+    parser.add_argument('--warmup', type=int, default=5)
+    parser.add_argument('--iters', type=int, default=20)
+    args = parser.parse_args()
+
+    num_lookups = args.batch_size * args.pooling
+    offsets = torch.arange(0, num_lookups, args.pooling, dtype=torch.long).to(ipex.DEVICE)
+    default_distance = ipex.core.get_embedding_bag_prefetch_distance()
+    print('lookups {}  dim {}  dtype {}  threads {}  hot rows {}'.format(
+        num_lookups, args.dim, args.dtype, torch.get_num_threads(), args.hot_rows))
+    print('{:>10} {:>6} {:>9} {:>12} {:>10}'.format('rows', 'alpha', 'distance', 'ipex(ms)', 'hit rate'))
+    for rows in args.rows:
+        emb = nn.EmbeddingBag(rows, args.dim, mode='sum').to(ipex.DEVICE)
+        if args.dtype == 'bfloat16':
+            emb = emb.bfloat16()
+        for alpha in args.alpha:
+            indices = zipf_indices(rows, num_lookups, alpha).to(ipex.DEVICE)
+            if args.hot_rows > 0:
+                ipex.core.enable_embedding_bag_hot_row_cache(emb.weight, indices, args.hot_rows)
+            for distance in args.distance:
+                ipex.core.set_embedding_bag_prefetch_distance(distance)
+                ms = bench(emb, indices, offsets, args.warmup, args.iters)
+                hit_rate = '-'
+                if args.hot_rows > 0:
+                    stats = ipex.core.get_embedding_bag_hot_row_cache_stats(emb.weight)
+                    hit_rate = '{:.3f}'.format(stats['hits'] / max(stats['hits'] + stats['misses'], 1))
+                print('{:>10} {:>6} {:>9} {:>12.3f} {:>10}'.format(rows, alpha, distance, ms, hit_rate))
+            ipex.core.disable_embedding_bag_hot_row_cache(emb.weight)
+    ipex.core.set_embedding_bag_prefetch_distance(default_distance)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,84 @@
+"""Latency of ipex.nms (bitmask kernel) against the previous serial kernel.
+
+The default cases follow the box counts seen in inference: SSD-ResNet34
+runs NMS with bias 0 on at most 200 boxes per class, or on all 15130 anchors
+without top-k, and MaskRCNN runs it with bias 1 on the RPN proposals (1000
+per FPN level, up to a few thousands per image) and on the box head outputs.
+
+    python bench_nms.py --boxes 200 1000 15130 --bias 0 1
+
+The SSD post-processing (batch_score_nms over 15130 boxes and 81 classes)
+is timed per image and batched with batch_score_nms_padded.
+"""
+import argparse
+import time
+
+import torch
+import intel_pytorch_extension as ipex
+
+CASES = [
+    ('ssd per class', 200, 0., 0.5),
+    ('ssd anchors', 15130, 0., 0.5),
+    ('maskrcnn box head', 1000, 1., 0.5),
+    ('maskrcnn rpn level', 2000, 1., 0.7),
+    ('maskrcnn rpn image', 12000, 1., 0.7),
+]
+
+
+def random_boxes(n, size):
+    xy = torch.rand(n, 2) * size
+    wh = torch.rand(n, 2) * size / 4 + 1
+    return torch.cat([xy, xy + wh], dim=1), torch.rand(n)
+
+
+def bench(fn, warmup, iters):
+    for _ in range(warmup):
+        fn()
+    start = time.time()
+    for _ in range(iters):
+        fn()
+    return (time.time() - start) / iters * 1000
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--boxes', type=int, nargs='+', default=None,
+                        help='box counts to run instead of the default cases')
+    parser.add_argument('--bias', type=float, nargs='+', default=[0., 1.])
+    parser.add_argument('--threshold', type=float, default=0.5)
+    parser.add_argument('--image-size', type=float, default=800)
+    parser.add_argument('--ssd-batch', type=int, nargs='+', default=[1, 16])
+    parser.add_argument('--warmup', type=int, default=5)
+    parser.add_argument('--iters', type=int, default=20)
+    args = parser.parse_args()
+
+    cases = CASES
+    if args.boxes is not None:
+        cases = [('custom', n, bias, args.threshold) for n in args.boxes for bias in args.bias]
+
+    print('threads {}'.format(torch.get_num_threads()))
+    print('{:>20} {:>7} {:>5} {:>10} {:>12} {:>12} {:>8}'.format(
+        'case', 'boxes', 'bias', 'threshold', 'serial(ms)', 'bitmask(ms)', 'speedup'))
+    for name, n, bias, threshold in cases:
+        dets, scores = random_boxes(n, args.image_size)
+        dets, scores = dets.to(ipex.DEVICE), scores.to(ipex.DEVICE)
+        keep = ipex.nms(dets, scores, threshold, bias)
+        assert torch.equal(keep.to('cpu'), ipex.core._nms_serial(dets, scores, threshold, bias).to('cpu'))
+        serial = bench(lambda: ipex.core._nms_serial(dets, scores, threshold, bias), args.warmup, args.iters)
+        bitmask = bench(lambda: ipex.nms(dets, scores, threshold, bias), args.warmup, args.iters)
+        print('{:>20} {:>7} {:>5} {:>10} {:>12.3f} {:>12.3f} {:>8.2f}'.format(
+            name, n, bias, threshold, serial, bitmask, serial / bitmask))
+
+    print('\n{:>10} {:>16} {:>16}'.format('ssd batch', 'per image(ms)', 'padded(ms)'))
+    for batch in args.ssd_batch:
+        dets, _ = random_boxes(batch * 15130, 1.)
+        dets = dets.view(batch, 15130, 4).to(ipex.DEVICE)
+        scores = torch.softmax(torch.randn(batch, 15130, 81) * 4, dim=-1).to(ipex.DEVICE)
+        per_image = bench(lambda: [ipex.batch_score_nms(dets[b], scores[b], 0.5) for b in range(batch)],
+                          args.warmup, args.iters)
+        padded = bench(lambda: ipex.batch_score_nms_padded(dets, scores, 0.5), args.warmup, args.iters)
+        print('{:>10} {:>16.3f} {:>16.3f}'.format(batch, per_image, padded))
+
+
+if __name__ == '__main__':
+    main()
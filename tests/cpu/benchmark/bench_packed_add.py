@@ -0,0 +1,59 @@
+"""Microbenchmark of the sparse branch of packed_add_ (bf16 split SGD).
+
+Reports the update throughput in rows/s and in GB/s of touched weight rows
+(top half, bottom half and gradient) for DLRM-like sparse gradients.
+
+    python bench_packed_add.py --rows 1000000 --nnz 204800 --dim 128
+"""
+import argparse
+import time
+
+import torch
+import intel_pytorch_extension as ipex
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--rows', type=int, nargs='+', default=[100000, 1000000, 10000000])
+    parser.add_argument('--nnz', type=int, default=204800)
+    parser.add_argument('--dim', type=int, default=128)
+    parser.add_argument('--alpha', type=float, nargs='+', default=[0, 1.05])
+    parser.add_argument('--coalesce', action='store_true',
+                        help='coalesce the gradient before the update')
+    parser.add_argument('--warmup', type=int, default=5)
+    parser.add_argument('--iters', type=int, default=50)
+    args = parser.parse_args()
+
+    print('nnz {}  dim {}  threads {}'.format(args.nnz, args.dim, torch.get_num_threads()))
+    print('{:>10} {:>6} {:>10} {:>12} {:>10}'.format('rows', 'alpha', 'time(ms)', 'Mrows/s', 'GB/s'))
+    for rows in args.rows:
+        top_half = torch.zeros(rows, args.dim, dtype=torch.bfloat16).to(ipex.DEVICE)
+        bot_half = torch.zeros(rows, args.dim, dtype=torch.bfloat16).to(ipex.DEVICE)
+        for alpha in args.alpha:
+            if alpha == 0:
+                indices = torch.randint(0, rows, (args.nnz,))
+            else:
+                probs = torch.arange(1, rows + 1, dtype=torch.double).pow(-alpha)
+                indices = torch.multinomial(probs / probs.sum(), args.nnz, replacement=True)
+            values = torch.randn(args.nnz, args.dim).bfloat16()
+            grad = torch.sparse_coo_tensor(indices.view(1, -1), values, (rows, args.dim))
+            if args.coalesce:
+                grad = grad.coalesce()
+            grad = grad.to(ipex.DEVICE)
+
+            for _ in range(args.warmup):
+                ipex.core.packed_add_(top_half, bot_half, grad, -0.01)
+            start = time.time()
+            for _ in range(args.iters):
+                ipex.core.packed_add_(top_half, bot_half, grad, -0.01)
+            elapsed = (time.time() - start) / args.iters
+
+            nnz = grad._nnz()
+            # read + write of both halves, read of the gradient row
+            bytes_moved = nnz * args.dim * 2 * 5
+            print('{:>10} {:>6} {:>10.3f} {:>12.2f} {:>10.2f}'.format(
+                rows, alpha, elapsed * 1000, nnz / elapsed / 1e6, bytes_moved / elapsed / 1e9))
+
+
+if __name__ == '__main__':
+    main()
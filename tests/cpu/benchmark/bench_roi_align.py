@@ -0,0 +1,82 @@
+"""ROIAlign training step (forward + backward) with both backward policies.
+
+The backward is run with each thread owning whole planes of the gradient
+("planes"), with per-thread gradient copies reduced at the end ("private")
+and with the policy picked by the ROI-count to feature-size ratio ("auto").
+The default cases are the MaskRCNN heads on FPN levels at batch 2 (512
+sampled proposals per image for the box head at 7x7, the positives for the
+mask head at 14x14) and small-map, many-ROI cases where the private copies
+are meant to win.
+
+    python bench_roi_align.py --channels-last
+"""
+import argparse
+import time
+
+import torch
+import intel_pytorch_extension as ipex
+
+# name, batch, channels, height, width, spatial scale, rois, pooled size
+CASES = [
+    ('box head P2', 2, 256, 200, 336, 1 / 4., 1024, 7),
+    ('box head P4', 2, 256, 50, 84, 1 / 16., 1024, 7),
+    ('box head P5', 2, 256, 25, 42, 1 / 32., 1024, 7),
+    ('mask head P3', 2, 256, 100, 168, 1 / 8., 128, 14),
+    ('many rois 14x14 map', 1, 256, 14, 14, 1 / 16., 2000, 7),
+    ('few channels', 2, 8, 64, 64, 1 / 4., 500, 7),
+]
+
+
+def random_rois(n, batch, height, width, spatial_scale):
+    size = torch.tensor([width, height]) / spatial_scale
+    xy = torch.rand(n, 2) * size * 0.8
+    wh = torch.rand(n, 2) * size * 0.3 + 4
+    batch_ind = torch.randint(0, batch, (n, 1)).float()
+    return torch.cat([batch_ind, xy, xy + wh], dim=1)
+
+
+def bench(fn, warmup, iters):
+    for _ in range(warmup):
+        fn()
+    start = time.time()
+    for _ in range(iters):
+        fn()
+    return (time.time() - start) / iters * 1000
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--channels-last', action='store_true')
+    parser.add_argument('--bf16', action='store_true')
+    parser.add_argument('--sampling-ratio', type=int, default=2)
+    parser.add_argument('--warmup', type=int, default=3)
+    parser.add_argument('--iters', type=int, default=10)
+    args = parser.parse_args()
+
+    memory_format = torch.channels_last if args.channels_last else torch.contiguous_format
+    dtype = torch.bfloat16 if args.bf16 else torch.float
+    print('threads {}, {}, {}'.format(torch.get_num_threads(), memory_format, dtype))
+    print('{:>20} {:>10} {:>10} {:>10} {:>10}'.format('case', 'forward', 'planes', 'private', 'auto'))
+    for name, batch, channels, height, width, scale, n, pooled in CASES:
+        feature = torch.randn(batch, channels, height, width).to(dtype).to(ipex.DEVICE)
+        feature = feature.contiguous(memory_format=memory_format)
+        rois = random_rois(n, batch, height, width, scale).to(ipex.DEVICE)
+
+        def forward():
+            return ipex.core.roi_align_forward(feature, rois, scale, pooled, pooled, args.sampling_ratio)
+
+        grad = forward().clone().uniform_()
+
+        def step(policy):
+            forward()
+            return ipex.core._roi_align_backward_with_policy(
+                grad, rois, scale, pooled, pooled, batch, channels, height, width,
+                args.sampling_ratio, policy)
+
+        t_fwd = bench(forward, args.warmup, args.iters)
+        times = [bench(lambda: step(p), args.warmup, args.iters) for p in ['planes', 'private', 'auto']]
+        print('{:>20} {:>8.2f}ms {:>8.2f}ms {:>8.2f}ms {:>8.2f}ms'.format(name, t_fwd, *times))
+
+
+if __name__ == '__main__':
+    main()
@@ -687,6 +687,107 @@ class TestGelu(TestCase):
                 self.assertTrue(ipex.core.is_bf16_dil_tensor(x_auto_mix_bf16.grad))
                 self.assertEqual(x_man_bf16.grad.float(), x_auto_mix_bf16.grad)
 
+class TestDropout(TestCase):
+    def test_dropout(self):
+        rand_seed = int(get_rand_seed())
+        print("{} rand sed: {}".format(sys._getframe().f_code.co_name, rand_seed))
+        # p = 0.5 scales by 2, which is exact in bf16
+        p = 0.5
+        x_cpu, _, x_auto_mix, x_man_bf16, x_auto_mix_bf16 = _gen_tensor(rand_seed, (4, 33, 65), is_forward=False)
+        grad = torch.randn(4, 33, 65)
+
+        with AutoDNNL(True), AutoMixPrecision(False, train=True):
+            torch.manual_seed(rand_seed)
+            res_man_bf16 = F.dropout(x_man_bf16, p)
+            self.assertEqual(res_man_bf16.dtype, torch.bfloat16)
+            kept = (res_man_bf16 != 0).float()
+            self.assertEqual(res_man_bf16.float(), x_man_bf16.float() * kept * 2)
+            res_man_bf16.backward(grad.to(device).bfloat16())
+            self.assertEqual(x_man_bf16.grad.float(), grad.bfloat16().float().to(device) * kept * 2)
+
+            # the mask only depends on the seed
+            torch.manual_seed(rand_seed)
+            res_fp32 = F.dropout(x_auto_mix, p)
+            self.assertEqual((res_fp32 != 0).float(), kept)
+
+            # BW train (input is bf16 dil tensor)
+            with AutoMixPrecision(True, train=True):
+                self.assertTrue(ipex.core.is_bf16_dil_tensor(x_auto_mix_bf16))
+                torch.manual_seed(rand_seed)
+                res_auto_mix_bf16 = F.dropout(x_auto_mix_bf16, p)
+                self.assertEqual(res_auto_mix_bf16.dtype, torch.float)
+                self.assertTrue(ipex.core.is_bf16_dil_tensor(res_auto_mix_bf16))
+                self.assertEqual(res_auto_mix_bf16, res_man_bf16.float())
+                res_auto_mix_bf16.backward(grad.to(device))
+                self.assertEqual(x_auto_mix_bf16.grad, grad.to(device) * kept * 2, 1e-2)
+
+    def test_dropout_add(self):
+        rand_seed = int(get_rand_seed())
+        print("{} rand sed: {}".format(sys._getframe().f_code.co_name, rand_seed))
+        p = 0.5
+        _, _, _, x_man_bf16, _ = _gen_tensor(rand_seed, (8, 128, 768), is_forward=False)
+        _, _, _, residual_man_bf16, _ = _gen_tensor(rand_seed + 1, (8, 128, 768), is_forward=False)
+
+        with AutoDNNL(True), AutoMixPrecision(False, train=True):
+            torch.manual_seed(rand_seed)
+            res = ipex.dropout_add(x_man_bf16, residual_man_bf16, p)
+            self.assertEqual(res.dtype, torch.bfloat16)
+            torch.manual_seed(rand_seed)
+            ref = F.dropout(x_man_bf16, p) + residual_man_bf16
+            # the fused op rounds to bf16 once, the reference twice: up to one
+            # bf16 ulp apart, 0.5 for the values in [64, 128)
+            self.assertEqual(res.float(), ref.float(), 1)
+
+class TestLayerNorm(TestCase):
+    def test_add_layer_norm(self):
+        rand_seed = int(get_rand_seed())
+        print("{} rand sed: {}".format(sys._getframe().f_code.co_name, rand_seed))
+        _, _, _, x_man_bf16, _ = _gen_tensor(rand_seed, (4, 32, 256), is_forward=False)
+        _, _, _, res_man_bf16, _ = _gen_tensor(rand_seed + 1, (4, 32, 256), is_forward=False)
+        m = torch.nn.LayerNorm(256)
+        m_man_bf16 = copy.deepcopy(m).to(device=device).to(torch.bfloat16)
+        grad = torch.randn(4, 32, 256)
+
+        x_ref = x_man_bf16.detach().float().cpu().requires_grad_()
+        res_ref = res_man_bf16.detach().float().cpu().requires_grad_()
+        y_ref = m(x_ref + res_ref)
+        y_ref.backward(grad)
+
+        with AutoDNNL(True), AutoMixPrecision(False, train=True):
+            y = ipex.add_layer_norm(x_man_bf16, res_man_bf16, [256], m_man_bf16.weight, m_man_bf16.bias, m.eps)
+            self.assertEqual(y.dtype, torch.bfloat16)
+            y.backward(grad.to(device).bfloat16())
+            # the statistics are accumulated in fp32 over the bf16 sum
+            self.assertEqual(y.float(), y_ref, 5e-2)
+            self.assertEqual(x_man_bf16.grad.float(), x_ref.grad, 1e-1)
+            self.assertEqual(res_man_bf16.grad.float(), res_ref.grad, 1e-1)
+
+class TestAttention(TestCase):
+    def test_multi_head_attention(self):
+        rand_seed = int(get_rand_seed())
+        print("{} rand sed: {}".format(sys._getframe().f_code.co_name, rand_seed))
+        torch.manual_seed(rand_seed)
+        B, S, H, D = 2, 80, 4, 64
+        q, k, v = [torch.randn(B, S, H * D).bfloat16().float() for _ in range(3)]
+        mask = (1.0 - (torch.rand(B, 1, 1, S) > 0.2).float()) * -10000.0
+        heads = lambda x: x.view(B, S, H, D).permute(0, 2, 1, 3)
+        scores = torch.matmul(heads(q), heads(k).transpose(-1, -2)) / math.sqrt(D) + mask
+        ref = torch.matmul(F.softmax(scores, dim=-1), heads(v)).permute(0, 2, 1, 3).reshape(B, S, H * D)
+
+        with AutoDNNL(True), torch.no_grad():
+            with AutoMixPrecision(False):
+                y = ipex.multi_head_attention(
+                    q.to(device).bfloat16(), k.to(device).bfloat16(), v.to(device).bfloat16(), H, mask.to(device))
+                self.assertEqual(y.dtype, torch.bfloat16)
+                self.assertEqual(y.float(), ref, 1e-2)
+
+            with AutoMixPrecision(True):
+                q_auto_mix, k_auto_mix, v_auto_mix = [x.to(device) for x in (q, k, v)]
+                y = ipex.multi_head_attention(q_auto_mix, k_auto_mix, v_auto_mix, H, mask.to(device))
+                self.assertEqual(y.dtype, torch.float)
+                self.assertTrue(ipex.core.is_bf16_dil_tensor(y))
+                self.assertEqual(y, ref, 1e-2)
+
 class TestShape(TestCase):
     def _check_tensor_shape(self, t1, t2):
         self.assertEqual(t1.size(), t2.size())
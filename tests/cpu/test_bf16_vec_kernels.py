@@ -0,0 +1,125 @@
+"""Tests of the runtime dispatched bf16 vector kernels.
+
+Every ISA variant the host can run is checked bit for bit against the scalar
+reference, and the scalar reference itself against numpy. bf16 values are
+passed around as int16 tensors holding the raw bits.
+"""
+import unittest
+
+import numpy as np
+import torch
+import intel_pytorch_extension as ipex
+from common_utils import TestCase
+
+LENGTHS = [1, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 1000]
+
+
+def to_bf16_bits(x):
+    # round to nearest even, quiet NaN
+    bits = x.numpy().view(np.uint32).astype(np.uint64)
+    rounded = (bits + 0x7fff + ((bits >> 16) & 1)) >> 16
+    nan = np.isnan(x.numpy())
+    rounded[nan] = (bits[nan] >> 16) | 0x40
+    return torch.from_numpy((rounded & 0xffff).astype(np.uint16).view(np.int16))
+
+
+def from_bf16_bits(x):
+    bits = x.numpy().view(np.uint16).astype(np.uint32) << 16
+    return torch.from_numpy(bits.view(np.float32))
+
+
+def random_fp32(n):
+    x = torch.randn(n) * 100
+    if n > 4:
+        x[0] = float('nan')
+        x[1] = float('-inf')
+        x[2] = 0.
+        x[3] = 1.00390625 + 1e-7
+    return x
+
+
+def random_bits(n):
+    return torch.randint(-2 ** 15, 2 ** 15, (n,), dtype=torch.int16)
+
+
+class TestBF16VecKernels(TestCase):
+    def run_kernel(self, isa, kernel, args, alpha=0.):
+        args = [a.clone() for a in args]
+        ipex.core.run_bf16_vec_kernel(isa, kernel, args, alpha)
+        return args
+
+    def isas(self):
+        isas = ipex.core.get_supported_bf16_vec_isas()
+        self.assertEqual(isas[0], 'scalar')
+        self.assertIn(ipex.core.get_bf16_vec_isa(), isas)
+        return isas
+
+    def test_scalar_reference(self):
+        for n in LENGTHS:
+            x = random_fp32(n)
+            out = self.run_kernel('scalar', 'fp32_to_bf16', [torch.zeros(n, dtype=torch.int16), x])[0]
+            self.assertTrue(torch.equal(out, to_bf16_bits(x)))
+
+            bits = to_bf16_bits(x)
+            out = self.run_kernel('scalar', 'bf16_to_fp32', [torch.zeros(n), bits])[0]
+            self.assertTrue(np.array_equal(out.numpy().view(np.uint32), from_bf16_bits(bits).numpy().view(np.uint32)))
+
+            finite = to_bf16_bits(torch.randn(n))
+            y = torch.randn(n)
+            out = self.run_kernel('scalar', 'add_fp32_bf16', [y, finite])[0]
+            self.assertEqual(out, y + from_bf16_bits(finite))
+
+            # the split fp32 master weight, top:bot, gets the update
+            w = torch.randn(n)
+            w_bits = w.numpy().view(np.uint32)
+            top = torch.from_numpy((w_bits >> 16).astype(np.uint16).view(np.int16))
+            bot = torch.from_numpy((w_bits & 0xffff).astype(np.uint16).view(np.int16))
+            g = torch.randn(n)
+            top, bot, _ = self.run_kernel('scalar', 'packed_bf16_add_fp32', [top, bot, g], alpha=-0.1)
+            packed = (top.numpy().view(np.uint16).astype(np.uint32) << 16) | bot.numpy().view(np.uint16)
+            self.assertEqual(torch.from_numpy(packed.view(np.float32)), w - 0.1 * g)
+
+    def check_same(self, isa, kernel, args, alpha=0.):
+        expected = self.run_kernel('scalar', kernel, args, alpha)
+        actual = self.run_kernel(isa, kernel, args, alpha)
+        for e, a in zip(expected, actual):
+            # compare the bits, NaN included
+            e, a = e.numpy().view(np.uint8), a.numpy().view(np.uint8)
+            self.assertTrue(np.array_equal(e, a), '{} {} len {}'.format(isa, kernel, len(e)))
+
+    def test_variants_match_scalar(self):
+        for isa in self.isas():
+            for n in LENGTHS:
+                x = random_fp32(n)
+                # arithmetic kernels get finite values, NaN payloads are not
+                # required to match
+                y = torch.randn(n) * 10
+                finite = to_bf16_bits(torch.randn(n) * 10)
+                self.check_same(isa, 'bf16_to_fp32', [torch.zeros(n), random_bits(n)])
+                self.check_same(isa, 'fp32_to_bf16', [torch.zeros(n, dtype=torch.int16), x])
+                self.check_same(isa, 'add_bf16', [finite, to_bf16_bits(y)])
+                self.check_same(isa, 'add_fp32', [torch.randn(n), y])
+                self.check_same(isa, 'add_fp32_bf16', [torch.randn(n), finite])
+                self.check_same(isa, 'move_bf16', [torch.zeros(n, dtype=torch.int16), random_bits(n)])
+                self.check_same(isa, 'move_fp32', [torch.zeros(n), x])
+                self.check_same(isa, 'zero_bf16', [random_bits(n)])
+                self.check_same(isa, 'zero_fp32', [torch.randn(n)])
+                self.check_same(isa, 'packed_bf16_add', [finite, random_bits(n), to_bf16_bits(y)], alpha=-0.01)
+                self.check_same(isa, 'packed_bf16_add_fp32', [finite, random_bits(n), y], alpha=-0.01)
+                self.check_same(isa, 'madd_fp32', [torch.randn(n), y], alpha=0.3)
+                self.check_same(isa, 'madd_fp32_bf16', [torch.randn(n), finite], alpha=0.3)
+
+    def test_kernels_leave_tail_alone(self):
+        # the masked tails must not write past the end of the row
+        for isa in self.isas():
+            for n in LENGTHS:
+                buf = torch.full((n + 16,), 7.)
+                ipex.core.run_bf16_vec_kernel(isa, 'zero_fp32', [buf[:n]], 0.)
+                self.assertEqual(buf[n:], torch.full((16,), 7.))
+                buf = torch.full((n + 32,), 7, dtype=torch.int16)
+                ipex.core.run_bf16_vec_kernel(isa, 'move_bf16', [buf[:n], random_bits(n)], 0.)
+                self.assertEqual(buf[n:], torch.full((32,), 7, dtype=torch.int16))
+
+
+if __name__ == '__main__':
+    test = unittest.main()
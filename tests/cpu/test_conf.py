@@ -49,5 +49,23 @@ class TestOptConf(TestCase):
         ipex.enable_jit_opt()
         self.assertTrue(ipex.get_jit_opt())
 
+    def test_primitive_cache(self):
+        import intel_pytorch_extension
+        capacity = ipex.get_primitive_cache_stats()['capacity']
+        ipex.clear_primitive_cache()
+        ipex.set_primitive_cache_capacity(2)
+        conv = torch.nn.Conv2d(1, 1, (3, 3)).to(device=intel_pytorch_extension.DEVICE)
+        with torch.no_grad():
+            for size in [7, 7, 8, 9]:
+                conv(torch.rand((1, 1, size, size)).to(device=intel_pytorch_extension.DEVICE))
+        stats = ipex.get_primitive_cache_stats()
+        self.assertEqual(stats['capacity'], 2)
+        self.assertEqual(stats['size'], 2)
+        self.assertEqual(stats['hits'], 1)
+        self.assertEqual(stats['misses'], 3)
+        self.assertEqual(stats['evictions'], 1)
+        ipex.clear_primitive_cache()
+        ipex.set_primitive_cache_capacity(capacity)
+
 if __name__ == '__main__':
     test = unittest.main()
@@ -41,5 +41,259 @@ class TestEMB(TestCase):
         self.assertEqual(cpu_emb.weight.grad.data._values(), dpcpp_emb.weight.grad.data._values().to('cpu'), 0.01)
         self.assertEqual(bf16_emb.weight.grad.data._values().dtype, torch.bfloat16)
 
+    def test_emb_dense_backward(self):
+        cpu_emb = nn.EmbeddingBag(1000, 33, mode='sum', sparse=False)
+        dpcpp_emb = copy.deepcopy(cpu_emb).to(ipex.DEVICE)
+        bf16_emb = copy.deepcopy(cpu_emb).to(ipex.DEVICE).bfloat16()
+        # skewed lookups with many duplicated rows across and within bags
+        cpu_input = torch.cat([torch.randint(0, 1000, (300,)), torch.randint(0, 4, (700,))])
+        cpu_input = cpu_input[torch.randperm(cpu_input.numel())]
+        cpu_offsets = torch.arange(0, 1000, 10)
+        dpcpp_input = cpu_input.clone().detach().to(ipex.DEVICE)
+        dpcpp_offsets = cpu_offsets.clone().detach().to(ipex.DEVICE)
+
+        grad = torch.randn(100, 33)
+        cpu_emb(cpu_input, cpu_offsets).backward(grad)
+        dpcpp_emb(dpcpp_input, dpcpp_offsets).backward(grad.to(ipex.DEVICE))
+        bf16_emb(dpcpp_input, dpcpp_offsets).float().backward(grad.to(ipex.DEVICE))
+
+        self.assertEqual(cpu_emb.weight.grad, dpcpp_emb.weight.grad.to('cpu'), 1e-4)
+        self.assertEqual(cpu_emb.weight.grad, bf16_emb.weight.grad.to('cpu').float(), 0.1)
+
+    def _test_emb_mode(self, mode, sparse, per_sample_weights=False):
+        cpu_emb = nn.EmbeddingBag(100, 33, mode=mode, sparse=sparse)
+        dpcpp_emb = copy.deepcopy(cpu_emb).to(ipex.DEVICE)
+        bf16_emb = copy.deepcopy(cpu_emb).to(ipex.DEVICE).bfloat16()
+        cpu_input = torch.randint(0, 100, (200,))
+        # bags of varying size including an empty one
+        cpu_offsets = torch.LongTensor([0, 1, 1, 7, 40, 41, 100, 150])
+        dpcpp_input = cpu_input.clone().detach().to(ipex.DEVICE)
+        dpcpp_offsets = cpu_offsets.clone().detach().to(ipex.DEVICE)
+
+        cpu_weights = dpcpp_weights = bf16_weights = None
+        if per_sample_weights:
+            cpu_weights = torch.randn(200, requires_grad=True)
+            dpcpp_weights = cpu_weights.clone().detach().to(ipex.DEVICE).requires_grad_()
+            bf16_weights = cpu_weights.clone().detach().to(ipex.DEVICE).bfloat16().requires_grad_()
+
+        cpu_out = cpu_emb(cpu_input, cpu_offsets, cpu_weights)
+        dpcpp_out = dpcpp_emb(dpcpp_input, dpcpp_offsets, dpcpp_weights)
+        bf16_out = bf16_emb(dpcpp_input, dpcpp_offsets, bf16_weights)
+        self.assertEqual(cpu_out, dpcpp_out.to('cpu'), 1e-5)
+        self.assertEqual(cpu_out, bf16_out.to('cpu').float(), 0.1)
+
+        grad = torch.randn(cpu_out.size())
+        cpu_out.backward(grad)
+        dpcpp_out.backward(grad.to(ipex.DEVICE))
+        bf16_out.float().backward(grad.to(ipex.DEVICE))
+
+        cpu_grad = cpu_emb.weight.grad.to_dense() if sparse else cpu_emb.weight.grad
+        dpcpp_grad = dpcpp_emb.weight.grad.to('cpu')
+        bf16_grad = bf16_emb.weight.grad.to('cpu').float()
+        if sparse:
+            dpcpp_grad = dpcpp_grad.to_dense()
+            bf16_grad = bf16_grad.to_dense()
+        self.assertEqual(cpu_grad, dpcpp_grad, 1e-4)
+        self.assertEqual(cpu_grad, bf16_grad, 0.1)
+        if per_sample_weights:
+            self.assertEqual(cpu_weights.grad, dpcpp_weights.grad.to('cpu'), 1e-4)
+            self.assertEqual(cpu_weights.grad, bf16_weights.grad.to('cpu').float(), 0.2)
+
+    def test_emb_mean(self):
+        self._test_emb_mode('mean', sparse=False)
+        self._test_emb_mode('mean', sparse=True)
+
+    def test_emb_max(self):
+        self._test_emb_mode('max', sparse=False)
+
+    def test_emb_max_bf16_backward_accumulation(self):
+        # thousands of bags win the same rows, a bf16 running sum would stall at 256
+        cpu_emb = nn.EmbeddingBag(2, 16, mode='max', sparse=False)
+        cpu_emb.weight.data = cpu_emb.weight.data.bfloat16().float()
+        bf16_emb = copy.deepcopy(cpu_emb).to(ipex.DEVICE).bfloat16()
+        cpu_input = torch.LongTensor([0, 1]).repeat(4096)
+        cpu_offsets = torch.arange(0, 8192, 2)
+        grad = torch.ones(4096, 16)
+
+        cpu_emb(cpu_input, cpu_offsets).backward(grad)
+        bf16_emb(cpu_input.to(ipex.DEVICE), cpu_offsets.to(ipex.DEVICE)).float().backward(grad.to(ipex.DEVICE))
+        self.assertEqual(cpu_emb.weight.grad, bf16_emb.weight.grad.to('cpu').float(), 4096 / 128)
+
+    def test_emb_per_sample_weights(self):
+        self._test_emb_mode('sum', sparse=False, per_sample_weights=True)
+        self._test_emb_mode('sum', sparse=True, per_sample_weights=True)
+
+    def _test_batched_emb(self, mode, sparse, dtype):
+        rows = [10, 1000, 37]
+        cpu_embs = [nn.EmbeddingBag(n, 16, mode=mode, sparse=sparse) for n in rows]
+        dpcpp_weights = [emb.weight.detach().clone().to(ipex.DEVICE).to(dtype).requires_grad_() for emb in cpu_embs]
+        cpu_inputs = [torch.randint(0, n, (50,)) for n in rows]
+        cpu_offsets = [torch.LongTensor([0, 3, 3, 20, 21, 49]) for _ in rows]
+
+        cpu_out = torch.cat([emb(i, o) for emb, i, o in zip(cpu_embs, cpu_inputs, cpu_offsets)], dim=1)
+        dpcpp_out = ipex.batched_embedding_bag(dpcpp_weights,
+                                               [i.to(ipex.DEVICE) for i in cpu_inputs],
+                                               [o.to(ipex.DEVICE) for o in cpu_offsets],
+                                               mode=mode, sparse=sparse)
+        prec = 1e-5 if dtype == torch.float else 0.1
+        self.assertEqual(cpu_out, dpcpp_out.to('cpu').float(), prec)
+
+        grad = torch.randn(cpu_out.size())
+        cpu_out.backward(grad)
+        dpcpp_out.float().backward(grad.to(ipex.DEVICE))
+        for emb, w in zip(cpu_embs, dpcpp_weights):
+            cpu_grad = emb.weight.grad.to_dense() if sparse else emb.weight.grad
+            dpcpp_grad = w.grad.to('cpu')
+            if sparse:
+                dpcpp_grad = dpcpp_grad.to_dense()
+            self.assertEqual(w.grad.dtype, dtype)
+            self.assertEqual(cpu_grad, dpcpp_grad.float(), prec)
+
+    def test_batched_emb(self):
+        for dtype in [torch.float, torch.bfloat16]:
+            self._test_batched_emb('sum', True, dtype)
+            self._test_batched_emb('sum', False, dtype)
+            self._test_batched_emb('mean', True, dtype)
+            self._test_batched_emb('mean', False, dtype)
+
+    def test_batched_emb_interaction(self):
+        weights = [torch.randn(100, 16).to(ipex.DEVICE) for _ in range(3)]
+        indices = [torch.randint(0, 100, (40,)).to(ipex.DEVICE) for _ in range(3)]
+        offsets = [torch.arange(0, 40, 5).to(ipex.DEVICE) for _ in range(3)]
+        dense = torch.randn(8, 16).to(ipex.DEVICE)
+        emb = ipex.batched_embedding_bag(weights, indices, offsets)
+        tables = [torch.nn.functional.embedding_bag(i, w, o, mode='sum') for w, i, o in zip(weights, indices, offsets)]
+        self.assertEqual(ipex.interaction(dense, emb), ipex.interaction(dense, *tables))
+
+    def _dequantize_rowwise(self, qweight, dim, bit_width):
+        qweight = qweight.to('cpu')
+        data_bytes = dim if bit_width == 8 else dim // 2
+        data = qweight[:, :data_bytes].long()
+        if bit_width == 4:
+            data = torch.stack([data & 0xF, data >> 4], dim=2).view(-1, dim)
+        scale_bias = torch.from_numpy(qweight[:, data_bytes:].contiguous().numpy().view('float32'))
+        return data.float() * scale_bias[:, 0:1] + scale_bias[:, 1:2]
+
+    def test_quantized_emb(self):
+        for bit_width in [8, 4]:
+            for mode in ['sum', 'mean']:
+                emb = nn.EmbeddingBag(1000, 70, mode=mode)
+                qemb = ipex.QuantizedEmbeddingBag.from_float(emb, bit_width)
+                ref_weight = self._dequantize_rowwise(qemb.qweight, 70, bit_width)
+                # quantization error is bounded by half a step of every row
+                self.assertEqual(ref_weight, emb.weight.detach(), (emb.weight.max() - emb.weight.min()).item() / (2 ** bit_width - 1))
+
+                input = torch.randint(0, 1000, (100,))
+                offsets = torch.LongTensor([0, 5, 5, 30, 99])
+                per_sample_weights = torch.randn(100) if mode == 'sum' else None
+                ref = torch.nn.functional.embedding_bag(input, ref_weight, offsets, mode=mode, per_sample_weights=per_sample_weights)
+                out = qemb(input.to(ipex.DEVICE), offsets.to(ipex.DEVICE),
+                           per_sample_weights.to(ipex.DEVICE) if per_sample_weights is not None else None)
+                self.assertEqual(ref, out.to('cpu'), 1e-4)
+
+    def test_emb_prefetch_and_hot_row_cache(self):
+        emb = nn.EmbeddingBag(1000, 33, mode='sum').to(ipex.DEVICE)
+        input = torch.cat([torch.randint(0, 1000, (100,)), torch.randint(0, 4, (300,))]).to(ipex.DEVICE)
+        offsets = torch.arange(0, 400, 7).to(ipex.DEVICE)
+        ref = torch.nn.functional.embedding_bag(input.to('cpu'), emb.weight.detach().to('cpu'), offsets.to('cpu'), mode='sum')
+
+        default_distance = ipex.core.get_embedding_bag_prefetch_distance()
+        for distance in [0, 1, 16]:
+            ipex.core.set_embedding_bag_prefetch_distance(distance)
+            self.assertEqual(ref, emb(input, offsets).to('cpu'), 1e-5)
+        ipex.core.set_embedding_bag_prefetch_distance(default_distance)
+
+        ipex.core.enable_embedding_bag_hot_row_cache(emb.weight, input, 4)
+        self.assertEqual(ref, emb(input, offsets).to('cpu'), 1e-5)
+        stats = ipex.core.get_embedding_bag_hot_row_cache_stats(emb.weight)
+        self.assertEqual(stats['rows'], 4)
+        self.assertEqual(stats['hits'] + stats['misses'], 400)
+        self.assertTrue(stats['hits'] >= 300)
+
+        # an in-place update of the table invalidates the cache
+        with torch.no_grad():
+            emb.weight.add_(1)
+        ref = torch.nn.functional.embedding_bag(input.to('cpu'), emb.weight.detach().to('cpu'), offsets.to('cpu'), mode='sum')
+        self.assertEqual(ref, emb(input, offsets).to('cpu'), 1e-5)
+        self.assertEqual(ipex.core.get_embedding_bag_hot_row_cache_stats(emb.weight)['hits'], stats['hits'])
+        ipex.core.disable_embedding_bag_hot_row_cache(emb.weight)
+        self.assertEqual(ipex.core.get_embedding_bag_hot_row_cache_stats(emb.weight)['rows'], 0)
+
+        # the cache of a freed table is dropped, a new table never inherits it,
+        # even when it is allocated at the same address
+        ipex.core.enable_embedding_bag_hot_row_cache(emb.weight, input, 4)
+        del emb
+        for _ in range(4):
+            weight = torch.randn(1000, 33).to(ipex.DEVICE)
+            self.assertEqual(ipex.core.get_embedding_bag_hot_row_cache_stats(weight)['rows'], 0)
+            ref = torch.nn.functional.embedding_bag(input.to('cpu'), weight.to('cpu'), offsets.to('cpu'), mode='sum')
+            self.assertEqual(ref, torch.nn.functional.embedding_bag(input, weight, offsets, mode='sum').to('cpu'), 1e-5)
+            del weight
+
+    def _test_emb_fused_update(self, fused_update, mode, dtype, hot_row_cache=False):
+        lr, eps = 0.1, 1e-8
+        ref_emb = nn.EmbeddingBag(100, 20, mode=mode)
+        emb = ipex.EmbeddingBag(100, 20, mode=mode, fused_update=fused_update, lr=lr, eps=eps)
+        emb.weight.data.copy_(ref_emb.weight.data)
+        emb = emb.to(ipex.DEVICE).to(dtype)
+        momentum = torch.zeros(100)
+        prec = 1e-4 if dtype == torch.float else 0.05
+        if hot_row_cache:
+            # the first update must drop the cache, later steps would read the old rows
+            ipex.core.enable_embedding_bag_hot_row_cache(emb.weight, torch.arange(5).to(ipex.DEVICE), 5)
+        for _ in range(3):
+            # duplicated rows within and across bags
+            input = torch.cat([torch.randint(0, 100, (30,)), torch.randint(0, 5, (30,))])
+            offsets = torch.LongTensor([0, 10, 10, 45])
+            grad = torch.randn(4, 20)
+
+            ref_emb.weight.grad = None
+            ref_out = ref_emb(input, offsets)
+            ref_out.backward(grad)
+            weight_grad = ref_emb.weight.grad
+            with torch.no_grad():
+                if fused_update == 'rowwise_adagrad':
+                    rows = input.unique()
+                    momentum[rows] += weight_grad[rows].pow(2).mean(1)
+                    ref_emb.weight[rows] -= lr * weight_grad[rows] / (momentum[rows].sqrt() + eps).unsqueeze(1)
+                else:
+                    ref_emb.weight -= lr * weight_grad
+
+            out = emb(input.to(ipex.DEVICE), offsets.to(ipex.DEVICE))
+            # the bags sum up to 35 rows, the bfloat16 outputs get a looser bound
+            self.assertEqual(ref_out.detach(), out.detach().to('cpu').float(), prec if dtype == torch.float else 0.2)
+            out.float().backward(grad.to(ipex.DEVICE))
+            self.assertTrue(emb.weight.grad is None)
+            if hot_row_cache:
+                self.assertEqual(ipex.core.get_embedding_bag_hot_row_cache_stats(emb.weight)['rows'], 0)
+        self.assertEqual(ref_emb.weight.data, emb.weight.data.to('cpu').float(), prec)
+        if fused_update == 'rowwise_adagrad':
+            self.assertEqual(momentum, emb.momentum.to('cpu'), prec)
+
+    def test_emb_fused_update(self):
+        for mode in ['sum', 'mean']:
+            self._test_emb_fused_update('sgd', mode, torch.float)
+            self._test_emb_fused_update('sgd', mode, torch.bfloat16)
+            self._test_emb_fused_update('split_sgd', mode, torch.bfloat16)
+            self._test_emb_fused_update('rowwise_adagrad', mode, torch.float)
+            self._test_emb_fused_update('sgd', mode, torch.float, hot_row_cache=True)
+            self._test_emb_fused_update('split_sgd', mode, torch.bfloat16, hot_row_cache=True)
+
+    def test_packed_add_sparse(self):
+        rows, dim = 1000, 35
+        # uncoalesced gradient with duplicated row ids
+        indices = torch.cat([torch.randint(0, rows, (500,)), torch.randint(0, 8, (500,))]).view(1, -1)
+        values = torch.randn(1000, dim).bfloat16()
+        grad = torch.sparse_coo_tensor(indices, values, (rows, dim))
+        top_half = torch.zeros(rows, dim, dtype=torch.bfloat16).to(ipex.DEVICE)
+        bot_half = torch.zeros(rows, dim, dtype=torch.bfloat16).to(ipex.DEVICE)
+        # packed_add_ writes the raw data and must drop the hot row cache itself
+        ipex.core.enable_embedding_bag_hot_row_cache(top_half, indices.view(-1).to(ipex.DEVICE), 8)
+        ipex.core.packed_add_(top_half, bot_half, grad.to(ipex.DEVICE), -0.1)
+        self.assertEqual(ipex.core.get_embedding_bag_hot_row_cache_stats(top_half)['rows'], 0)
+
+        expected = torch.zeros(rows, dim).index_add_(0, indices.view(-1), values.float()) * -0.1
+        self.assertEqual(expected, top_half.to('cpu').float(), 0.05)
+
 if __name__ == '__main__':
     test = unittest.main()
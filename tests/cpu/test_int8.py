@@ -69,6 +69,138 @@ class TestQuantizationConfigueTune(TestCase):
         self.assertTrue(ipex.core.is_fp32_dil_tensor(y))
         os.remove('configure.json')
 
+    def calibrate_scales(self, model, inputs, algorithm):
+        conf = ipex.AmpConf(torch.int8, calibration_algorithm=algorithm)
+        with ipex.AutoMixPrecision(conf, running_mode='calibration'):
+            for x in inputs:
+                model(x)
+        conf.save('configure.json')
+        with open('configure.json', 'r') as f:
+            data = json.load(f)
+        self.assertEqual(data[0]['algorithm'], algorithm)
+        return data[0]['inputs_scale'][0]
+
+    def test_histogram_calibration(self):
+        model = torch.nn.Linear(64, 32).float().to(device)
+        inputs = []
+        for i in range(4):
+            x = torch.randn(16, 64)
+            # a few outliers, clipped by kl and percentile
+            x[0, i] = 100.
+            inputs.append(x.to(device))
+
+        min_max_scale = self.calibrate_scales(copy.deepcopy(model), inputs, 'min_max')
+        self.assertAlmostEqual(min_max_scale, 127.5 / 100., places=4)
+        for algorithm in ['kl', 'percentile', 'percentile_99.9']:
+            scale = self.calibrate_scales(copy.deepcopy(model), inputs, algorithm)
+            self.assertGreater(scale, min_max_scale * 5)
+
+            conf = ipex.AmpConf(torch.int8, 'configure.json')
+            model_int8 = copy.deepcopy(model)
+            x = torch.randn(16, 64).to(device)
+            ref = model_int8(x)
+            with ipex.AutoMixPrecision(conf, running_mode='inference'):
+                y = model_int8(x)
+            self.assertTrue(ipex.core.is_int8_dil_tensor(y))
+            self.assertEqual(ref, y, prec=0.1)
+        os.remove('configure.json')
+
+        # the range grows by far more than the bins between two batches
+        inputs = [(torch.randn(16, 64) * 1e-30).to(device), (torch.randn(16, 64) * 1e30).to(device)]
+        for algorithm in ['kl', 'percentile']:
+            scale = self.calibrate_scales(copy.deepcopy(model), inputs, algorithm)
+            self.assertTrue(math.isfinite(scale) and scale > 0)
+        os.remove('configure.json')
+
+        with self.assertRaises(RuntimeError):
+            ipex.AmpConf(torch.int8, calibration_algorithm='entropy')
+        ipex.core.set_int8_calibration_algorithm('min_max')
+
+    def test_asymmetric_activation(self):
+        # mostly positive inputs, like the outputs of gelu
+        x = (torch.rand(8, 16, 14, 14) * 4 - 0.2).to(device)
+        conv = nn.Conv2d(16, 8, kernel_size=3, padding=1).float().to(device)
+        x_linear = (torch.rand(2, 10, 64) * 4 - 0.2).to(device)
+        linear = nn.Linear(64, 32).float().to(device)
+        for model, input in [(conv, x), (linear, x_linear)]:
+            ref = model(input)
+            conf = ipex.AmpConf(torch.int8, activation_qscheme='asymmetric')
+            with ipex.AutoMixPrecision(conf, running_mode='calibration'):
+                model(input)
+            conf.save('configure.json')
+            with open('configure.json', 'r') as f:
+                data = json.load(f)
+            self.assertEqual(data[0]['activation_qscheme'], 'asymmetric')
+            # 0.2 / 4 of the u8 range
+            self.assertEqual(data[0]['inputs_zero_point'], [13])
+            self.assertTrue(data[0]['inputs_uint8_used'][0])
+
+            conf = ipex.AmpConf(torch.int8, 'configure.json')
+            model_int8 = copy.deepcopy(model)
+            with ipex.AutoMixPrecision(conf, running_mode='inference'):
+                y = model_int8(input.clone())
+            self.assertTrue(ipex.core.is_int8_dil_tensor(y))
+            self.assertEqual(ref, y, prec=0.1)
+        os.remove('configure.json')
+        ipex.core.set_int8_activation_qscheme('symmetric')
+
+    def test_op_scopes(self):
+        model = nn.Sequential(nn.Linear(16, 32), nn.ReLU(), nn.Linear(32, 8)).float().to(device)
+        handles = ipex.int8_op_scopes(model)
+        x = torch.randn(4, 16).to(device)
+        conf = ipex.AmpConf(torch.int8)
+        with ipex.AutoMixPrecision(conf, running_mode='calibration'):
+            ref = model(x)
+        conf.save('configure.json')
+        with open('configure.json', 'r') as f:
+            data = json.load(f)
+        self.assertEqual([d['key'] for d in data], ['0/Linear.0', '1/Relu.0', '2/Linear.0'])
+
+        # a part of the model, the ops are found by their module and not by
+        # their position
+        conf = ipex.AmpConf(torch.int8, 'configure.json')
+        # the copy keeps the hooks
+        model_int8 = copy.deepcopy(model)
+        h = model[0](x)
+        with ipex.AutoMixPrecision(conf, running_mode='inference'):
+            y = model_int8[2](model_int8[1](h))
+        self.assertTrue(ipex.core.is_int8_dil_tensor(y))
+        self.assertEqual(ref, y, prec=0.1)
+        for handle in handles:
+            handle.remove()
+        os.remove('configure.json')
+
+    def test_dynamic_linear(self):
+        # inputs whose range varies from batch to batch
+        model = nn.Sequential(nn.Linear(64, 128), nn.ReLU(), nn.Linear(128, 32)).float().to(device)
+        xs = [(torch.randn(4, seq, 64) * r).to(device) for seq, r in [(7, 1), (19, 10), (3, 0.1)]]
+        refs = [model(x) for x in xs]
+        model_int8 = ipex.quantize_dynamic(copy.deepcopy(model))
+        for linear in [model_int8[0], model_int8[2]]:
+            self.assertTrue(ipex.core.is_dynamic_int8_weight(linear.weight))
+        for x, ref in zip(xs, refs):
+            y = model_int8(x)
+            self.assertFalse(ipex.core.is_int8_dil_tensor(y))
+            self.assertEqual(ref, y, prec=0.05 * ref.abs().max().item())
+
+        # the input scale is a runtime argument, a new range reuses the cached primitives
+        x = torch.randn(4, 7, 64).to(device)
+        model_int8(x)
+        misses = ipex.core.get_primitive_cache_stats()['misses']
+        for r in [0.1, 10, 1000]:
+            model_int8(x * r)
+        self.assertEqual(ipex.core.get_primitive_cache_stats()['misses'], misses)
+
+        # the fused linear + relu/gelu of the jit
+        for eltwise in [nn.ReLU(), nn.GELU()]:
+            model = nn.Sequential(nn.Linear(64, 128), eltwise).float().to(device)
+            x = torch.randn(5, 64).to(device)
+            ref = model(x)
+            model_int8 = torch.jit.script(ipex.quantize_dynamic(copy.deepcopy(model)))
+            with torch.no_grad():
+                y = model_int8(x)
+            self.assertEqual(ref, y, prec=0.05 * ref.abs().max().item())
+
 
 class TestQuantization(TestCase):
     def compare_fp32_int8(self, model, x):
@@ -150,6 +282,93 @@ class TestQuantization(TestCase):
             linear = torch.nn.Linear(in_features, out_features, bias=bias).float().to(device)
             self.compare_fp32_int8(linear, x)
 
+    def test_linear_sum(self):
+        # the jit fused linear + add (+ relu), accumulated into the int8 output
+        # of the other linear
+        class LinearSum(nn.Module):
+            def __init__(self):
+                super(LinearSum, self).__init__()
+                self.linear = nn.Linear(16, 32)
+                self.linear1 = nn.Linear(16, 32)
+
+            def forward(self, x):
+                return self.linear(x) + self.linear1(x)
+
+        class LinearSumRelu(LinearSum):
+            def forward(self, x):
+                return F.relu(self.linear(x) + self.linear1(x))
+
+        ipex.core.enable_jit_opt()
+        x = torch.randn(8, 16, dtype=torch.float32).to(device)
+        for module, kind in [(LinearSum, "ipex::linear_sum"), (LinearSumRelu, "ipex::linear_sum_relu")]:
+            model = torch.jit.script(module().float().to(device).eval())
+            with torch.no_grad():
+                self.assertTrue(any(n.kind() == kind for n in model.graph_for(x).nodes()))
+                self.compare_fp32_int8(model, x)
+
+    def _rnn_output(self, rnn):
+        class RNNOutput(nn.Module):
+            def __init__(self, rnn):
+                super(RNNOutput, self).__init__()
+                self.rnn = rnn
+
+            def forward(self, x):
+                return self.rnn(x)[0]
+        return RNNOutput(rnn).eval()
+
+    def test_lstm(self):
+        for num_layers, bidirectional in itertools.product([1, 2], [False, True]):
+            x = torch.randn(5, 3, 10, dtype=torch.float32).to(device)
+            lstm = nn.LSTM(10, 20, num_layers=num_layers, bidirectional=bidirectional).float().to(device)
+            model = self._rnn_output(lstm)
+            with torch.no_grad():
+                # the fp32 inference prepacks the weights, the int8 one quantizes them from the packed buffer
+                ref = model(x)
+                self.compare_fp32_int8(model, x)
+                # the s8 weights are copies, the module keeps its fp32 weights
+                self.assertEqual(ref, model(x), prec=1e-5)
+
+    def test_attention(self):
+        # the heads of the quantized projections take the unfused attention ops
+        class Attention(nn.Module):
+            def __init__(self, hidden, heads):
+                super(Attention, self).__init__()
+                self.heads = heads
+                self.query = nn.Linear(hidden, hidden)
+                self.key = nn.Linear(hidden, hidden)
+                self.value = nn.Linear(hidden, hidden)
+
+            def forward(self, x):
+                return ipex.multi_head_attention(self.query(x), self.key(x), self.value(x), self.heads)
+
+        x = torch.randn(2, 50, 64, dtype=torch.float32).to(device)
+        model = Attention(64, 4).float().to(device).eval()
+        with torch.no_grad():
+            conf = ipex.AmpConf(torch.int8)
+            with ipex.AutoMixPrecision(conf, running_mode='calibration'):
+                ref = model(x)
+            conf.save('configure.json')
+            conf = ipex.AmpConf(torch.int8, 'configure.json')
+            with ipex.AutoMixPrecision(conf, running_mode='inference'):
+                y = model(x)
+        self.assertEqual(ref, y, prec=0.1)
+        os.remove('configure.json')
+
+    def test_gru(self):
+        # gru runs in fp32 where oneDNN has no int8 linear-before-reset gru
+        x = torch.randn(5, 3, 10, dtype=torch.float32).to(device)
+        gru = self._rnn_output(nn.GRU(10, 20, num_layers=2).float().to(device))
+        with torch.no_grad():
+            conf = ipex.AmpConf(torch.int8)
+            with ipex.AutoMixPrecision(conf, running_mode='calibration'):
+                ref = gru(x)
+            conf.save('configure.json')
+            conf = ipex.AmpConf(torch.int8, 'configure.json')
+            with ipex.AutoMixPrecision(conf, running_mode='inference'):
+                y = gru(x)
+        self.assertEqual(ref, y, prec=0.1)
+        os.remove('configure.json')
+
 if __name__ == '__main__':
     rand_seed = int(time.time() * 1000000000)
     torch.manual_seed(rand_seed)
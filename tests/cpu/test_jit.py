@@ -194,6 +194,29 @@ class ConvSum(nn.Module):
         b = self.conv1(x)
         return a+b
 
+class ConvScalarSum(nn.Module):
+    def __init__(self, dim, in_channels, out_channels, **kwargs):
+        super(ConvScalarSum, self).__init__()
+        seed = 2018
+        torch.manual_seed(seed)
+        self.conv = conv_module[dim](in_channels, out_channels, bias=False, **kwargs)
+
+    def forward(self, x):
+        return self.conv(x) + 2
+
+class ConvAlphaSum(nn.Module):
+    def __init__(self, dim, in_channels, out_channels, **kwargs):
+        super(ConvAlphaSum, self).__init__()
+        seed = 2018
+        torch.manual_seed(seed)
+        self.conv = conv_module[dim](in_channels, out_channels, bias=False, **kwargs)
+        self.conv1 = conv_module[dim](in_channels, out_channels, bias=False, **kwargs)
+
+    def forward(self, x):
+        a = self.conv(x)
+        b = self.conv1(x)
+        return torch.add(b, a, alpha=2.0)
+
 class ConvSumRelu(nn.Module):
     def __init__(self, dim, in_channels, out_channels, **kwargs):
         super(ConvSumRelu, self).__init__()
@@ -272,6 +295,65 @@ class LinearAdd(nn.Module):
     def forward(self, x):
         return torch.add(self.linear(x),self.linear(x))
 
+class LinearSum(nn.Module):
+    def __init__(self, in_channels, out_channels, **kwargs):
+        super(LinearSum, self).__init__()
+        seed = 2018
+        torch.manual_seed(seed)
+        self.linear = nn.Linear(in_channels, out_channels, **kwargs)
+        self.linear1 = nn.Linear(in_channels, out_channels, **kwargs)
+
+    def forward(self, x):
+        return self.linear(x) + self.linear1(x)
+
+class LinearSumRelu(nn.Module):
+    def __init__(self, in_channels, out_channels, **kwargs):
+        super(LinearSumRelu, self).__init__()
+        seed = 2018
+        torch.manual_seed(seed)
+        self.linear = nn.Linear(in_channels, out_channels, **kwargs)
+        self.linear1 = nn.Linear(in_channels, out_channels, **kwargs)
+
+    def forward(self, x):
+        return F.relu(self.linear(x) + self.linear1(x), inplace=True)
+
+class LinearBiasAdd(nn.Module):
+    def __init__(self, in_channels, out_channels, **kwargs):
+        super(LinearBiasAdd, self).__init__()
+        seed = 2018
+        torch.manual_seed(seed)
+        self.linear = nn.Linear(in_channels, out_channels, **kwargs)
+        self.bias = nn.Parameter(torch.rand(out_channels))
+
+    def forward(self, x):
+        return self.linear(x) + self.bias
+
+class LinearResidualAdd(nn.Module):
+    def __init__(self, channels, **kwargs):
+        super(LinearResidualAdd, self).__init__()
+        seed = 2018
+        torch.manual_seed(seed)
+        self.linear = nn.Linear(channels, channels, **kwargs)
+
+    def forward(self, x):
+        return self.linear(x) + x
+
+class LinearViewResidualAdd(LinearResidualAdd):
+    def forward(self, x):
+        return self.linear(x) + x.view(x.size())
+
+class LinearInputResidualAdd(nn.Module):
+    def __init__(self, channels, **kwargs):
+        super(LinearInputResidualAdd, self).__init__()
+        seed = 2018
+        torch.manual_seed(seed)
+        self.linear0 = nn.Linear(channels, channels, **kwargs)
+        self.linear = nn.Linear(channels, channels, **kwargs)
+
+    def forward(self, x):
+        y = self.linear0(x)
+        return self.linear(y) + y
+
 class Linear_Reshape_Relu(nn.Module):
     def __init__(self, in_channels, out_channels,dest_shape, **kwargs):
         super(Linear_Reshape_Relu, self).__init__()
@@ -415,6 +497,92 @@ class ChannelShuffle(nn.Module):
         return x
 
 
+class DropoutAdd(nn.Module):
+    def __init__(self, dim, p):
+        super(DropoutAdd, self).__init__()
+        seed = 2018
+        torch.manual_seed(seed)
+        self.dense = nn.Linear(dim, dim)
+        self.dropout = nn.Dropout(p)
+
+    def forward(self, x):
+        return self.dropout(self.dense(x)) + x
+
+class DropoutAddInplace(nn.Module):
+    def __init__(self, dim, p):
+        super(DropoutAddInplace, self).__init__()
+        seed = 2018
+        torch.manual_seed(seed)
+        self.dense = nn.Linear(dim, dim)
+        self.dropout = nn.Dropout(p)
+
+    def forward(self, x):
+        # the dropout of inference returns y, which add_ writes
+        y = self.dense(x)
+        self.dropout(y).add_(x)
+        return y
+
+class AddLayerNorm(nn.Module):
+    def __init__(self, dim):
+        super(AddLayerNorm, self).__init__()
+        seed = 2018
+        torch.manual_seed(seed)
+        self.dense = nn.Linear(dim, dim)
+        self.layernorm = nn.LayerNorm(dim)
+
+    def forward(self, x):
+        return self.layernorm(self.dense(x) + x)
+
+class DropoutAddLayerNorm(nn.Module):
+    def __init__(self, dim, p):
+        super(DropoutAddLayerNorm, self).__init__()
+        seed = 2018
+        torch.manual_seed(seed)
+        self.dense = nn.Linear(dim, dim)
+        self.dropout = nn.Dropout(p)
+        self.layernorm = nn.LayerNorm(dim)
+
+    def forward(self, x):
+        return self.layernorm(self.dropout(self.dense(x)) + x)
+
+class SelfAttention(nn.Module):
+    # the scores of the HuggingFace BertSelfAttention
+    def __init__(self, hidden, heads, seq):
+        super(SelfAttention, self).__init__()
+        seed = 2018
+        torch.manual_seed(seed)
+        self.num_attention_heads = heads
+        self.attention_head_size = hidden // heads
+        self.query = nn.Linear(hidden, hidden)
+        self.key = nn.Linear(hidden, hidden)
+        self.value = nn.Linear(hidden, hidden)
+        self.dropout = nn.Dropout(0.1)
+        self.register_buffer("attention_mask", (1.0 - (torch.rand(1, 1, 1, seq) > 0.2).float()) * -10000.0)
+
+    def transpose_for_scores(self, x):
+        x = x.view(x.size(0), x.size(1), self.num_attention_heads, self.attention_head_size)
+        return x.permute(0, 2, 1, 3)
+
+    def attention_scores(self, x):
+        query_layer = self.transpose_for_scores(self.query(x))
+        key_layer = self.transpose_for_scores(self.key(x))
+        attention_scores = torch.matmul(query_layer, key_layer.transpose(-1, -2))
+        return attention_scores / math.sqrt(self.attention_head_size)
+
+    def context(self, attention_scores, x):
+        attention_probs = F.softmax(attention_scores, dim=-1)
+        attention_probs = self.dropout(attention_probs)
+        context_layer = torch.matmul(attention_probs, self.transpose_for_scores(self.value(x)))
+        context_layer = context_layer.permute(0, 2, 1, 3).contiguous()
+        return context_layer.view(x.size(0), x.size(1), -1)
+
+    def forward(self, x):
+        return self.context(self.attention_scores(x) + self.attention_mask, x)
+
+class SelfAttentionNoMask(SelfAttention):
+    def forward(self, x):
+        return self.context(self.attention_scores(x), x)
+
 class Tester(TestCase):
 
     def _test_output(self, model, x, kind_in_graph=None, kind_not_in_graph=None):
@@ -773,6 +941,27 @@ class Tester(TestCase):
             kind_in_graph="ipex::conv2d_sum_relu",
             prec=0.1)
 
+    def test_output_conv_scalar_sum(self):
+        # a scalar add is not a sum post op
+        self._test_output(
+            ConvScalarSum(2, 3, 32, kernel_size=3, stride=1),
+            torch.randn(32, 3, 64, 64),
+            kind_in_graph="aten::conv2d",
+            kind_not_in_graph="ipex::conv2d_sum")
+
+    def test_output_conv_alpha_sum(self):
+        # the sum post op can't scale the conv output, which is the other input here
+        self._test_output(
+            ConvAlphaSum(2, 3, 32, kernel_size=3, stride=1),
+            torch.randn(32, 3, 64, 64),
+            kind_in_graph="aten::add",
+            kind_not_in_graph="ipex::conv2d_sum")
+        self._test_output(
+            ConvAlphaSum(3, 3, 32, kernel_size=3, stride=1),
+            torch.randn(32, 3, 32, 32, 32),
+            kind_in_graph="aten::add",
+            kind_not_in_graph="ipex::conv3d_sum")
+
     def test_output_conv_sum_3d(self):
         self._test_output(
             ConvSum(3, 3, 32, kernel_size=3, stride=1),
@@ -837,6 +1026,103 @@ class Tester(TestCase):
             torch.rand(32, 3),
             kind_in_graph="torch_ipex::linear")
 
+    def test_output_linear_sum(self):
+        self._test_output(
+            LinearSum(3, 32, bias=True),
+            torch.rand(32, 3),
+            kind_in_graph="ipex::linear_sum")
+        self._test_output_bf16(
+            LinearSum(3, 32, bias=True),
+            torch.rand(32, 3),
+            kind_in_graph="ipex::linear_sum",
+            prec=0.02)
+        self._test_output_int8(
+            LinearSum(3, 32, bias=True),
+            torch.rand(32, 3),
+            kind_in_graph="ipex::linear_sum",
+            prec=0.1)
+        self._test_output(
+            LinearSum(64, 32, bias=False),
+            torch.rand(8, 16, 64),
+            kind_in_graph="ipex::linear_sum")
+
+    def test_output_linear_sum_relu(self):
+        self._test_output(
+            LinearSumRelu(3, 32, bias=True),
+            torch.randn(32, 3),
+            kind_in_graph="ipex::linear_sum_relu")
+        self._test_output_bf16(
+            LinearSumRelu(3, 32, bias=True),
+            torch.randn(32, 3),
+            kind_in_graph="ipex::linear_sum_relu",
+            prec=0.02)
+        self._test_output_int8(
+            LinearSumRelu(3, 32, bias=True),
+            torch.randn(32, 3),
+            kind_in_graph="ipex::linear_sum_relu",
+            prec=0.1)
+
+    def test_output_linear_bias_add(self):
+        # the parameter is not written, the add is folded into the bias
+        self._test_output(
+            LinearBiasAdd(3, 32, bias=True),
+            torch.rand(32, 3),
+            kind_in_graph="ipex::linear_add",
+            kind_not_in_graph="ipex::linear_sum")
+        self._test_output_bf16(
+            LinearBiasAdd(3, 32, bias=False),
+            torch.rand(32, 3),
+            kind_in_graph="ipex::linear_add",
+            prec=0.02)
+        # the folded bias is kept by the node until the parameters are updated
+        core.enable_jit_opt()
+        model = LinearBiasAdd(3, 32, bias=True).to(device).eval()
+        x = torch.rand(32, 3).to(device)
+        script_model = torch.jit.script(model)
+        with torch.no_grad():
+            script_model(x)
+            script_model(x)
+            for param in [model.bias, model.linear.bias]:
+                param.add_(1)
+                self.assertEqual(model(x), script_model(x))
+
+    def test_output_linear_residual_add(self):
+        # the residual is not a row of the output, the add is not fused
+        self._test_output(
+            LinearResidualAdd(64, bias=True),
+            torch.rand(8, 16, 64),
+            kind_in_graph="aten::add",
+            kind_not_in_graph="ipex::linear_add")
+        self._test_output(
+            LinearViewResidualAdd(64, bias=True),
+            torch.rand(8, 16, 64),
+            kind_in_graph="aten::add",
+            kind_not_in_graph="ipex::linear_add")
+        # the input of the graph, or a view of it, is not written
+        core.enable_jit_opt()
+        for module in [LinearResidualAdd, LinearViewResidualAdd]:
+            x = torch.rand(8, 16, 64).to(device)
+            x_copy = x.clone()
+            script_model = torch.jit.script(module(64).to(device).eval())
+            with torch.no_grad():
+                script_model(x)
+                script_model(x)
+            self.assertEqual(x, x_copy)
+
+    def test_output_linear_input_residual_add(self):
+        # the residual is the input of the linear, the linear can't write over it
+        self._test_output(
+            LinearInputResidualAdd(64, bias=True),
+            torch.rand(8, 16, 64),
+            kind_in_graph="aten::add",
+            kind_not_in_graph="ipex::linear_sum")
+        self._test_output_bf16(
+            LinearInputResidualAdd(64, bias=True),
+            torch.rand(8, 16, 64),
+            kind_in_graph="aten::add",
+            kind_not_in_graph="ipex::linear_sum",
+            prec=0.02)
+
     def test_output_linear_reshape_relu(self):
         self._test_output(
             Linear_Reshape_Relu(3, 32,(64,16),bias=True),
@@ -889,6 +1175,73 @@ class Tester(TestCase):
             kind_in_graph="ipex::shuffle_2d")
 
 
+    def test_output_dropout_add(self):
+        self._test_output(
+            DropoutAdd(64, 0.1),
+            torch.rand(8, 32, 64),
+            kind_in_graph="ipex::dropout_add")
+
+    def test_output_dropout_add_inplace(self):
+        self._test_output(
+            DropoutAddInplace(64, 0.1),
+            torch.rand(8, 32, 64),
+            kind_not_in_graph="ipex::dropout_add")
+
+    def test_dropout_add_train(self):
+        core.enable_auto_dnnl()
+        core.enable_jit_opt()
+        model = DropoutAdd(64, 0.1).to(device).train()
+        x = torch.rand(8, 32, 64).to(device)
+        script_model = torch.jit.script(model)
+        with torch.no_grad():
+            script_graph = script_model.graph_for(x)
+            self.assertTrue(any(n.kind() == "ipex::dropout_add" for n in script_graph.nodes()))
+            # the fused and the unfused dropout draw the same mask from the same seed
+            torch.manual_seed(2020)
+            fused_result = script_model(x)
+            torch.manual_seed(2020)
+            result = model(x)
+        self.assertEqual(result, fused_result)
+
+    def test_output_attention(self):
+        self._test_output(
+            SelfAttention(256, 4, 80),
+            torch.rand(2, 80, 256),
+            kind_in_graph="ipex::attention",
+            kind_not_in_graph="aten::softmax")
+        self._test_output(
+            SelfAttentionNoMask(256, 4, 80),
+            torch.rand(2, 80, 256),
+            kind_in_graph="ipex::attention",
+            kind_not_in_graph="aten::softmax")
+
+    def test_output_add_layer_norm(self):
+        self._test_output(
+            AddLayerNorm(64),
+            torch.rand(8, 32, 64),
+            kind_in_graph="ipex::add_layer_norm",
+            kind_not_in_graph="aten::layer_norm")
+        self._test_output(
+            DropoutAddLayerNorm(64, 0.1),
+            torch.rand(8, 32, 64),
+            kind_in_graph="ipex::add_layer_norm",
+            kind_not_in_graph="ipex::dropout_add")
+
+    def test_dropout_add_layer_norm_train(self):
+        core.enable_auto_dnnl()
+        core.enable_jit_opt()
+        model = DropoutAddLayerNorm(64, 0.1).to(device).train()
+        x = torch.rand(8, 32, 64).to(device)
+        script_model = torch.jit.script(model)
+        with torch.no_grad():
+            script_graph = script_model.graph_for(x)
+            self.assertTrue(any(n.kind() == "ipex::add_layer_norm" for n in script_graph.nodes()))
+            torch.manual_seed(2020)
+            fused_result = script_model(x)
+            torch.manual_seed(2020)
+            result = model(x)
+        self.assertEqual(result, fused_result)
+
     def test_jit_function(self):
         # test hool trace and script can works for function
         def fn(input, weight, bias):
@@ -1144,6 +1144,131 @@ class TestLayerNorm(TestCase):
             y_dpcpp.backward()
             self.assertEqual(input_cpu.grad, input_dpcpp.grad)
 
+    def test_add_layer_norm(self):
+        with AutoDNNL(True):
+            rand_seed = int(get_rand_seed())
+            print("{} rand sed: {}".format(sys._getframe().f_code.co_name, rand_seed))
+            torch.manual_seed(rand_seed)
+            x = torch.randn(4, 33, 72)
+            res = torch.randn(4, 33, 72)
+            m = torch.nn.LayerNorm(72)
+            m.weight.data.uniform_(0.5, 1.5)
+            m.bias.data.uniform_(-0.5, 0.5)
+            grad = torch.randn(4, 33, 72)
+
+            x_cpu = x.clone().requires_grad_()
+            res_cpu = res.clone().requires_grad_()
+            m_cpu = copy.deepcopy(m)
+            y_cpu = m_cpu(x_cpu + res_cpu)
+            y_cpu.backward(grad)
+
+            x_dpcpp = x.clone().to(device=device).requires_grad_()
+            res_dpcpp = res.clone().to(device=device).requires_grad_()
+            m_dpcpp = copy.deepcopy(m).to(device=device)
+            y_dpcpp = ipex.add_layer_norm(x_dpcpp, res_dpcpp, [72], m_dpcpp.weight, m_dpcpp.bias, m.eps)
+            y_dpcpp.backward(grad.to(device=device))
+            self.assertTrue(ipex.core.is_dil_tensor(y_dpcpp))
+            self.assertEqual(y_cpu, y_dpcpp)
+            self.assertEqual(x_cpu.grad, x_dpcpp.grad)
+            self.assertEqual(res_cpu.grad, res_dpcpp.grad)
+            self.assertEqual(m_cpu.weight.grad, m_dpcpp.weight.grad)
+            self.assertEqual(m_cpu.bias.grad, m_dpcpp.bias.grad)
+
+            # without the affine parameters
+            y_dpcpp = ipex.add_layer_norm(x_dpcpp, res_dpcpp, [33, 72])
+            self.assertEqual(F.layer_norm(x + res, [33, 72]), y_dpcpp)
+
+    def test_dropout_add_layer_norm(self):
+        with AutoDNNL(True):
+            rand_seed = int(get_rand_seed())
+            print("{} rand sed: {}".format(sys._getframe().f_code.co_name, rand_seed))
+            p = 0.1
+            x = torch.randn(8, 16, 64).to(device=device)
+            res = torch.randn(8, 16, 64).to(device=device)
+            m = torch.nn.LayerNorm(64).to(device=device)
+            grad = torch.randn(8, 16, 64).to(device=device)
+
+            # the mask is drawn as the one of dropout_add under the same seed
+            x1 = x.clone().requires_grad_()
+            res1 = res.clone().requires_grad_()
+            torch.manual_seed(rand_seed)
+            y1 = ipex.add_layer_norm(x1, res1, [64], m.weight, m.bias, m.eps, p, True)
+            y1.backward(grad)
+
+            x2 = x.clone().requires_grad_()
+            res2 = res.clone().requires_grad_()
+            torch.manual_seed(rand_seed)
+            y2 = m(ipex.dropout_add(x2, res2, p))
+            y2.backward(grad)
+
+            self.assertEqual(y1, y2)
+            self.assertEqual(x1.grad, x2.grad)
+            self.assertEqual(res1.grad, res2.grad)
+
+            # no dropout out of training
+            y = ipex.add_layer_norm(x, res, [64], m.weight, m.bias, m.eps, p, False)
+            self.assertEqual(y, m(x + res))
+
+class TestAttention(TestCase):
+    def _ref_attention(self, q, k, v, mask, scale):
+        scores = torch.matmul(q, k.transpose(-1, -2)) * scale
+        if mask is not None:
+            scores = scores + mask
+        return torch.matmul(F.softmax(scores, dim=-1), v)
+
+    def test_scaled_dot_product_attention(self):
+        with AutoDNNL(True), torch.no_grad():
+            rand_seed = int(get_rand_seed())
+            print("{} rand sed: {}".format(sys._getframe().f_code.co_name, rand_seed))
+            torch.manual_seed(rand_seed)
+            # key tiles of 64, the last ones partial
+            for B, H, Sq, Sk, D in [(2, 3, 5, 7, 8), (2, 4, 130, 70, 64), (1, 12, 128, 128, 64)]:
+                q = torch.randn(B, Sq, H, D).permute(0, 2, 1, 3)
+                k = torch.randn(B, Sk, H, D).permute(0, 2, 1, 3)
+                v = torch.randn(B, Sk, H, D).permute(0, 2, 1, 3)
+                # the extended mask of HuggingFace, a causal one and none
+                pad = (torch.rand(B, 1, 1, Sk) > 0.2).float()
+                causal = torch.ones(Sq, Sk).triu(1) * -1e4
+                for mask in [(1.0 - pad) * -10000.0, causal, None]:
+                    ref = self._ref_attention(q, k, v, mask, 1 / math.sqrt(D))
+                    mask_dpcpp = mask.to(device=device) if mask is not None else None
+                    y = ipex.scaled_dot_product_attention(
+                        q.to(device=device), k.to(device=device), v.to(device=device), mask_dpcpp)
+                    self.assertTrue(ipex.core.is_dil_tensor(y))
+                    self.assertTrue(y.is_contiguous())
+                    self.assertEqual(y.view(B, H * Sq, D), ref.reshape(B, H * Sq, D))
+
+    def test_multi_head_attention(self):
+        with AutoDNNL(True), torch.no_grad():
+            rand_seed = int(get_rand_seed())
+            print("{} rand sed: {}".format(sys._getframe().f_code.co_name, rand_seed))
+            torch.manual_seed(rand_seed)
+            B, S, H, D = 4, 96, 12, 64
+            q, k, v = [torch.randn(B, S, H * D) for _ in range(3)]
+            mask = (1.0 - (torch.rand(B, 1, 1, S) > 0.2).float()) * -10000.0
+            heads = lambda x: x.view(B, S, H, D).permute(0, 2, 1, 3)
+            ref = self._ref_attention(heads(q), heads(k), heads(v), mask, 0.125)
+            ref = ref.permute(0, 2, 1, 3).reshape(B, S, H * D)
+            y = ipex.multi_head_attention(
+                q.to(device=device), k.to(device=device), v.to(device=device), H, mask.to(device=device))
+            self.assertEqual(y.size(), (B, S, H * D))
+            self.assertEqual(y, ref)
+
+    def test_attention_backward(self):
+        # the gradients go through the unfused ops
+        with AutoDNNL(True):
+            rand_seed = int(get_rand_seed())
+            print("{} rand sed: {}".format(sys._getframe().f_code.co_name, rand_seed))
+            torch.manual_seed(rand_seed)
+            q, k, v = [torch.randn(2, 3, 10, 8) for _ in range(3)]
+            q_cpu, k_cpu, v_cpu = [x.clone().requires_grad_() for x in (q, k, v)]
+            q_dpcpp, k_dpcpp, v_dpcpp = [x.clone().to(device=device).requires_grad_() for x in (q, k, v)]
+            self._ref_attention(q_cpu, k_cpu, v_cpu, None, 0.5).sum().backward()
+            ipex.scaled_dot_product_attention(q_dpcpp, k_dpcpp, v_dpcpp, scale=0.5).sum().backward()
+            self.assertEqual(q_cpu.grad, q_dpcpp.grad)
+            self.assertEqual(k_cpu.grad, k_dpcpp.grad)
+            self.assertEqual(v_cpu.grad, v_dpcpp.grad)
+
 class TestTensorShape(TestCase):
     def test_reshape(self):
         with AutoDNNL(True):
@@ -1441,6 +1566,45 @@ class TestDropout(TestCase):
             module.__repr__()
             str(module)
 
+    def test_dropout_mask(self):
+        with AutoDNNL(True):
+            p = 0.3
+            # the number of elements is not a multiple of 8
+            x = torch.randn(4, 33, 65).to(device).requires_grad_()
+            torch.manual_seed(0)
+            y1 = F.dropout(x, p, training=True)
+            torch.manual_seed(0)
+            y2 = F.dropout(x, p, training=True)
+            self.assertEqual(y1, y2)
+
+            kept = (y1 != 0).float()
+            self.assertLess(abs(kept.mean().item() - (1 - p)), 0.05)
+            self.assertEqual(y1, x * kept / (1 - p))
+
+            grad = torch.randn(4, 33, 65).to(device)
+            y1.backward(grad)
+            self.assertEqual(x.grad, grad * kept / (1 - p))
+
+    def test_dropout_add(self):
+        with AutoDNNL(True):
+            p = 0.1
+            x = torch.randn(8, 128, 768).to(device).requires_grad_()
+            residual = torch.randn(8, 128, 768).to(device).requires_grad_()
+            torch.manual_seed(0)
+            y = ipex.dropout_add(x, residual, p)
+            torch.manual_seed(0)
+            ref = F.dropout(x, p, training=True)
+            self.assertEqual(y, ref + residual)
+
+            kept = (ref != 0).float()
+            grad = torch.randn(8, 128, 768).to(device)
+            y.backward(grad)
+            self.assertEqual(x.grad, grad * kept / (1 - p))
+            self.assertEqual(residual.grad, grad)
+
+            with torch.no_grad():
+                self.assertEqual(ipex.dropout_add(x, residual, p, False), x + residual)
+
 class TestSplit(TestCase):
     def test_split(self):
         with AutoDNNL(True):
@@ -1801,6 +1965,74 @@ class TestRNN(TestCase):
     def test_pack_padded_sequence_lstm_training(self):
         self._test_pack_padded_sequence_lstm(training=True)
 
+    def _test_rnn_weights_update(self, cell):
+        # the reordered weights are reused across steps until the optimizer updates them
+        rand_seed = int(get_rand_seed())
+        print("{} rand sed: {}".format(sys._getframe().f_code.co_name, rand_seed))
+        torch.manual_seed(rand_seed)
+
+        model_cpu = getattr(torch.nn, cell)(input_size=3, hidden_size=5, num_layers=2)
+        model_dpcpp = copy.deepcopy(model_cpu).to(device=device)
+        optimizer_cpu = torch.optim.SGD(model_cpu.parameters(), lr=0.1)
+        optimizer_dpcpp = torch.optim.SGD(model_dpcpp.parameters(), lr=0.1)
+        for _ in range(3):
+            input = torch.randn(4, 2, 3)
+            for model, optimizer, x in [(model_cpu, optimizer_cpu, input), (model_dpcpp, optimizer_dpcpp, input.to(device=device))]:
+                optimizer.zero_grad()
+                model(x)[0].sum().backward()
+                optimizer.step()
+            self.assertEqual(model_dpcpp.weight_ih_l1.to('cpu'), model_cpu.weight_ih_l1)
+
+        # decoding, one timestep a call, with an inplace update in between
+        model_cpu.eval()
+        model_dpcpp.eval()
+        with torch.no_grad():
+            for step in range(4):
+                if step == 2:
+                    model_cpu.weight_hh_l0.mul_(0.5)
+                    model_dpcpp.weight_hh_l0.mul_(0.5)
+                input = torch.randn(1, 2, 3)
+                self.assertEqual(model_dpcpp(input.to(device=device))[0], model_cpu(input)[0])
+
+    def test_lstm_weights_update(self):
+        self._test_rnn_weights_update("LSTM")
+
+    def test_gru_weights_update(self):
+        self._test_rnn_weights_update("GRU")
+
+    def _test_rnn_split_sgd(self, cell):
+        # SplitSGD updates the weights through .data, which keeps their version
+        rand_seed = int(get_rand_seed())
+        print("{} rand sed: {}".format(sys._getframe().f_code.co_name, rand_seed))
+        torch.manual_seed(rand_seed)
+
+        model_cpu = getattr(torch.nn, cell)(input_size=3, hidden_size=5, num_layers=2)
+        model_dpcpp = copy.deepcopy(model_cpu).to(device=device)
+        optimizer_cpu = torch.optim.SGD(model_cpu.parameters(), lr=0.1)
+        optimizer_dpcpp = ipex.SplitSGD(model_dpcpp.parameters(), lr=0.1)
+        for _ in range(3):
+            # inference first, to reorder the weights of their current value
+            model_cpu.eval()
+            model_dpcpp.eval()
+            with torch.no_grad():
+                input = torch.randn(4, 2, 3)
+                self.assertEqual(model_dpcpp(input.to(device=device))[0], model_cpu(input)[0])
+
+            model_cpu.train()
+            model_dpcpp.train()
+            input = torch.randn(4, 2, 3)
+            for model, optimizer, x in [(model_cpu, optimizer_cpu, input), (model_dpcpp, optimizer_dpcpp, input.to(device=device))]:
+                optimizer.zero_grad()
+                model(x)[0].sum().backward()
+                optimizer.step()
+            self.assertEqual(model_dpcpp.weight_hh_l1.to('cpu'), model_cpu.weight_hh_l1)
+
+    def test_lstm_split_sgd(self):
+        self._test_rnn_split_sgd("LSTM")
+
+    def test_gru_split_sgd(self):
+        self._test_rnn_split_sgd("GRU")
+
 class TestInterpolate(TestCase):
     def test_upsample_nearest1d_scale_factor(self):
         rand_seed = int(get_rand_seed())
@@ -0,0 +1,116 @@
+import unittest
+
+import torch
+import intel_pytorch_extension as ipex
+from common_utils import TestCase
+
+
+def random_boxes(n, dtype):
+    xy = torch.rand(n, 2, dtype=dtype) * 100
+    wh = torch.rand(n, 2, dtype=dtype) * 30 + 1
+    return torch.cat([xy, xy + wh], dim=1), torch.rand(n, dtype=dtype)
+
+
+def nms_reference(dets, scores, threshold, bias):
+    order = scores.sort(0, descending=True)[1].tolist()
+    x1, y1, x2, y2 = [dets[:, k].tolist() for k in range(4)]
+    areas = [(x2[i] - x1[i] + bias) * (y2[i] - y1[i] + bias) for i in range(len(x1))]
+    suppressed = [False] * len(x1)
+    for _i, i in enumerate(order):
+        if suppressed[i]:
+            continue
+        for j in order[_i + 1:]:
+            if suppressed[j]:
+                continue
+            w = max(0., min(x2[i], x2[j]) - max(x1[i], x1[j]) + bias)
+            h = max(0., min(y2[i], y2[j]) - max(y1[i], y1[j]) + bias)
+            inter = w * h
+            if inter / (areas[i] + areas[j] - inter) >= threshold:
+                suppressed[j] = True
+    return torch.tensor([i for i in range(len(x1)) if not suppressed[i]], dtype=torch.long)
+
+
+class TestNMS(TestCase):
+    def test_nms(self):
+        for dtype in [torch.float, torch.double]:
+            for n in [1, 63, 64, 65, 300]:
+                dets, scores = random_boxes(n, dtype)
+                for bias in [0., 1.]:
+                    for threshold in [0.3, 0.5]:
+                        expected = nms_reference(dets, scores, threshold, bias)
+                        keep = ipex.nms(dets.to(ipex.DEVICE), scores.to(ipex.DEVICE), threshold, bias)
+                        self.assertEqual(keep.to('cpu'), expected)
+
+    def test_nms_matches_serial_kernel(self):
+        # several blocks of the suppression mask
+        dets, scores = random_boxes(5000, torch.float)
+        for bias in [0., 1.]:
+            keep = ipex.nms(dets.to(ipex.DEVICE), scores.to(ipex.DEVICE), 0.5, bias)
+            serial = ipex.core._nms_serial(dets.to(ipex.DEVICE), scores.to(ipex.DEVICE), 0.5, bias)
+            self.assertEqual(keep.to('cpu'), serial.to('cpu'))
+
+    def test_nms_empty(self):
+        dets = torch.empty(0, 4)
+        scores = torch.empty(0)
+        keep = ipex.nms(dets.to(ipex.DEVICE), scores.to(ipex.DEVICE), 0.5)
+        self.assertEqual(keep.numel(), 0)
+
+    def score_nms_reference(self, dets, scores, threshold, max_num=200):
+        # per class: score > 0.05, max_num best, NMS with bias 0, best first
+        results = []
+        for c in range(1, scores.size(1)):
+            index = (scores[:, c] > 0.05).nonzero().view(-1)
+            if index.numel() == 0:
+                continue
+            score = scores[index, c]
+            order = score.sort(0, descending=True)[1][:max_num]
+            index, score = index[order], score[order]
+            keep = nms_reference(dets[index], score, threshold, 0.)
+            keep = keep[score[keep].sort(0, descending=True)[1]]
+            results.append((c, dets[index[keep]], score[keep]))
+        return results
+
+    def random_detections(self, batch, n, classes):
+        dets = []
+        for _ in range(batch):
+            xy = torch.rand(n, 2)
+            dets.append(torch.cat([xy, xy + torch.rand(n, 2) * 0.2], dim=1))
+        return torch.stack(dets), torch.rand(batch, n, classes) * 0.3
+
+    def test_batch_score_nms(self):
+        dets, scores = self.random_detections(1, 500, 5)
+        dets, scores = dets[0], scores[0]
+        bboxes, labels, out_scores = ipex.batch_score_nms(dets.to(ipex.DEVICE), scores.to(ipex.DEVICE), 0.5)
+        expected = self.score_nms_reference(dets, scores, 0.5)
+        offset = 0
+        for c, ref_boxes, ref_scores in expected:
+            n = ref_scores.numel()
+            # every class comes in ascending score order
+            self.assertEqual(bboxes[offset:offset + n].to('cpu'), ref_boxes.flip(0))
+            self.assertEqual(out_scores[offset:offset + n].to('cpu'), ref_scores.flip(0))
+            self.assertEqual(labels[offset:offset + n].to('cpu'), torch.full((n,), c))
+            offset += n
+        self.assertEqual(offset, labels.numel())
+
+    def test_batch_score_nms_padded(self):
+        batch, max_output = 3, 50
+        dets, scores = self.random_detections(batch, 500, 5)
+        bboxes, labels, out_scores, counts = ipex.batch_score_nms_padded(
+            dets.to(ipex.DEVICE), scores.to(ipex.DEVICE), 0.5, max_num=100, max_output=max_output)
+        self.assertEqual(bboxes.size(), torch.Size([batch, max_output, 4]))
+        for b in range(batch):
+            expected = self.score_nms_reference(dets[b], scores[b], 0.5, max_num=100)
+            ref_boxes = torch.cat([r[1] for r in expected])
+            ref_scores = torch.cat([r[2] for r in expected])
+            ref_labels = torch.cat([torch.full((r[2].numel(),), r[0], dtype=torch.long) for r in expected])
+            order = ref_scores.sort(0, descending=True)[1][:max_output]
+            n = order.numel()
+            self.assertEqual(counts[b].item(), n)
+            self.assertEqual(out_scores[b, :n].to('cpu'), ref_scores[order])
+            self.assertEqual(bboxes[b, :n].to('cpu'), ref_boxes[order])
+            self.assertEqual(labels[b, :n].to('cpu'), ref_labels[order])
+            self.assertEqual(out_scores[b, n:].to('cpu'), torch.zeros(max_output - n))
+
+
+if __name__ == '__main__':
+    test = unittest.main()
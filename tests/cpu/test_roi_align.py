@@ -0,0 +1,174 @@
+import math
+import unittest
+
+import torch
+import intel_pytorch_extension as ipex
+from common_utils import TestCase
+
+
+def bilinear(feature, y, x):
+    # feature: [C, H, W]
+    height, width = feature.size(1), feature.size(2)
+    if y < -1.0 or y > height or x < -1.0 or x > width:
+        return torch.zeros(feature.size(0), dtype=feature.dtype)
+    y, x = max(y, 0.), max(x, 0.)
+    y_low, x_low = int(y), int(x)
+    if y_low >= height - 1:
+        y_high = y_low = height - 1
+        y = float(y_low)
+    else:
+        y_high = y_low + 1
+    if x_low >= width - 1:
+        x_high = x_low = width - 1
+        x = float(x_low)
+    else:
+        x_high = x_low + 1
+    ly, lx = y - y_low, x - x_low
+    hy, hx = 1. - ly, 1. - lx
+    return (hy * hx * feature[:, y_low, x_low] + hy * lx * feature[:, y_low, x_high] +
+            ly * hx * feature[:, y_high, x_low] + ly * lx * feature[:, y_high, x_high])
+
+
+def roi_align_reference(input, rois, output_size, spatial_scale, sampling_ratio):
+    pooled_h, pooled_w = output_size
+    output = torch.zeros(rois.size(0), input.size(1), pooled_h, pooled_w, dtype=input.dtype)
+    for n, roi in enumerate(rois.tolist()):
+        feature = input[int(roi[0])]
+        start_w, start_h, end_w, end_h = [v * spatial_scale for v in roi[1:]]
+        roi_w, roi_h = max(end_w - start_w, 1.), max(end_h - start_h, 1.)
+        bin_h, bin_w = roi_h / pooled_h, roi_w / pooled_w
+        grid_h = sampling_ratio if sampling_ratio > 0 else math.ceil(roi_h / pooled_h)
+        grid_w = sampling_ratio if sampling_ratio > 0 else math.ceil(roi_w / pooled_w)
+        for ph in range(pooled_h):
+            for pw in range(pooled_w):
+                for iy in range(grid_h):
+                    y = start_h + ph * bin_h + (iy + .5) * bin_h / grid_h
+                    for ix in range(grid_w):
+                        x = start_w + pw * bin_w + (ix + .5) * bin_w / grid_w
+                        output[n, :, ph, pw] += bilinear(feature, y, x)
+                output[n, :, ph, pw] /= grid_h * grid_w
+    return output
+
+
+def random_rois(n, batch, height, width, spatial_scale):
+    x1 = torch.rand(n) * width / spatial_scale
+    y1 = torch.rand(n) * height / spatial_scale
+    x2 = x1 + torch.rand(n) * width / spatial_scale / 2
+    y2 = y1 + torch.rand(n) * height / spatial_scale / 2
+    batch_ind = torch.randint(0, batch, (n,)).float()
+    return torch.stack([batch_ind, x1, y1, x2, y2], dim=1)
+
+
+class TestROIAlign(TestCase):
+    def run_roi_align(self, input, rois, output_size, spatial_scale, sampling_ratio):
+        input = input.detach().requires_grad_()
+        output = ipex.roi_align(input, rois.to(ipex.DEVICE), output_size, spatial_scale, sampling_ratio)
+        grad = torch.linspace(-1, 1, output.numel()).view(output.size()).to(output.dtype).to(ipex.DEVICE)
+        output.backward(grad)
+        return output, input.grad
+
+    def test_roi_align(self):
+        input = torch.randn(2, 5, 12, 16)
+        rois = random_rois(8, 2, 12, 16, 0.5)
+        for sampling_ratio in [0, 2]:
+            output, _ = self.run_roi_align(input.to(ipex.DEVICE), rois, (3, 4), 0.5, sampling_ratio)
+            expected = roi_align_reference(input, rois, (3, 4), 0.5, sampling_ratio)
+            self.assertEqual(output.to('cpu'), expected)
+
+    def test_roi_align_channels_last(self):
+        input = torch.randn(2, 37, 25, 30)
+        rois = random_rois(50, 2, 25, 30, 0.25)
+        for sampling_ratio in [0, 2]:
+            output, grad_input = self.run_roi_align(input.to(ipex.DEVICE), rois, (7, 7), 0.25, sampling_ratio)
+            input_cl = input.to(ipex.DEVICE).contiguous(memory_format=torch.channels_last)
+            output_cl, grad_input_cl = self.run_roi_align(input_cl, rois, (7, 7), 0.25, sampling_ratio)
+            self.assertTrue(output_cl.is_contiguous(memory_format=torch.channels_last))
+            self.assertEqual(output_cl.to('cpu'), output.to('cpu'))
+            self.assertEqual(grad_input_cl.to('cpu'), grad_input.to('cpu'))
+
+    def test_roi_align_bf16(self):
+        input = torch.randn(2, 32, 25, 30)
+        rois = random_rois(50, 2, 25, 30, 0.25)
+        output, grad_input = self.run_roi_align(input.to(ipex.DEVICE), rois, (7, 7), 0.25, 2)
+        for memory_format in [torch.contiguous_format, torch.channels_last]:
+            input_bf16 = input.to(ipex.DEVICE).to(torch.bfloat16).contiguous(memory_format=memory_format)
+            output_bf16, grad_input_bf16 = self.run_roi_align(input_bf16, rois, (7, 7), 0.25, 2)
+            self.assertEqual(output_bf16.dtype, torch.bfloat16)
+            self.assertEqual(grad_input_bf16.dtype, torch.bfloat16)
+            self.assertEqual(output_bf16.float().to('cpu'), output.to('cpu'), 1e-2)
+            self.assertEqual(grad_input_bf16.float().to('cpu'), grad_input.to('cpu'), 2e-2)
+
+    def test_roi_align_backward_policies(self):
+        # many overlapping rois, every policy must give the serial result
+        rois = random_rois(300, 2, 10, 12, 0.5)
+        for memory_format in [torch.contiguous_format, torch.channels_last]:
+            grad = torch.randn(300, 24, 7, 7).contiguous(memory_format=memory_format).to(ipex.DEVICE)
+            results = []
+            for policy in ['planes', 'private', 'auto']:
+                results.append(ipex.core._roi_align_backward_with_policy(
+                    grad, rois.to(ipex.DEVICE), 0.5, 7, 7, 2, 24, 10, 12, 2, policy).to('cpu'))
+            num_threads = torch.get_num_threads()
+            torch.set_num_threads(1)
+            expected = ipex.core._roi_align_backward_with_policy(
+                grad, rois.to(ipex.DEVICE), 0.5, 7, 7, 2, 24, 10, 12, 2, 'planes').to('cpu')
+            torch.set_num_threads(num_threads)
+            for result in results:
+                self.assertEqual(result, expected)
+
+    def fpn_levels(self, rois, k_min, k_max):
+        # LevelMapper of maskrcnn-benchmark
+        area = (rois[:, 3] - rois[:, 1] + 1) * (rois[:, 4] - rois[:, 2] + 1)
+        levels = torch.floor(4 + torch.log2(torch.sqrt(area) / 224 + 1e-6))
+        return torch.clamp(levels, min=k_min, max=k_max).to(torch.int64) - k_min
+
+    def test_multilevel_roi_align(self):
+        scales = [1 / 4., 1 / 8., 1 / 16., 1 / 32.]
+        sizes = [(48, 64), (24, 32), (12, 16), (6, 8)]
+        x1y1 = torch.rand(60, 2) * 200
+        wh = torch.exp(torch.rand(60, 2) * 5 + 2)
+        batch_ind = torch.randint(0, 2, (60, 1)).float()
+        rois = torch.cat([batch_ind, x1y1, x1y1 + wh], dim=1)
+        levels = self.fpn_levels(rois, 2, 5)
+        for memory_format in [torch.contiguous_format, torch.channels_last]:
+            features = [torch.randn(2, 16, h, w).to(ipex.DEVICE).contiguous(memory_format=memory_format).requires_grad_()
+                        for h, w in sizes]
+            output = ipex.multilevel_roi_align(features, rois.to(ipex.DEVICE), (7, 7), scales, 2)
+            grad = torch.randn(output.size()).to(ipex.DEVICE)
+            output.backward(grad)
+
+            expected = torch.zeros(output.size())
+            for l, scale in enumerate(scales):
+                index = (levels == l).nonzero().view(-1)
+                if index.numel() == 0:
+                    continue
+                feature = features[l].detach().requires_grad_()
+                out = ipex.roi_align(feature, rois[index].to(ipex.DEVICE), (7, 7), scale, 2)
+                out.backward(grad.to('cpu')[index].to(ipex.DEVICE))
+                expected[index] = out.to('cpu')
+                self.assertEqual(features[l].grad.to('cpu'), feature.grad.to('cpu'))
+            self.assertEqual(output.to('cpu'), expected)
+
+    def test_multilevel_roi_align_degenerate(self):
+        # empty and inverted boxes go to the finest level, a huge one to the coarsest
+        scales = [1 / 4., 1 / 8., 1 / 16., 1 / 32.]
+        sizes = [(48, 64), (24, 32), (12, 16), (6, 8)]
+        rois = torch.tensor([[0, 10., 10., 9., 9.],
+                             [0, 10., 10., 8., 20.],
+                             [1, 20., 20., 5., 5.],
+                             [1, 0., 0., 1e30, 1e30]])
+        levels = [0, 0, 0, 3]
+        features = [torch.randn(2, 16, h, w).to(ipex.DEVICE) for h, w in sizes]
+        output = ipex.multilevel_roi_align(features, rois.to(ipex.DEVICE), (7, 7), scales, 2).to('cpu')
+        for n, l in enumerate(levels):
+            expected = ipex.roi_align(features[l], rois[n:n + 1].to(ipex.DEVICE), (7, 7), scales[l], 2).to('cpu')
+            self.assertEqual(output[n:n + 1], expected)
+
+    def test_roi_align_empty(self):
+        input = torch.randn(1, 4, 8, 8).to(ipex.DEVICE)
+        rois = torch.empty(0, 5)
+        output = ipex.roi_align(input, rois.to(ipex.DEVICE), (2, 2), 1., 2)
+        self.assertEqual(output.size(), torch.Size([0, 4, 2, 2]))
+
+
+if __name__ == '__main__':
+    test = unittest.main()
@@ -68,6 +68,14 @@ public:
   inline bool get_int8_calibration() {
     return calibration_step_;
   }
+  // Number of indices the embedding_bag forward prefetches ahead, 0 disables it
+  inline void set_embedding_bag_prefetch_distance(int64_t value) {
+    embedding_bag_prefetch_distance_ = value;
+  }
+  inline int64_t get_embedding_bag_prefetch_distance() {
+    return embedding_bag_prefetch_distance_;
+  }
+
   inline void set_xpu_mode(XPUMode xpu_mode){
     xpu_mode_ = xpu_mode;
   }
@@ -78,7 +86,8 @@ public:
 
 private:
   AutoOptConfig() : auto_dnnl_(true), mix_bf16_fp32_(false), mix_int8_fp32_(false),
-                    jit_fuse_(true), train_(false), calibration_step_(false), xpu_mode_(XPUMode::CPU) {}
+                    jit_fuse_(true), train_(false), calibration_step_(false), xpu_mode_(XPUMode::CPU),
+                    embedding_bag_prefetch_distance_(8) {}
 
   ~AutoOptConfig() = default;
   AutoOptConfig(const AutoOptConfig&) = default;
@@ -94,6 +103,7 @@ private:
   // the flag for one iteration of calibration step whether end or not
   bool calibration_step_;
   XPUMode xpu_mode_;
+  int64_t embedding_bag_prefetch_distance_;
 };
 
 } // namespace torch_ipex
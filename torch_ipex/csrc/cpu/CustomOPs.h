@@ -515,15 +515,14 @@ public:
 #endif
     try {
       if (torch_ipex::check_auto_dnnl() &&
-          torch_ipex::cpu::aten::embedding_bag::embedding_bag_fast_path_sum(
-              weight, per_sample_weights, mode) &&
+          torch_ipex::cpu::aten::embedding_bag::embedding_bag_fast_path(
+              weight, per_sample_weights, mode, sparse) &&
           weight.device().type() == c10::DeviceType::XPU &&
           indices.device().type() == c10::DeviceType::XPU &&
           offsets.device().type() == c10::DeviceType::XPU) {
-        auto ret = torch_ipex::cpu::aten::embedding_bag::embedding_bag_impl(
+        return torch_ipex::cpu::aten::embedding_bag::embedding_bag_impl(
             weight, indices, offsets, scale_grad_by_freq, mode, sparse,
             per_sample_weights, include_last_offset);
-        return {ret};
       }
     } catch (std::exception &e) {
 #if defined(_DEBUG)
@@ -621,23 +620,27 @@ public:
     try {
       if (torch_ipex::check_auto_dnnl() &&
           (torch_ipex::cpu::aten::embedding_bag::
-               embedding_bag_backward_fast_path_sum(
-                   grad, indices, offset2bag, per_sample_weights,
-                   scale_grad_by_freq, mode)) &&
+               embedding_bag_backward_fast_path(
+                   grad, indices, offset2bag, maximum_indices,
+                   per_sample_weights, scale_grad_by_freq, mode, sparse)) &&
           weight.device().type() == c10::DeviceType::XPU &&
           indices.device().type() == c10::DeviceType::XPU &&
           offsets.device().type() == c10::DeviceType::XPU) {
-        return {
+        auto weight_grad =
             torch_ipex::cpu::aten::embedding_bag::embedding_bag_backward_impl(
                 grad, indices, offsets, offset2bag, bag_size, maximum_indices,
                 num_weights, scale_grad_by_freq, mode, sparse,
-                per_sample_weights),
-            at::Tensor(),
-            at::Tensor(),
-            at::Tensor(),
-            at::Tensor(),
-            at::Tensor(),
-            at::Tensor()};
+                per_sample_weights);
+        auto per_sample_weights_grad =
+            (per_sample_weights.defined() && per_sample_weights.requires_grad())
+                ? torch_ipex::cpu::aten::embedding_bag::
+                      embedding_bag_per_sample_weights_backward_impl(
+                          grad, weight, indices, offsets, mode)
+                : at::Tensor();
+        return {weight_grad,  at::Tensor(),
+                at::Tensor(), at::Tensor(),
+                at::Tensor(), at::Tensor(),
+                at::Tensor(), per_sample_weights_grad};
       }
     } catch (std::exception &e) {
 #if defined(_DEBUG)
@@ -844,3 +847,118 @@ public:
     return {output, at::Tensor(), at::Tensor(), at::Tensor(), at::Tensor()};
   }
 };
+
+class NewDropoutOp : public torch::autograd::Function<NewDropoutOp> {
+public:
+  // Returns the output and the bit-packed mask, the output is dropout(input) + residual
+  // if residual is defined.
+  static std::tuple<at::Tensor, at::Tensor> _forward(const at::Tensor& input, double p,
+                                                     const at::Tensor& residual = at::Tensor()) {
+#if defined(IPEX_PROFILE_OP)
+    RECORD_FUNCTION("NewDropoutOp::_forward", std::vector<c10::IValue>({input, p, residual}),
+                    torch::autograd::Node::peek_at_next_sequence_nr());
+#endif
+    return torch_ipex::cpu::AtenIpexCPUDev::dil_dropout(input, p, residual);
+  }
+
+  static at::Tensor forward(torch::autograd::AutogradContext *ctx, const at::Tensor& input, double p) {
+#if defined(IPEX_PROFILE_OP)
+    RECORD_FUNCTION("NewDropoutOp::forward", std::vector<c10::IValue>({input, p}),
+                    torch::autograd::Node::peek_at_next_sequence_nr());
+#endif
+    at::Tensor output, mask;
+    std::tie(output, mask) = _forward(input, p);
+    ctx->saved_data["p"] = p;
+    ctx->save_for_backward({mask});
+    return output;
+  }
+
+  static torch::autograd::tensor_list
+  backward(torch::autograd::AutogradContext *ctx,
+           torch::autograd::tensor_list grad_outputs) {
+#if defined(IPEX_PROFILE_OP)
+    RECORD_FUNCTION("NewDropoutOp::backward", std::vector<c10::IValue>({}),
+                    torch::autograd::Node::peek_at_next_sequence_nr());
+#endif
+    auto saved = ctx->get_saved_variables();
+    at::Tensor mask = saved[0];
+    double p = ctx->saved_data["p"].toDouble();
+    at::Tensor grad_output = grad_outputs[0].contiguous();
+    auto grad_input = torch_ipex::cpu::AtenIpexCPUDev::dil_dropout_backward(grad_output, mask, p);
+    return {grad_input, at::Tensor()};
+  }
+};
+
+class NewDropoutAddOp : public torch::autograd::Function<NewDropoutAddOp> {
+public:
+  static at::Tensor forward(torch::autograd::AutogradContext *ctx, const at::Tensor& input,
+                            const at::Tensor& residual, double p) {
+#if defined(IPEX_PROFILE_OP)
+    RECORD_FUNCTION("NewDropoutAddOp::forward", std::vector<c10::IValue>({input, residual, p}),
+                    torch::autograd::Node::peek_at_next_sequence_nr());
+#endif
+    at::Tensor output, mask;
+    std::tie(output, mask) = NewDropoutOp::_forward(input, p, residual);
+    ctx->saved_data["p"] = p;
+    ctx->save_for_backward({mask});
+    return output;
+  }
+
+  static torch::autograd::tensor_list
+  backward(torch::autograd::AutogradContext *ctx,
+           torch::autograd::tensor_list grad_outputs) {
+#if defined(IPEX_PROFILE_OP)
+    RECORD_FUNCTION("NewDropoutAddOp::backward", std::vector<c10::IValue>({}),
+                    torch::autograd::Node::peek_at_next_sequence_nr());
+#endif
+    auto saved = ctx->get_saved_variables();
+    at::Tensor mask = saved[0];
+    double p = ctx->saved_data["p"].toDouble();
+    at::Tensor grad_output = grad_outputs[0].contiguous();
+    auto grad_input = torch_ipex::cpu::AtenIpexCPUDev::dil_dropout_backward(grad_output, mask, p);
+    return {grad_input, grad_output, at::Tensor()};
+  }
+};
+
+class NewAddLayerNormOp : public torch::autograd::Function<NewAddLayerNormOp> {
+public:
+  // layer_norm(dropout(input, p) + residual) over the last N elements
+  static at::Tensor _forward(const at::Tensor& input, const at::Tensor& residual, const at::Tensor& weight,
+                             const at::Tensor& bias, int64_t N, double eps, double p) {
+#if defined(IPEX_PROFILE_OP)
+    RECORD_FUNCTION("NewAddLayerNormOp::_forward", std::vector<c10::IValue>({input, residual, weight, bias, N, eps, p}),
+                    torch::autograd::Node::peek_at_next_sequence_nr());
+#endif
+    return torch_ipex::cpu::AtenIpexCPUDev::dil_add_layer_norm(input, residual, weight, bias, N, eps, p, false)[0];
+  }
+
+  static at::Tensor forward(torch::autograd::AutogradContext *ctx, const at::Tensor& input, const at::Tensor& residual,
+                            const at::Tensor& weight, const at::Tensor& bias, int64_t N, double eps, double p) {
+#if defined(IPEX_PROFILE_OP)
+    RECORD_FUNCTION("NewAddLayerNormOp::forward", std::vector<c10::IValue>({input, residual, weight, bias, N, eps, p}),
+                    torch::autograd::Node::peek_at_next_sequence_nr());
+#endif
+    auto outputs = torch_ipex::cpu::AtenIpexCPUDev::dil_add_layer_norm(input, residual, weight, bias, N, eps, p, true);
+    ctx->saved_data["N"] = N;
+    ctx->saved_data["p"] = p;
+    // outputs: output, sum, mean, rstd, mask
+    ctx->save_for_backward({outputs[1], outputs[2], outputs[3], weight, outputs[4]});
+    return outputs[0];
+  }
+
+  static torch::autograd::tensor_list
+  backward(torch::autograd::AutogradContext *ctx,
+           torch::autograd::tensor_list grad_outputs) {
+#if defined(IPEX_PROFILE_OP)
+    RECORD_FUNCTION("NewAddLayerNormOp::backward", std::vector<c10::IValue>({}),
+                    torch::autograd::Node::peek_at_next_sequence_nr());
+#endif
+    auto saved = ctx->get_saved_variables();
+    int64_t N = ctx->saved_data["N"].toInt();
+    double p = ctx->saved_data["p"].toDouble();
+    at::Tensor grad_output = grad_outputs[0].contiguous();
+    auto grads = torch_ipex::cpu::AtenIpexCPUDev::dil_add_layer_norm_backward(
+        grad_output, saved[0], saved[1], saved[2], saved[3], saved[4], N, p);
+    return {grads[0], grads[1], grads[2], grads[3], at::Tensor(), at::Tensor(), at::Tensor()};
+  }
+};
@@ -1,5 +1,6 @@
 #include "torch_ipex/csrc/cpu/DevOPs.h"
 
+#include <ATen/CPUGeneratorImpl.h>
 #include <ATen/Context.h>
 #include <ATen/InferSize.h>
 #include <ATen/NamedTensorUtils.h>
@@ -9,6 +10,7 @@
 #include <torch/csrc/autograd/function.h>
 
 #include <limits>
+#include <mutex>
 
 #include "torch_ipex/csrc/cpu/int8/Config.h"
 #include "torch_ipex/csrc/aten_ipex_bridge.h"
@@ -87,13 +89,14 @@ at::Tensor AtenIpexCPUDev::dil_convolution(
   bool quantized = false;
   std::vector<float> output_scale = {};
   if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
-    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id();
+    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id("Convolution");
     quantized = dbl::comm::get_int8_quantized_status(num_ops_id);
     std::vector<std::vector<float>> scales = dbl::comm::get_int8_scales(
         {input}, /*  uint8_used for output*/ false, num_ops_id);
     if (quantized) {
       output_scale.push_back(scales[1][0]);
-      dbl::comm::reorder_to_int8_for_mix_prec(input, scales[0]);
+      dbl::comm::reorder_to_int8_for_mix_prec(input, scales[0], /*uint8_used*/ false,
+                                              dbl::comm::get_int8_zero_points(num_ops_id));
       dbl::comm::reorder_to_int8_for_mix_prec(weight, {});
     } else {
       dbl::comm::reorder_to_dtype(input, at::kFloat);
@@ -150,7 +153,7 @@ at::Tensor AtenIpexCPUDev::dil_convolution(
 
   if (check_auto_mix_int8_fp32() && check_int8_calibration()) {
     insert_or_updata_observer({input}, {aten_output}, "Convolution",
-                              Int8OptConfig::fetch_and_add_ops_id());
+                              Int8OptConfig::fetch_and_add_ops_id("Convolution"));
   }
 
   return aten_output;
@@ -1026,16 +1029,23 @@ at::Tensor AtenIpexCPUDev::dil_linear(
                               attr.get_post_ops().kind(0) == dnnl::primitive::kind::eltwise,
                               "dil linear only fuse with eltwise now");
 
+  auto op_name = attr.get_post_ops().len() == 0 ? "Linear" : "LinearFuseEltwise";
   std::vector<float> output_scale = {};
   bool quantized = false;
-  if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
-    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id();
+  // a weight prepacked by quantize_dynamic: the activation is quantized with the scale of its own
+  // min/max, and the linear is neither calibrated nor configured by the indicators
+  bool dynamic_int8 = !check_train() && ShadeDataContext::isDynamicInt8Tensor(weight);
+  if (dynamic_int8) {
+    dbl::comm::reorder_to_dtype(self, at::kFloat);
+  } else if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
+    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id(op_name);
     quantized = dbl::comm::get_int8_quantized_status(num_ops_id);
     std::vector<std::vector<float>> scales = dbl::comm::get_int8_scales(
         {self}, /*  uint8_used for output*/ false, num_ops_id);
     if (quantized) {
       output_scale.push_back(scales[1][0]);
-      dbl::comm::reorder_to_int8_for_mix_prec(self, scales[0]);
+      dbl::comm::reorder_to_int8_for_mix_prec(self, scales[0], /*uint8_used*/ false,
+                                              dbl::comm::get_int8_zero_points(num_ops_id));
       dbl::comm::reorder_to_int8_for_mix_prec(weight, {});
     } else {
       dbl::comm::reorder_to_dtype(self, at::kFloat);
@@ -1054,9 +1064,17 @@ at::Tensor AtenIpexCPUDev::dil_linear(
   }
   const dil::tensor w = dbl::comm::try_gen_dil_tensor(weight);
 
+  std::vector<float> input_scale = {};
+  if (dynamic_int8) {
+    input_scale.push_back(dbl::linear::dynamic_int8_input_scale(x));
+  }
+
   c10::optional<dil::tensor> b{c10::nullopt};
   if (bias.defined()) {
-    if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
+    if (dynamic_int8) {
+      // the s32 bias scale changes with the input scale, the f32 bias is quantized every call
+      dbl::comm::reorder_to_dtype(bias, at::kFloat);
+    } else if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
       if (quantized) {
         auto src = dbl::comm::try_gen_dil_storage(bias);
         auto src_type = src.get_data_type();
@@ -1075,7 +1093,7 @@ at::Tensor AtenIpexCPUDev::dil_linear(
     b = dbl::comm::try_gen_dil_tensor(bias);
   }
 
-  dil::tensor y = dbl::linear::linear_impl(x, w, b, output_scale, attr);
+  dil::tensor y = dbl::linear::linear_impl(x, w, b, output_scale, attr, input_scale, weight);
 
   if (self.dim() > 2) {
     auto input_size = self.sizes();
@@ -1086,10 +1104,9 @@ at::Tensor AtenIpexCPUDev::dil_linear(
 
   auto aten_output = dbl::comm::gen_aten_tensor_by(std::move(y));
 
-  if (check_auto_mix_int8_fp32() && check_int8_calibration()) {
-    auto op_name = attr.get_post_ops().len() == 0 ? "Linear" : "LinearFuseEltwise";
+  if (check_auto_mix_int8_fp32() && check_int8_calibration() && !dynamic_int8) {
     insert_or_updata_observer({self}, {aten_output}, op_name,
-                              Int8OptConfig::fetch_and_add_ops_id());
+                              Int8OptConfig::fetch_and_add_ops_id(op_name));
   }
 
   return aten_output;
@@ -1172,29 +1189,67 @@ std::tuple<at::Tensor, at::Tensor, at::Tensor> AtenIpexCPUDev::dil_linear_backwa
   return std::tuple<at::Tensor, at::Tensor, at::Tensor>{grad_input, grad_weight, grad_bias};
 }
 
-std::tuple<at::Tensor, at::Tensor> _dil_dropout(
-    const at::Tensor& self,
-    double ratio) {
-  IPEX_CHECK(
-      ratio >= 0 && ratio < 1 && self.numel() != 0,
-      "dropout probability has to be between 0 and 1, but got ",
-      ratio);
-  dil::tensor x = dbl::comm::try_gen_dil_tensor(self);
-  dil::tensor mask;
-  dil::tensor y;
-  dil::dropout_forward::compute(x, ratio, y, mask);
-  return std::tuple<at::Tensor, at::Tensor>{
-      dbl::comm::gen_aten_tensor_by(std::move(y)),
-      dbl::comm::gen_aten_tensor_by(std::move(mask))};
+// Kernels indexing the elements in row major order (the dropout mask, the rows
+// of the fused layer norm) need the tensor in the default plain format of
+// `dtype`, reorder it if it is not there yet.
+dil::tensor plain_dil_tensor(const dil::tensor& t, dil::data_type dtype) {
+  auto plain_desc = t.get_desc().to_default_format().to_type(dtype);
+  if (t.get_desc() == plain_desc) {
+    return t;
+  }
+  dil::tensor plain{plain_desc};
+  t.reorder_to(plain);
+  if (t.has_scale() && dtype == t.get_data_type()) {
+    plain.set_scale(t.get_scale());
+  }
+  return plain;
+}
+
+// Seed of the Philox stream drawing a dropout mask, taken from the default CPU
+// generator so that torch.manual_seed makes the masks reproducible.
+uint64_t dropout_seed() {
+  auto gen = at::get_generator_or_default<at::CPUGeneratorImpl>(
+      c10::nullopt, at::detail::getDefaultCPUGenerator());
+  std::lock_guard<std::mutex> lock(gen->mutex_);
+  return gen->random64();
 }
 
-at::Tensor AtenIpexCPUDev::dil_dropout(const at::Tensor& self, double ratio, bool train) {
+std::tuple<at::Tensor, at::Tensor> AtenIpexCPUDev::dil_dropout(
+    const at::Tensor& self,
+    double ratio,
+    const at::Tensor& residual) {
   DEBUG("AtenIpexCPUDev::dil_dropout\n");
   CHECK_DNNL_OP_PRE_COND(self);
+  IPEX_CHECK(
+      ratio >= 0 && ratio < 1,
+      "dropout probability has to be between 0 and 1, but got ",
+      ratio);
+  if (residual.defined()) {
+    IPEX_CHECK(residual.sizes() == self.sizes(), "dropout residual should have the shape of input");
+  }
+  // nothing to draw, the backward returns the empty gradient as is
+  if (self.numel() == 0) {
+    return std::tuple<at::Tensor, at::Tensor>{at::empty_like(self), at::empty({0}, at::kByte)};
+  }
 
   dbl::comm::reorder_to_bf16_for_mix_prec(self, true);
-
-  return std::get<0>(_dil_dropout(self, ratio));
+  dil::tensor x = dbl::comm::try_gen_dil_tensor(self);
+  const auto nelems = x.get_nelems();
+  // One bit per element, 1/32 of the fp32 mask it replaces
+  auto mask = at::empty({dil::dropout_utils::get_mask_size(nelems)}, at::kByte);
+  dil::tensor mask_dil{dil::dropout_utils::get_mask_desc(nelems), mask.data_ptr()};
+  dil::tensor y;
+  if (residual.defined()) {
+    dbl::comm::reorder_to_bf16_for_mix_prec(residual, true);
+    auto dtype = x.get_data_type() == dil::data_type::bf16 ? dil::data_type::bf16 : dil::data_type::f32;
+    x = plain_dil_tensor(x, dtype);
+    auto res = plain_dil_tensor(dbl::comm::try_gen_dil_tensor(residual), dtype);
+    dil::dropout_forward::compute(x, res, ratio, dropout_seed(), y, mask_dil);
+  } else {
+    x = plain_dil_tensor(x, x.get_data_type());
+    dil::dropout_forward::compute(x, ratio, dropout_seed(), y, mask_dil);
+  }
+  return std::tuple<at::Tensor, at::Tensor>{dbl::comm::gen_aten_tensor_by(std::move(y)), mask};
 }
 
 at::Tensor AtenIpexCPUDev::dil_dropout_backward(
@@ -1208,12 +1263,15 @@ at::Tensor AtenIpexCPUDev::dil_dropout_backward(
   }
 
   dbl::comm::reorder_to_bf16_for_mix_prec(grady, true);
-  dbl::comm::reorder_to_bf16_for_mix_prec(mask, true);
 
   dil::tensor dY = dbl::comm::try_gen_dil_tensor(grady);
-  dil::tensor mask_dil = dbl::comm::try_gen_dil_tensor(mask);
+  dY = plain_dil_tensor(dY, dY.get_data_type());
+  IPEX_CHECK(mask.scalar_type() == at::kByte && mask.is_contiguous() &&
+      mask.numel() == dil::dropout_utils::get_mask_size(dY.get_nelems()),
+      "dropout mask does not match the gradient");
+  dil::tensor mask_dil{dil::dropout_utils::get_mask_desc(dY.get_nelems()), mask.data_ptr()};
   dil::tensor dX;
-  dil::dropout_backward::compute(mask_dil, dY, dX);
+  dil::dropout_backward::compute(mask_dil, ratio, dY, dX);
   return dbl::comm::gen_aten_tensor_by(std::move(dX));
 }
 
@@ -1240,7 +1298,7 @@ std::tuple<at::Tensor, at::Tensor, at::Tensor> AtenIpexCPUDev::dil_native_batch_
   std::vector<float> input_scales = {};
   std::vector<float> output_scales = {};
   if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
-    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id();
+    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id("BatchNorm");
     bool quantized = dbl::comm::get_int8_quantized_status(num_ops_id);
     std::vector<std::vector<float>> scales = dbl::comm::get_int8_scales(
         {input}, /*  uint8_used for output*/ false, num_ops_id);
@@ -1293,7 +1351,7 @@ std::tuple<at::Tensor, at::Tensor, at::Tensor> AtenIpexCPUDev::dil_native_batch_
 
     if (check_auto_mix_int8_fp32() && check_int8_calibration()) {
       insert_or_updata_observer({input}, {aten_output}, "BatchNorm",
-                                Int8OptConfig::fetch_and_add_ops_id());
+                                Int8OptConfig::fetch_and_add_ops_id("BatchNorm"));
     }
 
     return std::make_tuple(aten_output, at::Tensor(), at::Tensor());
@@ -1353,7 +1411,7 @@ at::Tensor AtenIpexCPUDev::dil_frozen_batch_norm(
   std::vector<float> output_scales = {};
   bool quantized = false;
   if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
-    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id();
+    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id("BatchNorm");
     quantized = dbl::comm::get_int8_quantized_status(num_ops_id);
     std::vector<std::vector<float>> scales = dbl::comm::get_int8_scales(
         {input}, /*  uint8_used for output*/ false, num_ops_id);
@@ -1380,7 +1438,7 @@ at::Tensor AtenIpexCPUDev::dil_frozen_batch_norm(
   auto aten_output = dbl::comm::gen_aten_tensor_by(std::move(y));
   if (check_auto_mix_int8_fp32() && check_int8_calibration()) {
     insert_or_updata_observer({input}, {aten_output}, "BatchNorm",
-                              Int8OptConfig::fetch_and_add_ops_id());
+                              Int8OptConfig::fetch_and_add_ops_id("BatchNorm"));
   }
   return aten_output;
 }
@@ -1423,7 +1481,7 @@ at::Tensor AtenIpexCPUDev::dil_max_pooling(
   DEBUG("AtenIpexCPUDev::dil_max_pooling\n");
   CHECK_DNNL_OP_PRE_COND(input);
   if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
-    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id();
+    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id("MaxPooling");
     bool quantized = dbl::comm::get_int8_quantized_status(num_ops_id);
     std::vector<std::vector<float>> scales = dbl::comm::get_int8_scales(
         {input}, /*  uint8_used for output*/ false, num_ops_id);
@@ -1438,7 +1496,7 @@ at::Tensor AtenIpexCPUDev::dil_max_pooling(
 
   if (check_auto_mix_int8_fp32() && check_int8_calibration()) {
     insert_or_updata_observer({input}, {input}, "MaxPooling",
-                              Int8OptConfig::fetch_and_add_ops_id());
+                              Int8OptConfig::fetch_and_add_ops_id("MaxPooling"));
   }
   return dbl::pool::_dil_pooling(
       input,
@@ -1464,7 +1522,7 @@ at::Tensor AtenIpexCPUDev::dil_avg_pool2d(
            "dil_avg_pooling operator does not support divisor");
 
   if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
-    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id();
+    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id("AvgPool2d");
     bool quantized = dbl::comm::get_int8_quantized_status(num_ops_id);
     std::vector<std::vector<float>> scales = dbl::comm::get_int8_scales(
         {input}, /*  uint8_used for output*/ false, num_ops_id);
@@ -1479,7 +1537,7 @@ at::Tensor AtenIpexCPUDev::dil_avg_pool2d(
 
   if (check_auto_mix_int8_fp32() && check_int8_calibration()) {
     insert_or_updata_observer({input}, {input}, "AvgPool2d",
-                              Int8OptConfig::fetch_and_add_ops_id());
+                              Int8OptConfig::fetch_and_add_ops_id("AvgPool2d"));
   }
 
   return dbl::pool::_dil_pooling(
@@ -1526,7 +1584,7 @@ at::Tensor AtenIpexCPUDev::dil_adaptive_avg_pool2d(
   CHECK_DNNL_OP_PRE_COND(input);
 
   if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
-    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id();
+    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id("AdaptiveAvgPool2d");
     bool quantized = dbl::comm::get_int8_quantized_status(num_ops_id);
     std::vector<std::vector<float>> scales = dbl::comm::get_int8_scales(
         {input}, /*  uint8_used for output*/ false, num_ops_id);
@@ -1561,7 +1619,7 @@ at::Tensor AtenIpexCPUDev::dil_adaptive_avg_pool2d(
 
   if (check_auto_mix_int8_fp32() && check_int8_calibration()) {
     insert_or_updata_observer({input}, {input}, "AdaptiveAvgPool2d",
-                              Int8OptConfig::fetch_and_add_ops_id());
+                              Int8OptConfig::fetch_and_add_ops_id("AdaptiveAvgPool2d"));
   }
   return dbl::pool::_dil_pooling(
       input,
@@ -1709,7 +1767,7 @@ at::Tensor AtenIpexCPUDev::dil_relu(const at::Tensor& input) {
   DEBUG("AtenIpexCPUDev::dil_relu\n");
   CHECK_DNNL_OP_PRE_COND(input);
   if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
-    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id();
+    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id("Relu");
     bool quantized = dbl::comm::get_int8_quantized_status(num_ops_id);
     std::vector<std::vector<float>> scales = dbl::comm::get_int8_scales(
         {input}, /*  uint8_used for output*/ true, num_ops_id);
@@ -1729,7 +1787,7 @@ at::Tensor AtenIpexCPUDev::dil_relu(const at::Tensor& input) {
 
   if (check_auto_mix_int8_fp32() && check_int8_calibration()) {
     insert_or_updata_observer({input}, {input}, "Relu",
-                              Int8OptConfig::fetch_and_add_ops_id());
+                              Int8OptConfig::fetch_and_add_ops_id("Relu"));
   }
 
   return dbl::comm::gen_aten_tensor_by(std::move(y));
@@ -1740,7 +1798,7 @@ at::Tensor& AtenIpexCPUDev::dil_relu_(at::Tensor& input) {
   CHECK_DNNL_OP_PRE_COND(input);
 
   if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
-    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id();
+    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id("Relu_");
     bool quantized = dbl::comm::get_int8_quantized_status(num_ops_id);
     std::vector<std::vector<float>> scales = dbl::comm::get_int8_scales(
         {input}, /*  uint8_used for output*/ true, num_ops_id);
@@ -1756,7 +1814,7 @@ at::Tensor& AtenIpexCPUDev::dil_relu_(at::Tensor& input) {
 
   if (check_auto_mix_int8_fp32() && check_int8_calibration()) {
     insert_or_updata_observer({input}, {input}, "Relu_",
-                              Int8OptConfig::fetch_and_add_ops_id());
+                              Int8OptConfig::fetch_and_add_ops_id("Relu_"));
   }
 
   auto dil_self = dbl::comm::try_gen_dil_tensor(input);
@@ -2491,6 +2549,136 @@ std::tuple<at::Tensor, at::Tensor, at::Tensor> AtenIpexCPUDev::dil_native_layer_
       dbl::comm::gen_aten_tensor_by(std::move(gradb)));
 }
 
+std::vector<at::Tensor> AtenIpexCPUDev::dil_add_layer_norm(
+    const at::Tensor& input,
+    const at::Tensor& residual,
+    const at::Tensor& gamma,
+    const at::Tensor& beta,
+    int64_t N,
+    double eps,
+    double p,
+    bool keep_sum) {
+  DEBUG("AtenIpexCPUDev::dil_add_layer_norm\n");
+  CHECK_DNNL_OP_PRE_COND(input);
+  CHECK_DNNL_OP_PRE_COND(residual);
+  IPEX_CHECK(residual.sizes() == input.sizes(), "add_layer_norm residual should have the shape of input");
+  IPEX_CHECK(p >= 0 && p < 1, "dropout probability has to be between 0 and 1, but got ", p);
+  IPEX_CHECK(p == 0 || N % 8 == 0, "add_layer_norm with dropout needs a normalized size of a multiple of 8");
+
+  dbl::comm::reorder_to_bf16_for_mix_prec(input, true);
+  dbl::comm::reorder_to_bf16_for_mix_prec(residual, true);
+  dil::tensor x = dbl::comm::try_gen_dil_tensor(input);
+  auto dtype = x.get_data_type() == dil::data_type::bf16 ? dil::data_type::bf16 : dil::data_type::f32;
+  x = plain_dil_tensor(x, dtype);
+  auto res = plain_dil_tensor(dbl::comm::try_gen_dil_tensor(residual), dtype);
+  dil::tensor scale, shift;
+  if (gamma.defined()) {
+    scale = plain_dil_tensor(dbl::comm::try_gen_dil_tensor(gamma), dil::data_type::f32);
+  }
+  if (beta.defined()) {
+    shift = plain_dil_tensor(dbl::comm::try_gen_dil_tensor(beta), dil::data_type::f32);
+  }
+
+  at::Tensor mask;
+  dil::tensor mask_dil;
+  if (p > 0) {
+    mask = at::empty({dil::dropout_utils::get_mask_size(x.get_nelems())}, at::kByte);
+    mask_dil.init(dil::dropout_utils::get_mask_desc(x.get_nelems()), mask.data_ptr());
+  }
+  dil::tensor y, sum, mean, rstd;
+  dil::add_layer_normalization_forward::compute(
+      x, res, scale, shift, y, sum, mean, rstd, mask_dil, N, eps, p, p > 0 ? dropout_seed() : 0, keep_sum);
+  return {
+      dbl::comm::gen_aten_tensor_by(std::move(y)),
+      keep_sum ? dbl::comm::gen_aten_tensor_by(std::move(sum)) : at::Tensor(),
+      dbl::comm::gen_aten_tensor_by(std::move(mean)),
+      dbl::comm::gen_aten_tensor_by(std::move(rstd)),
+      mask};
+}
+
+std::vector<at::Tensor> AtenIpexCPUDev::dil_add_layer_norm_backward(
+    const at::Tensor& grad_output,
+    const at::Tensor& sum,
+    const at::Tensor& mean,
+    const at::Tensor& rstd,
+    const at::Tensor& gamma,
+    const at::Tensor& mask,
+    int64_t N,
+    double p) {
+  DEBUG("AtenIpexCPUDev::dil_add_layer_norm_backward\n");
+  CHECK_DNNL_OP_PRE_COND(grad_output);
+  CHECK_DNNL_OP_PRE_COND(sum);
+
+  dil::tensor x = dbl::comm::try_gen_dil_tensor(sum);
+  dil::tensor dy = plain_dil_tensor(dbl::comm::try_gen_dil_tensor(grad_output), x.get_data_type());
+  dil::tensor m = dbl::comm::try_gen_dil_tensor(mean);
+  dil::tensor r = dbl::comm::try_gen_dil_tensor(rstd);
+  dil::tensor scale;
+  if (gamma.defined()) {
+    scale = plain_dil_tensor(dbl::comm::try_gen_dil_tensor(gamma), dil::data_type::f32);
+  }
+  dil::tensor mask_dil;
+  if (p > 0) {
+    IPEX_CHECK(mask.scalar_type() == at::kByte && mask.is_contiguous() &&
+        mask.numel() == dil::dropout_utils::get_mask_size(x.get_nelems()),
+        "dropout mask does not match the gradient");
+    mask_dil.init(dil::dropout_utils::get_mask_desc(x.get_nelems()), mask.data_ptr());
+  }
+  dil::tensor gradx, grad_res, gradg, gradb;
+  dil::add_layer_normalization_backward::compute(
+      x, m, r, scale, mask_dil, dy, gradx, grad_res, gradg, gradb, N, p);
+
+  at::Tensor grad_residual = dbl::comm::gen_aten_tensor_by(std::move(grad_res));
+  at::Tensor grad_input = p > 0 ? dbl::comm::gen_aten_tensor_by(std::move(gradx)) : grad_residual;
+  at::Tensor grad_gamma, grad_beta;
+  if (gamma.defined()) {
+    auto gamma_type = dbl::comm::try_gen_dil_tensor(gamma).get_data_type();
+    grad_gamma = dbl::comm::gen_aten_tensor_by(gradg.to_public(nullptr, gamma_type));
+    grad_beta = dbl::comm::gen_aten_tensor_by(gradb.to_public(nullptr, gamma_type));
+  }
+  return {grad_input, grad_residual, grad_gamma, grad_beta};
+}
+
+at::Tensor AtenIpexCPUDev::dil_attention(
+    const at::Tensor& query,
+    const at::Tensor& key,
+    const at::Tensor& value,
+    const at::Tensor& attn_mask,
+    double scale,
+    bool interleave_heads) {
+  DEBUG("AtenIpexCPUDev::dil_attention\n");
+  CHECK_DNNL_OP_PRE_COND(query);
+  CHECK_DNNL_OP_PRE_COND(key);
+  CHECK_DNNL_OP_PRE_COND(value);
+
+  // int8 inputs take the unfused ops, the kernel computes in f32, or bf16
+  // when the inputs are bf16
+  dbl::comm::reorder_to_bf16_for_mix_prec(query);
+  dbl::comm::reorder_to_bf16_for_mix_prec(key);
+  dbl::comm::reorder_to_bf16_for_mix_prec(value);
+
+  // the heads are strided views of the projections, they are read in place
+  std::vector<dil::tensor> qkv;
+  for (const auto& t : {query, key, value}) {
+    dil::tensor x = dbl::comm::try_gen_dil_tensor(t);
+    IPEX_CHECK(x.get_dims() == t.sizes().vec() && x.is_public_format(),
+        "dil_attention expects plain query, key and value");
+    qkv.push_back(std::move(x));
+  }
+
+  dil::tensor mask;
+  if (attn_mask.defined()) {
+    mask = dbl::comm::try_gen_dil_tensor(attn_mask);
+    if (mask.get_data_type() != dil::data_type::f32 || !mask.is_public_format()) {
+      mask = mask.to_public(nullptr, dil::data_type::f32);
+    }
+  }
+
+  dil::tensor y;
+  dil::attention_forward::compute(qkv[0], qkv[1], qkv[2], mask, static_cast<float>(scale), y, interleave_heads);
+  return dbl::comm::gen_aten_tensor_by(std::move(y));
+}
+
 at::Tensor AtenIpexCPUDev::dil_index_select(
     const at::Tensor & self,
     int64_t dim,
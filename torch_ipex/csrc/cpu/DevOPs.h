@@ -43,7 +43,7 @@ class AtenIpexCPUDev {
   static at::Tensor dil_linear_backward_input(at::IntArrayRef input_size, const at::Tensor& grad_output, const at::Tensor& weight);
   static std::tuple<at::Tensor, at::Tensor> dil_linear_backward_weights(const at::Tensor& grad_output, const at::Tensor& input, const at::Tensor& weight, bool bias_defined);
   static std::tuple<at::Tensor, at::Tensor, at::Tensor> dil_linear_backward(const at::Tensor& input, const at::Tensor& grad_output, const at::Tensor& weight, std::array<bool,3> output_mask);
-  static at::Tensor dil_dropout(const at::Tensor& self, double ratio, bool train);
+  static std::tuple<at::Tensor, at::Tensor> dil_dropout(const at::Tensor& self, double ratio, const at::Tensor& residual = at::Tensor());
   static at::Tensor dil_dropout_backward(const at::Tensor& grady, const at::Tensor& mask, double ratio);
   static std::tuple<at::Tensor, at::Tensor, at::Tensor> dil_native_batch_norm(const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, const at::Tensor& running_mean, const at::Tensor& running_var, bool train, double momentum, double eps);
   static std::tuple<at::Tensor, at::Tensor, at::Tensor> dil_native_batch_norm_backward(const at::Tensor& grad_output, const at::Tensor& input, const at::Tensor& weight, const at::Tensor& running_mean, const at::Tensor& running_var, const at::Tensor& save_mean, const at::Tensor& save_invstd, bool train,double eps, std::array<bool,3> grad_input_mask);
@@ -82,6 +82,9 @@ class AtenIpexCPUDev {
   static at::Tensor dil_gelu_backward(const at::Tensor& grad_output, const at::Tensor& input);
   static std::tuple<at::Tensor, at::Tensor, at::Tensor> dil_native_layer_norm(const at::Tensor& X, const at::Tensor& gamma, const at::Tensor& beta, int64_t M, int64_t N, double eps);
   static std::tuple<at::Tensor, at::Tensor, at::Tensor> dil_native_layer_norm_backward(const at::Tensor& dY, const at::Tensor& X, const at::Tensor& mean, const at::Tensor& rstd, const at::Tensor& gamma, int64_t M, int64_t N, std::array<bool, 3> grad_input_mask);
+  static std::vector<at::Tensor> dil_add_layer_norm(const at::Tensor& input, const at::Tensor& residual, const at::Tensor& gamma, const at::Tensor& beta, int64_t N, double eps, double p, bool keep_sum);
+  static std::vector<at::Tensor> dil_add_layer_norm_backward(const at::Tensor& grad_output, const at::Tensor& sum, const at::Tensor& mean, const at::Tensor& rstd, const at::Tensor& gamma, const at::Tensor& mask, int64_t N, double p);
+  static at::Tensor dil_attention(const at::Tensor& query, const at::Tensor& key, const at::Tensor& value, const at::Tensor& attn_mask, double scale, bool interleave_heads = false);
   static at::Tensor dil_slice(const at::Tensor & self, int64_t dim, int64_t start, int64_t end, int64_t step);
   static std::vector<at::Tensor> dil_unbind(const at::Tensor &self, int64_t dim);
   static std::vector<at::Tensor> dil_unbind(const at::Tensor& self, at::Dimname dim);
@@ -3,13 +3,16 @@
 #include "CustomOPs.h"
 #include "DevOPs.h"
 #include "FusionOPs.h"
+#include "ShadeDataContext.h"
 #include "aten/aten.hpp"
 #include "bf16/vec/bf16_vec_kernel.h"
+#include "bf16/vec/vec_kernel_dispatch.h"
 #include "dil/dil.hpp"
 #include "xsmm/libxsmm_utils.h"
 #include <ATen/Parallel.h>
 #include <ATen/MatrixRef.h>
 #include <algorithm>
+#include <numeric>
 #include <c10/util/Exception.h>
 #include <torch/csrc/autograd/function.h>
 
@@ -37,6 +40,9 @@ void AtenIpexTypeExt::packed_add_(at::Tensor &top_half, at::Tensor &bot_half,
   RECORD_FUNCTION("packed_add_", std::vector<c10::IValue>({top_half, bot_half, grad, alpha}));
 #endif
 
+  // the raw data updates below do not bump the version of the parameter
+  cpu::aten::embedding_bag::embedding_bag_invalidate_hot_row_cache(top_half);
+
   if (grad.is_sparse()) {
     TORCH_INTERNAL_ASSERT_DEBUG_ONLY(top_half.dim() == 2);
     auto sparse_nnz = grad._nnz();
@@ -61,61 +67,121 @@ void AtenIpexTypeExt::packed_add_(at::Tensor &top_half, at::Tensor &bot_half,
       sparse_stride[d] = top_half.stride(d);
     }
 
-    int32_t max_threads = at::get_num_threads();
-    max_threads = (entry_range < max_threads) ? entry_range : max_threads;
-    int64_t avg_size = entry_range / max_threads;
-    int64_t tail_size = entry_range % max_threads;
-    std::vector<int64_t> chunk_size(max_threads, avg_size);
-    std::transform(chunk_size.begin(), chunk_size.begin() + tail_size,
-                   chunk_size.begin(),
-                   [](int64_t a) -> int64_t { return a + 1; });
-    std::vector<int64_t> acc_chunk_size(max_threads + 1);
-    for (int64_t i = 1; i < max_threads + 1; i++) {
-      acc_chunk_size[i] = acc_chunk_size[i - 1] + chunk_size[i - 1];
+    if (sparse_nnz == 0 || entry_range == 0)
+      return;
+
+    // Rows are split into contiguous ranges, one per thread, balanced on the
+    // number of updates they receive according to a coarse histogram of the
+    // row ids. Every nnz entry is then scattered once into the bucket of the
+    // thread owning its row, so no thread rescans the whole gradient and
+    // every row has exactly one writer.
+    int64_t num_threads = at::get_num_threads();
+    num_threads = std::min(num_threads, sparse_nnz);
+    int64_t num_bins = std::min<int64_t>(entry_range, 4096);
+    auto bin_of = [&](int64_t row) { return row * num_bins / entry_range; };
+    auto slice_begin = [&](int64_t t) { return sparse_nnz * t / num_threads; };
+
+    std::vector<int64_t> bin_hist(num_threads * num_bins, 0);
+    at::parallel_for(0, num_threads, 1, [&](int64_t start, int64_t end) {
+      for (int64_t t = start; t < end; t++) {
+        auto local_hist = &bin_hist[t * num_bins];
+        for (int64_t n = slice_begin(t); n < slice_begin(t + 1); n++) {
+          local_hist[bin_of(indices_accessor[0][n])]++;
+        }
+      }
+    });
+
+    std::vector<int64_t> bin_owner(num_bins);
+    int64_t acc_nnz = 0, owner = 0;
+    for (int64_t b = 0; b < num_bins; b++) {
+      bin_owner[b] = owner;
+      for (int64_t t = 0; t < num_threads; t++) {
+        acc_nnz += bin_hist[t * num_bins + b];
+      }
+      if (owner < num_threads - 1 &&
+          acc_nnz >= sparse_nnz * (owner + 1) / num_threads) {
+        owner++;
+      }
     }
 
-    at::parallel_for(0, max_threads, 0, [&](int64_t start, int64_t end) {
-      for (int64_t c = start; c < end; c++) {
-        int64_t chunk_begin = acc_chunk_size[c];
-        int64_t chunk_end = acc_chunk_size[c + 1];
-        for (int64_t n = 0; n < sparse_nnz; n++) {
-          int64_t chunk_offset = indices_accessor[0][n];
-          if (chunk_offset >= chunk_begin && chunk_offset < chunk_end) {
-            int64_t table_offset = 0;
-            for (int64_t d = 0; d < sparse_dim; d++) {
-              table_offset += sparse_stride[d] * indices_accessor[d][n];
-            }
-            auto value_index = value_ptr + n * feature_size;
-            auto top_half_index = top_half_ptr + table_offset;
-            auto bot_half_index = bot_half_ptr + table_offset;
-            packed_bf16_add_ker(top_half_index, bot_half_index, value_index,
+    // scatter position of every (slice, owner) pair, ordered by owner first
+    std::vector<int64_t> scatter_pos(num_threads * num_threads, 0);
+    for (int64_t t = 0; t < num_threads; t++) {
+      for (int64_t b = 0; b < num_bins; b++) {
+        scatter_pos[t * num_threads + bin_owner[b]] += bin_hist[t * num_bins + b];
+      }
+    }
+    std::vector<int64_t> bucket_begin(num_threads + 1, 0);
+    int64_t pos = 0;
+    for (int64_t o = 0; o < num_threads; o++) {
+      bucket_begin[o] = pos;
+      for (int64_t t = 0; t < num_threads; t++) {
+        auto count = scatter_pos[t * num_threads + o];
+        scatter_pos[t * num_threads + o] = pos;
+        pos += count;
+      }
+    }
+    bucket_begin[num_threads] = pos;
+
+    // (table offset, nnz id) in bucket order
+    std::vector<std::pair<int64_t, int64_t>> buckets(sparse_nnz);
+    at::parallel_for(0, num_threads, 1, [&](int64_t start, int64_t end) {
+      for (int64_t t = start; t < end; t++) {
+        auto local_pos = &scatter_pos[t * num_threads];
+        for (int64_t n = slice_begin(t); n < slice_begin(t + 1); n++) {
+          int64_t table_offset = 0;
+          for (int64_t d = 0; d < sparse_dim; d++) {
+            table_offset += sparse_stride[d] * indices_accessor[d][n];
+          }
+          auto o = bin_owner[bin_of(indices_accessor[0][n])];
+          buckets[local_pos[o]++] = std::make_pair(table_offset, n);
+        }
+      }
+    });
+
+    at::parallel_for(0, num_threads, 1, [&](int64_t start, int64_t end) {
+      std::vector<float> dup_grad(feature_size);
+      for (int64_t o = start; o < end; o++) {
+        auto bucket_start = buckets.begin() + bucket_begin[o];
+        auto bucket_end = buckets.begin() + bucket_begin[o + 1];
+        std::sort(bucket_start, bucket_end);
+        for (auto it = bucket_start; it != bucket_end;) {
+          auto table_offset = it->first;
+          auto seg_end = it + 1;
+          while (seg_end != bucket_end && seg_end->first == table_offset) {
+            seg_end++;
+          }
+          auto top_half_index = top_half_ptr + table_offset;
+          auto bot_half_index = bot_half_ptr + table_offset;
+          if (seg_end - it == 1) {
+            packed_bf16_add_ker(top_half_index, bot_half_index,
+                                value_ptr + it->second * feature_size,
                                 feature_size, alpha);
+          } else {
+            // uncoalesced gradient, reduce the duplicates in fp32 first
+            zero_ker(dup_grad.data(), feature_size);
+            for (auto dup = it; dup != seg_end; dup++) {
+              add_ker(dup_grad.data(), value_ptr + dup->second * feature_size,
+                      feature_size);
+            }
+            packed_bf16_add_ker(top_half_index, bot_half_index,
+                                dup_grad.data(), feature_size, alpha);
           }
+          it = seg_end;
         }
       }
     });
   } else {
     TORCH_INTERNAL_ASSERT_DEBUG_ONLY(grad.is_contiguous());
-    // TODO: vector implementation basing on vector size
-    union packed_bf16 {
-      unsigned short s[2];
-      float f;
-    };
-
     auto len = top_half.numel();
-    auto value_ptr = grad.data_ptr<at::BFloat16>();
-    auto top_half_ptr = (unsigned short *)top_half.data_ptr();
-    auto bot_half_ptr = (unsigned short *)bot_half.data_ptr();
-
-    at::parallel_for(0, len, 0, [&](int64_t start, int64_t end) {
-      for (int64_t i = start; i < end; i++) {
-        packed_bf16 p16;
-        p16.s[0] = bot_half_ptr[i];
-        p16.s[1] = top_half_ptr[i];
-        p16.f += alpha * (float)(value_ptr[i]);
-        bot_half_ptr[i] = p16.s[0];
-        top_half_ptr[i] = p16.s[1];
-      }
+    auto value_ptr = (const uint16_t *)grad.data_ptr();
+    auto top_half_ptr = (uint16_t *)top_half.data_ptr();
+    auto bot_half_ptr = (uint16_t *)bot_half.data_ptr();
+    auto packed_bf16_add = cpu::bf16::vec::get_vec_kernels().packed_bf16_add;
+
+    at::parallel_for(0, len, 2048, [&](int64_t start, int64_t end) {
+      packed_bf16_add(top_half_ptr + start, bot_half_ptr + start,
+                      value_ptr + start, end - start, alpha);
     });
   }
 }
@@ -396,6 +462,77 @@ std::vector<at::Tensor> AtenIpexTypeExt::embedding_bag(
   }
 }
 
+void AtenIpexTypeExt::embedding_bag_backward_update_(
+    const at::Tensor &grad, at::Tensor &weight,
+    const c10::optional<at::Tensor> &bot_half,
+    const c10::optional<at::Tensor> &momentum, const at::Tensor &indices,
+    const at::Tensor &offsets, int64_t mode,
+    const c10::optional<at::Tensor> &per_sample_weights, double lr,
+    double eps) {
+#if defined(IPEX_PROFILE_OP)
+  RECORD_FUNCTION("AtenIpexTypeExt::embedding_bag_backward_update_",
+                  std::vector<c10::IValue>({grad, weight, indices, offsets}));
+#endif
+  cpu::aten::embedding_bag::embedding_bag_backward_update_impl(
+      grad, weight, bot_half.has_value() ? bot_half.value() : at::Tensor(),
+      momentum.has_value() ? momentum.value() : at::Tensor(), indices, offsets,
+      mode,
+      per_sample_weights.has_value() ? per_sample_weights.value()
+                                     : at::Tensor(),
+      lr, eps);
+}
+
+at::Tensor AtenIpexTypeExt::batched_embedding_bag_forward(
+    const std::vector<at::Tensor> &weights,
+    const std::vector<at::Tensor> &indices,
+    const std::vector<at::Tensor> &offsets, int64_t mode,
+    bool include_last_offset) {
+#if defined(IPEX_PROFILE_OP)
+  RECORD_FUNCTION("AtenIpexTypeExt::batched_embedding_bag_forward",
+                  std::vector<c10::IValue>({weights, indices, offsets}));
+#endif
+  return cpu::aten::embedding_bag::embedding_bag_batched_impl(
+      weights, indices, offsets, mode, include_last_offset);
+}
+
+std::vector<at::Tensor> AtenIpexTypeExt::batched_embedding_bag_backward(
+    const at::Tensor &grad, const std::vector<at::Tensor> &indices,
+    const std::vector<at::Tensor> &offsets, std::vector<int64_t> num_weights,
+    int64_t mode, bool sparse, bool include_last_offset) {
+#if defined(IPEX_PROFILE_OP)
+  RECORD_FUNCTION("AtenIpexTypeExt::batched_embedding_bag_backward",
+                  std::vector<c10::IValue>({grad, indices, offsets}));
+#endif
+  return cpu::aten::embedding_bag::embedding_bag_batched_backward_impl(
+      grad, indices, offsets, num_weights, mode, sparse, include_last_offset);
+}
+
+at::Tensor AtenIpexTypeExt::embedding_bag_rowwise_quantize(
+    const at::Tensor &weight, int64_t bit_width) {
+#if defined(IPEX_PROFILE_OP)
+  RECORD_FUNCTION("AtenIpexTypeExt::embedding_bag_rowwise_quantize",
+                  std::vector<c10::IValue>({weight}));
+#endif
+  return cpu::aten::embedding_bag::embedding_bag_rowwise_quantize_impl(
+      weight, bit_width);
+}
+
+at::Tensor AtenIpexTypeExt::quantized_embedding_bag(
+    const at::Tensor &qweight, const at::Tensor &indices,
+    const at::Tensor &offsets, int64_t bit_width, int64_t mode,
+    const c10::optional<at::Tensor> &per_sample_weights,
+    bool include_last_offset) {
+#if defined(IPEX_PROFILE_OP)
+  RECORD_FUNCTION("AtenIpexTypeExt::quantized_embedding_bag",
+                  std::vector<c10::IValue>({qweight, indices, offsets}));
+#endif
+  return cpu::aten::embedding_bag::quantized_embedding_bag_impl(
+      qweight, indices, offsets, bit_width, mode,
+      per_sample_weights.has_value() ? per_sample_weights.value()
+                                     : at::Tensor(),
+      include_last_offset);
+}
+
 at::Tensor AtenIpexTypeExt::linear(const at::Tensor &input,
                                    const at::Tensor &weight,
                                    const c10::optional<at::Tensor> &bias) {
@@ -598,6 +735,118 @@ at::Tensor AtenIpexTypeExt::frozen_batch_norm(const at::Tensor& input, const at:
   return FrozenBatchNormOp::_forward(input, weight, bias, running_mean, running_var);
 }
 
+at::Tensor AtenIpexTypeExt::dropout(const at::Tensor& input, double p, bool train) {
+  if (p == 0 || !train || input.numel() == 0)
+    return input;
+  if (torch_ipex::check_auto_dnnl() && input.device().type() == c10::DeviceType::XPU) {
+    if (at::GradMode::is_enabled())
+      return NewDropoutOp::apply(input, p);
+    return std::get<0>(NewDropoutOp::_forward(input, p));
+  }
+  return at::dropout(input, p, train);
+}
+
+at::Tensor AtenIpexTypeExt::dropout_add(const at::Tensor& input, const at::Tensor& residual, double p, bool train) {
+  if (p == 0 || !train || input.numel() == 0)
+    return at::add(input, residual);
+  if (torch_ipex::check_auto_dnnl() && input.device().type() == c10::DeviceType::XPU &&
+      residual.device().type() == c10::DeviceType::XPU && residual.sizes() == input.sizes()) {
+    if (at::GradMode::is_enabled())
+      return NewDropoutAddOp::apply(input, residual, p);
+    return std::get<0>(NewDropoutOp::_forward(input, p, residual));
+  }
+  return at::add(at::dropout(input, p, train), residual);
+}
+
+at::Tensor AtenIpexTypeExt::add_layer_norm(const at::Tensor& input, const at::Tensor& residual,
+                                           at::IntArrayRef normalized_shape, const c10::optional<at::Tensor>& weight,
+                                           const c10::optional<at::Tensor>& bias, double eps, double p, bool train) {
+  at::Tensor gamma = weight.has_value() ? weight.value() : at::Tensor();
+  at::Tensor beta = bias.has_value() ? bias.value() : at::Tensor();
+  if (!train)
+    p = 0;
+  int64_t ndim = normalized_shape.size();
+  int64_t N = std::accumulate(normalized_shape.begin(), normalized_shape.end(), int64_t(1), std::multiplies<int64_t>());
+  bool fusable = torch_ipex::check_auto_dnnl() && input.device().type() == c10::DeviceType::XPU &&
+      residual.device().type() == c10::DeviceType::XPU && residual.sizes() == input.sizes() &&
+      input.dim() >= ndim && input.sizes().slice(input.dim() - ndim).equals(normalized_shape) &&
+      input.numel() != 0 && (p == 0 || N % 8 == 0);
+  if (fusable) {
+    bool requires_grad = input.requires_grad() || residual.requires_grad() ||
+        (gamma.defined() && gamma.requires_grad()) || (beta.defined() && beta.requires_grad());
+    if (at::GradMode::is_enabled() && requires_grad)
+      return NewAddLayerNormOp::apply(input, residual, gamma, beta, N, eps, p);
+    return NewAddLayerNormOp::_forward(input, residual, gamma, beta, N, eps, p);
+  }
+  auto sum = p > 0 ? dropout_add(input, residual, p, train) : at::add(input, residual);
+  return at::layer_norm(sum, normalized_shape, gamma, beta, eps);
+}
+
+// The fused kernel writes the heads interleaved as [B, S, H * D] when asked
+// to, for the callers that merge them right after, and a contiguous
+// [B, H, S, D] like the unfused path otherwise.
+static at::Tensor attention(const at::Tensor& query, const at::Tensor& key, const at::Tensor& value,
+                            const at::Tensor& mask, double scale, double p, bool train,
+                            bool interleave_heads) {
+  if (!train)
+    p = 0;
+  bool requires_grad = query.requires_grad() || key.requires_grad() || value.requires_grad() ||
+      (mask.defined() && mask.requires_grad());
+  // the heads of an int8 projection are views of a quantized buffer, the
+  // kernel can only read whole dil tensors so they take the unfused ops
+  auto is_int8 = [](const at::Tensor& t) {
+    if (!cpu::ShadeDataContext::isDilTensor(t))
+      return false;
+    auto data_type = cpu::ShadeDataContext::getDilStorage(t).get_data_type();
+    return data_type == dil::data_type::s8 || data_type == dil::data_type::u8;
+  };
+  // the fused kernel is inference only and doesn't draw the dropout of the probabilities
+  bool fusable = torch_ipex::check_auto_dnnl() && p == 0 && !(at::GradMode::is_enabled() && requires_grad) &&
+      query.device().type() == c10::DeviceType::XPU && key.device().type() == c10::DeviceType::XPU &&
+      value.device().type() == c10::DeviceType::XPU && !is_int8(query) && !is_int8(key) && !is_int8(value) &&
+      query.dim() == 4 && key.dim() == 4 &&
+      value.sizes() == key.sizes() && query.size(0) == key.size(0) && query.size(1) == key.size(1) &&
+      query.size(3) == key.size(3) && query.stride(3) == 1 && key.stride(3) == 1 && value.stride(3) == 1 &&
+      query.numel() != 0 && key.numel() != 0 &&
+      (!mask.defined() || (mask.is_floating_point() && mask.dim() <= 4));
+  if (fusable)
+    return cpu::AtenIpexCPUDev::dil_attention(query, key, value, mask, scale, interleave_heads);
+
+  auto scores = at::matmul(query, key.transpose(-1, -2)).mul(scale);
+  if (mask.defined())
+    scores = scores.add(mask);
+  auto probs = at::softmax(scores, -1);
+  if (p > 0)
+    probs = AtenIpexTypeExt::dropout(probs, p, train);
+  return at::matmul(probs, value);
+}
+
+at::Tensor AtenIpexTypeExt::scaled_dot_product_attention(const at::Tensor& query, const at::Tensor& key,
+                                                         const at::Tensor& value,
+                                                         const c10::optional<at::Tensor>& attn_mask, double scale,
+                                                         double p, bool train) {
+  at::Tensor mask = attn_mask.has_value() ? attn_mask.value() : at::Tensor();
+  return attention(query, key, value, mask, scale, p, train, /*interleave_heads*/ false);
+}
+
+at::Tensor AtenIpexTypeExt::multi_head_attention(const at::Tensor& query, const at::Tensor& key,
+                                                 const at::Tensor& value,
+                                                 const c10::optional<at::Tensor>& attn_mask, int64_t num_heads,
+                                                 double scale) {
+  IPEX_CHECK(query.dim() == 3 && key.dim() == 3 && value.dim() == 3,
+             "multi_head_attention expects [B, S, H * D] query, key and value");
+  IPEX_CHECK(num_heads > 0 && query.size(2) % num_heads == 0 && key.size(2) % num_heads == 0 &&
+             value.size(2) % num_heads == 0, "multi_head_attention: the channels should be a multiple of num_heads");
+  auto heads = [num_heads](const at::Tensor& x) {
+    return x.reshape({x.size(0), x.size(1), num_heads, x.size(2) / num_heads}).permute({0, 2, 1, 3});
+  };
+  at::Tensor mask = attn_mask.has_value() ? attn_mask.value() : at::Tensor();
+  // the fused output of the heads is laid out as [B, S, H * D], the reshape is a view
+  auto context = attention(heads(query), heads(key), heads(value), mask, scale,
+                           /*p*/ 0, /*train*/ false, /*interleave_heads*/ true).permute({0, 2, 1, 3});
+  return context.reshape({context.size(0), context.size(1), -1});
+}
+
 } // namespace torch_ipex
 
 namespace {
@@ -635,6 +884,28 @@ static auto dispatch =
                   weight, indices, offsets, scale_grad_by_freq, mode, sparse,
                   per_sample_weights, include_last_offset);
             })
+        .op("torch_ipex::batched_embedding_bag_forward",
+            &torch_ipex::AtenIpexTypeExt::batched_embedding_bag_forward)
+        .op("torch_ipex::batched_embedding_bag_backward",
+            [](const at::Tensor &grad, const std::vector<at::Tensor> &indices,
+               const std::vector<at::Tensor> &offsets,
+               c10::List<int64_t> num_weights, int64_t mode, bool sparse,
+               bool include_last_offset) {
+              return torch_ipex::AtenIpexTypeExt::batched_embedding_bag_backward(
+                  grad, indices, offsets, num_weights.vec(), mode, sparse,
+                  include_last_offset);
+            })
+        .op("torch_ipex::embedding_bag_rowwise_quantize",
+            &torch_ipex::AtenIpexTypeExt::embedding_bag_rowwise_quantize)
+        .op("torch_ipex::quantized_embedding_bag",
+            [](const at::Tensor &qweight, const at::Tensor &indices,
+               const at::Tensor &offsets, int64_t bit_width, int64_t mode,
+               const c10::optional<at::Tensor> &per_sample_weights,
+               bool include_last_offset) {
+              return torch_ipex::AtenIpexTypeExt::quantized_embedding_bag(
+                  qweight, indices, offsets, bit_width, mode,
+                  per_sample_weights, include_last_offset);
+            })
         .op("torch_ipex::lstm",
             [](const at::Tensor& input, std::vector<at::Tensor> hidden, std::vector<at::Tensor> params, bool has_biases, int64_t num_layers, double dropout_p, bool train, bool bidirectional, bool batch_first) {
               return torch_ipex::AtenIpexTypeExt::lstm(input, hidden, params, has_biases, num_layers, dropout_p, train, bidirectional, batch_first);
@@ -653,5 +924,19 @@ static auto dispatch =
             })
         .op("torch_ipex::interaction_forward", &torch_ipex::AtenIpexTypeExt::interaction_forward)
         .op("torch_ipex::interaction_backward", &torch_ipex::AtenIpexTypeExt::interaction_backward)
-        .op("torch_ipex::frozen_batch_norm", torch_ipex::AtenIpexTypeExt::frozen_batch_norm);
+        .op("torch_ipex::frozen_batch_norm", torch_ipex::AtenIpexTypeExt::frozen_batch_norm)
+        .op("torch_ipex::dropout", &torch_ipex::AtenIpexTypeExt::dropout)
+        .op("torch_ipex::dropout_add", &torch_ipex::AtenIpexTypeExt::dropout_add)
+        .op("torch_ipex::add_layer_norm",
+            [](const at::Tensor &input, const at::Tensor &residual,
+               c10::List<int64_t> normalized_shape,
+               const c10::optional<at::Tensor> &weight,
+               const c10::optional<at::Tensor> &bias, double eps, double p,
+               bool train) {
+              return torch_ipex::AtenIpexTypeExt::add_layer_norm(
+                  input, residual, normalized_shape.vec(), weight, bias, eps,
+                  p, train);
+            })
+        .op("torch_ipex::scaled_dot_product_attention", &torch_ipex::AtenIpexTypeExt::scaled_dot_product_attention)
+        .op("torch_ipex::multi_head_attention", &torch_ipex::AtenIpexTypeExt::multi_head_attention);
 }
\ No newline at end of file
@@ -8,9 +8,14 @@ namespace torch_ipex {
 class AtenIpexTypeExt {
  public:
   static void packed_add_(at::Tensor & top_half, at::Tensor & bot_half, const at::Tensor & grad, float alpha);
+  static void embedding_bag_backward_update_(const at::Tensor & grad, at::Tensor & weight, const c10::optional<at::Tensor>& bot_half, const c10::optional<at::Tensor>& momentum, const at::Tensor & indices, const at::Tensor & offsets, int64_t mode, const c10::optional<at::Tensor>& per_sample_weights, double lr, double eps);
   static at::Tensor interaction_forward(const std::vector<at::Tensor> & input);
   static std::vector<at::Tensor> interaction_backward(const at::Tensor & grad_out, const std::vector<at::Tensor> & input);
   static std::vector<at::Tensor> embedding_bag(const at::Tensor & weight, const at::Tensor & indices, const at::Tensor & offsets, bool scale_grad_by_freq, int64_t mode, bool sparse, const c10::optional<at::Tensor>& per_sample_weights, bool include_last_offset);
+  static at::Tensor batched_embedding_bag_forward(const std::vector<at::Tensor> & weights, const std::vector<at::Tensor> & indices, const std::vector<at::Tensor> & offsets, int64_t mode, bool include_last_offset);
+  static std::vector<at::Tensor> batched_embedding_bag_backward(const at::Tensor & grad, const std::vector<at::Tensor> & indices, const std::vector<at::Tensor> & offsets, std::vector<int64_t> num_weights, int64_t mode, bool sparse, bool include_last_offset);
+  static at::Tensor embedding_bag_rowwise_quantize(const at::Tensor & weight, int64_t bit_width);
+  static at::Tensor quantized_embedding_bag(const at::Tensor & qweight, const at::Tensor & indices, const at::Tensor & offsets, int64_t bit_width, int64_t mode, const c10::optional<at::Tensor>& per_sample_weights, bool include_last_offset);
   static at::Tensor linear(const at::Tensor& input, const at::Tensor& weight, const c10::optional<at::Tensor>& bias);
   static at::Tensor adaptive_avg_pool2d(at::Tensor const& input, at::IntArrayRef output_size);
   static at::Tensor max_pool2d(const at::Tensor& input, at::IntArrayRef kernel_size, at::IntArrayRef stride, at::IntArrayRef padding, at::IntArrayRef dilation, bool ceil_mode);
@@ -21,6 +26,11 @@ class AtenIpexTypeExt {
   static std::vector<at::Tensor> gru(const at::Tensor& input, const at::Tensor& hidden, std::vector<at::Tensor> params, bool has_biases, int64_t num_layers, double dropout_p, bool train, bool bidirectional, bool batch_first);
   static at::Tensor linear_relu(const at::Tensor &input, const at::Tensor &weight, const c10::optional<at::Tensor> &bias);
   static at::Tensor frozen_batch_norm(const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, const at::Tensor& running_mean, const at::Tensor& running_var);
+  static at::Tensor dropout(const at::Tensor& input, double p, bool train);
+  static at::Tensor dropout_add(const at::Tensor& input, const at::Tensor& residual, double p, bool train);
+  static at::Tensor add_layer_norm(const at::Tensor& input, const at::Tensor& residual, at::IntArrayRef normalized_shape, const c10::optional<at::Tensor>& weight, const c10::optional<at::Tensor>& bias, double eps, double p, bool train);
+  static at::Tensor scaled_dot_product_attention(const at::Tensor& query, const at::Tensor& key, const at::Tensor& value, const c10::optional<at::Tensor>& attn_mask, double scale, double p, bool train);
+  static at::Tensor multi_head_attention(const at::Tensor& query, const at::Tensor& key, const at::Tensor& value, const c10::optional<at::Tensor>& attn_mask, int64_t num_heads, double scale);
 };
 
 }  // namespace torch_ipex
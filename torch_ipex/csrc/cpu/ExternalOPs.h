@@ -2,6 +2,9 @@
 
 #include <ATen/Tensor.h>
 
+#include <string>
+#include <vector>
+
 namespace torch_ipex {
 
 class IpexExternal {
@@ -24,13 +27,71 @@ class IpexExternal {
                                       const int width,
                                       const int sampling_ratio);
 
+  // ROIAlign_backward with a given parallelization, "auto", "planes" (one
+  // writer per plane) or "private" (per-thread gradients). Only for tests and
+  // benchmarks.
+  static at::Tensor ROIAlign_backward_with_policy(const at::Tensor& grad,
+                                                  const at::Tensor& rois,
+                                                  const float spatial_scale,
+                                                  const int pooled_height,
+                                                  const int pooled_width,
+                                                  const int batch_size,
+                                                  const int channels,
+                                                  const int height,
+                                                  const int width,
+                                                  const int sampling_ratio,
+                                                  const std::string& policy);
+
+  // ROIAlign over the feature maps of a pyramid, finest first, level k
+  // sampling the image at spatial_scales[k]. Every ROI is pooled from its
+  // canonical FPN level and the output keeps the order of the ROIs.
+  static at::Tensor ROIAlign_forward_multilevel(const std::vector<at::Tensor>& features,
+                                                const at::Tensor& rois,
+                                                const std::vector<double>& spatial_scales,
+                                                const int pooled_height,
+                                                const int pooled_width,
+                                                const int sampling_ratio,
+                                                const int canonical_scale = 224,
+                                                const int canonical_level = 4);
+
+  // Returns the gradient of every level, heights and widths give their sizes.
+  static std::vector<at::Tensor> ROIAlign_backward_multilevel(const at::Tensor& grad,
+                                                              const at::Tensor& rois,
+                                                              const std::vector<double>& spatial_scales,
+                                                              const int pooled_height,
+                                                              const int pooled_width,
+                                                              const int batch_size,
+                                                              const int channels,
+                                                              const std::vector<int64_t>& heights,
+                                                              const std::vector<int64_t>& widths,
+                                                              const int sampling_ratio,
+                                                              const int canonical_scale = 224,
+                                                              const int canonical_level = 4);
+
   static at::Tensor nms(const at::Tensor& dets,
                         const at::Tensor& scores,
-                        const float threshold);
+                        const float threshold,
+                        const float bias = 1);
+
+  // Previous serial kernel, only for tests and benchmarks.
+  static at::Tensor nms_serial(const at::Tensor& dets,
+                               const at::Tensor& scores,
+                               const float threshold,
+                               const float bias = 1);
 
   static std::tuple<at::Tensor, at::Tensor, at::Tensor> batch_score_nms(const at::Tensor& dets,
                         const at::Tensor& scores,
                         const float threshold);
+
+  // dets: [batch, boxes, 4], scores: [batch, boxes, classes]. Returns the
+  // boxes [batch, max_output, 4], labels and scores [batch, max_output],
+  // zero padded, and the number of detections of every image.
+  static std::vector<at::Tensor> batch_score_nms_padded(const at::Tensor& dets,
+                        const at::Tensor& scores,
+                        const float threshold,
+                        const int64_t max_num = 200,
+                        const int64_t max_output = 200,
+                        const float score_threshold = 0.05);
 };
 
 }  // namespace torch_ipex
\ No newline at end of file
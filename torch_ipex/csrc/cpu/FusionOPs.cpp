@@ -49,13 +49,14 @@ at::Tensor dil_convolution_outplace_fusion(
   bool quantized = false;
   std::vector<float> output_scale = {};
   if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
-    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id();
+    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id(op_name);
     quantized = dbl::comm::get_int8_quantized_status(num_ops_id);
     std::vector<std::vector<float>> scales = dbl::comm::get_int8_scales(
         {input}, /*  uint8_used for output*/ false, num_ops_id);
     if (quantized) {
       output_scale.push_back(scales[1][0]);
-      dbl::comm::reorder_to_int8_for_mix_prec(input_contiguous, scales[0]);
+      dbl::comm::reorder_to_int8_for_mix_prec(input_contiguous, scales[0], /*uint8_used*/ false,
+                                              dbl::comm::get_int8_zero_points(num_ops_id));
       dbl::comm::reorder_to_int8_for_mix_prec(weight_contiguous, {});
     } else {
       dbl::comm::reorder_to_dtype(input, at::kFloat);
@@ -112,7 +113,7 @@ at::Tensor dil_convolution_outplace_fusion(
   auto aten_output = dbl::comm::gen_aten_tensor_by(std::move(dil_output));
   if (check_auto_mix_int8_fp32() && check_int8_calibration()) {
     insert_or_updata_observer({input_contiguous}, {aten_output}, op_name,
-                              Int8OptConfig::fetch_and_add_ops_id());
+                              Int8OptConfig::fetch_and_add_ops_id(op_name));
   }
   return aten_output;
 }
@@ -145,13 +146,14 @@ static at::Tensor& dil_convolution_inplace_fusion(
   bool quantized = false;
   std::vector<float> output_scale = {};
   if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
-    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id();
+    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id(op_name);
     quantized = dbl::comm::get_int8_quantized_status(num_ops_id);
     std::vector<std::vector<float>> scales = dbl::comm::get_int8_scales(
         {input}, /*  uint8_used for output*/ false, num_ops_id);
     if (quantized) {
       output_scale.push_back(scales[1][0]);
-      dbl::comm::reorder_to_int8_for_mix_prec(input_contiguous, scales[0]);
+      dbl::comm::reorder_to_int8_for_mix_prec(input_contiguous, scales[0], /*uint8_used*/ false,
+                                              dbl::comm::get_int8_zero_points(num_ops_id));
       dbl::comm::reorder_to_int8_for_mix_prec(weight_contiguous, {});
     } else {
       dbl::comm::reorder_to_dtype(input_contiguous, at::kFloat);
@@ -214,56 +216,60 @@ static at::Tensor& dil_convolution_inplace_fusion(
   dbl::comm::equip_dil_buffer(accumu, dil_output);
   if (check_auto_mix_int8_fp32() && check_int8_calibration()) {
     insert_or_updata_observer({input_contiguous}, {accumu}, op_name,
-                              Int8OptConfig::fetch_and_add_ops_id());
+                              Int8OptConfig::fetch_and_add_ops_id(op_name));
   }
   return accumu;
 }
 
-at::Tensor AtenIpexJITDev::dil_convolution_swish(
-    const at::Tensor& input,
-    const at::Tensor& weight,
-    const at::Tensor& bias,
-    at::IntArrayRef stride,
-    at::IntArrayRef padding,
-    at::IntArrayRef dilation,
-    int64_t groups) {
-#if defined(IPEX_PROFILE_OP)
-  RECORD_FUNCTION("AtenIpexJITDev::dil_convolution_swish", std::vector<c10::IValue>({input, weight, bias}));
-#endif
-  return dil_convolution_outplace_fusion(
-    input,
-    weight,
-    bias,
-    stride,
-    padding,
-    dilation,
-    groups,
-    dil::attr_t::fuse_swish());
-}
+dil::attr_t make_post_ops_attr(c10::ArrayRef<PostOp> post_ops, c10::ArrayRef<c10::IValue> args) {
+  size_t pos = 0;
+  auto next_arg = [&]() {
+    IPEX_CHECK(pos < args.size(), "make_post_ops_attr: missing arguments of the post ops");
+    return args[pos++].toScalar().to<float>();
+  };
 
-at::Tensor AtenIpexJITDev::dil_convolution_sigmoid(
-    const at::Tensor& input,
-    const at::Tensor& weight,
-    const at::Tensor& bias,
-    at::IntArrayRef stride,
-    at::IntArrayRef padding,
-    at::IntArrayRef dilation,
-    int64_t groups) {
-#if defined(IPEX_PROFILE_OP)
-  RECORD_FUNCTION("AtenIpexJITDev::dil_convolution_sigmoid", std::vector<c10::IValue>({input, weight, bias}));
-#endif
-  return dil_convolution_outplace_fusion(
-    input,
-    weight,
-    bias,
-    stride,
-    padding,
-    dilation,
-    groups,
-    dil::attr_t::fuse_sigmoid());
+  dil::post_ops po;
+  for (auto post_op : post_ops) {
+    switch (post_op) {
+      case PostOp::relu:
+        po.append_eltwise(1.0, dil::algorithm::eltwise_relu, 0.f, 0.f);
+        break;
+      case PostOp::gelu:
+        po.append_eltwise(1.0, dil::algorithm::eltwise_gelu_erf, 0.f, 0.f);
+        break;
+      case PostOp::sigmoid:
+        po.append_eltwise(1.0, dil::algorithm::eltwise_logistic, 1.f, 0.f);
+        break;
+      case PostOp::swish:
+        po.append_eltwise(1.0, dil::algorithm::eltwise_swish, 1.f, 0.f);
+        break;
+      case PostOp::clamp: {
+        auto lower_bound = next_arg();
+        auto upper_bound = next_arg();
+        po.append_eltwise(1.0, dil::algorithm::eltwise_clip, lower_bound, upper_bound);
+        break;
+      }
+      case PostOp::elu: {
+        auto alpha = next_arg();
+        auto scale = next_arg();
+        auto input_scale = next_arg();
+        po.append_eltwise(scale, dil::algorithm::eltwise_elu, alpha, input_scale);
+        break;
+      }
+      case PostOp::sum: {
+        // the accumulator is the dst of the op
+        pos++;
+        auto scale = next_arg();
+        po.append_sum(scale);
+        break;
+      }
+    }
+  }
+  IPEX_CHECK(pos == args.size(), "make_post_ops_attr: ", args.size() - pos, " arguments left after the post ops");
+  return dil::attr_t::attr_post_ops(po);
 }
 
-at::Tensor AtenIpexJITDev::dil_convolution_clamp(
+at::Tensor AtenIpexJITDev::dil_convolution_fuse_eltwise(
     const at::Tensor& input,
     const at::Tensor& weight,
     const at::Tensor& bias,
@@ -271,32 +277,9 @@ at::Tensor AtenIpexJITDev::dil_convolution_clamp(
     at::IntArrayRef padding,
     at::IntArrayRef dilation,
     int64_t groups,
-    float lower_bound,
-    float upper_bound) {
-#if defined(IPEX_PROFILE_OP)
-  RECORD_FUNCTION("AtenIpexJITDev::dil_convolution_clamp", std::vector<c10::IValue>({input, weight, bias}));
-#endif
-  return dil_convolution_outplace_fusion(
-    input,
-    weight,
-    bias,
-    stride,
-    padding,
-    dilation,
-    groups,
-    dil::attr_t::fuse_clamp(lower_bound, upper_bound));
-}
-
-at::Tensor AtenIpexJITDev::dil_convolution_relu(
-    const at::Tensor& input,
-    const at::Tensor& weight,
-    const at::Tensor& bias,
-    at::IntArrayRef stride,
-    at::IntArrayRef padding,
-    at::IntArrayRef dilation,
-    int64_t groups) {
+    const dil::attr_t& attr) {
 #if defined(IPEX_PROFILE_OP)
-  RECORD_FUNCTION("AtenIpexJITDev::dil_convolution_relu", std::vector<c10::IValue>({input, weight, bias}));
+  RECORD_FUNCTION("AtenIpexJITDev::dil_convolution_fuse_eltwise", std::vector<c10::IValue>({input, weight, bias}));
 #endif
   return dil_convolution_outplace_fusion(
     input,
@@ -306,37 +289,10 @@ at::Tensor AtenIpexJITDev::dil_convolution_relu(
     padding,
     dilation,
     groups,
-    dil::attr_t::fuse_relu(),
+    attr,
     "Convolution_Relu");
 }
 
-at::Tensor AtenIpexJITDev::dil_convolution_elu(
-    const at::Tensor& input,
-    const at::Tensor& weight,
-    const at::Tensor& bias,
-    at::IntArrayRef stride,
-    at::IntArrayRef padding,
-    at::IntArrayRef dilation,
-    int64_t groups,
-    float alpha,
-    at::Scalar scale,
-    at::Scalar input_scale) {
-#if defined(IPEX_PROFILE_OP)
-  RECORD_FUNCTION("AtenIpexJITDev::dil_convolution_elu", std::vector<c10::IValue>({input, weight, bias}));
-#endif
-  auto scale_value = scale.to<float>();
-  auto input_scale_value = input_scale.to<float>();
-  return dil_convolution_outplace_fusion(
-    input,
-    weight,
-    bias,
-    stride,
-    padding,
-    dilation,
-    groups,
-    dil::attr_t::fuse_elu(scale_value, alpha, input_scale_value));
-}
-
 at::Tensor& AtenIpexJITDev::dil_convolution_sum(
     const at::Tensor& input,
     const at::Tensor& weight,
@@ -409,5 +365,226 @@ at::Tensor AtenIpexJITDev::dil_linear_fuse_eltwise(
   return AtenIpexCPUDev::dil_linear(self, weight, bias, attr);
 }
 
+// The linear of a sum post op whose accumulator is a whole buffer of the
+// output shape, the output is written into the accumulator
+static at::Tensor& dil_linear_inplace_fusion(
+    const at::Tensor& self,
+    const at::Tensor& weight,
+    const at::Tensor& bias,
+    at::Tensor& accumu,
+    const dil::attr_t& attr,
+    const std::string& op_name) {
+  bool quantized = false;
+  std::vector<float> output_scale = {};
+  if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
+    int64_t num_ops_id = Int8OptConfig::fetch_and_add_ops_id(op_name);
+    quantized = dbl::comm::get_int8_quantized_status(num_ops_id);
+    std::vector<std::vector<float>> scales = dbl::comm::get_int8_scales(
+        {self}, /*  uint8_used for output*/ false, num_ops_id);
+    if (quantized) {
+      dbl::comm::reorder_to_int8_for_mix_prec(self, scales[0], /*uint8_used*/ false,
+                                              dbl::comm::get_int8_zero_points(num_ops_id));
+      dbl::comm::reorder_to_int8_for_mix_prec(weight, {});
+      // the output has the data type of accumu, an int8 accumu is requantized
+      // to the output scale, any other one is accumulated in fp32
+      auto accumu_type = dbl::comm::try_gen_dil_tensor(accumu).get_data_type();
+      if (accumu_type == dil::data_type::s8 || accumu_type == dil::data_type::u8) {
+        output_scale.push_back(scales[1][0]);
+      } else {
+        dbl::comm::reorder_to_dtype(accumu, at::kFloat);
+      }
+    } else {
+      dbl::comm::reorder_to_dtype(self, at::kFloat);
+      dbl::comm::reorder_to_dtype(weight, at::kFloat);
+      // accumu may a int8 tensor, should reorder to fp32
+      dbl::comm::reorder_to_dtype(accumu, at::kFloat);
+    }
+  } else {
+    dbl::comm::reorder_to_bf16_for_mix_prec(self);
+    dbl::comm::reorder_to_bf16_for_mix_prec(weight, true);
+    dbl::comm::reorder_to_bf16_for_mix_prec(accumu);
+  }
+
+  auto self_reshaped = self.dim() > 2
+      ? AtenIpexCPUDev::dil_reshape(self, {-1, AtenIpexCPUDev::dil_size(self, self.dim() - 1)})
+      : self;
+  const dil::tensor x = dbl::comm::try_gen_dil_tensor(self_reshaped);
+  if (!check_train() && check_tensor_own_whole_storage(weight)) {
+    dbl::linear::prepack_linear_weights(self_reshaped, x, weight);
+  }
+  const dil::tensor w = dbl::comm::try_gen_dil_tensor(weight);
+
+  c10::optional<dil::tensor> b{c10::nullopt};
+  if (bias.defined()) {
+    if (check_auto_mix_int8_fp32() && !check_int8_calibration()) {
+      if (quantized) {
+        auto src = dbl::comm::try_gen_dil_storage(bias);
+        auto src_type = src.get_data_type();
+        if (src_type != dil::data_type::s32) {
+          auto dst_desc = src.get_desc().to_type(dil::data_type::s32);
+          auto bias_scales = w.get_scale();
+          for (auto &scale : bias_scales) { scale *= x.get_scale()[0];  }
+          dbl::comm::reorder_to_desc(bias, dst_desc, bias_scales);
+        }
+      } else {
+        dbl::comm::reorder_to_dtype(bias, at::kFloat);
+      }
+    } else {
+      dbl::comm::reorder_to_bf16_for_mix_prec(bias, true);
+    }
+    b = dbl::comm::try_gen_dil_tensor(bias);
+  }
+
+  // the 2d view of the buffer of accumu
+  dil::tensor y = dbl::comm::try_gen_dil_tensor(accumu);
+  y.reshape({x.get_dim(0), w.get_dim(0)});
+  dbl::linear::linear_inplace_impl(x, w, b, y, output_scale, attr, weight);
+  y.reshape(accumu.sizes().vec());
+  dbl::comm::equip_dil_buffer(accumu, y);
+
+  if (check_auto_mix_int8_fp32() && check_int8_calibration()) {
+    insert_or_updata_observer({self}, {accumu}, op_name,
+                              Int8OptConfig::fetch_and_add_ops_id(op_name));
+  }
+  return accumu;
+}
+
+// Applies the eltwise post ops of attr to an output in place
+static void apply_eltwise_post_ops(const at::Tensor& output, const dil::attr_t& attr) {
+  auto y = dbl::comm::try_gen_dil_tensor(output);
+  for (int i = 0; i < attr.get_post_ops().len(); i++) {
+    dil::kind akind;
+    float scale, alpha, beta;
+    dil::algorithm alg;
+    std::tie(akind, scale, alpha, beta, alg) = attr.get_params(i);
+    if (akind == dil::kind::eltwise) {
+      dil::eltwise_forward::compute(y, y, alg, dil::prop_kind::forward_inference, alpha, beta);
+    }
+  }
+}
+
+static uint32_t tensor_version(const at::Tensor& t) {
+  return t.defined() ? t.unsafeGetTensorImpl()->version_counter().current_version() : 0;
+}
+
+// bias + alpha * other, other being a row of the output
+static at::Tensor fold_linear_bias(const at::Tensor& bias, const at::Tensor& other, at::Scalar alpha) {
+  auto other_row = other.reshape({other.numel()});
+  return bias.defined() ? at::add(bias, other_row, alpha) : at::mul(other_row, alpha);
+}
+
+// The folded bias of a linear_add node, taken from folded_bias if it was
+// folded from the same tensors at their current versions
+static at::Tensor get_folded_linear_bias(
+    const at::Tensor& bias,
+    const at::Tensor& other,
+    at::Scalar alpha,
+    FoldedLinearBias* folded_bias) {
+  bool requires_grad = other.requires_grad() || (bias.defined() && bias.requires_grad());
+  if (!folded_bias || (at::GradMode::is_enabled() && requires_grad)) {
+    return fold_linear_bias(bias, other, alpha);
+  }
+
+  std::lock_guard<std::mutex> lock(folded_bias->mutex);
+  // the weak refs keep the addresses of the tensors from being reused
+  if (folded_bias->folded.defined() &&
+      folded_bias->bias._unsafe_get_target() == bias.unsafeGetTensorImpl() &&
+      folded_bias->other._unsafe_get_target() == other.unsafeGetTensorImpl() &&
+      folded_bias->bias_version == tensor_version(bias) &&
+      folded_bias->other_version == tensor_version(other) &&
+      folded_bias->alpha == alpha.to<double>()) {
+    return folded_bias->folded;
+  }
+  folded_bias->folded = fold_linear_bias(bias, other, alpha);
+  folded_bias->bias = bias.getIntrusivePtr();
+  folded_bias->other = other.getIntrusivePtr();
+  folded_bias->bias_version = tensor_version(bias);
+  folded_bias->other_version = tensor_version(other);
+  folded_bias->alpha = alpha.to<double>();
+  return folded_bias->folded;
+}
+
+// linear + alpha * other followed by the eltwise post ops of attr, other
+// broadcasts to the output. An other broadcast over the rows of the output,
+// as a bias is, is folded into the bias, once per version of bias and other
+// if folded_bias is given. Any other one is added to the output of the linear,
+// the JIT pass only fuses the add of a module attribute for that reason.
+static at::Tensor dil_linear_binary_add(
+    const at::Tensor& self,
+    const at::Tensor& weight,
+    const at::Tensor& bias,
+    const at::Tensor& other,
+    at::Scalar alpha,
+    const dil::attr_t& attr,
+    FoldedLinearBias* folded_bias = nullptr) {
+  auto out_features = weight.size(0);
+  if (other.dim() >= 1 && other.dim() <= self.dim() &&
+      other.size(-1) == out_features && other.numel() == out_features) {
+    auto fused_bias = get_folded_linear_bias(bias, other, alpha, folded_bias);
+    return AtenIpexCPUDev::dil_linear(self, weight, fused_bias, attr);
+  }
+
+  auto output = at::add(AtenIpexCPUDev::dil_linear(self, weight, bias), other, alpha);
+  apply_eltwise_post_ops(output, attr);
+  return output;
+}
+
+at::Tensor AtenIpexJITDev::dil_linear_sum(
+    const at::Tensor& self,
+    const at::Tensor& weight,
+    const at::Tensor& bias,
+    at::Tensor& accumu,
+    const dil::attr_t& attr) {
+#if defined(IPEX_PROFILE_OP)
+  RECORD_FUNCTION("AtenIpexJITDev::dil_linear_sum", std::vector<c10::IValue>({self, weight, bias}));
+#endif
+  IPEX_CHECK(self.dim() >= 2,
+      "dil_linear_sum: input needs to has dim at least 2, input dim ", self.dim());
+  auto output_size = self.sizes().vec();
+  output_size.back() = weight.size(0);
+  // a dynamic int8 weight quantizes the input on the fly, out of the indicators
+  bool dynamic_int8 = !check_train() && ShadeDataContext::isDynamicInt8Tensor(weight);
+  // the inner product can't write over its own operands
+  auto shares_storage = [&](const at::Tensor& t) {
+    return t.defined() && accumu.storage().is_alias_of(t.storage());
+  };
+  if (accumu.sizes().equals(output_size) && accumu.is_contiguous() &&
+      check_tensor_own_whole_storage(accumu) && !dynamic_int8 &&
+      !shares_storage(self) && !shares_storage(weight) && !shares_storage(bias)) {
+    // accumu is dead after the op, its buffer becomes the output
+    return dil_linear_inplace_fusion(self, weight, bias, accumu, attr, "LinearSum");
+  }
+
+  // accumu is not written, the output is a new tensor
+  float alpha = 1.f;
+  dil::post_ops eltwise_po;
+  for (int i = 0; i < attr.get_post_ops().len(); i++) {
+    dil::kind akind;
+    float scale, eltwise_alpha, beta;
+    dil::algorithm alg;
+    std::tie(akind, scale, eltwise_alpha, beta, alg) = attr.get_params(i);
+    if (akind == dil::kind::sum) {
+      alpha = scale;
+    } else {
+      eltwise_po.append_eltwise(scale, alg, eltwise_alpha, beta);
+    }
+  }
+  return dil_linear_binary_add(
+      self, weight, bias, accumu, alpha, dil::attr_t::attr_post_ops(eltwise_po));
+}
+
+at::Tensor AtenIpexJITDev::dil_linear_add(
+    const at::Tensor& self,
+    const at::Tensor& weight,
+    const at::Tensor& bias,
+    const at::Tensor& other,
+    at::Scalar alpha,
+    FoldedLinearBias* folded_bias) {
+#if defined(IPEX_PROFILE_OP)
+  RECORD_FUNCTION("AtenIpexJITDev::dil_linear_add", std::vector<c10::IValue>({self, weight, bias, other}));
+#endif
+  return dil_linear_binary_add(self, weight, bias, other, alpha, dil::attr_t(), folded_bias);
+}
+
 }  // namespace cpu
 }  // namespace torch_ipex
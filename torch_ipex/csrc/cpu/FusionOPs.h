@@ -2,6 +2,8 @@
 
 #include <ATen/Tensor.h>
 
+#include <mutex>
+
 #include <torch/csrc/jit/runtime/custom_operator.h>
 
 #include "dil/dil.hpp"
@@ -17,8 +19,14 @@ namespace ipex {
   // static auto conv2d_relu_sum = Symbol::fromQualString("ipex::conv2d_relu_sum");
   // static auto conv3d_relu_sum = Symbol::fromQualString("ipex::conv3d_relu_sum");
   static auto conv2d_sum_relu = Symbol::fromQualString("ipex::conv2d_sum_relu");
+  static auto conv2d_sigmoid = Symbol::fromQualString("ipex::conv2d_sigmoid");
+  static auto conv2d_clamp = Symbol::fromQualString("ipex::conv2d_clamp");
+  static auto conv2d_elu = Symbol::fromQualString("ipex::conv2d_elu");
   static auto linear_relu = Symbol::fromQualString("ipex::linear_relu");
   static auto linear_gelu = Symbol::fromQualString("ipex::linear_gelu");
+  static auto linear_sum = Symbol::fromQualString("ipex::linear_sum");
+  static auto linear_sum_relu = Symbol::fromQualString("ipex::linear_sum_relu");
+  static auto linear_add = Symbol::fromQualString("ipex::linear_add");
 
   // 3d ops
   static auto conv3d_relu = Symbol::fromQualString("ipex::conv3d_relu");
@@ -32,23 +40,41 @@ namespace ipex {
 namespace torch_ipex {
 namespace cpu {
 
+// The ops fused into the output stage of a dil convolution or linear
+enum class PostOp { relu, gelu, sigmoid, swish, clamp, elu, sum };
+
+// Builds the post ops of a fused op, in order, into a single attr. `args` holds
+// the arguments of the post ops in the same order: clamp takes its lower and
+// upper bound, elu its alpha, scale and input scale, sum its accumulator, which
+// is the dst of the op and is skipped, and its scale, the others take none.
+dil::attr_t make_post_ops_attr(c10::ArrayRef<PostOp> post_ops, c10::ArrayRef<c10::IValue> args);
+
+// The bias of a linear_add node folded with the other input of the add. The
+// node keeps it while bias, other and alpha are the same tensors and values,
+// at the same versions, and folds them again otherwise.
+struct FoldedLinearBias {
+  std::mutex mutex;
+  c10::weak_intrusive_ptr<c10::TensorImpl, c10::UndefinedTensorImpl> bias {at::Tensor().getIntrusivePtr()};
+  c10::weak_intrusive_ptr<c10::TensorImpl, c10::UndefinedTensorImpl> other {at::Tensor().getIntrusivePtr()};
+  uint32_t bias_version = 0;
+  uint32_t other_version = 0;
+  double alpha = 0;
+  at::Tensor folded;
+};
+
 class AtenIpexJITDev {
  public:
   // for JIT ops
-  static at::Tensor dil_convolution_swish(const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, at::IntArrayRef stride, at::IntArrayRef padding, at::IntArrayRef dilation, int64_t groups);
-
-  static at::Tensor dil_convolution_sigmoid(const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, at::IntArrayRef stride, at::IntArrayRef padding, at::IntArrayRef dilation, int64_t groups);
-
-  static at::Tensor dil_convolution_clamp(const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, at::IntArrayRef stride, at::IntArrayRef padding, at::IntArrayRef dilation, int64_t groups, float lower_bound, float upper_bound);
-
-  static at::Tensor dil_convolution_relu(const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, at::IntArrayRef stride, at::IntArrayRef padding, at::IntArrayRef dilation, int64_t groups);
-
-  static at::Tensor dil_convolution_elu(const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, at::IntArrayRef stride, at::IntArrayRef padding, at::IntArrayRef dilation, int64_t groups, float alpha, at::Scalar scale, at::Scalar input_scale);
+  static at::Tensor dil_convolution_fuse_eltwise(const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, at::IntArrayRef stride, at::IntArrayRef padding, at::IntArrayRef dilation, int64_t groups, const dil::attr_t& attr);
 
   static at::Tensor& dil_convolution_sum(const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, at::IntArrayRef stride, at::IntArrayRef padding, at::IntArrayRef dilation, int64_t groups, at::Tensor& accumu, at::Scalar alpha);
 
   static at::Tensor& dil_convolution_sum_relu( const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, at::IntArrayRef stride, at::IntArrayRef padding, at::IntArrayRef dilation, int64_t groups, at::Tensor& accumu, at::Scalar alpha);
 
+  static at::Tensor dil_linear_sum(const at::Tensor& self, const at::Tensor& weight, const at::Tensor& bias, at::Tensor& accumu, const dil::attr_t& attr);
+
+  static at::Tensor dil_linear_add(const at::Tensor& self, const at::Tensor& weight, const at::Tensor& bias, const at::Tensor& other, at::Scalar alpha, FoldedLinearBias* folded_bias = nullptr);
+
   static at::Tensor dil_linear_fuse_eltwise(const at::Tensor& self, const at::Tensor& weight, const at::Tensor& bias, const dil::attr_t& attr);
 
 };
@@ -1,10 +1,13 @@
 // Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
 #include "ExternalOPs.h"
 #include "torch_ipex/csrc/aten_ipex_bridge.h"
+#include "torch_ipex/csrc/cpu/ShadeDataContext.h"
+#include "torch_ipex/csrc/cpu/bf16/Bridge.hpp"
 #include "aten/aten.hpp"
 #include <ATen/Parallel.h>
 #include <ATen/record_function.h>
 #include <algorithm>
+#include <cmath>
 #include <c10/util/Exception.h>
 #include <torch/csrc/autograd/function.h>
 namespace torch_ipex {
@@ -118,383 +121,717 @@ void pre_calc_for_bilinear_interpolate(
   }
 }
 
+// bf16 features are accumulated and interpolated in fp32
 template <typename T>
-void ROIAlignForward_cpu_kernel(
-    const int nthreads,
+struct ROIAlignAccType {
+  using type = T;
+};
+
+template <>
+struct ROIAlignAccType<at::BFloat16> {
+  using type = float;
+};
+
+// Sampling grid of one ROI, shared by all the channels
+template <typename T>
+struct ROIAlignBinGrid {
+  int batch_ind;
+  T start_h;
+  T start_w;
+  T bin_size_h;
+  T bin_size_w;
+  int grid_h;
+  int grid_w;
+  T count;
+};
+
+template <typename T>
+inline ROIAlignBinGrid<T> roi_align_bin_grid(
+    const T* roi,
+    const T spatial_scale,
+    const int pooled_height,
+    const int pooled_width,
+    const int sampling_ratio) {
+  ROIAlignBinGrid<T> grid;
+  grid.batch_ind = roi[0];
+
+  // Do not using rounding; this implementation detail is critical
+  grid.start_w = roi[1] * spatial_scale;
+  grid.start_h = roi[2] * spatial_scale;
+  T roi_end_w = roi[3] * spatial_scale;
+  T roi_end_h = roi[4] * spatial_scale;
+
+  // Force malformed ROIs to be 1x1
+  T roi_width = std::max(roi_end_w - grid.start_w, (T)1.);
+  T roi_height = std::max(roi_end_h - grid.start_h, (T)1.);
+  grid.bin_size_h = static_cast<T>(roi_height) / static_cast<T>(pooled_height);
+  grid.bin_size_w = static_cast<T>(roi_width) / static_cast<T>(pooled_width);
+
+  // We use roi_bin_grid to sample the grid and mimic integral
+  grid.grid_h = (sampling_ratio > 0)
+      ? sampling_ratio
+      : ceil(roi_height / pooled_height); // e.g., = 2
+  grid.grid_w =
+      (sampling_ratio > 0) ? sampling_ratio : ceil(roi_width / pooled_width);
+
+  // We do average (integral) pooling inside a bin
+  grid.count = grid.grid_h * grid.grid_w; // e.g. = 4
+  return grid;
+}
+
+template <typename T>
+inline void roi_align_pre_calc(
+    const ROIAlignBinGrid<T>& grid,
+    const int height,
+    const int width,
+    const int pooled_height,
+    const int pooled_width,
+    std::vector<PreCalc<T>>& pre_calc) {
+  // only grows, so the buffer is allocated once per thread in practice
+  pre_calc.resize(grid.grid_h * grid.grid_w * pooled_width * pooled_height);
+  pre_calc_for_bilinear_interpolate(
+      height,
+      width,
+      pooled_height,
+      pooled_width,
+      grid.grid_h,
+      grid.grid_w,
+      grid.start_h,
+      grid.start_w,
+      grid.bin_size_h,
+      grid.bin_size_w,
+      grid.grid_h,
+      grid.grid_w,
+      pre_calc);
+}
+
+// NCHW, one channel plane at a time
+template <typename T, typename acc_t, typename out_t>
+inline void roi_align_forward_nchw(
     const T* bottom_data,
-    const T& spatial_scale,
+    const ROIAlignBinGrid<acc_t>& grid,
+    const PreCalc<acc_t>* pre_calc,
     const int channels,
     const int height,
     const int width,
     const int pooled_height,
     const int pooled_width,
-    const int sampling_ratio,
-    const T* bottom_rois,
-    //int roi_cols,
-    T* top_data) {
-  //AT_ASSERT(roi_cols == 4 || roi_cols == 5);
-  int roi_cols = 5;
+    out_t* top_data) {
+  for (int c = 0; c < channels; c++) {
+    const T* offset_bottom_data =
+        bottom_data + (int64_t)(grid.batch_ind * channels + c) * height * width;
+    out_t* offset_top_data = top_data + c * pooled_height * pooled_width;
+    int pre_calc_index = 0;
+
+    for (int ph = 0; ph < pooled_height; ph++) {
+      for (int pw = 0; pw < pooled_width; pw++) {
+        acc_t output_val = 0.;
+        for (int i = 0; i < grid.grid_h * grid.grid_w; i++) {
+          const PreCalc<acc_t>& pc = pre_calc[pre_calc_index];
+          output_val += pc.w1 * static_cast<acc_t>(offset_bottom_data[pc.pos1]) +
+              pc.w2 * static_cast<acc_t>(offset_bottom_data[pc.pos2]) +
+              pc.w3 * static_cast<acc_t>(offset_bottom_data[pc.pos3]) +
+              pc.w4 * static_cast<acc_t>(offset_bottom_data[pc.pos4]);
 
-  int n_rois = nthreads / channels / pooled_width / pooled_height;
-  // (n, c, ph, pw) is an element in the pooled output
-  // can be parallelized using omp
-  // #pragma omp parallel for num_threads(32)
-#ifdef _OPENMP
-#if (_OPENMP >= 201307)
-# pragma omp parallel for simd
-#else
-# pragma omp parallel for schedule(static)
-#endif
-#endif
-  for (int n = 0; n < n_rois; n++) {
-    int index_n = n * channels * pooled_width * pooled_height;
-
-    // roi could have 4 or 5 columns
-    const T* offset_bottom_rois = bottom_rois + n * roi_cols;
-    int roi_batch_ind = 0;
-    if (roi_cols == 5) {
-      roi_batch_ind = offset_bottom_rois[0];
-      offset_bottom_rois++;
+          pre_calc_index += 1;
+        }
+        output_val /= grid.count;
+
+        offset_top_data[ph * pooled_width + pw] = static_cast<out_t>(output_val);
+      } // for pw
+    } // for ph
+  } // for c
+}
+
+// NHWC, the four taps of a sample point are channel vectors, contiguous in
+// the input as well as in the (channels last) output
+template <typename T, typename acc_t, typename out_t>
+inline void roi_align_forward_nhwc(
+    const T* bottom_data,
+    const ROIAlignBinGrid<acc_t>& grid,
+    const PreCalc<acc_t>* pre_calc,
+    const int channels,
+    const int height,
+    const int width,
+    const int pooled_height,
+    const int pooled_width,
+    acc_t* acc,
+    out_t* top_data) {
+  const T* offset_bottom_data =
+      bottom_data + (int64_t)grid.batch_ind * height * width * channels;
+  int pre_calc_index = 0;
+
+  for (int bin = 0; bin < pooled_height * pooled_width; bin++) {
+    std::fill(acc, acc + channels, acc_t(0));
+    for (int i = 0; i < grid.grid_h * grid.grid_w; i++) {
+      const PreCalc<acc_t>& pc = pre_calc[pre_calc_index];
+      const T* v1 = offset_bottom_data + (int64_t)pc.pos1 * channels;
+      const T* v2 = offset_bottom_data + (int64_t)pc.pos2 * channels;
+      const T* v3 = offset_bottom_data + (int64_t)pc.pos3 * channels;
+      const T* v4 = offset_bottom_data + (int64_t)pc.pos4 * channels;
+#pragma omp simd
+      for (int c = 0; c < channels; c++) {
+        acc[c] += pc.w1 * static_cast<acc_t>(v1[c]) +
+            pc.w2 * static_cast<acc_t>(v2[c]) +
+            pc.w3 * static_cast<acc_t>(v3[c]) +
+            pc.w4 * static_cast<acc_t>(v4[c]);
+      }
+
+      pre_calc_index += 1;
     }
 
-    // Do not using rounding; this implementation detail is critical
-    T roi_start_w = offset_bottom_rois[0] * spatial_scale;
-    T roi_start_h = offset_bottom_rois[1] * spatial_scale;
-    T roi_end_w = offset_bottom_rois[2] * spatial_scale;
-    T roi_end_h = offset_bottom_rois[3] * spatial_scale;
-    // T roi_start_w = round(offset_bottom_rois[0] * spatial_scale);
-    // T roi_start_h = round(offset_bottom_rois[1] * spatial_scale);
-    // T roi_end_w = round(offset_bottom_rois[2] * spatial_scale);
-    // T roi_end_h = round(offset_bottom_rois[3] * spatial_scale);
-
-    // Force malformed ROIs to be 1x1
-    T roi_width = std::max(roi_end_w - roi_start_w, (T)1.);
-    T roi_height = std::max(roi_end_h - roi_start_h, (T)1.);
-    T bin_size_h = static_cast<T>(roi_height) / static_cast<T>(pooled_height);
-    T bin_size_w = static_cast<T>(roi_width) / static_cast<T>(pooled_width);
-
-    // We use roi_bin_grid to sample the grid and mimic integral
-    int roi_bin_grid_h = (sampling_ratio > 0)
-        ? sampling_ratio
-        : ceil(roi_height / pooled_height); // e.g., = 2
-    int roi_bin_grid_w =
-        (sampling_ratio > 0) ? sampling_ratio : ceil(roi_width / pooled_width);
-
-    // We do average (integral) pooling inside a bin
-    const T count = roi_bin_grid_h * roi_bin_grid_w; // e.g. = 4
+    out_t* offset_top_data = top_data + (int64_t)bin * channels;
+#pragma omp simd
+    for (int c = 0; c < channels; c++) {
+      offset_top_data[c] = static_cast<out_t>(acc[c] / grid.count);
+    }
+  }
+}
+
+// Feature maps of a pyramid, ROI n is pooled from level levels[n]. A single
+// feature map is a pyramid of one level without a level table.
+template <typename T, typename acc_t>
+struct ROIAlignPyramid {
+  std::vector<T*> data;
+  std::vector<int> height;
+  std::vector<int> width;
+  std::vector<acc_t> spatial_scale;
+  const int64_t* levels = nullptr;
+
+  int level(int64_t n) const {
+    return levels == nullptr ? 0 : levels[n];
+  }
+};
 
+template <typename T, typename out_t>
+void ROIAlignForward_cpu_kernel(
+    const int n_rois,
+    const ROIAlignPyramid<const T, typename ROIAlignAccType<T>::type>& input,
+    const int channels,
+    const int pooled_height,
+    const int pooled_width,
+    const int sampling_ratio,
+    const typename ROIAlignAccType<T>::type* bottom_rois,
+    const bool channels_last,
+    out_t* top_data) {
+  using acc_t = typename ROIAlignAccType<T>::type;
+  int roi_cols = 5;
+  int64_t roi_size = (int64_t)channels * pooled_width * pooled_height;
+
+  // all the ROIs of all the levels at once, each writes its own output slot
+  at::parallel_for(0, n_rois, 1, [&](int64_t begin, int64_t end) {
     // we want to precalculate indices and weights shared by all channels,
-    // this is the key point of optimization
-    std::vector<PreCalc<T>> pre_calc(
-        roi_bin_grid_h * roi_bin_grid_w * pooled_width * pooled_height);
-    pre_calc_for_bilinear_interpolate(
-        height,
-        width,
-        pooled_height,
-        pooled_width,
-        roi_bin_grid_h,
-        roi_bin_grid_w,
-        roi_start_h,
-        roi_start_w,
-        bin_size_h,
-        bin_size_w,
-        roi_bin_grid_h,
-        roi_bin_grid_w,
-        pre_calc);
+    // this is the key point of optimization. The buffers are reused by all
+    // the ROIs of a thread.
+    std::vector<PreCalc<acc_t>> pre_calc;
+    std::vector<acc_t> acc(channels_last ? channels : 0);
+
+    for (int64_t n = begin; n < end; n++) {
+      int l = input.level(n);
+      int height = input.height[l];
+      int width = input.width[l];
+      auto grid = roi_align_bin_grid(
+          bottom_rois + n * roi_cols, input.spatial_scale[l], pooled_height, pooled_width, sampling_ratio);
+      roi_align_pre_calc(grid, height, width, pooled_height, pooled_width, pre_calc);
+
+      if (channels_last) {
+        roi_align_forward_nhwc(
+            input.data[l], grid, pre_calc.data(), channels, height, width,
+            pooled_height, pooled_width, acc.data(), top_data + n * roi_size);
+      } else {
+        roi_align_forward_nchw(
+            input.data[l], grid, pre_calc.data(), channels, height, width,
+            pooled_height, pooled_width, top_data + n * roi_size);
+      }
+    } // for n
+  });
+}
 
-      for (int c = 0; c < channels; c++) {
-      int index_n_c = index_n + c * pooled_width * pooled_height;
-      const T* offset_bottom_data =
-          bottom_data + (roi_batch_ind * channels + c) * height * width;
-      int pre_calc_index = 0;
-
-      for (int ph = 0; ph < pooled_height; ph++) {
-        for (int pw = 0; pw < pooled_width; pw++) {
-          int index = index_n_c + ph * pooled_width + pw;
-
-          T output_val = 0.;
-          for (int iy = 0; iy < roi_bin_grid_h; iy++) {
-            for (int ix = 0; ix < roi_bin_grid_w; ix++) {
-              PreCalc<T> pc = pre_calc[pre_calc_index];
-              output_val += pc.w1 * offset_bottom_data[pc.pos1] +
-                  pc.w2 * offset_bottom_data[pc.pos2] +
-                  pc.w3 * offset_bottom_data[pc.pos3] +
-                  pc.w4 * offset_bottom_data[pc.pos4];
-
-              pre_calc_index += 1;
-            }
-          }
-          output_val /= count;
+// Channels last only when the strides say so unambiguously, e.g. a 1x1 map
+// is contiguous in both formats and goes the NCHW way.
+static bool roi_align_use_channels_last(const at::Tensor& t) {
+  return t.dim() == 4 && !t.is_contiguous() &&
+      t.is_contiguous(at::MemoryFormat::ChannelsLast);
+}
 
-          top_data[index] = output_val;
-        } // for pw
-      } // for ph
-    } // for c
-  } // for n
+// Canonical FPN level of every ROI (eq. 1 of the FPN paper), computed as the
+// LevelMapper of maskrcnn-benchmark does:
+//   k = floor(k0 + log2(sqrt(area) / s0 + 1e-6)), clamped to [k_min, k_max]
+// where level k samples the image at 2^-k. Returns k - k_min, the index of
+// the feature map.
+template <typename T>
+void roi_align_assign_levels(
+    const T* rois,
+    const int64_t n_rois,
+    const int k_min,
+    const int k_max,
+    const int canonical_scale,
+    const int canonical_level,
+    int64_t* levels) {
+  for (int64_t n = 0; n < n_rois; n++) {
+    const T* roi = rois + n * 5;
+    T area = (roi[3] - roi[1] + 1) * (roi[4] - roi[2] + 1);
+    // a degenerate or NaN box would take the log of 0 or NaN, it goes to the finest level
+    if (!(area > T(1e-6))) {
+      area = T(1e-6);
+    }
+    T k = std::floor(canonical_level + std::log2(std::sqrt(area) / canonical_scale + T(1e-6)));
+    // clamped before the conversion, which is undefined for an out of range value
+    k = std::min<T>(std::max<T>(k, k_min), k_max);
+    levels[n] = static_cast<int64_t>(k) - k_min;
+  }
 }
 
-at::Tensor ROIAlign_forward_cpu(const at::Tensor& input,
+static at::Tensor roi_align_levels(
+    const at::Tensor& rois,
+    const std::vector<double>& spatial_scales,
+    const int canonical_scale,
+    const int canonical_level) {
+  TORCH_CHECK(!spatial_scales.empty(), "ROIAlign: no feature map given");
+  int k_min = std::lround(-std::log2(spatial_scales.front()));
+  int k_max = std::lround(-std::log2(spatial_scales.back()));
+  TORCH_CHECK(k_max - k_min + 1 == static_cast<int64_t>(spatial_scales.size()),
+      "ROIAlign: the spatial scales of a pyramid must halve from one level to the next, finest first");
+
+  auto levels = at::empty({rois.size(0)}, rois.options().dtype(at::kLong));
+  AT_DISPATCH_FLOATING_TYPES(rois.scalar_type(), "ROIAlign_levels", [&] {
+    roi_align_assign_levels(
+        rois.data_ptr<scalar_t>(), rois.size(0), k_min, k_max,
+        canonical_scale, canonical_level, levels.data_ptr<int64_t>());
+  });
+  return levels;
+}
+
+// levels: level of every ROI, undefined for a single feature map
+at::Tensor ROIAlign_forward_cpu(const std::vector<at::Tensor>& inputs,
                                 const at::Tensor& rois,
-                                const float spatial_scale,
+                                const std::vector<double>& spatial_scales,
+                                const at::Tensor& levels,
                                 const int pooled_height,
                                 const int pooled_width,
-                                const int sampling_ratio) {
-  AT_ASSERTM(!input.type().is_cuda(), "input must be a CPU tensor");
+                                const int sampling_ratio,
+                                const at::ScalarType output_type) {
+  TORCH_CHECK(!inputs.empty() && inputs.size() == spatial_scales.size(),
+      "ROIAlign: expected a spatial scale for every feature map");
   AT_ASSERTM(!rois.type().is_cuda(), "rois must be a CPU tensor");
+  TORCH_CHECK(rois.dim() == 2 && rois.size(1) == 5, "ROIAlign: rois must be of shape [K, 5]");
+  const auto& input = inputs[0];
+  for (const auto& feature : inputs) {
+    AT_ASSERTM(!feature.type().is_cuda(), "input must be a CPU tensor");
+    TORCH_CHECK(feature.dim() == 4, "ROIAlign: expected a 4-D input, got ", feature.dim(), "-D");
+    TORCH_CHECK(feature.scalar_type() == input.scalar_type() &&
+        feature.size(0) == input.size(0) && feature.size(1) == input.size(1),
+        "ROIAlign: the feature maps must share their type, batch size and channels");
+  }
 
   auto num_rois = rois.size(0);
   auto channels = input.size(1);
-  auto height = input.size(2);
-  auto width = input.size(3);
 
-  auto output = at::empty({num_rois, channels, pooled_height, pooled_width}, input.options());
-  auto output_size = num_rois * pooled_height * pooled_width * channels;
+  // the first level decides the layout of all
+  bool channels_last = roi_align_use_channels_last(input);
+  auto memory_format = channels_last ? at::MemoryFormat::ChannelsLast : at::MemoryFormat::Contiguous;
+  auto output = at::empty(
+      {num_rois, channels, pooled_height, pooled_width},
+      input.options().dtype(output_type),
+      memory_format);
 
   if (output.numel() == 0) {
     return output;
   }
 
-  AT_DISPATCH_FLOATING_TYPES(input.type(), "ROIAlign_forward", [&] {
-    ROIAlignForward_cpu_kernel<scalar_t>(
-         output_size,
-         input.data<scalar_t>(),
-         spatial_scale,
-         channels,
-         height,
-         width,
-         pooled_height,
-         pooled_width,
-         sampling_ratio,
-         rois.data<scalar_t>(),
-         output.data<scalar_t>());
+  std::vector<at::Tensor> inputs_;
+  for (const auto& feature : inputs) {
+    inputs_.push_back(feature.contiguous(memory_format));
+  }
+  auto levels_ = levels.defined() ? levels.contiguous() : levels;
+  AT_DISPATCH_FLOATING_TYPES_AND(at::ScalarType::BFloat16, input.scalar_type(), "ROIAlign_forward", [&] {
+    using acc_t = typename ROIAlignAccType<scalar_t>::type;
+    auto rois_ = rois.to(c10::CppTypeToScalarType<acc_t>::value).contiguous();
+    ROIAlignPyramid<const scalar_t, acc_t> pyramid;
+    for (size_t l = 0; l < inputs_.size(); l++) {
+      pyramid.data.push_back(inputs_[l].data_ptr<scalar_t>());
+      pyramid.height.push_back(inputs_[l].size(2));
+      pyramid.width.push_back(inputs_[l].size(3));
+      pyramid.spatial_scale.push_back(spatial_scales[l]);
+    }
+    if (levels_.defined()) {
+      pyramid.levels = levels_.data_ptr<int64_t>();
+    }
+
+    if (output_type == input.scalar_type()) {
+      ROIAlignForward_cpu_kernel<scalar_t, scalar_t>(
+           num_rois,
+           pyramid,
+           channels,
+           pooled_height,
+           pooled_width,
+           sampling_ratio,
+           rois_.data_ptr<acc_t>(),
+           channels_last,
+           output.data_ptr<scalar_t>());
+    } else {
+      // bf16 storage behind an fp32 tensor, see roi_align_cpu_tensor
+      TORCH_CHECK(output_type == c10::CppTypeToScalarType<acc_t>::value,
+          "ROIAlign: unsupported output type ", output_type, " for input ", input.scalar_type());
+      ROIAlignForward_cpu_kernel<scalar_t, acc_t>(
+           num_rois,
+           pyramid,
+           channels,
+           pooled_height,
+           pooled_width,
+           sampling_ratio,
+           rois_.data_ptr<acc_t>(),
+           channels_last,
+           output.data_ptr<acc_t>());
+    }
   });
   return output;
 }
 
-template <class T>
-inline void add(const T& val, T* address) {
-  *address += val;
+// NCHW, scatters the gradient of one ROI to the planes [c_begin, c_end) of
+// its image
+template <typename T, typename acc_t>
+inline void roi_align_backward_nchw(
+    const T* top_diff,
+    const ROIAlignBinGrid<acc_t>& grid,
+    const PreCalc<acc_t>* pre_calc,
+    const int c_begin,
+    const int c_end,
+    const int channels,
+    const int height,
+    const int width,
+    const int pooled_height,
+    const int pooled_width,
+    acc_t* bottom_diff) {
+  for (int c = c_begin; c < c_end; c++) {
+    acc_t* offset_bottom_diff =
+        bottom_diff + ((int64_t)grid.batch_ind * channels + c) * height * width;
+    const T* offset_top_diff = top_diff + c * pooled_height * pooled_width;
+    int pre_calc_index = 0;
+
+    for (int bin = 0; bin < pooled_height * pooled_width; bin++) {
+      acc_t top_diff_this_bin = static_cast<acc_t>(offset_top_diff[bin]) / grid.count;
+      for (int i = 0; i < grid.grid_h * grid.grid_w; i++) {
+        const PreCalc<acc_t>& pc = pre_calc[pre_calc_index];
+        pre_calc_index += 1;
+        // sample points out of the feature map have no weight
+        offset_bottom_diff[pc.pos1] += pc.w1 * top_diff_this_bin;
+        offset_bottom_diff[pc.pos2] += pc.w2 * top_diff_this_bin;
+        offset_bottom_diff[pc.pos3] += pc.w3 * top_diff_this_bin;
+        offset_bottom_diff[pc.pos4] += pc.w4 * top_diff_this_bin;
+      }
+    } // for bin
+  } // for c
 }
 
-template <typename T>
-void bilinear_interpolate_gradient(
+// NHWC, the same for the channel slice [c_begin, c_end) of every pixel: the
+// taps of a sample point are shared by the whole slice
+template <typename T, typename acc_t>
+inline void roi_align_backward_nhwc(
+    const T* top_diff,
+    const ROIAlignBinGrid<acc_t>& grid,
+    const PreCalc<acc_t>* pre_calc,
+    const int c_begin,
+    const int c_end,
+    const int channels,
     const int height,
     const int width,
-    T y,
-    T x,
-    T& w1,
-    T& w2,
-    T& w3,
-    T& w4,
-    int& x_low,
-    int& x_high,
-    int& y_low,
-    int& y_high,
-    const int /*index*/ /* index for debug only*/) {
-  // deal with cases that inverse elements are out of feature map boundary
-  if (y < -1.0 || y > height || x < -1.0 || x > width) {
-    // empty
-    w1 = w2 = w3 = w4 = 0.;
-    x_low = x_high = y_low = y_high = -1;
-    return;
-  }
+    const int pooled_height,
+    const int pooled_width,
+    acc_t* grad_bin,
+    acc_t* bottom_diff) {
+  int c_len = c_end - c_begin;
+  acc_t* offset_bottom_diff =
+      bottom_diff + (int64_t)grid.batch_ind * height * width * channels + c_begin;
+  int pre_calc_index = 0;
 
-  if (y <= 0) {
-    y = 0;
-  }
-  if (x <= 0) {
-    x = 0;
-  }
+  for (int bin = 0; bin < pooled_height * pooled_width; bin++) {
+    const T* offset_top_diff = top_diff + (int64_t)bin * channels + c_begin;
+#pragma omp simd
+    for (int c = 0; c < c_len; c++) {
+      grad_bin[c] = static_cast<acc_t>(offset_top_diff[c]) / grid.count;
+    }
+
+    for (int i = 0; i < grid.grid_h * grid.grid_w; i++) {
+      const PreCalc<acc_t>& pc = pre_calc[pre_calc_index];
+      pre_calc_index += 1;
+      // sample point out of the feature map
+      if (pc.w1 == 0 && pc.w2 == 0 && pc.w3 == 0 && pc.w4 == 0) {
+        continue;
+      }
 
-  y_low = (int)y;
-  x_low = (int)x;
+      // the taps may share a pixel on the border, one loop per tap keeps
+      // the adds in order
+      const int pos[4] = {pc.pos1, pc.pos2, pc.pos3, pc.pos4};
+      const acc_t w[4] = {pc.w1, pc.w2, pc.w3, pc.w4};
+      for (int k = 0; k < 4; k++) {
+        acc_t* diff = offset_bottom_diff + (int64_t)pos[k] * channels;
+#pragma omp simd
+        for (int c = 0; c < c_len; c++) {
+          diff[c] += w[k] * grad_bin[c];
+        }
+      }
+    }
+  } // for bin
+}
 
-  if (y_low >= height - 1) {
-    y_high = y_low = height - 1;
-    y = (T)y_low;
-  } else {
-    y_high = y_low + 1;
+// Overlapping ROIs scatter to the same pixels, the backward is parallel in
+// one of two race free ways:
+//  PLANES:  threads own (image, channel block) planes and walk the ROIs of
+//           their images, every plane has exactly one writer.
+//  PRIVATE: threads split the ROIs and scatter into private copies of the
+//           gradient, summed up at the end.
+enum class ROIAlignBackwardPolicy { AUTO, PLANES, PRIVATE };
+
+// Channels of a PLANES work item in NHWC, a vector of adds per tap
+constexpr int kROIAlignChannelBlock = 16;
+// Cap on the elements of all the private gradient copies
+constexpr int64_t kROIAlignPrivateLimit = 1 << 26;
+
+// PLANES costs nothing extra but needs enough planes to feed the threads and
+// balances poorly when the ROIs crowd on a few images. PRIVATE zeroes and
+// reduces one copy of the feature maps per thread, which pays off once the
+// ROI samples outnumber the feature pixels, many ROIs on small maps.
+static ROIAlignBackwardPolicy roi_align_backward_policy(
+    const int64_t num_rois,
+    const int64_t batch_size,
+    const int64_t channels,
+    const int64_t pixels,
+    const int64_t pooled_size,
+    const bool channels_last) {
+  int64_t nthreads = at::get_num_threads();
+  if (nthreads == 1 || nthreads * batch_size * channels * pixels > kROIAlignPrivateLimit) {
+    return ROIAlignBackwardPolicy::PLANES;
   }
-
-  if (x_low >= width - 1) {
-    x_high = x_low = width - 1;
-    x = (T)x_low;
-  } else {
-    x_high = x_low + 1;
+  int64_t planes = batch_size *
+      (channels_last ? (channels + kROIAlignChannelBlock - 1) / kROIAlignChannelBlock : channels);
+  if (planes < nthreads || num_rois * pooled_size >= batch_size * pixels) {
+    return ROIAlignBackwardPolicy::PRIVATE;
   }
-
-  T ly = y - y_low;
-  T lx = x - x_low;
-  T hy = 1. - ly, hx = 1. - lx;
-
-  // reference in forward
-  // T v1 = bottom_data[y_low * width + x_low];
-  // T v2 = bottom_data[y_low * width + x_high];
-  // T v3 = bottom_data[y_high * width + x_low];
-  // T v4 = bottom_data[y_high * width + x_high];
-  // T val = (w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4);
-
-  w1 = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
-
-  return;
+  return ROIAlignBackwardPolicy::PLANES;
 }
 
-
-
 template <typename T>
-void RoIAlignBackwardFeature_cpu_kernel(
-    const int nthreads,
+void ROIAlignBackward_cpu_kernel(
     const T* top_diff,
     const int num_rois,
-    const T& spatial_scale,
+    const ROIAlignPyramid<typename ROIAlignAccType<T>::type, typename ROIAlignAccType<T>::type>& grad_input,
+    const int batch_size,
     const int channels,
-    const int height,
-    const int width,
     const int pooled_height,
     const int pooled_width,
     const int sampling_ratio,
-    T* bottom_diff,
-    const T* bottom_rois) {
-  //DCHECK(rois_cols == 4 || rois_cols == 5);
+    const typename ROIAlignAccType<T>::type* bottom_rois,
+    const bool channels_last,
+    ROIAlignBackwardPolicy policy) {
+  using acc_t = typename ROIAlignAccType<T>::type;
   int rois_cols = 5;
-#ifdef _OPENMP
-#if (_OPENMP >= 201307)
-# pragma omp parallel for simd
-#else
-# pragma omp parallel for schedule(static)
-#endif
-#endif
-  for (int index = 0; index < nthreads; index++) {
-    // (n, c, ph, pw) is an element in the pooled output
-    int pw = index % pooled_width;
-    int ph = (index / pooled_width) % pooled_height;
-    int c = (index / pooled_width / pooled_height) % channels;
-    int n = index / pooled_width / pooled_height / channels;
-
-    const T* offset_bottom_rois = bottom_rois + n * rois_cols;
-    int roi_batch_ind = 0;
-    if (rois_cols == 5) {
-      roi_batch_ind = offset_bottom_rois[0];
-      offset_bottom_rois++;
+  int64_t roi_size = (int64_t)channels * pooled_height * pooled_width;
+  int n_levels = grad_input.data.size();
+  std::vector<int64_t> level_numel(n_levels);
+  for (int l = 0; l < n_levels; l++) {
+    level_numel[l] = (int64_t)batch_size * channels * grad_input.height[l] * grad_input.width[l];
+  }
+
+  if (policy == ROIAlignBackwardPolicy::AUTO) {
+    int64_t pixels = 0;
+    for (int l = 0; l < n_levels; l++) {
+      pixels += grad_input.height[l] * grad_input.width[l];
     }
+    policy = roi_align_backward_policy(
+        num_rois, batch_size, channels, pixels, pooled_height * pooled_width, channels_last);
+  }
 
-    // Do not using rounding; this implementation detail is critical
-    T roi_start_w = offset_bottom_rois[0] * spatial_scale;
-    T roi_start_h = offset_bottom_rois[1] * spatial_scale;
-    T roi_end_w = offset_bottom_rois[2] * spatial_scale;
-    T roi_end_h = offset_bottom_rois[3] * spatial_scale;
-    // T roi_start_w = round(offset_bottom_rois[0] * spatial_scale);
-    // T roi_start_h = round(offset_bottom_rois[1] * spatial_scale);
-    // T roi_end_w = round(offset_bottom_rois[2] * spatial_scale);
-    // T roi_end_h = round(offset_bottom_rois[3] * spatial_scale);
-
-    // Force malformed ROIs to be 1x1
-    T roi_width = std::max(roi_end_w - roi_start_w, (T)1.);
-    T roi_height = std::max(roi_end_h - roi_start_h, (T)1.);
-    T bin_size_h = static_cast<T>(roi_height) / static_cast<T>(pooled_height);
-    T bin_size_w = static_cast<T>(roi_width) / static_cast<T>(pooled_width);
-
-    T* offset_bottom_diff =
-        bottom_diff + (roi_batch_ind * channels + c) * height * width;
-
-    int top_offset = (n * channels + c) * pooled_height * pooled_width;
-    const T* offset_top_diff = top_diff + top_offset;
-    const T top_diff_this_bin = offset_top_diff[ph * pooled_width + pw];
-
-    // We use roi_bin_grid to sample the grid and mimic integral
-    int roi_bin_grid_h = (sampling_ratio > 0)
-        ? sampling_ratio
-        : ceil(roi_height / pooled_height); // e.g., = 2
-    int roi_bin_grid_w =
-        (sampling_ratio > 0) ? sampling_ratio : ceil(roi_width / pooled_width);
-
-    // We do average (integral) pooling inside a bin
-    const T count = roi_bin_grid_h * roi_bin_grid_w; // e.g. = 4
-
-    for (int iy = 0; iy < roi_bin_grid_h; iy++) {
-      const T y = roi_start_h + ph * bin_size_h +
-          static_cast<T>(iy + .5f) * bin_size_h /
-              static_cast<T>(roi_bin_grid_h); // e.g., 0.5, 1.5
-      for (int ix = 0; ix < roi_bin_grid_w; ix++) {
-        const T x = roi_start_w + pw * bin_size_w +
-            static_cast<T>(ix + .5f) * bin_size_w /
-                static_cast<T>(roi_bin_grid_w);
-
-        T w1, w2, w3, w4;
-        int x_low, x_high, y_low, y_high;
-
-        bilinear_interpolate_gradient(
-            height,
-            width,
-            y,
-            x,
-            w1,
-            w2,
-            w3,
-            w4,
-            x_low,
-            x_high,
-            y_low,
-            y_high,
-            index);
-
-        T g1 = top_diff_this_bin * w1 / count;
-        T g2 = top_diff_this_bin * w2 / count;
-        T g3 = top_diff_this_bin * w3 / count;
-        T g4 = top_diff_this_bin * w4 / count;
-
-        if (x_low >= 0 && x_high >= 0 && y_low >= 0 && y_high >= 0) {
-          // atomic add is not needed for now since it is single threaded
-          add(static_cast<T>(g1), offset_bottom_diff + y_low * width + x_low);
-          add(static_cast<T>(g2), offset_bottom_diff + y_low * width + x_high);
-          add(static_cast<T>(g3), offset_bottom_diff + y_high * width + x_low);
-          add(static_cast<T>(g4), offset_bottom_diff + y_high * width + x_high);
-        } // if
-      } // ix
-    } // iy
-  } // for
-} // ROIAlignBackward
-
-
-
-// TODO remove the dependency on input and use instead its sizes -> save memory
-at::Tensor ROIAlign_backward_cpu(const at::Tensor& grad,
-                                 const at::Tensor& rois,
-                                 const float spatial_scale,
-                                 const int pooled_height,
-                                 const int pooled_width,
-                                 const int batch_size,
-                                 const int channels,
-                                 const int height,
-                                 const int width,
-                                 const int sampling_ratio) {
+  // ROI n to the planes [c_begin, c_end) of the gradient of its level
+  auto scatter = [&](int64_t n, int c_begin, int c_end, acc_t* const* level_diff,
+                     std::vector<PreCalc<acc_t>>& pre_calc, acc_t* grad_bin) {
+    int l = grad_input.level(n);
+    int height = grad_input.height[l];
+    int width = grad_input.width[l];
+    auto grid = roi_align_bin_grid(
+        bottom_rois + n * rois_cols, grad_input.spatial_scale[l], pooled_height, pooled_width, sampling_ratio);
+    roi_align_pre_calc(grid, height, width, pooled_height, pooled_width, pre_calc);
+    if (channels_last) {
+      roi_align_backward_nhwc(
+          top_diff + n * roi_size, grid, pre_calc.data(), c_begin, c_end, channels,
+          height, width, pooled_height, pooled_width, grad_bin, level_diff[l]);
+    } else {
+      roi_align_backward_nchw(
+          top_diff + n * roi_size, grid, pre_calc.data(), c_begin, c_end, channels,
+          height, width, pooled_height, pooled_width, level_diff[l]);
+    }
+  };
+
+  if (policy == ROIAlignBackwardPolicy::PLANES) {
+    std::vector<std::vector<int64_t>> image_rois(batch_size);
+    for (int64_t n = 0; n < num_rois; n++) {
+      int b = bottom_rois[n * rois_cols];
+      TORCH_CHECK(b >= 0 && b < batch_size, "ROIAlign: batch index ", b, " of ROI ", n, " out of range");
+      image_rois[b].push_back(n);
+    }
+
+    int c_block = channels_last ? kROIAlignChannelBlock : 1;
+    int64_t n_blocks = (channels + c_block - 1) / c_block;
+    at::parallel_for(0, batch_size * n_blocks, 1, [&](int64_t begin, int64_t end) {
+      std::vector<PreCalc<acc_t>> pre_calc;
+      std::vector<acc_t> grad_bin(channels_last ? channels : 0);
+      for (int64_t b = begin / n_blocks; b * n_blocks < end; b++) {
+        int c_begin = (std::max(begin, b * n_blocks) - b * n_blocks) * c_block;
+        int c_end = std::min<int64_t>((std::min(end, (b + 1) * n_blocks) - b * n_blocks) * c_block, channels);
+        for (auto n : image_rois[b]) {
+          scatter(n, c_begin, c_end, grad_input.data.data(), pre_calc, grad_bin.data());
+        }
+      }
+    });
+    return;
+  }
+
+  // PRIVATE, thread 0 accumulates into the result itself
+  int nthreads = at::get_num_threads();
+  int64_t total_numel = 0;
+  for (int l = 0; l < n_levels; l++) {
+    total_numel += level_numel[l];
+  }
+  std::vector<std::vector<acc_t>> private_diff(nthreads);
+  at::parallel_for(0, num_rois, 1, [&](int64_t begin, int64_t end) {
+    int tid = at::get_thread_num();
+    TORCH_INTERNAL_ASSERT(tid < nthreads);
+    std::vector<acc_t*> level_diff(grad_input.data);
+    if (tid != 0) {
+      if (private_diff[tid].empty()) {
+        private_diff[tid].assign(total_numel, acc_t(0));
+      }
+      acc_t* diff = private_diff[tid].data();
+      for (int l = 0; l < n_levels; l++) {
+        level_diff[l] = diff;
+        diff += level_numel[l];
+      }
+    }
+    std::vector<PreCalc<acc_t>> pre_calc;
+    std::vector<acc_t> grad_bin(channels_last ? channels : 0);
+    for (int64_t n = begin; n < end; n++) {
+      scatter(n, 0, channels, level_diff.data(), pre_calc, grad_bin.data());
+    }
+  });
+
+  int64_t offset = 0;
+  for (int l = 0; l < n_levels; l++) {
+    acc_t* out = grad_input.data[l];
+    at::parallel_for(0, level_numel[l], 2048, [&](int64_t begin, int64_t end) {
+      for (int t = 1; t < nthreads; t++) {
+        if (private_diff[t].empty()) {
+          continue;
+        }
+        const acc_t* diff = private_diff[t].data() + offset;
+#pragma omp simd
+        for (int64_t i = begin; i < end; i++) {
+          out[i] += diff[i];
+        }
+      }
+    });
+    offset += level_numel[l];
+  }
+}
+
+static ROIAlignBackwardPolicy roi_align_backward_policy_from_string(const std::string& policy) {
+  if (policy == "auto") {
+    return ROIAlignBackwardPolicy::AUTO;
+  } else if (policy == "planes") {
+    return ROIAlignBackwardPolicy::PLANES;
+  } else if (policy == "private") {
+    return ROIAlignBackwardPolicy::PRIVATE;
+  }
+  TORCH_CHECK(false, "ROIAlign: unknown backward policy ", policy, ", expected auto, planes or private");
+  return ROIAlignBackwardPolicy::AUTO;
+}
+
+// levels: level of every ROI, undefined for a single feature map. Returns the
+// gradient of every level.
+std::vector<at::Tensor> ROIAlign_backward_cpu(const at::Tensor& grad,
+                                              const at::Tensor& rois,
+                                              const std::vector<double>& spatial_scales,
+                                              const at::Tensor& levels,
+                                              const int pooled_height,
+                                              const int pooled_width,
+                                              const int batch_size,
+                                              const int channels,
+                                              const std::vector<int64_t>& heights,
+                                              const std::vector<int64_t>& widths,
+                                              const int sampling_ratio,
+                                              const at::ScalarType output_type,
+                                              const ROIAlignBackwardPolicy policy = ROIAlignBackwardPolicy::AUTO) {
   AT_ASSERTM(!grad.type().is_cuda(), "grad must be a CPU tensor");
   AT_ASSERTM(!rois.type().is_cuda(), "rois must be a CPU tensor");
+  TORCH_CHECK(rois.dim() == 2 && rois.size(1) == 5, "ROIAlign: rois must be of shape [K, 5]");
+  TORCH_CHECK(heights.size() == spatial_scales.size() && widths.size() == spatial_scales.size(),
+      "ROIAlign: expected a spatial scale for every feature map");
 
   auto num_rois = rois.size(0);
-  auto grad_input = at::zeros({batch_size, channels, height, width}, grad.options());
+  bool channels_last = roi_align_use_channels_last(grad);
+  auto memory_format = channels_last ? at::MemoryFormat::ChannelsLast : at::MemoryFormat::Contiguous;
+  // bf16 gradients are accumulated in fp32
+  auto acc_type = grad.scalar_type() == at::kBFloat16 ? at::kFloat : grad.scalar_type();
+  std::vector<at::Tensor> grad_inputs;
+  for (size_t l = 0; l < heights.size(); l++) {
+    grad_inputs.push_back(at::zeros(
+        {batch_size, channels, heights[l], widths[l]},
+        grad.options().dtype(acc_type),
+        memory_format));
+  }
 
   // handle possibly empty gradients
-  if (grad.numel() == 0) {
-    return grad_input;
+  if (grad.numel() != 0) {
+    auto grad_ = grad.contiguous(memory_format);
+    auto levels_ = levels.defined() ? levels.contiguous() : levels;
+    auto rois_ = rois.to(acc_type).contiguous();
+    AT_DISPATCH_FLOATING_TYPES_AND(at::ScalarType::BFloat16, grad.scalar_type(), "ROIAlign_backward", [&] {
+      using acc_t = typename ROIAlignAccType<scalar_t>::type;
+      ROIAlignPyramid<acc_t, acc_t> pyramid;
+      for (size_t l = 0; l < grad_inputs.size(); l++) {
+        pyramid.data.push_back(grad_inputs[l].data_ptr<acc_t>());
+        pyramid.height.push_back(heights[l]);
+        pyramid.width.push_back(widths[l]);
+        pyramid.spatial_scale.push_back(spatial_scales[l]);
+      }
+      if (levels_.defined()) {
+        pyramid.levels = levels_.data_ptr<int64_t>();
+      }
+
+      ROIAlignBackward_cpu_kernel<scalar_t>(
+           grad_.data_ptr<scalar_t>(),
+           num_rois,
+           pyramid,
+           batch_size,
+           channels,
+           pooled_height,
+           pooled_width,
+           sampling_ratio,
+           rois_.data_ptr<acc_t>(),
+           channels_last,
+           policy);
+    });
   }
 
-  AT_DISPATCH_FLOATING_TYPES(grad.type(), "ROIAlign_backward", [&] {
-    RoIAlignBackwardFeature_cpu_kernel<scalar_t>(
-         grad.numel(),
-         grad.data<scalar_t>(),
-         num_rois,
-         spatial_scale,
-         channels,
-         height,
-         width,
-         pooled_height,
-         pooled_width,
-         sampling_ratio,
-         grad_input.data<scalar_t>(),
-         rois.data<scalar_t>());
-  });
-  return grad_input;
+  for (auto& grad_input : grad_inputs) {
+    if (grad_input.scalar_type() != output_type) {
+      grad_input = grad_input.to(output_type);
+    }
+  }
+  return grad_inputs;
+}
+
+// Mixed precision (auto bf16) keeps the feature maps as bf16 dil buffers
+// behind fp32 aten tensors. The kernels read the bf16 buffer in place rather
+// than reordering the whole map to fp32, the result is fp32 as the aten
+// type says.
+static at::Tensor roi_align_cpu_tensor(const at::Tensor& t, at::ScalarType& aten_type) {
+  aten_type = t.scalar_type();
+  if (cpu::ShadeDataContext::isDilTensor(t) &&
+      cpu::ShadeDataContext::isTensorMixPrecision(t) &&
+      cpu::ShadeDataContext::getDilStorage(t).get_data_type() == dil::data_type::bf16) {
+    return cpu::bf16::gen_consistent_tensor(t);
+  }
+  return bridge::shallowFallbackToCPUTensor(t);
 }
 
 at::Tensor IpexExternal::ROIAlign_forward(const at::Tensor& input,
@@ -511,9 +848,10 @@ at::Tensor IpexExternal::ROIAlign_forward(const at::Tensor& input,
 #endif
   TORCH_INTERNAL_ASSERT_DEBUG_ONLY(input.layout() == c10::kStrided);
   TORCH_INTERNAL_ASSERT_DEBUG_ONLY(rois.layout() == c10::kStrided);
-  auto&& _ipex_input = bridge::shallowFallbackToCPUTensor(input);
+  at::ScalarType output_type;
+  auto&& _ipex_input = roi_align_cpu_tensor(input, output_type);
   auto&& _ipex_rois = bridge::shallowFallbackToCPUTensor(rois);
-  auto&& _ipex_output = ROIAlign_forward_cpu(_ipex_input, _ipex_rois, spatial_scale, pooled_height, pooled_width, sampling_ratio);
+  auto&& _ipex_output = ROIAlign_forward_cpu({_ipex_input}, _ipex_rois, {spatial_scale}, at::Tensor(), pooled_height, pooled_width, sampling_ratio, output_type);
   static_cast<void>(_ipex_output); // Avoid warnings in case not used
   return bridge::shallowUpgradeToDPCPPTensor(_ipex_output);
 }
@@ -536,12 +874,90 @@ at::Tensor IpexExternal::ROIAlign_backward(const at::Tensor& grad,
 #endif
   TORCH_INTERNAL_ASSERT_DEBUG_ONLY(grad.layout() == c10::kStrided);
   TORCH_INTERNAL_ASSERT_DEBUG_ONLY(rois.layout() == c10::kStrided);
-  auto&& _ipex_grad = bridge::shallowFallbackToCPUTensor(grad);
+  at::ScalarType output_type;
+  auto&& _ipex_grad = roi_align_cpu_tensor(grad, output_type);
   auto&& _ipex_rois = bridge::shallowFallbackToCPUTensor(rois);
-  auto&& _ipex_grad_input = ROIAlign_backward_cpu(_ipex_grad, _ipex_rois, spatial_scale, pooled_height, pooled_width, batch_size, channels, height, width, sampling_ratio);
+  auto&& _ipex_grad_input = ROIAlign_backward_cpu(_ipex_grad, _ipex_rois, {spatial_scale}, at::Tensor(), pooled_height, pooled_width, batch_size, channels, {height}, {width}, sampling_ratio, output_type);
   static_cast<void>(_ipex_grad_input); // Avoid warnings in case not used
-  return bridge::shallowUpgradeToDPCPPTensor(_ipex_grad_input);
+  return bridge::shallowUpgradeToDPCPPTensor(_ipex_grad_input[0]);
+}
+
+at::Tensor IpexExternal::ROIAlign_backward_with_policy(const at::Tensor& grad,
+                                 const at::Tensor& rois,
+                                 const float spatial_scale,
+                                 const int pooled_height,
+                                 const int pooled_width,
+                                 const int batch_size,
+                                 const int channels,
+                                 const int height,
+                                 const int width,
+                                 const int sampling_ratio,
+                                 const std::string& policy) {
+  at::ScalarType output_type;
+  auto&& _ipex_grad = roi_align_cpu_tensor(grad, output_type);
+  auto&& _ipex_rois = bridge::shallowFallbackToCPUTensor(rois);
+  auto&& _ipex_grad_input = ROIAlign_backward_cpu(_ipex_grad, _ipex_rois, {spatial_scale}, at::Tensor(), pooled_height, pooled_width, batch_size, channels, {height}, {width}, sampling_ratio, output_type, roi_align_backward_policy_from_string(policy));
+  return bridge::shallowUpgradeToDPCPPTensor(_ipex_grad_input[0]);
 }
 
+at::Tensor IpexExternal::ROIAlign_forward_multilevel(const std::vector<at::Tensor>& features,
+                                           const at::Tensor& rois,
+                                           const std::vector<double>& spatial_scales,
+                                           const int pooled_height,
+                                           const int pooled_width,
+                                           const int sampling_ratio,
+                                           const int canonical_scale,
+                                           const int canonical_level) {
+#if defined(IPEX_DISP_OP)
+  printf("IpexExternal::ROIAlign_forward_multilevel\n");
+#endif
+#if defined(IPEX_PROFILE_OP)
+  RECORD_FUNCTION("IpexExternal::ROIAlign_forward_multilevel", std::vector<c10::IValue>({rois}));
+#endif
+  TORCH_INTERNAL_ASSERT_DEBUG_ONLY(rois.layout() == c10::kStrided);
+  at::ScalarType output_type;
+  std::vector<at::Tensor> _ipex_features;
+  for (const auto& feature : features) {
+    TORCH_INTERNAL_ASSERT_DEBUG_ONLY(feature.layout() == c10::kStrided);
+    _ipex_features.push_back(roi_align_cpu_tensor(feature, output_type));
+  }
+  auto&& _ipex_rois = bridge::shallowFallbackToCPUTensor(rois);
+  auto&& _ipex_levels = roi_align_levels(_ipex_rois, spatial_scales, canonical_scale, canonical_level);
+  auto&& _ipex_output = ROIAlign_forward_cpu(_ipex_features, _ipex_rois, spatial_scales, _ipex_levels, pooled_height, pooled_width, sampling_ratio, output_type);
+  static_cast<void>(_ipex_output); // Avoid warnings in case not used
+  return bridge::shallowUpgradeToDPCPPTensor(_ipex_output);
 }
 
+std::vector<at::Tensor> IpexExternal::ROIAlign_backward_multilevel(const at::Tensor& grad,
+                                           const at::Tensor& rois,
+                                           const std::vector<double>& spatial_scales,
+                                           const int pooled_height,
+                                           const int pooled_width,
+                                           const int batch_size,
+                                           const int channels,
+                                           const std::vector<int64_t>& heights,
+                                           const std::vector<int64_t>& widths,
+                                           const int sampling_ratio,
+                                           const int canonical_scale,
+                                           const int canonical_level) {
+#if defined(IPEX_DISP_OP)
+  printf("IpexExternal::ROIAlign_backward_multilevel\n");
+#endif
+#if defined(IPEX_PROFILE_OP)
+  RECORD_FUNCTION("IpexExternal::ROIAlign_backward_multilevel", std::vector<c10::IValue>({grad, rois}));
+#endif
+  TORCH_INTERNAL_ASSERT_DEBUG_ONLY(grad.layout() == c10::kStrided);
+  TORCH_INTERNAL_ASSERT_DEBUG_ONLY(rois.layout() == c10::kStrided);
+  at::ScalarType output_type;
+  auto&& _ipex_grad = roi_align_cpu_tensor(grad, output_type);
+  auto&& _ipex_rois = bridge::shallowFallbackToCPUTensor(rois);
+  auto&& _ipex_levels = roi_align_levels(_ipex_rois, spatial_scales, canonical_scale, canonical_level);
+  auto&& _ipex_grad_inputs = ROIAlign_backward_cpu(_ipex_grad, _ipex_rois, spatial_scales, _ipex_levels, pooled_height, pooled_width, batch_size, channels, heights, widths, sampling_ratio, output_type);
+  std::vector<at::Tensor> grad_inputs;
+  for (const auto& grad_input : _ipex_grad_inputs) {
+    grad_inputs.push_back(bridge::shallowUpgradeToDPCPPTensor(grad_input));
+  }
+  return grad_inputs;
+}
+
+}
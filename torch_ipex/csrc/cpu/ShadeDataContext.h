@@ -8,6 +8,7 @@
 
 #include "torch_ipex/csrc/utils.h"
 #include <mutex>
+#include <vector>
 
 namespace torch_ipex {
 namespace cpu {
@@ -63,10 +64,27 @@ struct ShadeDataContext {
   // only reorder for auto mix precision is inplace now, and new dtype may need new format for oneDNN kernel
   bool packed;
 
+  // The weight of a linear quantized to s8 once for the dynamic int8 mode, whose activations are quantized
+  // on the fly per call. Like "packed", it is reset when the tensor is reordered.
+  bool dynamic_int8;
+
+  // The weights of some ops, like the rnn ones, cannot be packed inplace because the formats of their forward
+  // and backward differ or because they are shuffled first. Their reordered copies are kept here instead and
+  // reused while the weight is unchanged. They all belong to the version "reordered_version" of the tensor, so
+  // an inplace update of the weight, e.g. by the optimizer, invalidates them. An update through .data does not
+  // bump that version, its writer drops them with dropReorderedWeights. They also belong to one execution mode,
+  // "reordered_train", so the inference copies are freed by the first call in training and vice versa.
+  std::vector<dil::tensor> reordered_weights;
+  uint32_t reordered_version;
+  bool reordered_train;
+
   ShadeDataContext() : dil_tensor(),
                        cpu_raw_data(nullptr),
                        cpu_del_fun(nullptr),
                        packed(false),
+                       dynamic_int8(false),
+                       reordered_version(0),
+                       reordered_train(false),
                        data_type(SHADE_DATA_TYPE::CPU_RAW),
                        mix_prec_type(MIX_PREC_TYPE::NONE),
                        shade_tensor_tag(SHADE_TENSOR_TAG::OTHER) {}
@@ -294,6 +312,125 @@ struct ShadeDataContext {
     ShadeDataContext *shade_data_context = (ShadeDataContext*)storage_context;
     shade_data_context->packed = value;
   }
+
+  /**
+   * Check if the input aten tensor is a weight quantized for the dynamic int8 mode.
+   *
+   * @param tensor input aten tensor
+   */
+  static inline bool isDynamicInt8Tensor(const at::Tensor &tensor) {
+    TORCH_INTERNAL_ASSERT_DEBUG_ONLY(tensor.has_storage());
+    if (!check_tensor_own_shade_context(tensor)) return false;
+    void *storage_context = tensor.storage().data_ptr().get_context();
+    ShadeDataContext *shade_data_context = (ShadeDataContext*)storage_context;
+    return shade_data_context->dynamic_int8;
+  }
+
+  /**
+   * Set the dynamic int8 status of the input aten tensor.
+   *
+   * @param tensor input aten tensor
+   */
+  static inline void setDynamicInt8Tensor(const at::Tensor &tensor, bool value) {
+    TORCH_INTERNAL_ASSERT_DEBUG_ONLY(tensor.has_storage());
+    void *storage_context = tensor.storage().data_ptr().get_context();
+    ShadeDataContext *shade_data_context = (ShadeDataContext*)storage_context;
+    shade_data_context->dynamic_int8 = value;
+  }
+
+  /**
+   * Get the copy of the input aten tensor reordered to desc for its current version.
+   *
+   * @param tensor input aten tensor
+   * @param desc the desc of the reordered copy
+   * @param train whether the copy is used in training
+   *
+   * @return The reordered copy, or nothing if it does not exist, the tensor has been updated since or the
+   * copies were made in the other execution mode
+   */
+  static inline c10::optional<dil::tensor> getReorderedWeight(const at::Tensor &tensor, const dil::tensor::desc &desc, bool train) {
+    TORCH_INTERNAL_ASSERT_DEBUG_ONLY(tensor.has_storage());
+    if (!check_tensor_own_shade_context(tensor)) return c10::nullopt;
+    void *storage_context = tensor.storage().data_ptr().get_context();
+    ShadeDataContext *shade_data_context = (ShadeDataContext*)storage_context;
+    std::lock_guard<std::mutex> lock(shade_data_context->mutex);
+    if (shade_data_context->reordered_train != train) {
+      shade_data_context->reordered_weights.clear();
+      return c10::nullopt;
+    }
+    if (shade_data_context->reordered_version != tensor.unsafeGetTensorImpl()->version_counter().current_version())
+      return c10::nullopt;
+    for (const auto &reordered : shade_data_context->reordered_weights) {
+      if (reordered.get_desc() == desc) return reordered;
+    }
+    return c10::nullopt;
+  }
+
+  /**
+   * Get the copy of the input aten tensor reordered to data_type for its current version, for the copies
+   * whose desc depends on more than the tensor, e.g. the quantized ones.
+   *
+   * @param tensor input aten tensor
+   * @param data_type the data type of the reordered copy
+   * @param train whether the copy is used in training
+   *
+   * @return The first reordered copy of that data type, or nothing as getReorderedWeight
+   */
+  static inline c10::optional<dil::tensor> getReorderedWeight(const at::Tensor &tensor, dil::data_type data_type, bool train) {
+    TORCH_INTERNAL_ASSERT_DEBUG_ONLY(tensor.has_storage());
+    if (!check_tensor_own_shade_context(tensor)) return c10::nullopt;
+    void *storage_context = tensor.storage().data_ptr().get_context();
+    ShadeDataContext *shade_data_context = (ShadeDataContext*)storage_context;
+    std::lock_guard<std::mutex> lock(shade_data_context->mutex);
+    if (shade_data_context->reordered_train != train) {
+      shade_data_context->reordered_weights.clear();
+      return c10::nullopt;
+    }
+    if (shade_data_context->reordered_version != tensor.unsafeGetTensorImpl()->version_counter().current_version())
+      return c10::nullopt;
+    for (const auto &reordered : shade_data_context->reordered_weights) {
+      if (reordered.get_data_type() == data_type) return reordered;
+    }
+    return c10::nullopt;
+  }
+
+  /**
+   * Keep a copy of the input aten tensor reordered for its current version, dropping the copies
+   * of its previous versions and of the other execution mode.
+   *
+   * @param tensor input aten tensor
+   * @param reordered the reordered copy
+   * @param train whether the copy is used in training
+   */
+  static inline void addReorderedWeight(const at::Tensor &tensor, const dil::tensor &reordered, bool train) {
+    TORCH_INTERNAL_ASSERT_DEBUG_ONLY(tensor.has_storage());
+    if (!check_tensor_own_shade_context(tensor)) return;
+    void *storage_context = tensor.storage().data_ptr().get_context();
+    ShadeDataContext *shade_data_context = (ShadeDataContext*)storage_context;
+    std::lock_guard<std::mutex> lock(shade_data_context->mutex);
+    auto version = tensor.unsafeGetTensorImpl()->version_counter().current_version();
+    if (shade_data_context->reordered_version != version || shade_data_context->reordered_train != train) {
+      shade_data_context->reordered_weights.clear();
+      shade_data_context->reordered_version = version;
+      shade_data_context->reordered_train = train;
+    }
+    shade_data_context->reordered_weights.push_back(reordered);
+  }
+
+  /**
+   * Drop the reordered copies of the input aten tensor, after it has been updated in a way that
+   * does not bump its version, e.g. through .data.
+   *
+   * @param tensor input aten tensor
+   */
+  static inline void dropReorderedWeights(const at::Tensor &tensor) {
+    TORCH_INTERNAL_ASSERT_DEBUG_ONLY(tensor.has_storage());
+    if (!check_tensor_own_shade_context(tensor)) return;
+    void *storage_context = tensor.storage().data_ptr().get_context();
+    ShadeDataContext *shade_data_context = (ShadeDataContext*)storage_context;
+    std::lock_guard<std::mutex> lock(shade_data_context->mutex);
+    shade_data_context->reordered_weights.clear();
+  }
 };
 
 }  // namespace cpu
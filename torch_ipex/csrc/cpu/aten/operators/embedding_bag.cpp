@@ -1,6 +1,17 @@
 #include "embedding_bag.hpp"
 #include "aten_ipex_bridge.h"
 #include "cpu/bf16/vec/bf16_vec_kernel.h"
+#include "cpu/aten/utils/hot_row_cache.hpp"
+#include "cpu/aten/utils/radix_sort.hpp"
+#include "torch_ipex/csrc/auto_opt_config.h"
+#include "torch_ipex/csrc/utils.h"
+
+#include <c10/util/intrusive_ptr.h>
+
+#include <cmath>
+#include <mutex>
+#include <type_traits>
+#include <xmmintrin.h>
 
 namespace torch_ipex {
 namespace cpu {
@@ -25,61 +36,317 @@ static inline bool is_bfloat16_tensor(const at::Tensor tensor_) {
   return false;
 }
 
-bool embedding_bag_fast_path_sum(const at::Tensor weight, const at::Tensor per_sample_weights, int64_t mode) {
-  if ((mode != MODE_SUM) || (weight.stride(1) != 1) || per_sample_weights.defined()) return false;
+bool embedding_bag_fast_path(const at::Tensor weight, const at::Tensor per_sample_weights, int64_t mode, bool sparse) {
+  if ((mode != MODE_SUM) && (mode != MODE_MEAN) && (mode != MODE_MAX)) return false;
+  if (weight.stride(1) != 1) return false;
   if ((weight.scalar_type() != at::kFloat) && (weight.scalar_type() != at::kBFloat16)) return false;
+  // per_sample_weights are only defined for the SUM mode and must share the weight dtype
+  if (per_sample_weights.defined() &&
+      ((mode != MODE_SUM) || (per_sample_weights.scalar_type() != weight.scalar_type()))) return false;
+  // sparse gradient is not supported by the MAX mode, let ATen report it
+  if ((mode == MODE_MAX) && sparse) return false;
   return true;
 }
 
+// Returns the begin offset of every bag followed by the end of the last one,
+// so that bag i always spans [offsets[i], offsets[i + 1]).
+static inline const int64_t* get_offsets_include_last(const at::Tensor offsets, int64_t indices_numel,
+    bool include_last_offset, std::vector<int64_t>& buf, int64_t& output_size) {
+  auto* offsets_data = offsets.data_ptr<int64_t>();
+  output_size = offsets.numel() - 1;
+  if (!include_last_offset) {
+    output_size = offsets.numel();
+    buf.resize(output_size + 1);
+    std::memcpy(buf.data(), offsets_data, sizeof(int64_t) * output_size);
+    buf[output_size] = indices_numel;
+    offsets_data = buf.data();
+  }
+  return offsets_data;
+}
+
+// Lookups are latency bound: while row s is accumulated, the row of index
+// s + distance is already requested. Every cache line of the row is touched.
+static inline void prefetch_row(const void* row, int64_t bytes) {
+  auto* p = static_cast<const char*>(row);
+  for (int64_t off = 0; off < bytes; off += 64) {
+    _mm_prefetch(p + off, _MM_HINT_T0);
+  }
+}
+
+static inline int64_t get_prefetch_distance() {
+  return AutoOptConfig::singleton().get_embedding_bag_prefetch_distance();
+}
+
+// Hot row caches, keyed by the storage of their table. An entry holds a weak
+// reference to the storage, which keeps its address from being reused, so a
+// live table never hits the entry of a freed one and lookups need no pruning.
+// The entries of freed storages are pruned when the caches are enabled,
+// disabled or queried. The count lets lookups skip the lock entirely when no
+// cache is enabled.
+struct HotRowCacheEntry {
+  c10::weak_intrusive_ptr<c10::StorageImpl> storage;
+  std::shared_ptr<HotRowCache> cache;
+};
+
+static std::mutex hot_row_cache_mutex;
+static std::atomic<int64_t> num_hot_row_caches{0};
+
+static std::unordered_map<const c10::StorageImpl*, HotRowCacheEntry>& hot_row_caches() {
+  static std::unordered_map<const c10::StorageImpl*, HotRowCacheEntry> caches;
+  return caches;
+}
+
+// Drops the caches of the freed tables, called with hot_row_cache_mutex held.
+static inline void prune_hot_row_caches() {
+  auto& caches = hot_row_caches();
+  for (auto it = caches.begin(); it != caches.end();) {
+    if (it->second.storage.expired()) {
+      it = caches.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  num_hot_row_caches = caches.size();
+}
+
+static inline std::shared_ptr<HotRowCache> find_hot_row_cache(const at::Tensor& weight) {
+  if (num_hot_row_caches.load(std::memory_order_relaxed) == 0) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(hot_row_cache_mutex);
+  auto& caches = hot_row_caches();
+  auto it = caches.find(weight.storage().unsafeGetStorageImpl());
+  if (it == caches.end() || !it->second.cache->valid_for(weight)) {
+    return nullptr;
+  }
+  return it->second.cache;
+}
+
+void embedding_bag_enable_hot_row_cache(const at::Tensor & weight, const at::Tensor & indices, int64_t num_hot_rows) {
+  IPEX_CHECK(weight.dim() == 2 && weight.stride(1) == 1, "hot row cache expects a 2D table with contiguous rows");
+  IPEX_CHECK((weight.scalar_type() == at::kFloat) || (weight.scalar_type() == at::kBFloat16),
+      "hot row cache only supports float and bfloat16 tables");
+  auto cache = std::make_shared<HotRowCache>(weight, indices, num_hot_rows);
+  c10::weak_intrusive_ptr<c10::StorageImpl> storage(weight.storage().getIntrusivePtr());
+  std::lock_guard<std::mutex> lock(hot_row_cache_mutex);
+  hot_row_caches()[weight.storage().unsafeGetStorageImpl()] = {std::move(storage), std::move(cache)};
+  prune_hot_row_caches();
+}
+
+void embedding_bag_disable_hot_row_cache(const at::Tensor & weight) {
+  std::lock_guard<std::mutex> lock(hot_row_cache_mutex);
+  hot_row_caches().erase(weight.storage().unsafeGetStorageImpl());
+  prune_hot_row_caches();
+}
+
+void embedding_bag_invalidate_hot_row_cache(const at::Tensor & weight) {
+  if (num_hot_row_caches.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  embedding_bag_disable_hot_row_cache(weight);
+}
+
+std::vector<int64_t> embedding_bag_hot_row_cache_stats(const at::Tensor & weight) {
+  std::lock_guard<std::mutex> lock(hot_row_cache_mutex);
+  prune_hot_row_caches();
+  auto it = hot_row_caches().find(weight.storage().unsafeGetStorageImpl());
+  if (it == hot_row_caches().end()) {
+    return {0, 0, 0};
+  }
+  const auto& cache = it->second.cache;
+  return {cache->size(), static_cast<int64_t>(cache->hits()), static_cast<int64_t>(cache->misses())};
+}
+
+// Resolves a row id to the cached copy of a hot row or to the table itself.
+template<typename T>
+static inline T* select_row(T* src_data, int64_t idx, int64_t ddim, const HotRowCache* cache, uint64_t& hits) {
+  if (cache) {
+    if (auto* row = cache->find<T>(idx)) {
+      hits++;
+      return const_cast<T*>(row);
+    }
+  }
+  return src_data + idx * ddim;
+}
+
 template<typename T>
 static inline at::Tensor _embedding_bag_index_add_select_fast(const at::Tensor select_indices,
     const at::Tensor src, const at::Tensor offsets,  bool include_last_offset) {
   int64_t ddim = src.size(1);
   auto* src_data = src.data_ptr<T>();
-  int64_t output_size = offsets.numel() - 1;
-  auto* offsets_data = offsets.data_ptr<int64_t>();
+  int64_t output_size;
   std::vector<int64_t> offsets_include_last;
-
-  if (!include_last_offset) {
-    output_size = offsets.numel();
-    offsets_include_last.resize(output_size + 1);
-    std::memcpy(offsets_include_last.data(), offsets_data, sizeof(int64_t) * output_size);
-    offsets_include_last[output_size] = select_indices.numel();
-    offsets_data = offsets_include_last.data();
-  }
+  auto* offsets_data = get_offsets_include_last(offsets, select_indices.numel(),
+      include_last_offset, offsets_include_last, output_size);
 
   at::Tensor output = at::empty({output_size, src.size(1)}, src.options());
   auto* output_data = output.data_ptr<T>();
   auto indices_accessor = select_indices.accessor<int64_t, 1>();
+  int64_t prefetch_distance = get_prefetch_distance();
+  auto cache = find_hot_row_cache(src);
   at::parallel_for(0, output_size, 16, [&](int64_t start, int64_t end) {
+    uint64_t hits = 0;
+    int64_t chunk_end = offsets_data[end];
     for (int64_t i = start; i < end; i++) {
       auto* out_data_ptr = &output_data[i * ddim];
       zero_ker((T*)out_data_ptr, ddim);
       auto inputs_start = offsets_data[i];
       auto inputs_end = offsets_data[i + 1];
       for (int64_t s = inputs_start; s < inputs_end; s++) {
-        T* select_data_ptr = &src_data[indices_accessor[s] * ddim];
+        if ((prefetch_distance > 0) && (s + prefetch_distance < chunk_end)) {
+          prefetch_row(&src_data[indices_accessor[s + prefetch_distance] * ddim], ddim * sizeof(T));
+        }
+        T* select_data_ptr = select_row(src_data, indices_accessor[s], ddim, cache.get(), hits);
         add_ker((T *)out_data_ptr, (T *)select_data_ptr, ddim);
       }
     }
+    if (cache) {
+      uint64_t lookups = chunk_end - offsets_data[start];
+      cache->record(hits, lookups - hits);
+    }
   });
 
   return output;
 }
 
-at::Tensor embedding_bag_impl(const at::Tensor & weight, const at::Tensor & indices,
+// MEAN mode and weighted SUM mode: every row is scaled by 1 / bag size or by
+// its per sample weight and accumulated in fp32. bag_size is returned for
+// the backward, offset2bag is left empty and rebuilt there when needed.
+template<typename T>
+static inline std::vector<at::Tensor> _embedding_bag_weighted_sum_fast(const at::Tensor select_indices,
+    const at::Tensor src, const at::Tensor offsets, bool include_last_offset,
+    const at::Tensor per_sample_weights, int64_t mode) {
+  int64_t ddim = src.size(1);
+  auto* src_data = src.data_ptr<T>();
+  int64_t output_size;
+  std::vector<int64_t> offsets_include_last;
+  auto* offsets_data = get_offsets_include_last(offsets, select_indices.numel(),
+      include_last_offset, offsets_include_last, output_size);
+
+  at::Tensor output = at::empty({output_size, ddim}, src.options());
+  at::Tensor bag_size = at::empty({output_size}, select_indices.options());
+  auto* output_data = output.data_ptr<T>();
+  auto* bag_size_data = bag_size.data_ptr<int64_t>();
+  T* weights_data = per_sample_weights.defined() ? per_sample_weights.data_ptr<T>() : nullptr;
+  auto indices_accessor = select_indices.accessor<int64_t, 1>();
+  int64_t prefetch_distance = get_prefetch_distance();
+  auto cache = find_hot_row_cache(src);
+  at::parallel_for(0, output_size, 16, [&](int64_t start, int64_t end) {
+    std::vector<float> temp_output(ddim);
+    float* acc = temp_output.data();
+    uint64_t hits = 0;
+    int64_t chunk_end = offsets_data[end];
+    for (int64_t i = start; i < end; i++) {
+      auto inputs_start = offsets_data[i];
+      auto inputs_end = offsets_data[i + 1];
+      bag_size_data[i] = inputs_end - inputs_start;
+      float scale = 1.f;
+      if ((mode == MODE_MEAN) && (inputs_end > inputs_start)) {
+        scale = 1.f / (inputs_end - inputs_start);
+      }
+      zero_ker(acc, ddim);
+      for (int64_t s = inputs_start; s < inputs_end; s++) {
+        if ((prefetch_distance > 0) && (s + prefetch_distance < chunk_end)) {
+          prefetch_row(&src_data[indices_accessor[s + prefetch_distance] * ddim], ddim * sizeof(T));
+        }
+        float w = weights_data ? static_cast<float>(weights_data[s]) : scale;
+        madd_ker(acc, select_row(src_data, indices_accessor[s], ddim, cache.get(), hits), ddim, w);
+      }
+      move_ker(&output_data[i * ddim], acc, ddim);
+    }
+    if (cache) {
+      uint64_t lookups = chunk_end - offsets_data[start];
+      cache->record(hits, lookups - hits);
+    }
+  });
+
+  return {output, at::empty({0}, select_indices.options()), bag_size,
+          at::empty({0}, select_indices.options())};
+}
+
+// MAX mode: element-wise max over the rows of a bag, keeping the row id of
+// the winner of every column for the backward. Empty bags produce zeros and
+// a bag_size of 0, their max indices are never read.
+template<typename T>
+static inline std::vector<at::Tensor> _embedding_bag_max_fast(const at::Tensor select_indices,
+    const at::Tensor src, const at::Tensor offsets, bool include_last_offset) {
+  int64_t ddim = src.size(1);
+  auto* src_data = src.data_ptr<T>();
+  int64_t output_size;
+  std::vector<int64_t> offsets_include_last;
+  auto* offsets_data = get_offsets_include_last(offsets, select_indices.numel(),
+      include_last_offset, offsets_include_last, output_size);
+
+  at::Tensor output = at::empty({output_size, ddim}, src.options());
+  at::Tensor bag_size = at::empty({output_size}, select_indices.options());
+  at::Tensor max_indices = at::empty({output_size, ddim}, select_indices.options());
+  auto* output_data = output.data_ptr<T>();
+  auto* bag_size_data = bag_size.data_ptr<int64_t>();
+  auto* max_indices_data = max_indices.data_ptr<int64_t>();
+  auto indices_accessor = select_indices.accessor<int64_t, 1>();
+  int64_t prefetch_distance = get_prefetch_distance();
+  at::parallel_for(0, output_size, 16, [&](int64_t start, int64_t end) {
+    std::vector<float> temp_output(ddim);
+    float* acc = temp_output.data();
+    int64_t chunk_end = offsets_data[end];
+    for (int64_t i = start; i < end; i++) {
+      auto inputs_start = offsets_data[i];
+      auto inputs_end = offsets_data[i + 1];
+      bag_size_data[i] = inputs_end - inputs_start;
+      int64_t* max_idx = &max_indices_data[i * ddim];
+      if (inputs_start == inputs_end) {
+        zero_ker(&output_data[i * ddim], ddim);
+        std::fill(max_idx, max_idx + ddim, 0);
+        continue;
+      }
+      int64_t first = indices_accessor[inputs_start];
+      move_ker(acc, &src_data[first * ddim], ddim);
+      std::fill(max_idx, max_idx + ddim, first);
+      for (int64_t s = inputs_start + 1; s < inputs_end; s++) {
+        if ((prefetch_distance > 0) && (s + prefetch_distance < chunk_end)) {
+          prefetch_row(&src_data[indices_accessor[s + prefetch_distance] * ddim], ddim * sizeof(T));
+        }
+        int64_t idx = indices_accessor[s];
+        max_ker(acc, max_idx, &src_data[idx * ddim], idx, ddim);
+      }
+      move_ker(&output_data[i * ddim], acc, ddim);
+    }
+  });
+
+  return {output, at::empty({0}, select_indices.options()), bag_size, max_indices};
+}
+
+std::vector<at::Tensor> embedding_bag_impl(const at::Tensor & weight, const at::Tensor & indices,
   const at::Tensor & offsets, bool scale_grad_by_freq, int64_t mode, bool sparse,
   const at::Tensor & per_sample_weights, bool include_last_offset) {
 
   at::Tensor offsets_ = offsets.is_contiguous()? offsets : offsets.contiguous();
 
+  if (mode == MODE_MAX) {
+    if (is_bfloat16_tensor(weight)) {
+      return _embedding_bag_max_fast<at::BFloat16>(indices, weight, offsets_, include_last_offset);
+    } else {
+      return _embedding_bag_max_fast<float>(indices, weight, offsets_, include_last_offset);
+    }
+  }
+
+  if ((mode == MODE_MEAN) || per_sample_weights.defined()) {
+    at::Tensor weights_ = per_sample_weights.defined() ? per_sample_weights.contiguous() : per_sample_weights;
+    if (is_bfloat16_tensor(weight)) {
+      return _embedding_bag_weighted_sum_fast<at::BFloat16>(indices, weight, offsets_, include_last_offset, weights_, mode);
+    } else {
+      return _embedding_bag_weighted_sum_fast<float>(indices, weight, offsets_, include_last_offset, weights_, mode);
+    }
+  }
+
+  // Plain SUM mode only returns the output, nothing else is needed by the backward.
   at::Tensor output;
   if(is_bfloat16_tensor(weight)) {
       output = _embedding_bag_index_add_select_fast<at::BFloat16>(indices, weight, offsets_, include_last_offset);
   } else {
       output = _embedding_bag_index_add_select_fast<float>(indices, weight, offsets_, include_last_offset);
   }
-  return output;
+  return {output};
 }
 
 static inline at::Tensor expand_values_if_needed(const at::Tensor& values) {
@@ -102,12 +369,65 @@ at::Tensor _sparse_coo_tensor_unsafe(const at::Tensor& indices, const at::Tensor
   return at::native::new_with_dims_and_tensor_sparse(sparse_dim, dense_dim, size, indices, values, values.options().layout(c10::kSparse));
 }
 
+// Wraps the per entry gradient rows into an uncoalesced sparse gradient of
+// a [num_weights, ddim] table.
+static inline at::Tensor make_sparse_grad(const at::Tensor index_grad, const at::Tensor indices, int64_t num_weights) {
+  int64_t num_features = index_grad.size(-1);
+  auto weight_size = std::array<int64_t, 2>{{ num_weights, num_features }};
+  auto dense_options = index_grad.options();
+
+  if (index_grad.numel() == 0) {
+    return _sparse_coo_tensor_unsafe(at::empty({1, 0}, indices.options()),
+                                         at::empty({0, num_features}, dense_options),
+                                         weight_size);
+  }
+
+  auto index = indices.reshape({1, -1});
+  auto values = index_grad.reshape({-1, num_features});
+
+  return _sparse_coo_tensor_unsafe(index, values, weight_size);
+}
+
+// Per entry scale applied to the gradient of its bag: the per sample weight
+// in SUM mode, 1 / bag size in MEAN mode. Left empty for the plain SUM mode.
+template<typename T>
+static inline std::vector<float> get_entry_scales(const at::Tensor offsets, int64_t indices_numel,
+    int64_t mode, const at::Tensor per_sample_weights) {
+  std::vector<float> scales;
+  if (per_sample_weights.defined()) {
+    auto weights_ = per_sample_weights.contiguous();
+    T* weights_data = weights_.data_ptr<T>();
+    scales.resize(indices_numel);
+    at::parallel_for(0, indices_numel, 4096, [&](int64_t start, int64_t end) {
+      for (int64_t s = start; s < end; s++) {
+        scales[s] = static_cast<float>(weights_data[s]);
+      }
+    });
+  } else if (mode == MODE_MEAN) {
+    auto offsets_accessor = offsets.accessor<int64_t, 1>();
+    auto offset_numel = offsets.numel();
+    scales.resize(indices_numel);
+    at::parallel_for(0, offset_numel, 16, [&](int64_t start, int64_t end) {
+      for (auto mb = start; mb < end; mb++) {
+        int64_t select_off_start = offsets_accessor[mb];
+        int64_t select_off_end = (mb < (offset_numel - 1) ? offsets_accessor[mb + 1] : indices_numel);
+        float scale = 1.f / std::max<int64_t>(select_off_end - select_off_start, 1);
+        for (int64_t s = select_off_start; s < select_off_end; s++) {
+          scales[s] = scale;
+        }
+      }
+    });
+  }
+  return scales;
+}
+
 template<typename T>
-static inline at::Tensor embedding_bag_sparse_backward_sum_fast(
+static inline at::Tensor embedding_bag_sparse_backward_fast(
     const at::Tensor grad, const at::Tensor indices,
-    const at::Tensor offsets, int num_weights, int mode) {
+    const at::Tensor offsets, int num_weights, int mode,
+    const at::Tensor per_sample_weights) {
 
-  assert((mode == MODE_SUM) && (grad.stride(1) == 1));
+  assert((mode != MODE_MAX) && (grad.stride(1) == 1));
 
   int64_t indices_size0 = indices.size(0);
   int64_t ddim = grad.size(1);
@@ -116,55 +436,42 @@ static inline at::Tensor embedding_bag_sparse_backward_sum_fast(
 
   auto offsets_accessor = offsets.accessor<int64_t, 1>();
   auto offset_numel = offsets.numel();
+  std::vector<float> scales = get_entry_scales<T>(offsets, indices_size0, mode, per_sample_weights);
 
   T* gradout_data = index_grad.data_ptr<T>();
   T* grad_data = grad.data_ptr<T>();
   at::parallel_for(0, offset_numel, 16, [&](int64_t start, int64_t end) {
+    std::vector<float> temp_grad(scales.empty() ? 0 : ddim);
+    float* temp_output = temp_grad.data();
     for(auto mb = start; mb < end; mb++) {
       int64_t select_off_start = offsets_accessor[mb];
       int64_t select_off_end = (mb < (offset_numel - 1) ? offsets_accessor[mb + 1] : indices_size0);
       auto grad_block = grad_data + grad_stride0 * mb;
       for (int64_t s = select_off_start; s < select_off_end; s++) {
-        move_ker((T*)(gradout_data + ddim * s), (T*)grad_block, ddim);
+        if (scales.empty()) {
+          move_ker((T*)(gradout_data + ddim * s), (T*)grad_block, ddim);
+        } else {
+          zero_ker(temp_output, ddim);
+          madd_ker(temp_output, (T*)grad_block, ddim, scales[s]);
+          move_ker((T*)(gradout_data + ddim * s), temp_output, ddim);
+        }
       }
     }
   });
 
-  int64_t num_features = index_grad.size(-1);
-  auto weight_size = std::array<int64_t, 2>{{ num_weights, num_features }};
-  auto dense_options = index_grad.options();
-
-  if (index_grad.numel() == 0) {
-    return _sparse_coo_tensor_unsafe(at::empty({1, 0}, indices.options()),
-                                         at::empty({0, num_features}, dense_options),
-                                         weight_size);
-  }
-
-  auto index = indices.reshape({1, -1});
-  auto values = index_grad.reshape({-1, num_features});
-
-  return _sparse_coo_tensor_unsafe(index, values, weight_size);
-}
-
-static inline int64_t
-count_and_map_uniq(const at::TensorAccessor<int64_t, 1>& indices_accessor, int64_t indices_length, std::vector<int64_t>& indices_to_index, std::vector<int64_t>& index_to_indices) {
-  int64_t u = 0;
-  for (int64_t i = 0; i < indices_length; i++) {
-    int64_t indices = indices_accessor[i];
-    if (indices_to_index[indices] == -1ull) {
-      indices_to_index[indices] = u;
-      index_to_indices[u] = indices;
-      u++;
-    }
-  }
-  return u;
+  return make_sparse_grad(index_grad, indices, num_weights);
 }
 
+// Dense backward of the SUM and MEAN modes: (row id, entry) pairs are
+// radix-sorted by row id so that every destination row becomes a contiguous
+// segment. The sorted array is split among threads on segment borders, so
+// each thread reads only its own part of it and owns the rows it writes.
 template<typename T>
-static inline at::Tensor embedding_bag_dense_backward_sum_fast(const at::Tensor grad, const at::Tensor indices, const at::Tensor offsets, int num_weights, int mode) {
+static inline at::Tensor embedding_bag_dense_backward_fast(const at::Tensor grad, const at::Tensor indices,
+    const at::Tensor offsets, int num_weights, int mode, const at::Tensor per_sample_weights) {
 
   int64_t indices_numel = indices.numel();
-  assert((mode == MODE_SUM) && (grad.stride(1) == 1) && (indices_numel > 0));
+  assert((mode != MODE_MAX) && (grad.stride(1) == 1) && (indices_numel > 0));
   auto offset_numel = offsets.numel();
   at::Tensor offset2bag_ ;
   if (offset_numel != indices_numel) {
@@ -174,70 +481,126 @@ static inline at::Tensor embedding_bag_dense_backward_sum_fast(const at::Tensor
   } else {
     offset2bag_ = offsets;
   }
-  auto indices_accessor = indices.accessor<int64_t, 1>();
-  std::vector<int64_t> indices_to_index(num_weights, -1ull);
-  std::vector<int64_t> index_to_indices;
-  index_to_indices.reserve(num_weights);
-  int64_t unique_indices = count_and_map_uniq(indices_accessor, indices_numel, indices_to_index, index_to_indices);
+  std::vector<float> scales = get_entry_scales<T>(offsets, indices_numel, mode, per_sample_weights);
+
+  auto* indices_data = indices.data_ptr<int64_t>();
+  auto* offset2bag_data = offset2bag_.data_ptr<int64_t>();
+  std::vector<int64_t> sort_buf(indices_numel * 4);
+  int64_t* keys = sort_buf.data();
+  int64_t* values = keys + indices_numel;
+  int64_t* tmp_keys = values + indices_numel;
+  int64_t* tmp_values = tmp_keys + indices_numel;
+  at::parallel_for(0, indices_numel, 4096, [&](int64_t start, int64_t end) {
+    std::memcpy(keys + start, indices_data + start, (end - start) * sizeof(int64_t));
+    for (int64_t s = start; s < end; s++) {
+      values[s] = s;
+    }
+  });
+  int64_t* sorted_keys;
+  int64_t* sorted_values;
+  std::tie(sorted_keys, sorted_values) = radix_sort_parallel(
+      keys, values, tmp_keys, tmp_values, indices_numel, num_weights - 1);
 
   int max_threads = at::get_num_threads();
-  max_threads = (unique_indices < max_threads) ? unique_indices : max_threads;
-  int64_t avg_chunk_down = unique_indices / max_threads;
-  std::vector<int64_t> chuck_size(max_threads);
-  std::vector<int64_t> chuck_sum_size(max_threads + 1);
-  for (auto i = 0; i < max_threads; i++) {
-    chuck_size[i] = avg_chunk_down;
-  }
-  //make chunk balance among threads as 211
-  for (auto i = 0 ; i < unique_indices % max_threads ; i++) {
-    chuck_size[i] += 1;
-  }
-  chuck_sum_size[0] = 0;
-  for (auto i = 1; i < max_threads; i++) {
-    chuck_sum_size[i] = chuck_sum_size[i - 1] + chuck_size[i - 1];
-  }
-  chuck_sum_size[max_threads] = unique_indices;
+  std::vector<int64_t> chunk_bounds;
+  split_sorted_segments(sorted_keys, indices_numel, max_threads, chunk_bounds);
 
   int64_t ddim = grad.size(1);
-
   at::Tensor index_grad_weight = at::empty({num_weights, ddim}, grad.options());
   T* gradout_data = index_grad_weight.data_ptr<T>();
-  zero_ker((T*)gradout_data, num_weights * ddim);
-
-  std::vector<float> temp_grad_weight(unique_indices * ddim);
-  float* temp_output = temp_grad_weight.data();
-  zero_ker(temp_output, unique_indices * ddim);
+  at::parallel_for(0, num_weights, 1024, [&](int64_t start, int64_t end) {
+    zero_ker((T*)(gradout_data + start * ddim), (end - start) * ddim);
+  });
 
-  auto offset2bag_accessor = offset2bag_.accessor<int64_t, 1>();
   T* grad_data = grad.data_ptr<T>();
-  at::parallel_for(0, max_threads, 0, [&](int64_t start, int64_t end) {
-    for(int k = start; k < end; k++) {
-      int64_t chunk_start = chuck_sum_size[k];
-      int64_t chunk_end = chuck_sum_size[k + 1];
-      for (int64_t mb = 0; mb < indices_numel; mb++) {
-        int64_t indices_num = indices_accessor[mb];
-        int64_t index = indices_to_index[indices_num];
-        if (index >= chunk_start && index < chunk_end) {
-          auto s = offset2bag_accessor[mb];
-          add_ker((float*)(temp_output + index * ddim), (T*)(grad_data + s * ddim), ddim);
+  int64_t grad_stride0 = grad.stride(0);
+  at::parallel_for(0, max_threads, 1, [&](int64_t start, int64_t end) {
+    std::vector<float> temp_grad_weight(ddim);
+    float* temp_output = temp_grad_weight.data();
+    for (int64_t c = start; c < end; c++) {
+      int64_t seg_start = chunk_bounds[c];
+      int64_t chunk_end = chunk_bounds[c + 1];
+      while (seg_start < chunk_end) {
+        int64_t row = sorted_keys[seg_start];
+        int64_t seg_end = seg_start + 1;
+        while (seg_end < chunk_end && sorted_keys[seg_end] == row) {
+          seg_end++;
         }
+        zero_ker(temp_output, ddim);
+        for (int64_t j = seg_start; j < seg_end; j++) {
+          int64_t s = sorted_values[j];
+          T* grad_block = grad_data + offset2bag_data[s] * grad_stride0;
+          if (scales.empty()) {
+            add_ker(temp_output, grad_block, ddim);
+          } else {
+            madd_ker(temp_output, grad_block, ddim, scales[s]);
+          }
+        }
+        move_ker((T*)(gradout_data + row * ddim), temp_output, ddim);
+        seg_start = seg_end;
       }
-      for (int64_t index = chunk_start; index < chunk_end; index++) {
-        auto indices = index_to_indices[index];
-        move_ker((T*)(gradout_data + indices * ddim), (float*)(temp_output + index * ddim), ddim);
+    }
+  });
+
+  return index_grad_weight;
+}
+
+// Dense backward of the MAX mode: the gradient of every (bag, column) goes to
+// the row that won this column in the forward. Threads own disjoint column
+// ranges, so no two of them ever update the same element. The sums are kept
+// in fp32 and a bf16 gradient is rounded once at the end.
+template<typename T>
+static inline at::Tensor embedding_bag_dense_backward_max_fast(const at::Tensor grad,
+    const at::Tensor bag_size, const at::Tensor maximum_indices, int num_weights) {
+
+  int64_t num_bags = grad.size(0);
+  int64_t ddim = grad.size(1);
+  assert((grad.stride(1) == 1) && (maximum_indices.numel() == num_bags * ddim));
+  auto bag_size_ = bag_size.contiguous();
+  auto maximum_indices_ = maximum_indices.contiguous();
+  auto* bag_size_data = bag_size_.data_ptr<int64_t>();
+  auto* max_indices_data = maximum_indices_.data_ptr<int64_t>();
+
+  at::Tensor index_grad_weight = at::empty({num_weights, ddim}, grad.options());
+  at::Tensor acc_grad_weight = std::is_same<T, float>::value
+      ? index_grad_weight : at::empty({num_weights, ddim}, grad.options().dtype(at::kFloat));
+  float* acc_data = acc_grad_weight.data_ptr<float>();
+  at::parallel_for(0, num_weights, 1024, [&](int64_t start, int64_t end) {
+    zero_ker(acc_data + start * ddim, (end - start) * ddim);
+  });
+
+  T* grad_data = grad.data_ptr<T>();
+  at::parallel_for(0, ddim, 16, [&](int64_t start, int64_t end) {
+    for (int64_t b = 0; b < num_bags; b++) {
+      if (bag_size_data[b] == 0) continue;
+      auto* max_idx = max_indices_data + b * ddim;
+      auto* grad_block = grad_data + b * ddim;
+      for (int64_t d = start; d < end; d++) {
+        acc_data[max_idx[d] * ddim + d] += static_cast<float>(grad_block[d]);
       }
     }
   });
 
+  if (!std::is_same<T, float>::value) {
+    T* gradout_data = index_grad_weight.data_ptr<T>();
+    at::parallel_for(0, num_weights, 1024, [&](int64_t start, int64_t end) {
+      move_ker(gradout_data + start * ddim, acc_data + start * ddim, (end - start) * ddim);
+    });
+  }
   return index_grad_weight;
 }
 
-bool embedding_bag_backward_fast_path_sum(const at::Tensor grad, const at::Tensor indices, const at::Tensor offset2bag, const at::Tensor per_sample_weights, bool scale_grad_by_freq, int64_t mode) {
+bool embedding_bag_backward_fast_path(const at::Tensor grad, const at::Tensor indices, const at::Tensor offset2bag,
+    const at::Tensor maximum_indices, const at::Tensor per_sample_weights, bool scale_grad_by_freq, int64_t mode, bool sparse) {
 
   if ((grad.scalar_type() != at::kFloat) && (grad.scalar_type() != at::kBFloat16)) return false;
-  if ((mode != MODE_SUM) || (grad.stride(1) != 1)) return false;
+  if (grad.stride(1) != 1) return false;
+  // A non-empty offset2bag means the forward did not go through the fast path
   if ((indices.numel() == 0) || (offset2bag.numel() != 0)) return false;
-  if (per_sample_weights.defined() || scale_grad_by_freq) return false;
+  if (scale_grad_by_freq) return false;
+  if (per_sample_weights.defined() &&
+      ((mode != MODE_SUM) || (per_sample_weights.scalar_type() != grad.scalar_type()))) return false;
+  if ((mode == MODE_MAX) && (sparse || !maximum_indices.defined() || (maximum_indices.numel() != grad.numel()))) return false;
 
   return true;
 }
@@ -263,17 +626,503 @@ at::Tensor embedding_bag_backward_impl(const at::Tensor & grad, const at::Tensor
   const at::Tensor & per_sample_weights) {
   if (sparse) {
     if (is_bfloat16_tensor(grad)) {
-      return embedding_bag_sparse_backward_sum_fast<at::BFloat16>(grad, indices, offsets, num_weights, mode);
+      return embedding_bag_sparse_backward_fast<at::BFloat16>(grad, indices, offsets, num_weights, mode, per_sample_weights);
     } else {
-      return embedding_bag_sparse_backward_sum_fast<float>(grad, indices, offsets, num_weights, mode);
+      return embedding_bag_sparse_backward_fast<float>(grad, indices, offsets, num_weights, mode, per_sample_weights);
     } 
   } else {
     auto grad_c = grad.contiguous();
+    if (mode == MODE_MAX) {
+      if (is_bfloat16_tensor(grad)) {
+        return embedding_bag_dense_backward_max_fast<at::BFloat16>(grad_c, bag_size, maximum_indices, num_weights);
+      } else {
+        return embedding_bag_dense_backward_max_fast<float>(grad_c, bag_size, maximum_indices, num_weights);
+      }
+    }
     if (is_bfloat16_tensor(grad)) {
-      return embedding_bag_dense_backward_sum_fast<at::BFloat16>(grad_c, indices, offsets, num_weights, mode);
+      return embedding_bag_dense_backward_fast<at::BFloat16>(grad_c, indices, offsets, num_weights, mode, per_sample_weights);
     } else {
-      return embedding_bag_dense_backward_sum_fast<float>(grad_c, indices, offsets, num_weights, mode);
+      return embedding_bag_dense_backward_fast<float>(grad_c, indices, offsets, num_weights, mode, per_sample_weights);
+    }
+  }
+}
+
+// Gradient of the per sample weights in SUM mode: the dot product of the bag
+// gradient with the embedding row each weight was applied to.
+template<typename T>
+static inline at::Tensor embedding_bag_per_sample_weights_backward_fast(const at::Tensor grad,
+    const at::Tensor weight, const at::Tensor indices, const at::Tensor offsets) {
+  int64_t indices_numel = indices.numel();
+  int64_t ddim = grad.size(1);
+  at::Tensor output = at::empty({indices_numel}, grad.options());
+  auto offsets_accessor = offsets.accessor<int64_t, 1>();
+  auto indices_accessor = indices.accessor<int64_t, 1>();
+  auto offset_numel = offsets.numel();
+  int64_t grad_stride0 = grad.stride(0);
+  int64_t weight_stride0 = weight.stride(0);
+
+  T* output_data = output.data_ptr<T>();
+  T* grad_data = grad.data_ptr<T>();
+  T* weight_data = weight.data_ptr<T>();
+  at::parallel_for(0, offset_numel, 16, [&](int64_t start, int64_t end) {
+    for (auto mb = start; mb < end; mb++) {
+      int64_t select_off_start = offsets_accessor[mb];
+      int64_t select_off_end = (mb < (offset_numel - 1) ? offsets_accessor[mb + 1] : indices_numel);
+      auto grad_block = grad_data + grad_stride0 * mb;
+      for (int64_t s = select_off_start; s < select_off_end; s++) {
+        output_data[s] = dot_ker(grad_block, weight_data + weight_stride0 * indices_accessor[s], ddim);
+      }
     }
+  });
+  return output;
+}
+
+at::Tensor embedding_bag_per_sample_weights_backward_impl(const at::Tensor & grad, const at::Tensor & weight,
+  const at::Tensor & indices, const at::Tensor & offsets, int64_t mode) {
+  IPEX_CHECK(mode == MODE_SUM, "embedding_bag: per_sample_weights only supported with mode='sum'");
+  if (is_bfloat16_tensor(grad)) {
+    return embedding_bag_per_sample_weights_backward_fast<at::BFloat16>(grad, weight, indices, offsets);
+  } else {
+    return embedding_bag_per_sample_weights_backward_fast<float>(grad, weight, indices, offsets);
+  }
+}
+
+// Common checks of the batched operator: every table has the same dtype and
+// embedding dim, and every batch of offsets describes the same number of bags.
+static inline int64_t check_batched_inputs(const std::vector<at::Tensor>& weights,
+    const std::vector<at::Tensor>& indices, const std::vector<at::Tensor>& offsets,
+    int64_t mode, bool include_last_offset) {
+  IPEX_CHECK(weights.size() > 0, "batched embedding_bag expects at least one table");
+  IPEX_CHECK(weights.size() == indices.size() && weights.size() == offsets.size(),
+      "batched embedding_bag expects as many indices and offsets as tables");
+  IPEX_CHECK((mode == MODE_SUM) || (mode == MODE_MEAN), "batched embedding_bag only supports sum and mean modes");
+  auto dtype = weights[0].scalar_type();
+  IPEX_CHECK((dtype == at::kFloat) || (dtype == at::kBFloat16), "batched embedding_bag only supports float and bfloat16 tables");
+  int64_t ddim = weights[0].size(1);
+  int64_t num_bags = include_last_offset ? offsets[0].numel() - 1 : offsets[0].numel();
+  for (size_t t = 0; t < weights.size(); t++) {
+    IPEX_CHECK(weights[t].scalar_type() == dtype && weights[t].size(1) == ddim && weights[t].stride(1) == 1,
+        "batched embedding_bag expects tables of the same dtype and embedding dim");
+    int64_t bags = include_last_offset ? offsets[t].numel() - 1 : offsets[t].numel();
+    IPEX_CHECK(bags == num_bags, "batched embedding_bag expects the same number of bags for every table");
+  }
+  return num_bags;
+}
+
+// Fused lookup of several tables: all (bag, table) pairs are scheduled in
+// one parallel region, instead of one region per table that small tables
+// cannot fill. The result is [num_bags, num_tables * ddim] with the tables
+// concatenated along the features, which interaction_forward takes as is.
+template<typename T>
+static inline at::Tensor _embedding_bag_batched_fast(const std::vector<at::Tensor>& weights,
+    const std::vector<at::Tensor>& indices, const std::vector<at::Tensor>& offsets,
+    int64_t mode, bool include_last_offset, int64_t num_bags) {
+  int64_t num_tables = weights.size();
+  int64_t ddim = weights[0].size(1);
+  std::vector<T*> weight_data(num_tables);
+  std::vector<int64_t*> indices_data(num_tables);
+  std::vector<const int64_t*> offsets_data(num_tables);
+  std::vector<at::Tensor> indices_(num_tables);
+  std::vector<at::Tensor> offsets_(num_tables);
+  std::vector<std::vector<int64_t>> offsets_include_last(num_tables);
+  for (int64_t t = 0; t < num_tables; t++) {
+    int64_t output_size;
+    indices_[t] = indices[t].contiguous();
+    offsets_[t] = offsets[t].contiguous();
+    weight_data[t] = weights[t].data_ptr<T>();
+    indices_data[t] = indices_[t].data_ptr<int64_t>();
+    offsets_data[t] = get_offsets_include_last(offsets_[t], indices_[t].numel(),
+        include_last_offset, offsets_include_last[t], output_size);
+  }
+
+  int64_t out_stride0 = num_tables * ddim;
+  at::Tensor output = at::empty({num_bags, out_stride0}, weights[0].options());
+  auto* output_data = output.data_ptr<T>();
+  int64_t prefetch_distance = get_prefetch_distance();
+  at::parallel_for(0, num_bags * num_tables, 16, [&](int64_t start, int64_t end) {
+    std::vector<float> temp_output(ddim);
+    float* acc = temp_output.data();
+    for (int64_t w = start; w < end; w++) {
+      int64_t b = w / num_tables;
+      int64_t t = w % num_tables;
+      auto inputs_start = offsets_data[t][b];
+      auto inputs_end = offsets_data[t][b + 1];
+      float scale = 1.f;
+      if ((mode == MODE_MEAN) && (inputs_end > inputs_start)) {
+        scale = 1.f / (inputs_end - inputs_start);
+      }
+      zero_ker(acc, ddim);
+      // consecutive work items hit different tables, so only prefetch within the bag
+      for (int64_t s = inputs_start; s < inputs_end; s++) {
+        if ((prefetch_distance > 0) && (s + prefetch_distance < inputs_end)) {
+          prefetch_row(&weight_data[t][indices_data[t][s + prefetch_distance] * ddim], ddim * sizeof(T));
+        }
+        madd_ker(acc, &weight_data[t][indices_data[t][s] * ddim], ddim, scale);
+      }
+      move_ker(&output_data[b * out_stride0 + t * ddim], acc, ddim);
+    }
+  });
+
+  return output;
+}
+
+at::Tensor embedding_bag_batched_impl(const std::vector<at::Tensor>& weights,
+    const std::vector<at::Tensor>& indices, const std::vector<at::Tensor>& offsets,
+    int64_t mode, bool include_last_offset) {
+  int64_t num_bags = check_batched_inputs(weights, indices, offsets, mode, include_last_offset);
+  if (is_bfloat16_tensor(weights[0])) {
+    return _embedding_bag_batched_fast<at::BFloat16>(weights, indices, offsets, mode, include_last_offset, num_bags);
+  } else {
+    return _embedding_bag_batched_fast<float>(weights, indices, offsets, mode, include_last_offset, num_bags);
+  }
+}
+
+// Sparse backward of the batched lookup: the gradient rows of every table
+// are written in one parallel region, again over (bag, table) pairs.
+template<typename T>
+static inline std::vector<at::Tensor> embedding_bag_batched_sparse_backward_fast(const at::Tensor grad,
+    const std::vector<at::Tensor>& indices, const std::vector<at::Tensor>& offsets,
+    const std::vector<int64_t>& num_weights, int64_t mode, bool include_last_offset, int64_t num_bags) {
+  int64_t num_tables = indices.size();
+  int64_t ddim = grad.size(1) / num_tables;
+  std::vector<at::Tensor> indices_(num_tables);
+  std::vector<at::Tensor> offsets_(num_tables);
+  std::vector<at::Tensor> index_grad(num_tables);
+  std::vector<T*> gradout_data(num_tables);
+  std::vector<const int64_t*> offsets_data(num_tables);
+  std::vector<std::vector<int64_t>> offsets_include_last(num_tables);
+  for (int64_t t = 0; t < num_tables; t++) {
+    int64_t output_size;
+    indices_[t] = indices[t].contiguous();
+    offsets_[t] = offsets[t].contiguous();
+    index_grad[t] = at::empty({indices_[t].numel(), ddim}, grad.options());
+    gradout_data[t] = index_grad[t].data_ptr<T>();
+    offsets_data[t] = get_offsets_include_last(offsets_[t], indices_[t].numel(),
+        include_last_offset, offsets_include_last[t], output_size);
+  }
+
+  T* grad_data = grad.data_ptr<T>();
+  int64_t grad_stride0 = grad.stride(0);
+  at::parallel_for(0, num_bags * num_tables, 16, [&](int64_t start, int64_t end) {
+    std::vector<float> temp_grad(ddim);
+    float* temp_output = temp_grad.data();
+    for (int64_t w = start; w < end; w++) {
+      int64_t b = w / num_tables;
+      int64_t t = w % num_tables;
+      auto select_off_start = offsets_data[t][b];
+      auto select_off_end = offsets_data[t][b + 1];
+      auto grad_block = grad_data + b * grad_stride0 + t * ddim;
+      if (select_off_start == select_off_end) continue;
+      if (mode == MODE_MEAN) {
+        zero_ker(temp_output, ddim);
+        madd_ker(temp_output, grad_block, ddim, 1.f / (select_off_end - select_off_start));
+      }
+      for (int64_t s = select_off_start; s < select_off_end; s++) {
+        if (mode == MODE_MEAN) {
+          move_ker(gradout_data[t] + ddim * s, temp_output, ddim);
+        } else {
+          move_ker(gradout_data[t] + ddim * s, grad_block, ddim);
+        }
+      }
+    }
+  });
+
+  std::vector<at::Tensor> weight_grads(num_tables);
+  for (int64_t t = 0; t < num_tables; t++) {
+    weight_grads[t] = make_sparse_grad(index_grad[t], indices_[t], num_weights[t]);
+  }
+  return weight_grads;
+}
+
+std::vector<at::Tensor> embedding_bag_batched_backward_impl(const at::Tensor& grad,
+    const std::vector<at::Tensor>& indices, const std::vector<at::Tensor>& offsets,
+    const std::vector<int64_t>& num_weights, int64_t mode, bool sparse, bool include_last_offset) {
+  int64_t num_tables = indices.size();
+  IPEX_CHECK(num_weights.size() == num_tables, "batched embedding_bag expects as many num_weights as tables");
+  IPEX_CHECK((mode == MODE_SUM) || (mode == MODE_MEAN), "batched embedding_bag only supports sum and mean modes");
+  IPEX_CHECK(grad.size(1) % num_tables == 0, "batched embedding_bag expects a [num_bags, num_tables * ddim] gradient");
+  auto grad_c = grad.contiguous();
+  int64_t num_bags = grad_c.size(0);
+
+  if (sparse) {
+    if (is_bfloat16_tensor(grad_c)) {
+      return embedding_bag_batched_sparse_backward_fast<at::BFloat16>(grad_c, indices, offsets, num_weights, mode, include_last_offset, num_bags);
+    } else {
+      return embedding_bag_batched_sparse_backward_fast<float>(grad_c, indices, offsets, num_weights, mode, include_last_offset, num_bags);
+    }
+  }
+
+  // The dense backward is already parallel over the sorted rows of a table,
+  // so the tables are simply walked in turn on their slice of the gradient.
+  int64_t ddim = grad_c.size(1) / num_tables;
+  std::vector<at::Tensor> weight_grads(num_tables);
+  for (int64_t t = 0; t < num_tables; t++) {
+    auto grad_t = grad_c.narrow(1, t * ddim, ddim);
+    auto indices_t = indices[t].contiguous();
+    auto offsets_t = offsets[t].contiguous();
+    if (indices_t.numel() == 0) {
+      weight_grads[t] = at::zeros({num_weights[t], ddim}, grad_c.options());
+    } else if (is_bfloat16_tensor(grad_c)) {
+      weight_grads[t] = embedding_bag_dense_backward_fast<at::BFloat16>(grad_t, indices_t, offsets_t, num_weights[t], mode, at::Tensor());
+    } else {
+      weight_grads[t] = embedding_bag_dense_backward_fast<float>(grad_t, indices_t, offsets_t, num_weights[t], mode, at::Tensor());
+    }
+  }
+  return weight_grads;
+}
+
+// Row-wise quantized tables are uint8 tensors of [num_rows, row_bytes]: the
+// quantized values (one byte per element for 8 bits, two elements per byte
+// for 4 bits), then the fp32 scale and bias of the row.
+static constexpr int64_t QUANT_ROW_TAIL = 2 * sizeof(float);
+
+static inline int64_t quantized_row_data_bytes(int64_t ddim, int64_t bit_width) {
+  return bit_width == 8 ? ddim : ddim / 2;
+}
+
+at::Tensor embedding_bag_rowwise_quantize_impl(const at::Tensor & weight, int64_t bit_width) {
+  IPEX_CHECK((bit_width == 8) || (bit_width == 4), "row-wise quantization supports 8 and 4 bits");
+  IPEX_CHECK(weight.dim() == 2, "row-wise quantization expects a 2D table");
+  int64_t num_rows = weight.size(0);
+  int64_t ddim = weight.size(1);
+  IPEX_CHECK((bit_width == 8) || (ddim % 2 == 0), "4-bit row-wise quantization expects an even embedding dim");
+  auto weight_ = weight.to(at::kFloat).contiguous();
+  int64_t data_bytes = quantized_row_data_bytes(ddim, bit_width);
+  int64_t row_bytes = data_bytes + QUANT_ROW_TAIL;
+  at::Tensor output = at::empty({num_rows, row_bytes}, weight_.options().dtype(at::kByte));
+
+  float* weight_data = weight_.data_ptr<float>();
+  uint8_t* output_data = output.data_ptr<uint8_t>();
+  const float levels = (1 << bit_width) - 1;
+  at::parallel_for(0, num_rows, 64, [&](int64_t start, int64_t end) {
+    for (int64_t r = start; r < end; r++) {
+      const float* in = weight_data + r * ddim;
+      uint8_t* out = output_data + r * row_bytes;
+      float min_val = ddim > 0 ? *std::min_element(in, in + ddim) : 0.f;
+      float max_val = ddim > 0 ? *std::max_element(in, in + ddim) : 0.f;
+      float range = max_val - min_val;
+      float scale = range / levels;
+      float inverse_scale = levels / (range + 1e-8f);
+      std::memset(out, 0, data_bytes);
+      for (int64_t d = 0; d < ddim; d++) {
+        int q = std::lrintf((in[d] - min_val) * inverse_scale);
+        q = std::max(0, std::min<int>(q, levels));
+        if (bit_width == 8) {
+          out[d] = q;
+        } else {
+          out[d / 2] |= q << ((d % 2) * 4);
+        }
+      }
+      std::memcpy(out + data_bytes, &scale, sizeof(float));
+      std::memcpy(out + data_bytes + sizeof(float), &min_val, sizeof(float));
+    }
+  });
+  return output;
+}
+
+// SUM and MEAN lookups over a row-wise quantized table, reading 4x (8 bits)
+// or 8x (4 bits) fewer bytes per row than fp32. Rows are dequantized and
+// accumulated straight into the fp32 output.
+template<int64_t bit_width>
+static inline at::Tensor _quantized_embedding_bag_fast(const at::Tensor qweight,
+    const at::Tensor select_indices, const at::Tensor offsets, int64_t mode,
+    const at::Tensor per_sample_weights, bool include_last_offset) {
+  int64_t row_bytes = qweight.size(1);
+  int64_t data_bytes = row_bytes - QUANT_ROW_TAIL;
+  int64_t ddim = bit_width == 8 ? data_bytes : data_bytes * 2;
+  int64_t output_size;
+  std::vector<int64_t> offsets_include_last;
+  auto* offsets_data = get_offsets_include_last(offsets, select_indices.numel(),
+      include_last_offset, offsets_include_last, output_size);
+
+  at::Tensor output = at::empty({output_size, ddim}, qweight.options().dtype(at::kFloat));
+  float* output_data = output.data_ptr<float>();
+  const uint8_t* qweight_data = qweight.data_ptr<uint8_t>();
+  float* weights_data = per_sample_weights.defined() ? per_sample_weights.data_ptr<float>() : nullptr;
+  auto indices_accessor = select_indices.accessor<int64_t, 1>();
+  int64_t prefetch_distance = get_prefetch_distance();
+  at::parallel_for(0, output_size, 16, [&](int64_t start, int64_t end) {
+    int64_t chunk_end = offsets_data[end];
+    for (int64_t i = start; i < end; i++) {
+      float* out = &output_data[i * ddim];
+      auto inputs_start = offsets_data[i];
+      auto inputs_end = offsets_data[i + 1];
+      float bag_scale = 1.f;
+      if ((mode == MODE_MEAN) && (inputs_end > inputs_start)) {
+        bag_scale = 1.f / (inputs_end - inputs_start);
+      }
+      zero_ker(out, ddim);
+      for (int64_t s = inputs_start; s < inputs_end; s++) {
+        if ((prefetch_distance > 0) && (s + prefetch_distance < chunk_end)) {
+          prefetch_row(qweight_data + indices_accessor[s + prefetch_distance] * row_bytes, row_bytes);
+        }
+        const uint8_t* row = qweight_data + indices_accessor[s] * row_bytes;
+        float w = weights_data ? weights_data[s] : bag_scale;
+        float scale, bias;
+        std::memcpy(&scale, row + data_bytes, sizeof(float));
+        std::memcpy(&bias, row + data_bytes + sizeof(float), sizeof(float));
+        if (bit_width == 8) {
+          dequant_add_ker(out, row, ddim, w * scale, w * bias);
+        } else {
+          dequant_add_4bit_ker(out, row, ddim, w * scale, w * bias);
+        }
+      }
+    }
+  });
+  return output;
+}
+
+at::Tensor quantized_embedding_bag_impl(const at::Tensor & qweight, const at::Tensor & indices,
+  const at::Tensor & offsets, int64_t bit_width, int64_t mode,
+  const at::Tensor & per_sample_weights, bool include_last_offset) {
+  IPEX_CHECK((bit_width == 8) || (bit_width == 4), "quantized embedding_bag supports 8 and 4 bits");
+  IPEX_CHECK(qweight.scalar_type() == at::kByte && qweight.dim() == 2 && qweight.size(1) > QUANT_ROW_TAIL,
+      "quantized embedding_bag expects a table made by embedding_bag_rowwise_quantize");
+  IPEX_CHECK((mode == MODE_SUM) || (mode == MODE_MEAN), "quantized embedding_bag only supports sum and mean modes");
+  IPEX_CHECK(!per_sample_weights.defined() || (mode == MODE_SUM),
+      "embedding_bag: per_sample_weights only supported with mode='sum'");
+
+  auto qweight_ = qweight.contiguous();
+  auto indices_ = indices.contiguous();
+  auto offsets_ = offsets.contiguous();
+  auto weights_ = per_sample_weights.defined() ? per_sample_weights.to(at::kFloat).contiguous() : per_sample_weights;
+  if (bit_width == 8) {
+    return _quantized_embedding_bag_fast<8>(qweight_, indices_, offsets_, mode, weights_, include_last_offset);
+  } else {
+    return _quantized_embedding_bag_fast<4>(qweight_, indices_, offsets_, mode, weights_, include_last_offset);
+  }
+}
+
+// weight_row += alpha * grad_row, with bf16 tables updated either through
+// their fp32 split (top_half = weight, bot_half = lower 16 bits) or by a
+// plain round trip through fp32.
+static inline void apply_row_update(float* weight_row, at::BFloat16* bot_half_row,
+    float* grad_row, int64_t ddim, float alpha, float* tmp) {
+  madd_ker(weight_row, grad_row, ddim, alpha);
+}
+
+static inline void apply_row_update(at::BFloat16* weight_row, at::BFloat16* bot_half_row,
+    float* grad_row, int64_t ddim, float alpha, float* tmp) {
+  if (bot_half_row) {
+    packed_bf16_add_ker(weight_row, bot_half_row, grad_row, ddim, alpha);
+  } else {
+    move_ker(tmp, weight_row, ddim);
+    madd_ker(tmp, grad_row, ddim, alpha);
+    move_ker(weight_row, tmp, ddim);
+  }
+}
+
+// Fused backward and sparse optimizer step for the SUM and MEAN modes. The
+// weight gradient is never materialized: (row id, entry) pairs are sorted
+// like in the dense backward, the entries of every unique row are reduced in
+// fp32 and the step is applied to the row right away by the thread owning it.
+//   SGD:              w -= lr * g
+//   row-wise Adagrad: m += mean(g * g); w -= lr / (sqrt(m) + eps) * g
+template<typename T>
+static inline void embedding_bag_backward_update_fast(const at::Tensor grad, at::Tensor weight,
+    const at::Tensor bot_half, const at::Tensor momentum, const at::Tensor indices,
+    const at::Tensor offsets, int64_t mode, const at::Tensor per_sample_weights, float lr, float eps) {
+  int64_t indices_numel = indices.numel();
+  int64_t num_weights = weight.size(0);
+  int64_t ddim = weight.size(1);
+  at::Tensor offset2bag_ = embedding_bag_get_offset2bag(indices, offsets, at::empty({0}, indices.options()));
+  std::vector<float> scales = get_entry_scales<T>(offsets, indices_numel, mode, per_sample_weights);
+
+  auto* indices_data = indices.data_ptr<int64_t>();
+  auto* offset2bag_data = offset2bag_.data_ptr<int64_t>();
+  std::vector<int64_t> sort_buf(indices_numel * 4);
+  int64_t* keys = sort_buf.data();
+  int64_t* values = keys + indices_numel;
+  int64_t* tmp_keys = values + indices_numel;
+  int64_t* tmp_values = tmp_keys + indices_numel;
+  at::parallel_for(0, indices_numel, 4096, [&](int64_t start, int64_t end) {
+    std::memcpy(keys + start, indices_data + start, (end - start) * sizeof(int64_t));
+    for (int64_t s = start; s < end; s++) {
+      values[s] = s;
+    }
+  });
+  int64_t* sorted_keys;
+  int64_t* sorted_values;
+  std::tie(sorted_keys, sorted_values) = radix_sort_parallel(
+      keys, values, tmp_keys, tmp_values, indices_numel, num_weights - 1);
+
+  int max_threads = at::get_num_threads();
+  std::vector<int64_t> chunk_bounds;
+  split_sorted_segments(sorted_keys, indices_numel, max_threads, chunk_bounds);
+
+  T* grad_data = grad.data_ptr<T>();
+  T* weight_data = weight.data_ptr<T>();
+  at::BFloat16* bot_half_data = bot_half.defined() ? bot_half.data_ptr<at::BFloat16>() : nullptr;
+  float* momentum_data = momentum.defined() ? momentum.data_ptr<float>() : nullptr;
+  at::parallel_for(0, max_threads, 1, [&](int64_t start, int64_t end) {
+    std::vector<float> temp_buf(2 * ddim);
+    float* temp_grad = temp_buf.data();
+    float* tmp = temp_grad + ddim;
+    for (int64_t c = start; c < end; c++) {
+      int64_t seg_start = chunk_bounds[c];
+      int64_t chunk_end = chunk_bounds[c + 1];
+      while (seg_start < chunk_end) {
+        int64_t row = sorted_keys[seg_start];
+        int64_t seg_end = seg_start + 1;
+        while (seg_end < chunk_end && sorted_keys[seg_end] == row) {
+          seg_end++;
+        }
+        zero_ker(temp_grad, ddim);
+        for (int64_t j = seg_start; j < seg_end; j++) {
+          int64_t s = sorted_values[j];
+          T* grad_block = grad_data + offset2bag_data[s] * ddim;
+          if (scales.empty()) {
+            add_ker(temp_grad, grad_block, ddim);
+          } else {
+            madd_ker(temp_grad, grad_block, ddim, scales[s]);
+          }
+        }
+        float alpha = -lr;
+        if (momentum_data) {
+          momentum_data[row] += dot_ker(temp_grad, temp_grad, ddim) / ddim;
+          alpha = -lr / (std::sqrt(momentum_data[row]) + eps);
+        }
+        apply_row_update(weight_data + row * ddim, bot_half_data ? bot_half_data + row * ddim : nullptr,
+                         temp_grad, ddim, alpha, tmp);
+        seg_start = seg_end;
+      }
+    }
+  });
+}
+
+void embedding_bag_backward_update_impl(const at::Tensor & grad, at::Tensor & weight,
+  const at::Tensor & bot_half, const at::Tensor & momentum, const at::Tensor & indices,
+  const at::Tensor & offsets, int64_t mode, const at::Tensor & per_sample_weights,
+  double lr, double eps) {
+  IPEX_CHECK((mode == MODE_SUM) || (mode == MODE_MEAN), "fused embedding_bag update only supports sum and mean modes");
+  IPEX_CHECK(weight.dim() == 2 && weight.is_contiguous(), "fused embedding_bag update expects a contiguous 2D table");
+  IPEX_CHECK((weight.scalar_type() == at::kFloat) || (weight.scalar_type() == at::kBFloat16),
+      "fused embedding_bag update only supports float and bfloat16 tables");
+  IPEX_CHECK(grad.scalar_type() == weight.scalar_type(), "fused embedding_bag update expects the gradient in the table dtype");
+  IPEX_CHECK(!bot_half.defined() ||
+      (weight.scalar_type() == at::kBFloat16 && bot_half.sizes() == weight.sizes() && bot_half.is_contiguous()),
+      "split SGD expects a bfloat16 table and a bottom half of the same shape");
+  IPEX_CHECK(!momentum.defined() ||
+      (momentum.scalar_type() == at::kFloat && momentum.numel() == weight.size(0) && momentum.is_contiguous()),
+      "row-wise Adagrad expects one float momentum per row");
+  IPEX_CHECK(!per_sample_weights.defined() || (mode == MODE_SUM),
+      "embedding_bag: per_sample_weights only supported with mode='sum'");
+  if (indices.numel() == 0) {
+    return;
+  }
+
+  // the table is updated through its raw data, which does not bump the version
+  // of the parameter, so its hot row cache is dropped explicitly
+  embedding_bag_invalidate_hot_row_cache(weight);
+  auto grad_c = grad.contiguous();
+  auto indices_ = indices.contiguous();
+  auto offsets_ = offsets.contiguous();
+  if (is_bfloat16_tensor(weight)) {
+    embedding_bag_backward_update_fast<at::BFloat16>(grad_c, weight, bot_half, momentum, indices_, offsets_,
+                                                     mode, per_sample_weights, lr, eps);
+  } else {
+    embedding_bag_backward_update_fast<float>(grad_c, weight, bot_half, momentum, indices_, offsets_,
+                                              mode, per_sample_weights, lr, eps);
   }
 }
 
@@ -12,7 +12,7 @@ namespace cpu {
 namespace aten {
 namespace embedding_bag {
 
-at::Tensor embedding_bag_impl(const at::Tensor & weight, const at::Tensor & indices,
+std::vector<at::Tensor> embedding_bag_impl(const at::Tensor & weight, const at::Tensor & indices,
   const at::Tensor & offsets, bool scale_grad_by_freq, int64_t mode, bool sparse,
   const at::Tensor & per_sample_weights, bool include_last_offset);
 
@@ -21,11 +21,43 @@ at::Tensor embedding_bag_backward_impl(const at::Tensor & grad, const at::Tensor
   int64_t num_weights, bool scale_grad_by_freq, int64_t mode, bool sparse,
   const at::Tensor & per_sample_weights);
 
+at::Tensor embedding_bag_per_sample_weights_backward_impl(const at::Tensor & grad, const at::Tensor & weight,
+  const at::Tensor & indices, const at::Tensor & offsets, int64_t mode);
+
 at::Tensor embedding_bag_get_offset2bag(const at::Tensor indices, const at::Tensor & offsets, const at::Tensor & offset2bag);
 
-bool embedding_bag_backward_fast_path_sum(const at::Tensor grad, const at::Tensor indices, const at::Tensor offset2bag, const at::Tensor per_sample_weights, bool scale_grad_by_freq, int64_t mode);
+at::Tensor embedding_bag_batched_impl(const std::vector<at::Tensor>& weights,
+  const std::vector<at::Tensor>& indices, const std::vector<at::Tensor>& offsets,
+  int64_t mode, bool include_last_offset);
+
+std::vector<at::Tensor> embedding_bag_batched_backward_impl(const at::Tensor& grad,
+  const std::vector<at::Tensor>& indices, const std::vector<at::Tensor>& offsets,
+  const std::vector<int64_t>& num_weights, int64_t mode, bool sparse, bool include_last_offset);
+
+at::Tensor embedding_bag_rowwise_quantize_impl(const at::Tensor & weight, int64_t bit_width);
+
+at::Tensor quantized_embedding_bag_impl(const at::Tensor & qweight, const at::Tensor & indices,
+  const at::Tensor & offsets, int64_t bit_width, int64_t mode,
+  const at::Tensor & per_sample_weights, bool include_last_offset);
+
+void embedding_bag_enable_hot_row_cache(const at::Tensor & weight, const at::Tensor & indices, int64_t num_hot_rows);
+
+void embedding_bag_disable_hot_row_cache(const at::Tensor & weight);
+
+// Drops the hot row cache of a table updated without bumping its version.
+void embedding_bag_invalidate_hot_row_cache(const at::Tensor & weight);
+
+std::vector<int64_t> embedding_bag_hot_row_cache_stats(const at::Tensor & weight);
+
+void embedding_bag_backward_update_impl(const at::Tensor & grad, at::Tensor & weight,
+  const at::Tensor & bot_half, const at::Tensor & momentum, const at::Tensor & indices,
+  const at::Tensor & offsets, int64_t mode, const at::Tensor & per_sample_weights,
+  double lr, double eps);
+
+bool embedding_bag_backward_fast_path(const at::Tensor grad, const at::Tensor indices, const at::Tensor offset2bag,
+  const at::Tensor maximum_indices, const at::Tensor per_sample_weights, bool scale_grad_by_freq, int64_t mode, bool sparse);
 
-bool embedding_bag_fast_path_sum(const at::Tensor weight, const at::Tensor per_sample_weights, int64_t mode);
+bool embedding_bag_fast_path(const at::Tensor weight, const at::Tensor per_sample_weights, int64_t mode, bool sparse);
 
 }  // namespace embedding_bag
 }  // namespace aten
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <ATen/ATen.h>
+#include <ATen/Parallel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace torch_ipex {
+namespace cpu {
+namespace aten {
+
+// Copy of the N most frequently looked up rows of an embedding table, kept
+// in a compact side table with 64-byte aligned rows. Row ids are resolved
+// through a small open-addressing hash, so a miss only costs a probe in a
+// structure that stays in cache.
+//
+// The cache is a snapshot: it records the version of the table it was built
+// from and must not be used once the table has been updated in place. The
+// version only catches the updates made through ATen ops; the writers that
+// update the raw data (packed_add_, the fused embedding_bag update) drop the
+// cache with embedding_bag_invalidate_hot_row_cache instead.
+class HotRowCache {
+ public:
+  HotRowCache(const at::Tensor& weight, const at::Tensor& indices, int64_t num_hot_rows)
+      : weight_data_(weight.data_ptr()),
+        version_(table_version(weight)),
+        num_rows_(weight.size(0)),
+        ddim_(weight.size(1)),
+        dtype_(weight.scalar_type()) {
+    auto hot_rows = select_hot_rows(indices, num_hot_rows);
+
+    int64_t capacity = 16;
+    while (capacity < 2 * static_cast<int64_t>(hot_rows.size())) {
+      capacity *= 2;
+    }
+    mask_ = capacity - 1;
+    keys_.assign(capacity, -1);
+    slots_.assign(capacity, -1);
+
+    int64_t elem_size = weight.element_size();
+    row_stride_ = ((ddim_ * elem_size + 63) / 64 * 64) / elem_size;
+    // the CPU allocator returns 64-byte aligned buffers
+    rows_ = at::empty({static_cast<int64_t>(hot_rows.size()), row_stride_},
+                      at::TensorOptions().dtype(dtype_).device(at::kCPU));
+    auto* src = static_cast<const char*>(weight_data_);
+    auto* dst = static_cast<char*>(rows_.data_ptr());
+    for (size_t slot = 0; slot < hot_rows.size(); slot++) {
+      int64_t row = hot_rows[slot];
+      std::memcpy(dst + slot * row_stride_ * elem_size,
+                  src + row * weight.stride(0) * elem_size, ddim_ * elem_size);
+      int64_t pos = hash(row);
+      while (keys_[pos] != -1) {
+        pos = (pos + 1) & mask_;
+      }
+      keys_[pos] = row;
+      slots_[pos] = slot;
+    }
+  }
+
+  // True if the cache was built from this very table and is still current.
+  bool valid_for(const at::Tensor& weight) const {
+    return weight.data_ptr() == weight_data_ && table_version(weight) == version_ &&
+           weight.size(0) == num_rows_ && weight.size(1) == ddim_ &&
+           weight.scalar_type() == dtype_;
+  }
+
+  // Returns the cached copy of the row, or nullptr if it is not hot.
+  template <typename T>
+  const T* find(int64_t row) const {
+    int64_t pos = hash(row);
+    while (true) {
+      int64_t key = keys_[pos];
+      if (key == row) {
+        return rows_.data_ptr<T>() + slots_[pos] * row_stride_;
+      }
+      if (key == -1) {
+        return nullptr;
+      }
+      pos = (pos + 1) & mask_;
+    }
+  }
+
+  void record(uint64_t hits, uint64_t misses) {
+    hits_ += hits;
+    misses_ += misses;
+  }
+
+  int64_t size() const { return rows_.size(0); }
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+ private:
+  static int64_t table_version(const at::Tensor& weight) {
+    return weight.unsafeGetTensorImpl()->version_counter().current_version();
+  }
+
+  int64_t hash(int64_t row) const {
+    return static_cast<int64_t>((static_cast<uint64_t>(row) * 0x9E3779B97F4A7C15ULL) >> 16) & mask_;
+  }
+
+  // Most frequent row ids of the sample, ties broken by the smaller id.
+  static std::vector<int64_t> select_hot_rows(const at::Tensor& indices, int64_t num_hot_rows) {
+    auto indices_ = indices.contiguous();
+    auto* data = indices_.data_ptr<int64_t>();
+    std::unordered_map<int64_t, int64_t> counts;
+    for (int64_t i = 0; i < indices_.numel(); i++) {
+      counts[data[i]]++;
+    }
+    std::vector<std::pair<int64_t, int64_t>> by_count(counts.begin(), counts.end());
+    int64_t n = std::min<int64_t>(num_hot_rows, by_count.size());
+    std::partial_sort(by_count.begin(), by_count.begin() + n, by_count.end(),
+                      [](const std::pair<int64_t, int64_t>& a, const std::pair<int64_t, int64_t>& b) {
+                        return a.second > b.second || (a.second == b.second && a.first < b.first);
+                      });
+    std::vector<int64_t> rows(n);
+    for (int64_t i = 0; i < n; i++) {
+      rows[i] = by_count[i].first;
+    }
+    return rows;
+  }
+
+  const void* weight_data_;
+  int64_t version_;
+  int64_t num_rows_;
+  int64_t ddim_;
+  at::ScalarType dtype_;
+  int64_t mask_;
+  int64_t row_stride_;
+  std::vector<int64_t> keys_;
+  std::vector<int32_t> slots_;
+  at::Tensor rows_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+};
+
+}  // namespace aten
+}  // namespace cpu
+}  // namespace torch_ipex
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace torch_ipex {
+namespace cpu {
+namespace aten {
+
+constexpr int RDX_HIST_SIZE = 256;
+
+// Parallel, stable LSD radix sort of (key, value) pairs, 8 bits per pass.
+// Only as many passes as needed to cover max_value are done, so sorting row
+// ids of a table with 2^20 rows costs 3 passes over the input.
+//
+// Each thread keeps the same static chunk of the input across the histogram
+// and scatter steps, which is what makes the sort stable.
+//
+// Returns the pair of buffers holding the sorted result: either the input
+// buffers or the tmp buffers depending on the parity of the pass count.
+template <typename K, typename V>
+std::pair<K*, V*> radix_sort_parallel(
+    K* inp_key_buf,
+    V* inp_value_buf,
+    K* tmp_key_buf,
+    V* tmp_value_buf,
+    int64_t elements_count,
+    int64_t max_value) {
+  if (max_value <= 0 || elements_count <= 1) {
+    return std::make_pair(inp_key_buf, inp_value_buf);
+  }
+
+  int max_threads = omp_get_max_threads();
+  std::vector<int64_t> histogram(RDX_HIST_SIZE * max_threads);
+  std::vector<int64_t> histogram_ps(RDX_HIST_SIZE * max_threads + 1);
+
+  int num_bits = 64 - __builtin_clzll(static_cast<uint64_t>(max_value));
+  int num_passes = (num_bits + 7) / 8;
+
+#pragma omp parallel
+  {
+    int tid = omp_get_thread_num();
+    int nthreads = omp_get_num_threads();
+    int64_t* local_histogram = &histogram[RDX_HIST_SIZE * tid];
+    int64_t* local_histogram_ps = &histogram_ps[RDX_HIST_SIZE * tid];
+
+    K* input_keys = inp_key_buf;
+    V* input_values = inp_value_buf;
+    K* output_keys = tmp_key_buf;
+    V* output_values = tmp_value_buf;
+
+    for (int pass = 0; pass < num_passes; pass++) {
+      int shift = pass * 8;
+
+      // Step 1: per-thread histogram of the current digit
+      for (int i = 0; i < RDX_HIST_SIZE; i++) {
+        local_histogram[i] = 0;
+      }
+#pragma omp for schedule(static)
+      for (int64_t i = 0; i < elements_count; i++) {
+        local_histogram[(input_keys[i] >> shift) & 0xFF]++;
+      }
+
+      // Step 2: exclusive prefix sum ordered by (digit, thread)
+#pragma omp single
+      {
+        int64_t sum = 0;
+        for (int bin = 0; bin < RDX_HIST_SIZE; bin++) {
+          for (int t = 0; t < nthreads; t++) {
+            histogram_ps[RDX_HIST_SIZE * t + bin] = sum;
+            sum += histogram[RDX_HIST_SIZE * t + bin];
+          }
+        }
+        histogram_ps[RDX_HIST_SIZE * nthreads] = sum;
+      }
+
+      // Step 3: scatter, each thread walks the same chunk as in step 1
+#pragma omp for schedule(static)
+      for (int64_t i = 0; i < elements_count; i++) {
+        K key = input_keys[i];
+        int64_t pos = local_histogram_ps[(key >> shift) & 0xFF]++;
+        output_keys[pos] = key;
+        output_values[pos] = input_values[i];
+      }
+
+      std::swap(input_keys, output_keys);
+      std::swap(input_values, output_values);
+    }
+  }
+
+  return (num_passes % 2 == 0) ? std::make_pair(inp_key_buf, inp_value_buf)
+                               : std::make_pair(tmp_key_buf, tmp_value_buf);
+}
+
+// Splits the sorted key array [0, n) into at most `num_chunks` contiguous
+// ranges whose borders never cut a run of equal keys. `bounds` gets
+// num_chunks + 1 entries, empty ranges are allowed.
+template <typename K>
+void split_sorted_segments(const K* sorted_keys, int64_t n, int num_chunks,
+                           std::vector<int64_t>& bounds) {
+  bounds.resize(num_chunks + 1);
+  bounds[0] = 0;
+  for (int c = 1; c < num_chunks; c++) {
+    int64_t pos = std::max(bounds[c - 1], n * c / num_chunks);
+    while (pos > 0 && pos < n && sorted_keys[pos] == sorted_keys[pos - 1]) {
+      pos++;
+    }
+    bounds[c] = pos;
+  }
+  bounds[num_chunks] = n;
+}
+
+}  // namespace aten
+}  // namespace cpu
+}  // namespace torch_ipex
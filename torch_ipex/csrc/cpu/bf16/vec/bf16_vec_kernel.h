@@ -1,211 +1,112 @@
-#include <immintrin.h>
-#include "vec_type_cvt.h"
-
-inline __m512 pack_bf16_to_fp32(const __m256i top, const __m256i bot) {
-  auto x1 = _mm512_cvtepu16_epi32(top);
-  auto x2 = _mm512_cvtepu16_epi32(bot);
-  auto y = _mm512_add_epi32(_mm512_bslli_epi128(x1, 2), x2);
-  return _mm512_castsi512_ps(y);
-}
-
-// Only support AVX512 impl at current stage. Will expand this impl to cover AVX2 and other cases.
-inline void packed_bf16_add_ker(at::BFloat16 *a1, at::BFloat16 *a2, at::BFloat16 *b, int len, float alpha) {
-  auto vAlpha = _mm512_set1_ps(alpha);
-  int i = 0;
-  for (; i < len - 15; i += 16) {
-    auto x1 = _mm256_loadu_si256((__m256i *)(a1 + i));
-    auto x2 = _mm256_loadu_si256((__m256i *)(a2 + i));
-    auto y1 = _mm256_loadu_si256((__m256i *)(b + i));
-
-    auto z1 = pack_bf16_to_fp32(x1, x2);
-    auto z2 = cvt_bf16_to_fp32(y1);
-    z1 = _mm512_fmadd_ps(vAlpha, z2, z1);
-    // Update result back to split input tensors.
-    _mm256_storeu_si256((__m256i *)(a1 + i), trunc_fp32_to_bf16(z1));
-    _mm256_storeu_si256((__m256i *)(a2 + i), _mm512_cvtepi32_epi16(_mm512_castps_si512(z1)));
-  }
-
-  if (i < len) {
-    __mmask16 mask = (1 << (len - i)) - 1;
-    auto x1 = _mm256_maskz_loadu_epi16(mask, a1 + i);
-    auto x2 = _mm256_maskz_loadu_epi16(mask, a2 + i);
-    auto y1 = _mm256_maskz_loadu_epi16(mask, b + i);
-
-    auto z1 = pack_bf16_to_fp32(x1, x2);
-    auto z2 = cvt_bf16_to_fp32(y1);
-    z1 = _mm512_fmadd_ps(vAlpha, z2, z1);
-    // Update result back to split input tensors.
-    _mm256_mask_storeu_epi16(a1 + i, mask, trunc_fp32_to_bf16(z1));
-    _mm256_mask_storeu_epi16(a2 + i, mask, _mm512_cvtepi32_epi16(_mm512_castps_si512(z1)));
-  }
-}
-
-inline void add_ker(at::BFloat16 *inout, at::BFloat16 *in, int len) {
-  int i = 0;
-  #pragma unroll(2)
-  for(; i < len - 15; i += 16) {
-    auto x1 = cvt_bf16_to_fp32(_mm256_loadu_si256((__m256i*)(inout + i)));
-    auto x2 = cvt_bf16_to_fp32(_mm256_loadu_si256((__m256i*)(in + i)));
-    x1 = _mm512_add_ps(x1, x2);
-    _mm256_storeu_si256((__m256i*)(inout + i), cvt_fp32_to_bf16(x1));
-  }
-  if(i < len) {
-    auto mask = (1 << (len - i)) - 1;
-    auto x1 = cvt_bf16_to_fp32(_mm256_maskz_loadu_epi16(mask, inout + i));
-    auto x2 = cvt_bf16_to_fp32(_mm256_maskz_loadu_epi16(mask, in + i));
-    x1 = _mm512_add_ps(x1, x2);
-    _mm256_mask_storeu_epi16(inout + i, mask, cvt_fp32_to_bf16(x1));
-  }
-}
-
-inline void add_ker(float *inout, float *in, int len) {
-  int i = 0;
-  for(; i < len - 31; i += 32) {
-    auto out1 = _mm512_loadu_ps(inout + i);
-    auto out2 = _mm512_loadu_ps(inout + i + 16);
-    auto in1 = _mm512_loadu_ps(in + i);
-    auto in2 = _mm512_loadu_ps(in + i + 16);
-    out1 = _mm512_add_ps(out1, in1);
-    out2 = _mm512_add_ps(out2, in2);
-    _mm512_storeu_ps(inout + i, out1);
-    _mm512_storeu_ps(inout + i + 16, out2);
-  }
-
-  if (i < len - 15) {
-    auto out1 = _mm512_loadu_ps(inout + i);
-    auto in1 = _mm512_loadu_ps(in + i);
-    out1 = _mm512_add_ps(out1, in1);
-    _mm512_storeu_ps(inout + i, out1);
-    i += 16;
-  }
-
-  if(i < len) {
-    auto mask = (1 << (len - i)) - 1;
-    auto x1 = _mm512_maskz_loadu_ps(mask, inout + i);
-    auto x2 = _mm512_maskz_loadu_ps(mask, in + i);
-    x1 = _mm512_add_ps(x1, x2);
-    _mm512_mask_storeu_ps(inout + i, mask, x1);
-  }
-}
-
-inline void add_ker(float *inout, at::BFloat16 *in, int len) {
-  int i = 0;
-  for(; i < len - 31; i += 32) {
-    auto out1 = _mm512_loadu_ps(inout + i);
-    auto out2 = _mm512_loadu_ps(inout + i + 16);
-    auto in1 = cvt_bf16_to_fp32(_mm256_loadu_si256((__m256i*)(in + i)));
-    auto in2 = cvt_bf16_to_fp32(_mm256_loadu_si256((__m256i*)(in + i + 16)));
-    out1 = _mm512_add_ps(out1, in1);
-    out2 = _mm512_add_ps(out2, in2);
-    _mm512_storeu_ps(inout + i, out1);
-    _mm512_storeu_ps(inout + i + 16, out2);
-  }
-
-  if (i < len - 15) {
-    auto out1 = _mm512_loadu_ps(inout + i);
-    auto in1 = cvt_bf16_to_fp32(_mm256_loadu_si256((__m256i*)(in + i)));
-    out1 = _mm512_add_ps(out1, in1);
-    _mm512_storeu_ps(inout + i, out1);
-    i += 16;
-  }
-
-  if(i < len) {
-    auto mask = (1 << (len - i)) - 1;
-    auto x1 = _mm512_maskz_loadu_ps(mask, inout + i);
-    auto x2 = cvt_bf16_to_fp32(_mm256_maskz_loadu_epi16(mask, in + i));
-    x1 = _mm512_add_ps(x1, x2);
-    _mm512_mask_storeu_ps(inout + i, mask, x1);
-  }
-}
-
-static inline void move_ker(at::BFloat16 *out, float *in, int64_t len) {
-  int64_t i = 0;
-  for (; i < len - 31; i += 32) {
-    auto in0 = cvt_fp32_to_bf16(_mm512_loadu_ps(in + i));
-    auto in1 = cvt_fp32_to_bf16(_mm512_loadu_ps(in + i + 16));
-    _mm256_storeu_si256((__m256i *)(out + i), in0);
-    _mm256_storeu_si256((__m256i *)(out + i + 16), in1);
-  }
-
-  if (i < len - 15) {
-    auto in0 = cvt_fp32_to_bf16(_mm512_loadu_ps(in + i));
-    _mm256_storeu_si256((__m256i *)(out + i), in0);
-    i += 16;
-  }
-
-  if (i < len) {
-    auto mask = ((1 << (len - i)) - 1);
-    auto in0 = cvt_fp32_to_bf16(_mm512_maskz_loadu_ps(mask, in + i));
-    _mm256_mask_storeu_epi16((__m256i *)(out + i), mask, in0);
-  }
-}
-
-static inline void move_ker(float *out, float *in, int64_t len) {
-  int64_t i = 0;
-  for (; i < len - 31 ; i += 32) {
-    auto in0 = _mm512_loadu_ps(in + i );
-    auto in1 = _mm512_loadu_ps(in + i + 16);
-    _mm512_storeu_ps(out + i, in0);
-    _mm512_storeu_ps(out + i + 16, in1);
-  }
-
-  if (i < len - 15) {
-    auto in0 = _mm512_loadu_ps(in + i);
-    _mm512_storeu_ps(out + i, in0);
-    i += 16;
-  }
-
-  if (i < len) {
-    auto mask = ((1 << (len - i)) - 1);
-    auto in0 = _mm512_maskz_loadu_ps(mask, in + i);
-    _mm512_mask_storeu_ps(out + i, mask, in0);
-  }
-}
-
-static inline void move_ker(at::BFloat16 *out, at::BFloat16 *in, int64_t len) {
-  int64_t i = 0;
-  for (; i < len - 63; i += 64) {
-    auto in0 = _mm512_loadu_si512(in + i);
-    auto in1 = _mm512_loadu_si512(in + i + 32);
-    _mm512_storeu_si512(out + i, in0);
-    _mm512_storeu_si512(out + i + 32, in1);
-  }
-
-  if (i < len - 31) {
-    auto in0 = _mm512_loadu_si512(in + i);
-    _mm512_storeu_si512(out + i, in0);
-    i += 31;
-  }
-
-  if (i < len) {
-    auto mask = (1 << (len - i)) - 1;
-    auto in0 = _mm512_maskz_loadu_epi16(mask, in + i);
-    _mm512_mask_storeu_epi16(out + i, mask, in0);
-  }
-}
-
-static inline void zero_ker(float *out, int64_t len) {
-  int64_t i = 0;
-  __m512 zero_512 = _mm512_setzero_ps();
-  for (; i < len - 15; i += 16) {
-    _mm512_storeu_ps(out + i, zero_512);
-  }
-
-  if (i < len) {
-    auto mask = ((1 << (len - i)) - 1);
-    _mm512_mask_storeu_ps(out + i, mask, zero_512);
-  }
-}
-
-static inline void zero_ker(at::BFloat16 *out, int64_t len) {
-  int64_t i = 0;
-  __m512i zero_512 = _mm512_setzero_si512();
-  for (; i < len - 31; i += 32) {
-    _mm512_storeu_si512(out + i, zero_512);
-  }
-
-  if (i < len) {
-    auto mask = ((1 << (len - i)) - 1);
-    _mm512_mask_storeu_epi16(out + i, mask, zero_512);
-  }
+#pragma once
+
+#include <ATen/ATen.h>
+#include "vec_kernel_dispatch.h"
+
+// Typed front ends of the runtime selected kernels of vec_kernel_dispatch.h,
+// for the fused paths (embedding_bag, packed_add_, interaction). They are
+// built with the baseline flags like their callers and pass bf16 data to the
+// kernels as raw bits, so the callers run on any host.
+
+inline const torch_ipex::cpu::bf16::vec::VecKernels& vec_kernels() {
+  return torch_ipex::cpu::bf16::vec::get_vec_kernels();
+}
+
+inline uint16_t* bf16_bits(at::BFloat16 *p) {
+  return reinterpret_cast<uint16_t *>(p);
+}
+
+inline const uint16_t* bf16_bits(const at::BFloat16 *p) {
+  return reinterpret_cast<const uint16_t *>(p);
+}
+
+inline void cvt_bf16_to_fp32(float *dst, const at::BFloat16 *src, int64_t len) {
+  vec_kernels().bf16_to_fp32(dst, bf16_bits(src), len);
+}
+
+inline void cvt_fp32_to_bf16(at::BFloat16 *dst, const float *src, int64_t len) {
+  vec_kernels().fp32_to_bf16(bf16_bits(dst), src, len);
+}
+
+inline void packed_bf16_add_ker(at::BFloat16 *a1, at::BFloat16 *a2, const at::BFloat16 *b, int64_t len, float alpha) {
+  vec_kernels().packed_bf16_add(bf16_bits(a1), bf16_bits(a2), bf16_bits(b), len, alpha);
+}
+
+// Same as above with a fp32 gradient, used when duplicated rows have been
+// reduced in fp32 before the update.
+inline void packed_bf16_add_ker(at::BFloat16 *a1, at::BFloat16 *a2, const float *b, int64_t len, float alpha) {
+  vec_kernels().packed_bf16_add_fp32(bf16_bits(a1), bf16_bits(a2), b, len, alpha);
+}
+
+inline void add_ker(at::BFloat16 *inout, const at::BFloat16 *in, int64_t len) {
+  vec_kernels().add_bf16(bf16_bits(inout), bf16_bits(in), len);
+}
+
+inline void add_ker(float *inout, const float *in, int64_t len) {
+  vec_kernels().add_fp32(inout, in, len);
+}
+
+inline void add_ker(float *inout, const at::BFloat16 *in, int64_t len) {
+  vec_kernels().add_fp32_bf16(inout, bf16_bits(in), len);
+}
+
+inline void move_ker(at::BFloat16 *out, const float *in, int64_t len) {
+  vec_kernels().fp32_to_bf16(bf16_bits(out), in, len);
+}
+
+inline void move_ker(float *out, const float *in, int64_t len) {
+  vec_kernels().move_fp32(out, in, len);
+}
+
+inline void move_ker(at::BFloat16 *out, const at::BFloat16 *in, int64_t len) {
+  vec_kernels().move_bf16(bf16_bits(out), bf16_bits(in), len);
+}
+
+inline void move_ker(float *out, const at::BFloat16 *in, int64_t len) {
+  vec_kernels().bf16_to_fp32(out, bf16_bits(in), len);
+}
+
+inline void zero_ker(float *out, int64_t len) {
+  vec_kernels().zero_fp32(out, len);
+}
+
+inline void zero_ker(at::BFloat16 *out, int64_t len) {
+  vec_kernels().zero_bf16(bf16_bits(out), len);
+}
+
+// inout += alpha * in, used by the weighted sum and mean reductions.
+inline void madd_ker(float *inout, const float *in, int64_t len, float alpha) {
+  vec_kernels().madd_fp32(inout, in, len, alpha);
+}
+
+inline void madd_ker(float *inout, const at::BFloat16 *in, int64_t len, float alpha) {
+  vec_kernels().madd_fp32_bf16(inout, bf16_bits(in), len, alpha);
+}
+
+inline void max_ker(float *inout, int64_t *inout_idx, const float *in, int64_t in_idx, int64_t len) {
+  vec_kernels().max_fp32(inout, inout_idx, in, in_idx, len);
+}
+
+inline void max_ker(float *inout, int64_t *inout_idx, const at::BFloat16 *in, int64_t in_idx, int64_t len) {
+  vec_kernels().max_fp32_bf16(inout, inout_idx, bf16_bits(in), in_idx, len);
+}
+
+inline float dot_ker(const float *a, const float *b, int64_t len) {
+  return vec_kernels().dot_fp32(a, b, len);
+}
+
+inline float dot_ker(const at::BFloat16 *a, const at::BFloat16 *b, int64_t len) {
+  return vec_kernels().dot_bf16(bf16_bits(a), bf16_bits(b), len);
+}
+
+// Row-wise quantized embedding rows: inout += scale * q + bias, where the
+// caller folds the bag weight into scale and bias.
+inline void dequant_add_ker(float *inout, const uint8_t *in, int64_t len, float scale, float bias) {
+  vec_kernels().dequant_add_u8(inout, in, len, scale, bias);
+}
+
+// Same for 4-bit rows, element 2k is the low nibble of byte k and element
+// 2k + 1 the high one. len must be even.
+inline void dequant_add_4bit_ker(float *inout, const uint8_t *in, int64_t len, float scale, float bias) {
+  vec_kernels().dequant_add_u4(inout, in, len, scale, bias);
 }
@@ -0,0 +1,340 @@
+// AVX2 + FMA kernels, 8 fp32 lanes. There is no masked 16-bit load in AVX2,
+// so the tails fall back to the scalar helpers.
+
+#include "vec_kernel_dispatch.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+#include <immintrin.h>
+#include "vec_kernel_ref.h"
+
+namespace torch_ipex {
+namespace cpu {
+namespace bf16 {
+namespace vec {
+namespace {
+
+inline __m256 load_bf16(const uint16_t* src) {
+  auto x = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)src));
+  return _mm256_castsi256_ps(_mm256_slli_epi32(x, 16));
+}
+
+inline __m128i cvt_fp32_to_bf16(__m256 src) {
+  auto x = _mm256_castps_si256(src);
+  auto hi = _mm256_srli_epi32(x, 16);
+  auto bias = _mm256_add_epi32(_mm256_and_si256(hi, _mm256_set1_epi32(1)), _mm256_set1_epi32(0x7fff));
+  auto y = _mm256_srli_epi32(_mm256_add_epi32(x, bias), 16);
+  auto nan = _mm256_castps_si256(_mm256_cmp_ps(src, src, _CMP_UNORD_Q));
+  y = _mm256_blendv_epi8(y, _mm256_or_si256(hi, _mm256_set1_epi32(0x40)), nan);
+  // every lane holds a value below 2^16, so unsigned saturation is a no-op
+  return _mm_packus_epi32(_mm256_castsi256_si128(y), _mm256_extracti128_si256(y, 1));
+}
+
+inline float reduce_add(__m256 x) {
+  auto s = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+inline __m256 unpack_4bit(const uint8_t* in) {
+  int32_t bytes;
+  std::memcpy(&bytes, in, sizeof(bytes));
+  auto b = _mm_cvtsi32_si128(bytes);
+  auto nibble_mask = _mm_set1_epi8(0x0f);
+  auto lo = _mm_and_si128(b, nibble_mask);
+  auto hi = _mm_and_si128(_mm_srli_epi16(b, 4), nibble_mask);
+  return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_unpacklo_epi8(lo, hi)));
+}
+
+inline void store_bf16(uint16_t* dst, __m256 src) {
+  _mm_storeu_si128((__m128i*)dst, cvt_fp32_to_bf16(src));
+}
+
+inline __m256 load_packed(const uint16_t* top, const uint16_t* bot) {
+  auto x1 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)top));
+  auto x2 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)bot));
+  return _mm256_castsi256_ps(_mm256_or_si256(_mm256_slli_epi32(x1, 16), x2));
+}
+
+inline void store_packed(uint16_t* top, uint16_t* bot, __m256 src) {
+  auto x = _mm256_castps_si256(src);
+  auto hi = _mm256_srli_epi32(x, 16);
+  auto lo = _mm256_and_si256(x, _mm256_set1_epi32(0xffff));
+  _mm_storeu_si128((__m128i*)top, _mm_packus_epi32(_mm256_castsi256_si128(hi), _mm256_extracti128_si256(hi, 1)));
+  _mm_storeu_si128((__m128i*)bot, _mm_packus_epi32(_mm256_castsi256_si128(lo), _mm256_extracti128_si256(lo, 1)));
+}
+
+void bf16_to_fp32(float* dst, const uint16_t* src, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    _mm256_storeu_ps(dst + i, load_bf16(src + i));
+  }
+  for (; i < len; i++) {
+    dst[i] = ref_bf16_to_fp32(src[i]);
+  }
+}
+
+void fp32_to_bf16(uint16_t* dst, const float* src, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    store_bf16(dst + i, _mm256_loadu_ps(src + i));
+  }
+  for (; i < len; i++) {
+    dst[i] = ref_fp32_to_bf16(src[i]);
+  }
+}
+
+void add_bf16(uint16_t* inout, const uint16_t* in, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    store_bf16(inout + i, _mm256_add_ps(load_bf16(inout + i), load_bf16(in + i)));
+  }
+  for (; i < len; i++) {
+    inout[i] = ref_fp32_to_bf16(ref_bf16_to_fp32(inout[i]) + ref_bf16_to_fp32(in[i]));
+  }
+}
+
+void add_fp32(float* inout, const float* in, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 15; i += 16) {
+    auto out1 = _mm256_add_ps(_mm256_loadu_ps(inout + i), _mm256_loadu_ps(in + i));
+    auto out2 = _mm256_add_ps(_mm256_loadu_ps(inout + i + 8), _mm256_loadu_ps(in + i + 8));
+    _mm256_storeu_ps(inout + i, out1);
+    _mm256_storeu_ps(inout + i + 8, out2);
+  }
+  if (i < len - 7) {
+    _mm256_storeu_ps(inout + i, _mm256_add_ps(_mm256_loadu_ps(inout + i), _mm256_loadu_ps(in + i)));
+    i += 8;
+  }
+  if (i < len) {
+    auto mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(len - i)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    auto x1 = _mm256_maskload_ps(inout + i, mask);
+    auto x2 = _mm256_maskload_ps(in + i, mask);
+    _mm256_maskstore_ps(inout + i, mask, _mm256_add_ps(x1, x2));
+  }
+}
+
+void add_fp32_bf16(float* inout, const uint16_t* in, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    _mm256_storeu_ps(inout + i, _mm256_add_ps(_mm256_loadu_ps(inout + i), load_bf16(in + i)));
+  }
+  for (; i < len; i++) {
+    inout[i] += ref_bf16_to_fp32(in[i]);
+  }
+}
+
+void move_bf16(uint16_t* out, const uint16_t* in, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 15; i += 16) {
+    _mm256_storeu_si256((__m256i*)(out + i), _mm256_loadu_si256((const __m256i*)(in + i)));
+  }
+  for (; i < len; i++) {
+    out[i] = in[i];
+  }
+}
+
+void move_fp32(float* out, const float* in, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    _mm256_storeu_ps(out + i, _mm256_loadu_ps(in + i));
+  }
+  if (i < len) {
+    auto mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(len - i)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    _mm256_maskstore_ps(out + i, mask, _mm256_maskload_ps(in + i, mask));
+  }
+}
+
+void zero_bf16(uint16_t* out, int64_t len) {
+  int64_t i = 0;
+  auto zero = _mm256_setzero_si256();
+  for (; i < len - 15; i += 16) {
+    _mm256_storeu_si256((__m256i*)(out + i), zero);
+  }
+  for (; i < len; i++) {
+    out[i] = 0;
+  }
+}
+
+void zero_fp32(float* out, int64_t len) {
+  int64_t i = 0;
+  auto zero = _mm256_setzero_ps();
+  for (; i < len - 7; i += 8) {
+    _mm256_storeu_ps(out + i, zero);
+  }
+  if (i < len) {
+    auto mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(len - i)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    _mm256_maskstore_ps(out + i, mask, zero);
+  }
+}
+
+void packed_bf16_add(uint16_t* top, uint16_t* bot, const uint16_t* grad, int64_t len, float alpha) {
+  auto vAlpha = _mm256_set1_ps(alpha);
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    auto w = _mm256_fmadd_ps(vAlpha, load_bf16(grad + i), load_packed(top + i, bot + i));
+    store_packed(top + i, bot + i, w);
+  }
+  for (; i < len; i++) {
+    ref_packed_bf16_add(top + i, bot + i, ref_bf16_to_fp32(grad[i]), alpha);
+  }
+}
+
+void packed_bf16_add_fp32(uint16_t* top, uint16_t* bot, const float* grad, int64_t len, float alpha) {
+  auto vAlpha = _mm256_set1_ps(alpha);
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    auto w = _mm256_fmadd_ps(vAlpha, _mm256_loadu_ps(grad + i), load_packed(top + i, bot + i));
+    store_packed(top + i, bot + i, w);
+  }
+  for (; i < len; i++) {
+    ref_packed_bf16_add(top + i, bot + i, grad[i], alpha);
+  }
+}
+
+void madd_fp32(float* inout, const float* in, int64_t len, float alpha) {
+  auto vAlpha = _mm256_set1_ps(alpha);
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    _mm256_storeu_ps(inout + i, _mm256_fmadd_ps(vAlpha, _mm256_loadu_ps(in + i), _mm256_loadu_ps(inout + i)));
+  }
+  for (; i < len; i++) {
+    inout[i] = std::fma(alpha, in[i], inout[i]);
+  }
+}
+
+void madd_fp32_bf16(float* inout, const uint16_t* in, int64_t len, float alpha) {
+  auto vAlpha = _mm256_set1_ps(alpha);
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    _mm256_storeu_ps(inout + i, _mm256_fmadd_ps(vAlpha, load_bf16(in + i), _mm256_loadu_ps(inout + i)));
+  }
+  for (; i < len; i++) {
+    inout[i] = std::fma(alpha, ref_bf16_to_fp32(in[i]), inout[i]);
+  }
+}
+
+inline void max_update_8(float* inout, int64_t* inout_idx, __m256 x, __m256i idx) {
+  auto gt = _mm256_castps_si256(_mm256_cmp_ps(x, _mm256_loadu_ps(inout), _CMP_GT_OQ));
+  _mm256_maskstore_ps(inout, gt, x);
+  _mm256_maskstore_epi64((long long*)inout_idx, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(gt)), idx);
+  _mm256_maskstore_epi64((long long*)(inout_idx + 4), _mm256_cvtepi32_epi64(_mm256_extracti128_si256(gt, 1)), idx);
+}
+
+void max_fp32(float* inout, int64_t* inout_idx, const float* in, int64_t in_idx, int64_t len) {
+  auto vIdx = _mm256_set1_epi64x(in_idx);
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    max_update_8(inout + i, inout_idx + i, _mm256_loadu_ps(in + i), vIdx);
+  }
+  for (; i < len; i++) {
+    ref_max_update(inout + i, inout_idx + i, in[i], in_idx);
+  }
+}
+
+void max_fp32_bf16(float* inout, int64_t* inout_idx, const uint16_t* in, int64_t in_idx, int64_t len) {
+  auto vIdx = _mm256_set1_epi64x(in_idx);
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    max_update_8(inout + i, inout_idx + i, load_bf16(in + i), vIdx);
+  }
+  for (; i < len; i++) {
+    ref_max_update(inout + i, inout_idx + i, ref_bf16_to_fp32(in[i]), in_idx);
+  }
+}
+
+float dot_fp32(const float* a, const float* b, int64_t len) {
+  auto acc = _mm256_setzero_ps();
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc);
+  }
+  float sum = reduce_add(acc);
+  for (; i < len; i++) {
+    sum = std::fma(a[i], b[i], sum);
+  }
+  return sum;
+}
+
+float dot_bf16(const uint16_t* a, const uint16_t* b, int64_t len) {
+  auto acc = _mm256_setzero_ps();
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    acc = _mm256_fmadd_ps(load_bf16(a + i), load_bf16(b + i), acc);
+  }
+  float sum = reduce_add(acc);
+  for (; i < len; i++) {
+    sum = std::fma(ref_bf16_to_fp32(a[i]), ref_bf16_to_fp32(b[i]), sum);
+  }
+  return sum;
+}
+
+void dequant_add_u8(float* inout, const uint8_t* in, int64_t len, float scale, float bias) {
+  auto vScale = _mm256_set1_ps(scale);
+  auto vBias = _mm256_set1_ps(bias);
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    auto q = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + i))));
+    auto out = _mm256_add_ps(_mm256_loadu_ps(inout + i), vBias);
+    _mm256_storeu_ps(inout + i, _mm256_fmadd_ps(vScale, q, out));
+  }
+  for (; i < len; i++) {
+    inout[i] = std::fma(scale, static_cast<float>(in[i]), inout[i] + bias);
+  }
+}
+
+void dequant_add_u4(float* inout, const uint8_t* in, int64_t len, float scale, float bias) {
+  auto vScale = _mm256_set1_ps(scale);
+  auto vBias = _mm256_set1_ps(bias);
+  int64_t i = 0;
+  for (; i < len - 7; i += 8) {
+    auto out = _mm256_add_ps(_mm256_loadu_ps(inout + i), vBias);
+    _mm256_storeu_ps(inout + i, _mm256_fmadd_ps(vScale, unpack_4bit(in + i / 2), out));
+  }
+  for (; i < len; i++) {
+    inout[i] = std::fma(scale, ref_unpack_4bit(in, i), inout[i] + bias);
+  }
+}
+
+}  // namespace
+
+namespace detail {
+
+const VecKernels* vec_kernels_avx2() {
+  static const VecKernels kernels = {
+      VecISA::AVX2, "avx2",
+      bf16_to_fp32, fp32_to_bf16,
+      add_bf16, add_fp32, add_fp32_bf16,
+      move_bf16, move_fp32, zero_bf16, zero_fp32,
+      packed_bf16_add, packed_bf16_add_fp32,
+      madd_fp32, madd_fp32_bf16, max_fp32, max_fp32_bf16,
+      dot_fp32, dot_bf16, dequant_add_u8, dequant_add_u4,
+  };
+  return &kernels;
+}
+
+}  // namespace detail
+
+}  // namespace vec
+}  // namespace bf16
+}  // namespace cpu
+}  // namespace torch_ipex
+
+#else
+
+namespace torch_ipex {
+namespace cpu {
+namespace bf16 {
+namespace vec {
+namespace detail {
+
+const VecKernels* vec_kernels_avx2() { return nullptr; }
+
+}  // namespace detail
+}  // namespace vec
+}  // namespace bf16
+}  // namespace cpu
+}  // namespace torch_ipex
+
+#endif
@@ -0,0 +1,43 @@
+// AVX512F/BW/VL kernels, built without -mavx512bf16 so that they run on
+// every AVX512 host (see cmake/CPU.cmake).
+
+#include "vec_kernel_dispatch.h"
+
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VL__) && !defined(__AVX512BF16__)
+
+#include "vec_kernel_avx512.h"
+
+namespace torch_ipex {
+namespace cpu {
+namespace bf16 {
+namespace vec {
+namespace detail {
+
+const VecKernels* vec_kernels_avx512() {
+  static const VecKernels kernels = IPEX_AVX512_VEC_KERNELS(VecISA::AVX512, "avx512");
+  return &kernels;
+}
+
+}  // namespace detail
+}  // namespace vec
+}  // namespace bf16
+}  // namespace cpu
+}  // namespace torch_ipex
+
+#else
+
+namespace torch_ipex {
+namespace cpu {
+namespace bf16 {
+namespace vec {
+namespace detail {
+
+const VecKernels* vec_kernels_avx512() { return nullptr; }
+
+}  // namespace detail
+}  // namespace vec
+}  // namespace bf16
+}  // namespace cpu
+}  // namespace torch_ipex
+
+#endif
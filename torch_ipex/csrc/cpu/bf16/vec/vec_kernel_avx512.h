@@ -0,0 +1,317 @@
+#pragma once
+
+// AVX512F/BW/VL kernels, 16 fp32 lanes with masked tails. Included by the
+// AVX512 and the AVX512-BF16 translation units only: the latter is built
+// with -mavx512bf16 and converts fp32 to bf16 with vcvtne2ps2bf16 /
+// vcvtneps2bf16, the former emulates the same rounding with integer ops.
+
+#include <immintrin.h>
+#include "vec_kernel_dispatch.h"
+
+namespace torch_ipex {
+namespace cpu {
+namespace bf16 {
+namespace vec {
+namespace {
+
+inline __mmask16 tail_mask16(int64_t n) {
+  return static_cast<__mmask16>((1u << n) - 1);
+}
+
+inline __mmask32 tail_mask32(int64_t n) {
+  return n >= 32 ? static_cast<__mmask32>(0xffffffffu) : static_cast<__mmask32>((1u << n) - 1);
+}
+
+inline __m512 cvt_bf16_to_fp32(__m256i src) {
+  return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(src), 16));
+}
+
+inline __m256i cvt_fp32_to_bf16(__m512 src) {
+#if defined(__AVX512BF16__)
+  return (__m256i)_mm512_cvtneps_pbh(src);
+#else
+  auto x = _mm512_castps_si512(src);
+  auto hi = _mm512_srli_epi32(x, 16);
+  auto bias = _mm512_add_epi32(_mm512_and_si512(hi, _mm512_set1_epi32(1)), _mm512_set1_epi32(0x7fff));
+  auto y = _mm512_srli_epi32(_mm512_add_epi32(x, bias), 16);
+  auto nan = _mm512_cmp_ps_mask(src, src, _CMP_UNORD_Q);
+  y = _mm512_mask_blend_epi32(nan, y, _mm512_or_si512(hi, _mm512_set1_epi32(0x40)));
+  return _mm512_cvtepi32_epi16(y);
+#endif
+}
+
+// 32 conversions at once, lo goes to the lower half of the result
+inline __m512i cvt2_fp32_to_bf16(__m512 lo, __m512 hi) {
+#if defined(__AVX512BF16__)
+  return (__m512i)_mm512_cvtne2ps_pbh(hi, lo);
+#else
+  return _mm512_inserti64x4(_mm512_castsi256_si512(cvt_fp32_to_bf16(lo)), cvt_fp32_to_bf16(hi), 1);
+#endif
+}
+
+inline __m512 load_packed(const uint16_t* top, const uint16_t* bot, __mmask16 mask) {
+  auto x1 = _mm512_cvtepu16_epi32(_mm256_maskz_loadu_epi16(mask, top));
+  auto x2 = _mm512_cvtepu16_epi32(_mm256_maskz_loadu_epi16(mask, bot));
+  return _mm512_castsi512_ps(_mm512_or_si512(_mm512_slli_epi32(x1, 16), x2));
+}
+
+inline void store_packed(uint16_t* top, uint16_t* bot, __m512 src, __mmask16 mask) {
+  auto x = _mm512_castps_si512(src);
+  _mm256_mask_storeu_epi16(top, mask, _mm512_cvtepi32_epi16(_mm512_srli_epi32(x, 16)));
+  _mm256_mask_storeu_epi16(bot, mask, _mm512_cvtepi32_epi16(x));
+}
+
+void bf16_to_fp32(float* dst, const uint16_t* src, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 15; i += 16) {
+    _mm512_storeu_ps(dst + i, cvt_bf16_to_fp32(_mm256_loadu_si256((const __m256i*)(src + i))));
+  }
+  if (i < len) {
+    auto mask = tail_mask16(len - i);
+    _mm512_mask_storeu_ps(dst + i, mask, cvt_bf16_to_fp32(_mm256_maskz_loadu_epi16(mask, src + i)));
+  }
+}
+
+void fp32_to_bf16(uint16_t* dst, const float* src, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 31; i += 32) {
+    auto y = cvt2_fp32_to_bf16(_mm512_loadu_ps(src + i), _mm512_loadu_ps(src + i + 16));
+    _mm512_storeu_si512(dst + i, y);
+  }
+  if (i < len - 15) {
+    _mm256_storeu_si256((__m256i*)(dst + i), cvt_fp32_to_bf16(_mm512_loadu_ps(src + i)));
+    i += 16;
+  }
+  if (i < len) {
+    auto mask = tail_mask16(len - i);
+    _mm256_mask_storeu_epi16(dst + i, mask, cvt_fp32_to_bf16(_mm512_maskz_loadu_ps(mask, src + i)));
+  }
+}
+
+void add_bf16(uint16_t* inout, const uint16_t* in, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 31; i += 32) {
+    auto x1 = _mm512_add_ps(cvt_bf16_to_fp32(_mm256_loadu_si256((const __m256i*)(inout + i))),
+                            cvt_bf16_to_fp32(_mm256_loadu_si256((const __m256i*)(in + i))));
+    auto x2 = _mm512_add_ps(cvt_bf16_to_fp32(_mm256_loadu_si256((const __m256i*)(inout + i + 16))),
+                            cvt_bf16_to_fp32(_mm256_loadu_si256((const __m256i*)(in + i + 16))));
+    _mm512_storeu_si512(inout + i, cvt2_fp32_to_bf16(x1, x2));
+  }
+  for (; i < len; i += 16) {
+    auto mask = tail_mask16(len - i < 16 ? len - i : 16);
+    auto x = _mm512_add_ps(cvt_bf16_to_fp32(_mm256_maskz_loadu_epi16(mask, inout + i)),
+                           cvt_bf16_to_fp32(_mm256_maskz_loadu_epi16(mask, in + i)));
+    _mm256_mask_storeu_epi16(inout + i, mask, cvt_fp32_to_bf16(x));
+  }
+}
+
+void add_fp32(float* inout, const float* in, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 31; i += 32) {
+    auto out1 = _mm512_add_ps(_mm512_loadu_ps(inout + i), _mm512_loadu_ps(in + i));
+    auto out2 = _mm512_add_ps(_mm512_loadu_ps(inout + i + 16), _mm512_loadu_ps(in + i + 16));
+    _mm512_storeu_ps(inout + i, out1);
+    _mm512_storeu_ps(inout + i + 16, out2);
+  }
+  for (; i < len; i += 16) {
+    auto mask = tail_mask16(len - i < 16 ? len - i : 16);
+    auto x = _mm512_add_ps(_mm512_maskz_loadu_ps(mask, inout + i), _mm512_maskz_loadu_ps(mask, in + i));
+    _mm512_mask_storeu_ps(inout + i, mask, x);
+  }
+}
+
+void add_fp32_bf16(float* inout, const uint16_t* in, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 15; i += 16) {
+    auto x = _mm512_add_ps(_mm512_loadu_ps(inout + i),
+                           cvt_bf16_to_fp32(_mm256_loadu_si256((const __m256i*)(in + i))));
+    _mm512_storeu_ps(inout + i, x);
+  }
+  if (i < len) {
+    auto mask = tail_mask16(len - i);
+    auto x = _mm512_add_ps(_mm512_maskz_loadu_ps(mask, inout + i),
+                           cvt_bf16_to_fp32(_mm256_maskz_loadu_epi16(mask, in + i)));
+    _mm512_mask_storeu_ps(inout + i, mask, x);
+  }
+}
+
+void move_bf16(uint16_t* out, const uint16_t* in, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 31; i += 32) {
+    _mm512_storeu_si512(out + i, _mm512_loadu_si512(in + i));
+  }
+  if (i < len) {
+    auto mask = tail_mask32(len - i);
+    _mm512_mask_storeu_epi16(out + i, mask, _mm512_maskz_loadu_epi16(mask, in + i));
+  }
+}
+
+void move_fp32(float* out, const float* in, int64_t len) {
+  int64_t i = 0;
+  for (; i < len - 15; i += 16) {
+    _mm512_storeu_ps(out + i, _mm512_loadu_ps(in + i));
+  }
+  if (i < len) {
+    auto mask = tail_mask16(len - i);
+    _mm512_mask_storeu_ps(out + i, mask, _mm512_maskz_loadu_ps(mask, in + i));
+  }
+}
+
+void zero_bf16(uint16_t* out, int64_t len) {
+  int64_t i = 0;
+  auto zero = _mm512_setzero_si512();
+  for (; i < len - 31; i += 32) {
+    _mm512_storeu_si512(out + i, zero);
+  }
+  if (i < len) {
+    _mm512_mask_storeu_epi16(out + i, tail_mask32(len - i), zero);
+  }
+}
+
+void zero_fp32(float* out, int64_t len) {
+  int64_t i = 0;
+  auto zero = _mm512_setzero_ps();
+  for (; i < len - 15; i += 16) {
+    _mm512_storeu_ps(out + i, zero);
+  }
+  if (i < len) {
+    _mm512_mask_storeu_ps(out + i, tail_mask16(len - i), zero);
+  }
+}
+
+void packed_bf16_add(uint16_t* top, uint16_t* bot, const uint16_t* grad, int64_t len, float alpha) {
+  auto vAlpha = _mm512_set1_ps(alpha);
+  for (int64_t i = 0; i < len; i += 16) {
+    auto mask = tail_mask16(len - i < 16 ? len - i : 16);
+    auto g = cvt_bf16_to_fp32(_mm256_maskz_loadu_epi16(mask, grad + i));
+    auto w = _mm512_fmadd_ps(vAlpha, g, load_packed(top + i, bot + i, mask));
+    store_packed(top + i, bot + i, w, mask);
+  }
+}
+
+void packed_bf16_add_fp32(uint16_t* top, uint16_t* bot, const float* grad, int64_t len, float alpha) {
+  auto vAlpha = _mm512_set1_ps(alpha);
+  for (int64_t i = 0; i < len; i += 16) {
+    auto mask = tail_mask16(len - i < 16 ? len - i : 16);
+    auto g = _mm512_maskz_loadu_ps(mask, grad + i);
+    auto w = _mm512_fmadd_ps(vAlpha, g, load_packed(top + i, bot + i, mask));
+    store_packed(top + i, bot + i, w, mask);
+  }
+}
+
+void madd_fp32(float* inout, const float* in, int64_t len, float alpha) {
+  auto vAlpha = _mm512_set1_ps(alpha);
+  int64_t i = 0;
+  for (; i < len - 31; i += 32) {
+    auto out1 = _mm512_fmadd_ps(vAlpha, _mm512_loadu_ps(in + i), _mm512_loadu_ps(inout + i));
+    auto out2 = _mm512_fmadd_ps(vAlpha, _mm512_loadu_ps(in + i + 16), _mm512_loadu_ps(inout + i + 16));
+    _mm512_storeu_ps(inout + i, out1);
+    _mm512_storeu_ps(inout + i + 16, out2);
+  }
+  for (; i < len; i += 16) {
+    auto mask = tail_mask16(len - i < 16 ? len - i : 16);
+    auto x = _mm512_fmadd_ps(vAlpha, _mm512_maskz_loadu_ps(mask, in + i), _mm512_maskz_loadu_ps(mask, inout + i));
+    _mm512_mask_storeu_ps(inout + i, mask, x);
+  }
+}
+
+void madd_fp32_bf16(float* inout, const uint16_t* in, int64_t len, float alpha) {
+  auto vAlpha = _mm512_set1_ps(alpha);
+  for (int64_t i = 0; i < len; i += 16) {
+    auto mask = tail_mask16(len - i < 16 ? len - i : 16);
+    auto x = cvt_bf16_to_fp32(_mm256_maskz_loadu_epi16(mask, in + i));
+    _mm512_mask_storeu_ps(inout + i, mask, _mm512_fmadd_ps(vAlpha, x, _mm512_maskz_loadu_ps(mask, inout + i)));
+  }
+}
+
+inline void max_update_16(float* inout, int64_t* inout_idx, __m512 x, __m512i idx, __mmask16 mask) {
+  auto cur = _mm512_maskz_loadu_ps(mask, inout);
+  __mmask16 gt = _mm512_mask_cmp_ps_mask(mask, x, cur, _CMP_GT_OQ);
+  _mm512_mask_storeu_ps(inout, gt, x);
+  _mm512_mask_storeu_epi64(inout_idx, static_cast<__mmask8>(gt), idx);
+  _mm512_mask_storeu_epi64(inout_idx + 8, static_cast<__mmask8>(gt >> 8), idx);
+}
+
+void max_fp32(float* inout, int64_t* inout_idx, const float* in, int64_t in_idx, int64_t len) {
+  auto vIdx = _mm512_set1_epi64(in_idx);
+  for (int64_t i = 0; i < len; i += 16) {
+    auto mask = tail_mask16(len - i < 16 ? len - i : 16);
+    max_update_16(inout + i, inout_idx + i, _mm512_maskz_loadu_ps(mask, in + i), vIdx, mask);
+  }
+}
+
+void max_fp32_bf16(float* inout, int64_t* inout_idx, const uint16_t* in, int64_t in_idx, int64_t len) {
+  auto vIdx = _mm512_set1_epi64(in_idx);
+  for (int64_t i = 0; i < len; i += 16) {
+    auto mask = tail_mask16(len - i < 16 ? len - i : 16);
+    auto x = cvt_bf16_to_fp32(_mm256_maskz_loadu_epi16(mask, in + i));
+    max_update_16(inout + i, inout_idx + i, x, vIdx, mask);
+  }
+}
+
+float dot_fp32(const float* a, const float* b, int64_t len) {
+  auto acc = _mm512_setzero_ps();
+  for (int64_t i = 0; i < len; i += 16) {
+    auto mask = tail_mask16(len - i < 16 ? len - i : 16);
+    acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc);
+  }
+  return _mm512_reduce_add_ps(acc);
+}
+
+float dot_bf16(const uint16_t* a, const uint16_t* b, int64_t len) {
+  auto acc = _mm512_setzero_ps();
+  for (int64_t i = 0; i < len; i += 16) {
+    auto mask = tail_mask16(len - i < 16 ? len - i : 16);
+    auto x1 = cvt_bf16_to_fp32(_mm256_maskz_loadu_epi16(mask, a + i));
+    auto x2 = cvt_bf16_to_fp32(_mm256_maskz_loadu_epi16(mask, b + i));
+    acc = _mm512_fmadd_ps(x1, x2, acc);
+  }
+  return _mm512_reduce_add_ps(acc);
+}
+
+void dequant_add_u8(float* inout, const uint8_t* in, int64_t len, float scale, float bias) {
+  auto vScale = _mm512_set1_ps(scale);
+  auto vBias = _mm512_set1_ps(bias);
+  for (int64_t i = 0; i < len; i += 16) {
+    auto mask = tail_mask16(len - i < 16 ? len - i : 16);
+    auto q = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_maskz_loadu_epi8(mask, in + i)));
+    auto out = _mm512_add_ps(_mm512_maskz_loadu_ps(mask, inout + i), vBias);
+    _mm512_mask_storeu_ps(inout + i, mask, _mm512_fmadd_ps(vScale, q, out));
+  }
+}
+
+inline __m512 unpack_4bit_to_fp32(__m128i bytes) {
+  auto nibble_mask = _mm_set1_epi8(0x0f);
+  auto lo = _mm_and_si128(bytes, nibble_mask);
+  auto hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble_mask);
+  return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_unpacklo_epi8(lo, hi)));
+}
+
+void dequant_add_u4(float* inout, const uint8_t* in, int64_t len, float scale, float bias) {
+  auto vScale = _mm512_set1_ps(scale);
+  auto vBias = _mm512_set1_ps(bias);
+  for (int64_t i = 0; i < len; i += 16) {
+    int64_t n = len - i < 16 ? len - i : 16;
+    auto mask = tail_mask16(n);
+    auto q = unpack_4bit_to_fp32(_mm_maskz_loadu_epi8(tail_mask16(n / 2), in + i / 2));
+    auto out = _mm512_add_ps(_mm512_maskz_loadu_ps(mask, inout + i), vBias);
+    _mm512_mask_storeu_ps(inout + i, mask, _mm512_fmadd_ps(vScale, q, out));
+  }
+}
+
+}  // namespace
+}  // namespace vec
+}  // namespace bf16
+}  // namespace cpu
+}  // namespace torch_ipex
+
+#define IPEX_AVX512_VEC_KERNELS(ISA, NAME)              \
+  {                                                     \
+    ISA, NAME,                                          \
+    bf16_to_fp32, fp32_to_bf16,                         \
+    add_bf16, add_fp32, add_fp32_bf16,                  \
+    move_bf16, move_fp32, zero_bf16, zero_fp32,         \
+    packed_bf16_add, packed_bf16_add_fp32,              \
+    madd_fp32, madd_fp32_bf16, max_fp32, max_fp32_bf16, \
+    dot_fp32, dot_bf16, dequant_add_u8, dequant_add_u4, \
+  }
@@ -0,0 +1,43 @@
+// AVX512 kernels with native fp32 -> bf16 conversions, only built when the
+// compiler knows -mavx512bf16.
+
+#include "vec_kernel_dispatch.h"
+
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VL__) && defined(__AVX512BF16__)
+
+#include "vec_kernel_avx512.h"
+
+namespace torch_ipex {
+namespace cpu {
+namespace bf16 {
+namespace vec {
+namespace detail {
+
+const VecKernels* vec_kernels_avx512_bf16() {
+  static const VecKernels kernels = IPEX_AVX512_VEC_KERNELS(VecISA::AVX512_BF16, "avx512_bf16");
+  return &kernels;
+}
+
+}  // namespace detail
+}  // namespace vec
+}  // namespace bf16
+}  // namespace cpu
+}  // namespace torch_ipex
+
+#else
+
+namespace torch_ipex {
+namespace cpu {
+namespace bf16 {
+namespace vec {
+namespace detail {
+
+const VecKernels* vec_kernels_avx512_bf16() { return nullptr; }
+
+}  // namespace detail
+}  // namespace vec
+}  // namespace bf16
+}  // namespace cpu
+}  // namespace torch_ipex
+
+#endif
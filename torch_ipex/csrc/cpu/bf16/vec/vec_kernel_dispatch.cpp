@@ -0,0 +1,160 @@
+#include "vec_kernel_dispatch.h"
+
+#include <cpuid.h>
+
+#include <cstdlib>
+#include <cstring>
+
+namespace torch_ipex {
+namespace cpu {
+namespace bf16 {
+namespace vec {
+namespace {
+
+struct CPUFeatures {
+  bool avx2 = false;
+  bool avx512 = false;
+  bool avx512_bf16 = false;
+};
+
+uint64_t read_xcr0() {
+  uint32_t eax, edx;
+  __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<uint64_t>(edx) << 32) | eax;
+}
+
+// An instruction set is only usable when the CPU has it and the OS saves the
+// matching register state, which is what XCR0 tells.
+CPUFeatures detect_cpu_features() {
+  CPUFeatures features;
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid_max(0, nullptr) < 7) {
+    return features;
+  }
+
+  __cpuid_count(1, 0, eax, ebx, ecx, edx);
+  bool fma = ecx & (1u << 12);
+  bool osxsave = ecx & (1u << 27);
+  bool f16c = ecx & (1u << 29);
+  if (!osxsave) {
+    return features;
+  }
+  uint64_t xcr0 = read_xcr0();
+  bool ymm_state = (xcr0 & 0x6) == 0x6;
+  bool zmm_state = (xcr0 & 0xe6) == 0xe6;
+
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  unsigned int max_subleaf = eax;
+  features.avx2 = ymm_state && fma && f16c && (ebx & (1u << 5));
+  features.avx512 = features.avx2 && zmm_state && (ebx & (1u << 16)) &&
+                    (ebx & (1u << 30)) && (ebx & (1u << 31));
+  if (features.avx512 && max_subleaf >= 1) {
+    __cpuid_count(7, 1, eax, ebx, ecx, edx);
+    features.avx512_bf16 = eax & (1u << 5);
+  }
+  return features;
+}
+
+const CPUFeatures& cpu_features() {
+  static const CPUFeatures features = detect_cpu_features();
+  return features;
+}
+
+bool host_supports(VecISA isa) {
+  auto& features = cpu_features();
+  switch (isa) {
+    case VecISA::SCALAR:
+      return true;
+    case VecISA::AVX2:
+      return features.avx2;
+    case VecISA::AVX512:
+      return features.avx512;
+    case VecISA::AVX512_BF16:
+      return features.avx512_bf16;
+  }
+  return false;
+}
+
+const VecKernels* built_kernels(VecISA isa) {
+  switch (isa) {
+    case VecISA::SCALAR:
+      return detail::vec_kernels_scalar();
+    case VecISA::AVX2:
+      return detail::vec_kernels_avx2();
+    case VecISA::AVX512:
+      return detail::vec_kernels_avx512();
+    case VecISA::AVX512_BF16:
+      return detail::vec_kernels_avx512_bf16();
+  }
+  return nullptr;
+}
+
+constexpr VecISA all_isas[] = {VecISA::SCALAR, VecISA::AVX2, VecISA::AVX512, VecISA::AVX512_BF16};
+static_assert(sizeof(all_isas) / sizeof(all_isas[0]) == kNumVecISAs, "kNumVecISAs is out of date");
+
+// Strongest ISA allowed by IPEX_VEC_ISA, unknown values are ignored.
+VecISA max_isa_from_env() {
+  const char* env = std::getenv("IPEX_VEC_ISA");
+  if (env != nullptr) {
+    for (auto isa : all_isas) {
+      if (std::strcmp(env, vec_isa_name(isa)) == 0) {
+        return isa;
+      }
+    }
+  }
+  return VecISA::AVX512_BF16;
+}
+
+const VecKernels* select_kernels() {
+  auto max_isa = max_isa_from_env();
+  const VecKernels* selected = detail::vec_kernels_scalar();
+  for (auto isa : all_isas) {
+    if (static_cast<int>(isa) > static_cast<int>(max_isa)) {
+      break;
+    }
+    if (auto kernels = get_vec_kernels(isa)) {
+      selected = kernels;
+    }
+  }
+  return selected;
+}
+
+}  // namespace
+
+const VecKernels& get_vec_kernels() {
+  static const VecKernels* kernels = select_kernels();
+  return *kernels;
+}
+
+const VecKernels* get_vec_kernels(VecISA isa) {
+  return host_supports(isa) ? built_kernels(isa) : nullptr;
+}
+
+int get_supported_vec_isas(VecISA* isas) {
+  int n = 0;
+  for (auto isa : all_isas) {
+    if (get_vec_kernels(isa) != nullptr) {
+      isas[n++] = isa;
+    }
+  }
+  return n;
+}
+
+const char* vec_isa_name(VecISA isa) {
+  switch (isa) {
+    case VecISA::SCALAR:
+      return "scalar";
+    case VecISA::AVX2:
+      return "avx2";
+    case VecISA::AVX512:
+      return "avx512";
+    case VecISA::AVX512_BF16:
+      return "avx512_bf16";
+  }
+  return "unknown";
+}
+
+}  // namespace vec
+}  // namespace bf16
+}  // namespace cpu
+}  // namespace torch_ipex
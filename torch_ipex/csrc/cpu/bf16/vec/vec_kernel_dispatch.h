@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+
+namespace torch_ipex {
+namespace cpu {
+namespace bf16 {
+namespace vec {
+
+// Instruction sets the bf16 kernels below are built for, from the weakest
+// to the strongest one.
+enum class VecISA : int {
+  SCALAR = 0,
+  AVX2,
+  AVX512,
+  AVX512_BF16,
+};
+
+constexpr int kNumVecISAs = 4;
+
+// Table of the bf16 vector kernels built for one ISA. Every variant lives in
+// its own translation unit compiled with the matching target flags, and only
+// sees raw uint16_t bf16 values so that no inline ATen code gets emitted with
+// those flags.
+//
+// fp32 -> bf16 conversions round to nearest even and turn NaN into a quiet
+// NaN, like vcvtneps2bf16. The AVX512-BF16 variant uses that instruction,
+// which also flushes fp32 denormals to zero.
+struct VecKernels {
+  VecISA isa;
+  const char* name;
+
+  void (*bf16_to_fp32)(float* dst, const uint16_t* src, int64_t len);
+  void (*fp32_to_bf16)(uint16_t* dst, const float* src, int64_t len);
+
+  // inout += in
+  void (*add_bf16)(uint16_t* inout, const uint16_t* in, int64_t len);
+  void (*add_fp32)(float* inout, const float* in, int64_t len);
+  void (*add_fp32_bf16)(float* inout, const uint16_t* in, int64_t len);
+
+  void (*move_bf16)(uint16_t* out, const uint16_t* in, int64_t len);
+  void (*move_fp32)(float* out, const float* in, int64_t len);
+  void (*zero_bf16)(uint16_t* out, int64_t len);
+  void (*zero_fp32)(float* out, int64_t len);
+
+  // The fp32 master weight is split into its high (top) and low (bottom)
+  // 16 bits, top being the bf16 weight itself. weight += alpha * grad is
+  // done with a single fma in fp32 and split back.
+  void (*packed_bf16_add)(uint16_t* top, uint16_t* bot, const uint16_t* grad,
+                          int64_t len, float alpha);
+  void (*packed_bf16_add_fp32)(uint16_t* top, uint16_t* bot, const float* grad,
+                               int64_t len, float alpha);
+
+  // inout += alpha * in, with a single fma per element
+  void (*madd_fp32)(float* inout, const float* in, int64_t len, float alpha);
+  void (*madd_fp32_bf16)(float* inout, const uint16_t* in, int64_t len, float alpha);
+
+  // Element-wise running max with argmax: the elements of in strictly greater
+  // than inout replace them and set their index to in_idx. Ties keep the first
+  // occurrence and NaN is never selected, like the ATen kernel.
+  void (*max_fp32)(float* inout, int64_t* inout_idx, const float* in,
+                   int64_t in_idx, int64_t len);
+  void (*max_fp32_bf16)(float* inout, int64_t* inout_idx, const uint16_t* in,
+                        int64_t in_idx, int64_t len);
+
+  float (*dot_fp32)(const float* a, const float* b, int64_t len);
+  float (*dot_bf16)(const uint16_t* a, const uint16_t* b, int64_t len);
+
+  // Row-wise quantized rows: inout += scale * q + bias. In the 4-bit rows
+  // element 2k is the low nibble of byte k and 2k + 1 the high one, and len
+  // must be even.
+  void (*dequant_add_u8)(float* inout, const uint8_t* in, int64_t len,
+                         float scale, float bias);
+  void (*dequant_add_u4)(float* inout, const uint8_t* in, int64_t len,
+                         float scale, float bias);
+};
+
+// Kernels of the strongest ISA both built and supported by the host. The
+// choice is made once, on first use, from CPUID. IPEX_VEC_ISA=scalar|avx2|
+// avx512|avx512_bf16 caps it, e.g. to compare variants on the same host.
+const VecKernels& get_vec_kernels();
+
+// Kernels of the given ISA, or nullptr if they were not built or the host
+// cannot run them.
+const VecKernels* get_vec_kernels(VecISA isa);
+
+// Writes every ISA get_vec_kernels(isa) is able to serve on this host to
+// isas, which has room for kNumVecISAs, and returns their number. The header
+// is included by the kernel translation units built with -mno-avx and such,
+// it stays free of standard containers whose inline code they would emit.
+int get_supported_vec_isas(VecISA* isas);
+
+const char* vec_isa_name(VecISA isa);
+
+namespace detail {
+
+// Per-ISA tables, nullptr when the compiler could not build the variant.
+const VecKernels* vec_kernels_scalar();
+const VecKernels* vec_kernels_avx2();
+const VecKernels* vec_kernels_avx512();
+const VecKernels* vec_kernels_avx512_bf16();
+
+}  // namespace detail
+
+}  // namespace vec
+}  // namespace bf16
+}  // namespace cpu
+}  // namespace torch_ipex
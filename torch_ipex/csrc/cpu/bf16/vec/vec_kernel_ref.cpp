@@ -0,0 +1,145 @@
+// Scalar reference kernels. Built without AVX (see cmake/CPU.cmake) so they
+// run on any x86-64 host, and used as the ground truth of the other variants.
+
+#include "vec_kernel_dispatch.h"
+#include "vec_kernel_ref.h"
+
+namespace torch_ipex {
+namespace cpu {
+namespace bf16 {
+namespace vec {
+namespace {
+
+void bf16_to_fp32(float* dst, const uint16_t* src, int64_t len) {
+  for (int64_t i = 0; i < len; i++) {
+    dst[i] = ref_bf16_to_fp32(src[i]);
+  }
+}
+
+void fp32_to_bf16(uint16_t* dst, const float* src, int64_t len) {
+  for (int64_t i = 0; i < len; i++) {
+    dst[i] = ref_fp32_to_bf16(src[i]);
+  }
+}
+
+void add_bf16(uint16_t* inout, const uint16_t* in, int64_t len) {
+  for (int64_t i = 0; i < len; i++) {
+    inout[i] = ref_fp32_to_bf16(ref_bf16_to_fp32(inout[i]) + ref_bf16_to_fp32(in[i]));
+  }
+}
+
+void add_fp32(float* inout, const float* in, int64_t len) {
+  for (int64_t i = 0; i < len; i++) {
+    inout[i] += in[i];
+  }
+}
+
+void add_fp32_bf16(float* inout, const uint16_t* in, int64_t len) {
+  for (int64_t i = 0; i < len; i++) {
+    inout[i] += ref_bf16_to_fp32(in[i]);
+  }
+}
+
+void move_bf16(uint16_t* out, const uint16_t* in, int64_t len) {
+  std::memcpy(out, in, len * sizeof(uint16_t));
+}
+
+void move_fp32(float* out, const float* in, int64_t len) {
+  std::memcpy(out, in, len * sizeof(float));
+}
+
+void zero_bf16(uint16_t* out, int64_t len) {
+  std::memset(out, 0, len * sizeof(uint16_t));
+}
+
+void zero_fp32(float* out, int64_t len) {
+  std::memset(out, 0, len * sizeof(float));
+}
+
+void packed_bf16_add(uint16_t* top, uint16_t* bot, const uint16_t* grad, int64_t len, float alpha) {
+  for (int64_t i = 0; i < len; i++) {
+    ref_packed_bf16_add(top + i, bot + i, ref_bf16_to_fp32(grad[i]), alpha);
+  }
+}
+
+void packed_bf16_add_fp32(uint16_t* top, uint16_t* bot, const float* grad, int64_t len, float alpha) {
+  for (int64_t i = 0; i < len; i++) {
+    ref_packed_bf16_add(top + i, bot + i, grad[i], alpha);
+  }
+}
+
+void madd_fp32(float* inout, const float* in, int64_t len, float alpha) {
+  for (int64_t i = 0; i < len; i++) {
+    inout[i] = std::fma(alpha, in[i], inout[i]);
+  }
+}
+
+void madd_fp32_bf16(float* inout, const uint16_t* in, int64_t len, float alpha) {
+  for (int64_t i = 0; i < len; i++) {
+    inout[i] = std::fma(alpha, ref_bf16_to_fp32(in[i]), inout[i]);
+  }
+}
+
+void max_fp32(float* inout, int64_t* inout_idx, const float* in, int64_t in_idx, int64_t len) {
+  for (int64_t i = 0; i < len; i++) {
+    ref_max_update(inout + i, inout_idx + i, in[i], in_idx);
+  }
+}
+
+void max_fp32_bf16(float* inout, int64_t* inout_idx, const uint16_t* in, int64_t in_idx, int64_t len) {
+  for (int64_t i = 0; i < len; i++) {
+    ref_max_update(inout + i, inout_idx + i, ref_bf16_to_fp32(in[i]), in_idx);
+  }
+}
+
+float dot_fp32(const float* a, const float* b, int64_t len) {
+  float acc = 0.f;
+  for (int64_t i = 0; i < len; i++) {
+    acc = std::fma(a[i], b[i], acc);
+  }
+  return acc;
+}
+
+float dot_bf16(const uint16_t* a, const uint16_t* b, int64_t len) {
+  float acc = 0.f;
+  for (int64_t i = 0; i < len; i++) {
+    acc = std::fma(ref_bf16_to_fp32(a[i]), ref_bf16_to_fp32(b[i]), acc);
+  }
+  return acc;
+}
+
+void dequant_add_u8(float* inout, const uint8_t* in, int64_t len, float scale, float bias) {
+  for (int64_t i = 0; i < len; i++) {
+    inout[i] = std::fma(scale, static_cast<float>(in[i]), inout[i] + bias);
+  }
+}
+
+void dequant_add_u4(float* inout, const uint8_t* in, int64_t len, float scale, float bias) {
+  for (int64_t i = 0; i < len; i++) {
+    inout[i] = std::fma(scale, ref_unpack_4bit(in, i), inout[i] + bias);
+  }
+}
+
+}  // namespace
+
+namespace detail {
+
+const VecKernels* vec_kernels_scalar() {
+  static const VecKernels kernels = {
+      VecISA::SCALAR, "scalar",
+      bf16_to_fp32, fp32_to_bf16,
+      add_bf16, add_fp32, add_fp32_bf16,
+      move_bf16, move_fp32, zero_bf16, zero_fp32,
+      packed_bf16_add, packed_bf16_add_fp32,
+      madd_fp32, madd_fp32_bf16, max_fp32, max_fp32_bf16,
+      dot_fp32, dot_bf16, dequant_add_u8, dequant_add_u4,
+  };
+  return &kernels;
+}
+
+}  // namespace detail
+
+}  // namespace vec
+}  // namespace bf16
+}  // namespace cpu
+}  // namespace torch_ipex
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Scalar bf16 helpers shared by the per-ISA kernel translation units, for
+// the reference kernels and the tails of the vector loops. Everything here
+// has internal linkage, each translation unit gets its own copy built with
+// its own target flags.
+
+namespace torch_ipex {
+namespace cpu {
+namespace bf16 {
+namespace vec {
+namespace {
+
+inline uint32_t fp32_bits(float f) {
+  uint32_t bits;
+  std::memcpy(&bits, &f, sizeof(bits));
+  return bits;
+}
+
+inline float bits_fp32(uint32_t bits) {
+  float f;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+inline float ref_bf16_to_fp32(uint16_t x) {
+  return bits_fp32(static_cast<uint32_t>(x) << 16);
+}
+
+// Round to nearest even, NaN becomes a quiet NaN keeping sign and payload.
+inline uint16_t ref_fp32_to_bf16(float f) {
+  uint32_t bits = fp32_bits(f);
+  if ((bits & 0x7fffffffu) > 0x7f800000u) {
+    return static_cast<uint16_t>((bits >> 16) | 0x0040u);
+  }
+  bits += 0x7fffu + ((bits >> 16) & 1u);
+  return static_cast<uint16_t>(bits >> 16);
+}
+
+inline void ref_packed_bf16_add(uint16_t* top, uint16_t* bot, float grad, float alpha) {
+  float w = bits_fp32((static_cast<uint32_t>(*top) << 16) | *bot);
+  uint32_t bits = fp32_bits(std::fma(alpha, grad, w));
+  *top = static_cast<uint16_t>(bits >> 16);
+  *bot = static_cast<uint16_t>(bits & 0xffffu);
+}
+
+inline void ref_max_update(float* inout, int64_t* inout_idx, float x, int64_t idx) {
+  if (x > *inout) {
+    *inout = x;
+    *inout_idx = idx;
+  }
+}
+
+inline float ref_unpack_4bit(const uint8_t* in, int64_t i) {
+  return static_cast<float>((in[i / 2] >> ((i & 1) * 4)) & 0xfu);
+}
+
+}  // namespace
+}  // namespace vec
+}  // namespace bf16
+}  // namespace cpu
+}  // namespace torch_ipex
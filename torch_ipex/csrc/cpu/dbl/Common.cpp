@@ -195,7 +195,14 @@ bool get_int8_quantized_status(const int64_t ops_id) {
   return false;
 }
 
-void reorder_to_int8_for_mix_prec(const at::Tensor& tensor, std::vector<float> scales, bool uint8_used) {
+std::vector<int32_t> get_int8_zero_points(const int64_t ops_id) {
+  if (check_auto_mix_int8_fp32() && !check_int8_calibration())
+    return get_indicator_zero_points(ops_id);
+  return {};
+}
+
+void reorder_to_int8_for_mix_prec(const at::Tensor& tensor, std::vector<float> scales, bool uint8_used,
+                                  std::vector<int32_t> zero_points) {
   if (!check_auto_mix_int8_fp32() || check_int8_calibration())
     return;
 
@@ -204,11 +211,20 @@ void reorder_to_int8_for_mix_prec(const at::Tensor& tensor, std::vector<float> s
   if (tensor_dtype != at::kFloat)
     return;
 
-  auto src_type = try_gen_dil_storage(tensor).get_data_type();
-  if (!uint8_used && (src_type == dil::data_type::u8 || src_type == dil::data_type::s8))
+  auto src = try_gen_dil_storage(tensor);
+  auto src_type = src.get_data_type();
+  bool src_int8 = src_type == dil::data_type::u8 || src_type == dil::data_type::s8;
+  bool asymmetric = !zero_points.empty();
+  if (src_int8 && src.has_zero_point() && !asymmetric) {
+    // the op doesn't handle the zero point of an asymmetric tensor, requantize it
+    auto dst_type = uint8_used ? dil::data_type::u8 : dil::data_type::s8;
+    reorder_to_desc(tensor, src.get_desc().to_type(dst_type), scales);
+    return;
+  }
+  if ((!uint8_used || asymmetric) && src_int8)
     return;
 
-  auto dst_scalar_type = uint8_used ? at::kQUInt8 : at::kQInt8;
+  auto dst_scalar_type = (uint8_used || asymmetric) ? at::kQUInt8 : at::kQInt8;
 
   auto inner_scales = scales;
   if (scales.empty()) {
@@ -218,10 +234,11 @@ void reorder_to_int8_for_mix_prec(const at::Tensor& tensor, std::vector<float> s
     }
   }
 
-  reorder_to_dtype(tensor, dst_scalar_type, inner_scales);
+  reorder_to_dtype(tensor, dst_scalar_type, inner_scales, zero_points);
 }
 
-void reorder_to_dtype(const at::Tensor& tensor, at::ScalarType dst_scalar_type, std::vector<float> scales) {
+void reorder_to_dtype(const at::Tensor& tensor, at::ScalarType dst_scalar_type, std::vector<float> scales,
+                      std::vector<int32_t> zero_points) {
   auto src = try_gen_dil_storage(tensor);
   if (get_at_data_type(src.get_data_type()) == dst_scalar_type) {
     // The data type of DIL tensor is same as the dst data type. DO NOTHING
@@ -231,7 +248,7 @@ void reorder_to_dtype(const at::Tensor& tensor, at::ScalarType dst_scalar_type,
   IPEX_CHECK(cpu::ShadeDataContext::isDilTensor(tensor) || check_tensor_own_whole_storage(tensor),  "Reorder only works while tensor owns the whole storage or tensor is a dil tensor");
 
   auto dst_desc = src.get_desc().to_type(get_dil_data_type(dst_scalar_type));
-  reorder_to_desc(tensor, dst_desc, scales);
+  reorder_to_desc(tensor, dst_desc, scales, zero_points);
 }
 
 void equip_dil_buffer_nosync_shape(const at::Tensor& tensor, dil::tensor dil_buffer) {
@@ -399,16 +416,21 @@ void reorder_to_public(const at::Tensor& tensor, bool remain_dtype) {
 }
 
 // Reorder *Storage* to expected_desc
-void reorder_to_desc(const at::Tensor& tensor, const dil::tensor::desc& expected_desc, const std::vector<float> scales) {
+void reorder_to_desc(const at::Tensor& tensor, const dil::tensor::desc& expected_desc, const std::vector<float> scales,
+                     const std::vector<int32_t> zero_points) {
   auto& mutex = cpu::ShadeDataContext::getMutex(tensor);
   std::lock_guard<std::mutex> lock(mutex);
   auto src = try_gen_dil_storage(tensor);
-  if (src.get_desc() == expected_desc)
+  auto src_zero_points = src.has_zero_point() ? src.get_zero_point() : std::vector<int32_t>();
+  if (src.get_desc() == expected_desc && src_zero_points == zero_points)
     return;
   dil::tensor dst {expected_desc};
   if(!scales.empty()) {
     dst.set_scale(scales);
   }
+  if (!zero_points.empty()) {
+    dst.set_zero_point(zero_points);
+  }
   dst.feed_from(src);
 
   // If a max pool output is converting from bf16 back to fp32,
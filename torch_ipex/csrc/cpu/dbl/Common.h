@@ -23,7 +23,23 @@ get_int8_scales(const at::TensorList &tensor, bool uint8_used, int64_t ops_id);
 
 bool get_int8_quantized_status(const int64_t ops_id);
 
-void reorder_to_int8_for_mix_prec(const at::Tensor& tensor, std::vector<float> scales, bool uint8_used = false);
+/**
+ * Zero points of the asymmetric u8 inputs of an int8 op, empty if its inputs
+ * are quantized symmetrically.
+ */
+std::vector<int32_t> get_int8_zero_points(const int64_t ops_id);
+
+/**
+ * Reorder the input tensor to int8 for mix precision
+ *
+ * @param[in] tensor      The input tensor
+ * @param[in] scales      The quantization scales, per-channel weight scales are computed if empty
+ * @param[in] uint8_used  Quantize to u8 instead of s8
+ * @param[in] zero_points Quantize asymmetrically to u8 with the zero point. A tensor already in int8
+ *                        is kept as is, unless it has a zero point and none is asked for.
+ */
+void reorder_to_int8_for_mix_prec(const at::Tensor& tensor, std::vector<float> scales, bool uint8_used = false,
+                                  std::vector<int32_t> zero_points = {});
 
 /**
  * Reorder the input tensor to the specified scalar type.
@@ -32,7 +48,8 @@ void reorder_to_int8_for_mix_prec(const at::Tensor& tensor, std::vector<float> s
  * @param[in] dst_scalar_type The scalar type which the shade buffer of the ipex tensor will be reordered to. It should
  *                            be at::kBFloat16 or at::kFloat
  */
-void reorder_to_dtype(const at::Tensor& tensor, at::ScalarType dtype, std::vector<float> sclaes = {});
+void reorder_to_dtype(const at::Tensor& tensor, at::ScalarType dtype, std::vector<float> sclaes = {},
+                      std::vector<int32_t> zero_points = {});
 
 /**
  * Reorder (outplace) the dil input tensor to the specified dil data type.
@@ -55,7 +72,8 @@ void reorder_to_public(const at::Tensor &tensor, bool remain_dtype = false);
  * @param[in] tensor        The tensor to be reordered to the spcified oneDNN descriptor
  * @param[in] expected_desc The dil buffer of the input tensor will be reordered to expected_desc
  */
-void reorder_to_desc(const at::Tensor& tensor, const dil::tensor::desc& expected_desc, const std::vector<float> scales = {});
+void reorder_to_desc(const at::Tensor& tensor, const dil::tensor::desc& expected_desc, const std::vector<float> scales = {},
+                     const std::vector<int32_t> zero_points = {});
 
 /**
  * Replace the whole original storage with a dil storage `dil_buffer`
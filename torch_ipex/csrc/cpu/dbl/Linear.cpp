@@ -1,33 +1,121 @@
 #include "Linear.h"
 
+#include <ATen/Parallel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "Common.h"
 #include "cpu/ShadeDataContext.h"
+#include "torch_ipex/csrc/utils.h"
 
 namespace torch_ipex {
 namespace cpu {
 namespace dbl {
 namespace linear {
 
-dil::tensor linear_impl(
+// sum_k w[n][k] of a s8 weight. They only depend on the weight, so they are
+// computed once per version of it and kept beside it, see getReorderedWeight.
+static dil::tensor s8_weight_row_sums(const dil::tensor& w, const at::Tensor& weight) {
+  dil::tensor::desc sums_desc {{w.get_dim(0)}, dil::data_type::s32};
+  if (weight.defined()) {
+    auto cached = cpu::ShadeDataContext::getReorderedWeight(weight, sums_desc, /*train*/false);
+    if (cached.has_value()) {
+      return cached.value();
+    }
+  }
+
+  auto w_public = w.to_public(nullptr, dil::data_type::s8);
+  auto out_features = w_public.get_dim(0);
+  auto in_features = w_public.get_dim(1);
+  auto w_strides = w_public.get_strides();
+  auto w_data = static_cast<const int8_t*>(w_public.get_data_handle());
+  dil::tensor sums {sums_desc};
+  auto sums_data = static_cast<int32_t*>(sums.get_data_handle());
+  at::parallel_for(0, out_features, 16, [&](int64_t begin, int64_t end) {
+    for (int64_t n = begin; n < end; n++) {
+      int32_t w_sum = 0;
+      for (int64_t k = 0; k < in_features; k++) {
+        w_sum += w_data[n * w_strides[0] + k * w_strides[1]];
+      }
+      sums_data[n] = w_sum;
+    }
+  });
+
+  if (weight.defined()) {
+    cpu::ShadeDataContext::addReorderedWeight(weight, sums, /*train*/false);
+  }
+  return sums;
+}
+
+// oneDNN inner product has no zero point attribute, the zero point of an
+// asymmetric u8 src is folded into the s32 bias instead:
+//   sum_k w[n][k] * (x[k] - zp) + b[n] = sum_k w[n][k] * x[k] + (b[n] - zp * sum_k w[n][k])
+static dil::tensor zero_point_compensated_bias(
     const dil::tensor& x,
     const dil::tensor& w,
     const c10::optional<dil::tensor>& b,
+    const at::Tensor& weight) {
+  IPEX_CHECK(x.get_zero_point().size() == 1, "linear only supports a per-tensor zero point");
+  int32_t zero_point = x.get_zero_point()[0];
+  auto w_sums = s8_weight_row_sums(w, weight);
+  auto out_features = w_sums.get_dim(0);
+  auto w_sums_data = static_cast<const int32_t*>(w_sums.get_data_handle());
+
+  dil::tensor b_public;
+  const int32_t* b_data = nullptr;
+  if (b.has_value()) {
+    IPEX_CHECK(b->get_data_type() == dil::data_type::s32, "linear: the bias of an asymmetric u8 input must be s32");
+    b_public = b->to_public(nullptr, dil::data_type::s32);
+    b_data = static_cast<const int32_t*>(b_public.get_data_handle());
+  }
+
+  dil::tensor compensated {{out_features}, dil::data_type::s32};
+  auto compensated_data = static_cast<int32_t*>(compensated.get_data_handle());
+  for (int64_t n = 0; n < out_features; n++) {
+    compensated_data[n] = (b_data ? b_data[n] : 0) - zero_point * w_sums_data[n];
+  }
+  return compensated;
+}
+
+static void linear_compute(
+    const dil::tensor& x,
+    const dil::tensor& w,
+    const c10::optional<dil::tensor>& b,
+    dil::tensor& y,
     const dil::scale_t& dst_scales,
-    const dil::attr_t& attr) {
+    const dil::attr_t& attr,
+    const dil::scale_t& src_scales,
+    const at::Tensor& weight) {
+  // a f32 src with scales is quantized to s8 for every call, see
+  // dynamic_int8_input_scale. Its output scales are runtime arguments of a
+  // matmul, an inner product would need a primitive for each src scale.
+  if (dil::data_type::f32 == x.get_data_type() && !src_scales.empty()) {
+    auto w_t = w;
+    w_t.transpose_(0, 1);
+    dil::matmul_forward::compute_dynamic(
+        x, w_t, b.has_value() ? b.value() : dil::tensor(), y, src_scales[0], attr);
+    return;
+  }
 
   dil::lowp_kind alowp_kind = dil::u8s8;
   if (dil::data_type::s8 == x.get_data_type()) {
     alowp_kind = dil::s8s8;
   }
 
-  dil::tensor y;
-  if (b.has_value()) {
+  c10::optional<dil::tensor> bias = b;
+  if (x.has_zero_point() && w.get_data_type() == dil::data_type::s8) {
+    bias = zero_point_compensated_bias(x, w, b, weight);
+  }
+
+  if (bias.has_value()) {
     dil::inner_product_forward::compute(
         x,
         w,
-        b.value(),
+        bias.value(),
         y,
-        dil::scale_t(),
+        src_scales,
         dil::scale_t(),
         dst_scales,
         attr,
@@ -38,16 +126,39 @@ dil::tensor linear_impl(
         x,
         w,
         y,
-        dil::scale_t(),
+        src_scales,
         dil::scale_t(),
         dst_scales,
         attr,
         dil::prop_kind::forward,
         alowp_kind);
   }
+}
+
+dil::tensor linear_impl(
+    const dil::tensor& x,
+    const dil::tensor& w,
+    const c10::optional<dil::tensor>& b,
+    const dil::scale_t& dst_scales,
+    const dil::attr_t& attr,
+    const dil::scale_t& src_scales,
+    const at::Tensor& weight) {
+  dil::tensor y;
+  linear_compute(x, w, b, y, dst_scales, attr, src_scales, weight);
   return y;
 }
 
+void linear_inplace_impl(
+    const dil::tensor& x,
+    const dil::tensor& w,
+    const c10::optional<dil::tensor>& b,
+    dil::tensor& y,
+    const dil::scale_t& dst_scales,
+    const dil::attr_t& attr,
+    const at::Tensor& weight) {
+  linear_compute(x, w, b, y, dst_scales, attr, dil::scale_t(), weight);
+}
+
 void prepack_linear_weights(
     const at::Tensor& input,
     const dil::tensor& dil_input,
@@ -71,6 +182,63 @@ void prepack_linear_weights(
   }
 }
 
+void prepack_dynamic_int8_weights(const at::Tensor& weight) {
+  if (cpu::ShadeDataContext::isDynamicInt8Tensor(weight)) {
+    return;
+  }
+  IPEX_CHECK(weight.dim() == 2, "dynamic int8 linear: weight needs to be 2D, got dim ", weight.dim());
+  auto dil_weight = dbl::comm::try_gen_dil_tensor(weight);
+  IPEX_CHECK(dil_weight.get_data_type() == dil::data_type::f32 || dil_weight.get_data_type() == dil::data_type::bf16,
+      "dynamic int8 linear: weight is already quantized");
+  // the scales are computed on the plain f32 weight, whatever format it was packed to
+  auto w_public = dil_weight.to_public(nullptr, dil::data_type::f32);
+  auto out_features = w_public.get_dim(0);
+  auto in_features = w_public.get_dim(1);
+  auto w_data = static_cast<const float*>(w_public.get_data_handle());
+
+  dil::scale_t scales(out_features);
+  at::parallel_for(0, out_features, 16, [&](int64_t begin, int64_t end) {
+    for (int64_t n = begin; n < end; n++) {
+      const float* row = w_data + n * in_features;
+      float abs_max = 0.f;
+#pragma omp simd reduction(max:abs_max)
+      for (int64_t k = 0; k < in_features; k++) {
+        abs_max = std::max(abs_max, std::abs(row[k]));
+      }
+      scales[n] = abs_max == 0.f ? 1.f : float(127.5) / abs_max;
+    }
+  });
+
+  // plain [N, K], read transposed by the dynamic matmul
+  dil::tensor::desc packed_desc {weight.sizes().vec(), dil::data_type::s8, dil::format_tag::ab};
+  dil::tensor packed_weight {packed_desc};
+  packed_weight.set_scale(scales);
+  packed_weight.feed_from(w_public);
+  dbl::comm::equip_dil_buffer(weight, packed_weight);
+  cpu::ShadeDataContext::setPackedTensor(weight, true);
+  cpu::ShadeDataContext::setDynamicInt8Tensor(weight, true);
+}
+
+float dynamic_int8_input_scale(const dil::tensor& x) {
+  auto x_public = x.is_public_format() && x.is_dense() ? x : x.to_public(nullptr, dil::data_type::f32);
+  auto data = static_cast<const float*>(x_public.get_data_handle());
+  int64_t len = x_public.get_nelems();
+  // one min/max pass, vectorized within the chunk of each thread
+  float abs_max = at::parallel_reduce(0, len, 1 << 14, 0.f,
+      [&](int64_t begin, int64_t end, float ident) {
+        float min = std::numeric_limits<float>::max();
+        float max = std::numeric_limits<float>::lowest();
+#pragma omp simd reduction(min:min) reduction(max:max)
+        for (int64_t i = begin; i < end; i++) {
+          min = std::min(min, data[i]);
+          max = std::max(max, data[i]);
+        }
+        return std::max(ident, std::max(-min, max));
+      },
+      [](float a, float b) { return std::max(a, b); });
+  return abs_max == 0.f || !std::isfinite(abs_max) ? 1.f : float(127.5) / abs_max;
+}
+
 } // namespace linear  
 } // namespace dbl
 } // namespace cpu
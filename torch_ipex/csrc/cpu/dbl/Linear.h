@@ -11,18 +11,56 @@ namespace cpu {
 namespace dbl {
 namespace linear {
 
+/**
+ * Linear of x and w.
+ *
+ * @param[in] weight The aten tensor of w, if any, beside which the values derived from w alone are kept
+ */
 dil::tensor linear_impl(
     const dil::tensor& x,
     const dil::tensor& w,
     const c10::optional<dil::tensor>& b,
     const dil::scale_t& dst_scales = dil::scale_t(),
-    const dil::attr_t& attr = dil::attr_t());
+    const dil::attr_t& attr = dil::attr_t(),
+    const dil::scale_t& src_scales = dil::scale_t(),
+    const at::Tensor& weight = at::Tensor());
+
+/**
+ * Linear accumulated into its output by the sum post op of attr.
+ *
+ * @param[in,out] y The accumulator on entry, the output on return, it has the dims of the output
+ * @param[in] weight The aten tensor of w, as for linear_impl
+ */
+void linear_inplace_impl(
+    const dil::tensor& x,
+    const dil::tensor& w,
+    const c10::optional<dil::tensor>& b,
+    dil::tensor& y,
+    const dil::scale_t& dst_scales = dil::scale_t(),
+    const dil::attr_t& attr = dil::attr_t(),
+    const at::Tensor& weight = at::Tensor());
 
 void prepack_linear_weights(
     const at::Tensor& input,
     const dil::tensor& dil_input,
     const at::Tensor& weight);
-    
+
+/**
+ * Quantize the weight of a linear to s8 per output channel and prepack it, once, for the dynamic int8 mode.
+ * The activations of such a linear are quantized on the fly with the scale of their own min/max, so the
+ * linear needs no calibration. The weight stays quantized.
+ *
+ * @param[in] weight The weight of the linear, a 2D dil tensor
+ */
+void prepack_dynamic_int8_weights(const at::Tensor& weight);
+
+/**
+ * Symmetric s8 scale of the activation of a dynamic int8 linear, from the min/max of this very activation.
+ *
+ * @param[in] x The f32 activation
+ */
+float dynamic_int8_input_scale(const dil::tensor& x);
+
 } // namespace linear
 } // namespace dbl
 } // namespace cpu
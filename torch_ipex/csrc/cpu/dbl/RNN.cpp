@@ -6,9 +6,17 @@
 #include <ATen/TensorUtils.h>
 #include <c10/util/Exception.h>
 
+#include <ATen/Parallel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "RNN.h"
 #include "Common.h"
 #include "cpu/ShadeDataContext.h"
+#include "cpu/int8/Config.h"
+#include "torch_ipex/csrc/utils.h"
 
 namespace torch_ipex {
 namespace cpu {
@@ -175,6 +183,7 @@ void prepack_lstm_weights(
                         bias,
                         reverse,
                         aprop,
+                        dil::rnn_qparams_t(),
                         aengine);
     } else {
       TORCH_CHECK(_rnn_kind == dil::rnn_kind::RNN_RELU || _rnn_kind == dil::rnn_kind::RNN_TANH,
@@ -206,6 +215,229 @@ void prepack_lstm_weights(
     cpu::ShadeDataContext::setPackedTensor(weight_hh, true);
   }
 
+// Returns the weights of a layer in the descs expected by its forward or backward
+// primitive. The weights of the module stay in the plain ldgoi format of PyTorch,
+// which the optimizer updates. Their reordered copies (shuffled first for a gru) are
+// kept on them through ShadeDataContext and reused until they are updated, so that
+// the layer does not reorder them on each call, e.g. once per step of a decoder.
+// The copies of inference are freed by the first call in training, and vice versa.
+std::tuple<dil::tensor, dil::tensor> get_reordered_rnn_weights(
+    const at::Tensor& weight1,
+    const at::Tensor& weight2,
+    const RNNParams& rnn,
+    int64_t input_size,
+    const dil::tensor::desc& weights_layer_desc,
+    const dil::tensor::desc& weights_iter_desc) {
+  auto cached_w1 = cpu::ShadeDataContext::getReorderedWeight(weight1, weights_layer_desc, rnn.train);
+  auto cached_w2 = cpu::ShadeDataContext::getReorderedWeight(weight2, weights_iter_desc, rnn.train);
+  if (cached_w1.has_value() && cached_w2.has_value()) {
+    return std::make_tuple(cached_w1.value(), cached_w2.value());
+  }
+
+  auto reorder = [&](const at::Tensor& weight, const dil::dims& dims, const dil::tensor::desc& expected_desc) {
+    auto src = dbl::comm::try_gen_dil_tensor(_shuffle_weight(weight, rnn.mode), dims, dil::format_tag::ldgoi);
+    if (rnn.mode != dil::rnn_kind::GRU && src.get_desc() == expected_desc) {
+      // the plain weight is used as is
+      return src;
+    }
+    dil::tensor dst {expected_desc};
+    dst.feed_from(src);
+    cpu::ShadeDataContext::addReorderedWeight(weight, dst, rnn.train);
+    return dst;
+  };
+  auto w1 = cached_w1.has_value() ? cached_w1.value()
+      : reorder(weight1, {1, 1, input_size, rnn.num_gates, rnn.hidden_size}, weights_layer_desc);
+  auto w2 = cached_w2.has_value() ? cached_w2.value()
+      : reorder(weight2, {1, 1, rnn.hidden_size, rnn.num_gates, rnn.hidden_size}, weights_iter_desc);
+  return std::make_tuple(w1, w2);
+}
+
+// Int8 lstm and gru inference
+//
+// The u8 src/dst layer and iter of an int8 rnn share one scale and shift. They
+// cover the widest calibrated range of the input, hx, output and hy of the op,
+// symmetrically around the shift 128, which is also the zero point of the u8
+// dil tensors. The weights are s8 with one scale per gate and output channel,
+// shared by weights layer and iter. They are quantized and prepacked once, to
+// copies kept in the ShadeDataContext of the fp32 weights of the module, which
+// stay as they are for the ops that are not quantized.
+
+bool is_int8_rnn_kind(dil::rnn_kind kind) {
+  return kind == dil::rnn_kind::LSTM || kind == dil::rnn_kind::GRU;
+}
+
+const char* int8_rnn_op_name(dil::rnn_kind kind) {
+  return kind == dil::rnn_kind::LSTM ? "LSTM" : "GRU";
+}
+
+dil::rnn_qparams_t rnn_data_qparams(int64_t ops_id) {
+  auto scales = get_indicator_scales({false, false}, {false, false}, ops_id);
+  float s8_scale = std::numeric_limits<float>::max();
+  for (const auto& op_scales : scales) {
+    for (auto scale : op_scales) {
+      s8_scale = std::min(s8_scale, scale);
+    }
+  }
+  dil::rnn_qparams_t qparams;
+  // 127.5 / threshold for s8, [-threshold, threshold] maps to [1, 255]
+  qparams.data_scale = s8_scale * 127.f / 127.5f;
+  qparams.data_shift = 128.f;
+  return qparams;
+}
+
+// u8 copy of an activation with the data qparams, kept as is if it's already one
+dil::tensor quantize_rnn_data(const dil::tensor& src, const dil::rnn_qparams_t& qparams) {
+  int32_t zero_point = static_cast<int32_t>(qparams.data_shift);
+  if (src.get_data_type() == dil::data_type::u8 && src.has_scale() && src.has_zero_point() &&
+      src.get_scale() == dil::scale_t{qparams.data_scale} && src.get_zero_point() == std::vector<int32_t>{zero_point}) {
+    return src;
+  }
+  auto src_f32 = src.get_data_type() == dil::data_type::f32 ? src : src.to_public(nullptr, dil::data_type::f32);
+  dil::tensor dst {src_f32.get_desc().to_type(dil::data_type::u8)};
+  dst.set_scale({qparams.data_scale});
+  dst.set_zero_point({zero_point});
+  dst.feed_from(src_f32);
+  return dst;
+}
+
+// s8 scales of the ldigo weights layer and iter, per gate and output channel
+dil::scale_t rnn_weights_scales(const dil::tensor& w1, const dil::tensor& w2, int64_t num_gates, int64_t hidden_size) {
+  dil::scale_t scales(num_gates * hidden_size);
+  at::parallel_for(0, num_gates * hidden_size, 16, [&](int64_t begin, int64_t end) {
+    for (int64_t go = begin; go < end; go++) {
+      int64_t g = go / hidden_size, o = go % hidden_size;
+      float abs_max = 0.f;
+      for (const auto* w : {&w1, &w2}) {
+        auto strides = w->get_strides();
+        auto data = static_cast<const float*>(w->get_data_handle()) + g * strides[3] + o * strides[4];
+        for (int64_t i = 0; i < w->get_dim(2); i++) {
+          abs_max = std::max(abs_max, std::abs(data[i * strides[2]]));
+        }
+      }
+      scales[go] = abs_max == 0.f ? 1.f : 127.f / abs_max;
+    }
+  });
+  return scales;
+}
+
+// Returns the s8 weights layer and iter of an int8 lstm or gru, prepacked with
+// their scales, or nothing if oneDNN has no int8 implementation of the cell.
+// They are quantized from weight1 and weight2, the weight_ih and weight_hh of
+// the module, once per version of them, see get_reordered_rnn_weights. The gru
+// weights are packed in the oneDNN gate order.
+c10::optional<std::tuple<dil::tensor, dil::tensor>> get_int8_rnn_weights(
+    const at::Tensor& weight1,
+    const at::Tensor& weight2,
+    const RNNParams& rnn,
+    int64_t input_size,
+    const dil::dims& output_sizes,
+    const dil::tensor& x,
+    const dil::tensor& hx,
+    const dil::tensor& cx,
+    const dil::tensor& bias,
+    bool reverse,
+    dil::rnn_qparams_t qparams) {
+  auto cached_w1 = cpu::ShadeDataContext::getReorderedWeight(weight1, dil::data_type::s8, /*train*/false);
+  auto cached_w2 = cpu::ShadeDataContext::getReorderedWeight(weight2, dil::data_type::s8, /*train*/false);
+  if (cached_w1.has_value() && cached_w2.has_value()) {
+    return std::make_tuple(cached_w1.value(), cached_w2.value());
+  }
+
+  // plain f32 ldigo copy of a weight. The lstm weights prepacked by a previous
+  // fp32 or bf16 inference hold a [1, 1, I, G, O] buffer in the layout of the
+  // primitive, with the gate order of PyTorch, which is the lstm order of oneDNN
+  auto plain_weight = [&](const at::Tensor& weight, const dil::dims& dims) {
+    if (cpu::ShadeDataContext::isPackedTensor(weight)) {
+      auto packed = dbl::comm::try_gen_dil_storage(weight);
+      TORCH_INTERNAL_ASSERT(rnn.mode == dil::rnn_kind::LSTM && packed.get_dims() == dims);
+      return packed.to_public(nullptr, dil::data_type::f32);
+    }
+    return dbl::comm::try_gen_dil_tensor(_shuffle_weight(weight, rnn.mode), dims, dil::format_tag::ldgoi)
+        .to_public(nullptr, dil::data_type::f32);
+  };
+  auto w1 = plain_weight(weight1, {1, 1, input_size, rnn.num_gates, rnn.hidden_size});
+  auto w2 = plain_weight(weight2, {1, 1, rnn.hidden_size, rnn.num_gates, rnn.hidden_size});
+  qparams.weights_scales = rnn_weights_scales(w1, w2, rnn.num_gates, rnn.hidden_size);
+
+  dil::tensor::desc expected_weights_layer_desc, expected_weights_iter_desc;
+  auto aprop = dil::prop_kind::forward_inference;
+  try {
+    if (rnn.mode == dil::rnn_kind::LSTM) {
+      std::tie(expected_weights_layer_desc, expected_weights_iter_desc) = dil::lstm_forward::expected_weights_desc(
+          output_sizes, x, hx, cx, w1, w2, bias, reverse, aprop, qparams);
+    } else {
+      std::tie(expected_weights_layer_desc, expected_weights_iter_desc) = dil::lbr_gru_forward::expected_weights_desc(
+          output_sizes, x, hx, w1, w2, bias, reverse, aprop, qparams);
+    }
+  } catch (const dnnl::error&) {
+    return c10::nullopt;
+  }
+
+  dil::tensor packed_weight_ih {expected_weights_layer_desc};
+  dil::tensor packed_weight_hh {expected_weights_iter_desc};
+  // the rnn weights reorder quantizes with the qparams and computes the s8 compensation
+  w1.reorder_to(packed_weight_ih, qparams.to_attr());
+  w2.reorder_to(packed_weight_hh, qparams.to_attr());
+  packed_weight_ih.set_scale(qparams.weights_scales);
+  packed_weight_hh.set_scale(qparams.weights_scales);
+
+  cpu::ShadeDataContext::addReorderedWeight(weight1, packed_weight_ih, /*train*/false);
+  cpu::ShadeDataContext::addReorderedWeight(weight2, packed_weight_hh, /*train*/false);
+  return std::make_tuple(packed_weight_ih, packed_weight_hh);
+}
+
+// Runs an int8 lstm or gru layer, returns nothing if the cell has no int8 implementation
+c10::optional<std::vector<at::Tensor>> mkldnn_rnn_layer_int8(
+    const at::Tensor& input,
+    const at::Tensor& weight1,
+    const at::Tensor& weight2,
+    const at::Tensor& bias,
+    const at::Tensor& hx_,
+    const at::Tensor& cx_,
+    const RNNParams& rnn,
+    bool reverse,
+    dil::rnn_qparams_t qparams) {
+  auto output_size = _output_size</*is_single_direction*/true>(rnn);
+  dil::dims output_sizes {output_size.cbegin(), output_size.cend()};
+  int64_t input_size = input.size(2);
+
+  auto x = quantize_rnn_data(
+      dbl::comm::try_gen_dil_tensor(input, {rnn.seq_length, rnn.mini_batch, input_size}, dil::format_tag::tnc), qparams);
+  auto hx = quantize_rnn_data(
+      dbl::comm::try_gen_dil_tensor(hx_, {1, 1, rnn.mini_batch, rnn.hidden_size}, dil::format_tag::ldnc), qparams);
+  auto cx = dbl::comm::try_gen_dil_tensor(cx_, {1, 1, rnn.mini_batch, rnn.hidden_size}, dil::format_tag::ldnc);
+  auto b = dbl::comm::try_gen_dil_tensor(bias, {1, 1, rnn.num_bias_gates, rnn.hidden_size}, dil::format_tag::ldgo);
+
+  auto weights = get_int8_rnn_weights(
+      weight1, weight2, rnn, input_size, output_sizes, x, hx, cx, b, reverse, qparams);
+  if (!weights.has_value()) {
+    return c10::nullopt;
+  }
+  dil::tensor w1, w2;
+  std::tie(w1, w2) = weights.value();
+  qparams.weights_scales = w1.get_scale();
+
+  auto aprop = dil::prop_kind::forward_inference;
+  dil::tensor y, hy, cy;
+  if (rnn.mode == dil::rnn_kind::LSTM) {
+    dil::lstm_forward::compute(output_sizes, x, hx, cx, w1, w2, b, y, hy, cy, reverse, aprop, qparams);
+  } else {
+    dil::lbr_gru_forward::compute(output_sizes, x, hx, w1, w2, b, y, hy, reverse, aprop, qparams);
+  }
+  // the output stays u8 for the int8 consumers, hy is dequantized to be stacked with the other layers
+  for (auto* dst : {&y, &hy}) {
+    dst->set_scale({qparams.data_scale});
+    dst->set_zero_point({static_cast<int32_t>(qparams.data_shift)});
+  }
+  auto hy_f32 = hy.to_public(nullptr, dil::data_type::f32);
+  auto output = dbl::comm::gen_aten_tensor_by(std::move(y));
+  auto hy_ = dbl::comm::gen_aten_tensor_by(std::move(hy_f32)).reshape(hx_.sizes());
+  if (rnn.mode == dil::rnn_kind::LSTM) {
+    return std::vector<at::Tensor>{output, hy_, dbl::comm::gen_aten_tensor_by(std::move(cy)).reshape(cx_.sizes())};
+  }
+  return std::vector<at::Tensor>{output, hy_, at::zeros(hx_.sizes(), hx_.options())};
+}
+
 std::vector<at::Tensor> mkldnn_rnn_layer(const at::Tensor& input, const at::Tensor& weight1, const at::Tensor& weight2,
     const at::Tensor& weight3, const at::Tensor& weight4, const at::Tensor& hx_, const at::Tensor& cx_tmp, bool reverse, int64_t mode,
     int64_t hidden_size, int64_t num_layers, bool has_biases, bool train, bool bidirectional, at::IntArrayRef batch_sizes) {
@@ -213,8 +445,21 @@ std::vector<at::Tensor> mkldnn_rnn_layer(const at::Tensor& input, const at::Tens
   RNNParams rnn(input, batch_sizes, mode, hidden_size, num_layers, bidirectional, train);
   auto output_size = _output_size</*is_single_direction*/true>(rnn);
 
-  auto weight_ih = _shuffle_weight(weight1, rnn.mode);
-  auto weight_hh = _shuffle_weight(weight2, rnn.mode);
+  bool int8_rnn = !train && check_auto_mix_int8_fp32() && is_int8_rnn_kind(rnn.mode);
+  bool int8_calibration = int8_rnn && check_int8_calibration();
+  bool int8_quantized = false;
+  dil::rnn_qparams_t qparams;
+  if (int8_rnn && !int8_calibration) {
+    auto ops_id = Int8OptConfig::fetch_and_add_ops_id(int8_rnn_op_name(rnn.mode));
+    int8_quantized = get_indicator_quantized_status(ops_id);
+    if (int8_quantized) {
+      qparams = rnn_data_qparams(ops_id);
+    }
+  }
+
+  // the gru weights are shuffled into the oneDNN gate order when they are reordered
+  auto weight_ih = weight1.contiguous();
+  auto weight_hh = weight2.contiguous();
   auto bias = has_biases ? _shuffle_bias(weight3, weight4, rnn.mode)
                        : at::zeros({rnn.num_bias_gates * rnn.hidden_size}, weight_ih.options());
 
@@ -235,6 +480,18 @@ std::vector<at::Tensor> mkldnn_rnn_layer(const at::Tensor& input, const at::Tens
   // cx, cy and bias should always be fp32 in bf16 inference
   dbl::comm::reorder_to_dtype(bias, at::kFloat);
   dbl::comm::reorder_to_dtype(cx_, at::kFloat);
+
+  if (int8_quantized) {
+    auto outputs = mkldnn_rnn_layer_int8(
+        input, weight1, weight2, bias, hx_, cx_, rnn, reverse, qparams);
+    if (outputs.has_value()) {
+      return outputs.value();
+    }
+  }
+  if (check_auto_mix_int8_fp32()) {
+    // the output of a preceding int8 op
+    dbl::comm::reorder_to_dtype(input, at::kFloat);
+  }
   auto x = dbl::comm::try_gen_dil_tensor(input, {rnn.seq_length, rnn.mini_batch, input_size}, dil::format_tag::tnc);
   auto hx = dbl::comm::try_gen_dil_tensor(hx_, {1, 1, rnn.mini_batch, rnn.hidden_size}, dil::format_tag::ldnc);
 
@@ -257,10 +514,11 @@ std::vector<at::Tensor> mkldnn_rnn_layer(const at::Tensor& input, const at::Tens
   // FW weight format: ldigo
   // BW weight format: ldgoi
 
-  // TODO: prepack for GRU inference: GRU need to shuffle weight
-  // We need to design how to sync the shape of the dil tensor and the aten tensor
-  // during FW and BW
-  if (!train && _rnn_kind != dil::rnn_kind::GRU) {
+  // The gru weights, which are shuffled, and the weights in training are reordered
+  // to copies kept until the weights are updated instead, see get_reordered_rnn_weights
+  // The weights are kept plain during the int8 calibration, the int8 inference
+  // quantizes them from their fp32 values, read back from the prepacked buffer if any
+  if (!train && _rnn_kind != dil::rnn_kind::GRU && !int8_calibration) {
     prepack_lstm_weights(
       weight_ih,
       weight_hh,
@@ -279,20 +537,44 @@ std::vector<at::Tensor> mkldnn_rnn_layer(const at::Tensor& input, const at::Tens
     w1 = dbl::comm::try_gen_dil_tensor(weight_ih);
     w2 = dbl::comm::try_gen_dil_tensor(weight_hh);
   } else {
-    w1 = dbl::comm::try_gen_dil_tensor(weight_ih, {1, 1, input_size, rnn.num_gates, rnn.hidden_size}, dil::format_tag::ldgoi);
-    w2 = dbl::comm::try_gen_dil_tensor(weight_hh, {1, 1, rnn.hidden_size, rnn.num_gates, rnn.hidden_size}, dil::format_tag::ldgoi);
+    // the descs only depend on the shape and type of the weights, which the gru shuffle keeps
+    auto plain_w1 = dbl::comm::try_gen_dil_tensor(weight_ih, {1, 1, input_size, rnn.num_gates, rnn.hidden_size}, dil::format_tag::ldgoi);
+    auto plain_w2 = dbl::comm::try_gen_dil_tensor(weight_hh, {1, 1, rnn.hidden_size, rnn.num_gates, rnn.hidden_size}, dil::format_tag::ldgoi);
+    dil::tensor::desc expected_weights_layer_desc, expected_weights_iter_desc;
+    dil::dims output_sizes {output_size.cbegin(), output_size.cend()};
+    if (_rnn_kind == dil::rnn_kind::LSTM) {
+      std::tie(expected_weights_layer_desc, expected_weights_iter_desc) = dil::lstm_forward::expected_weights_desc(
+          output_sizes, x, hx, cx, plain_w1, plain_w2, b, reverse, aprop_kind);
+    } else if (_rnn_kind == dil::rnn_kind::GRU) {
+      std::tie(expected_weights_layer_desc, expected_weights_iter_desc) = dil::lbr_gru_forward::expected_weights_desc(
+          output_sizes, x, hx, plain_w1, plain_w2, b, reverse);
+    } else {
+      std::tie(expected_weights_layer_desc, expected_weights_iter_desc) = dil::rnn_forward::expected_weights_desc(
+          output_sizes, x, hx, plain_w1, plain_w2, b, _rnn_kind, reverse);
+    }
+    std::tie(w1, w2) = get_reordered_rnn_weights(
+        weight1, weight2, rnn, input_size, expected_weights_layer_desc, expected_weights_iter_desc);
   }
 
 
   dil::tensor y, hy;
 
-  if (_rnn_kind == dil::rnn_kind::LSTM) {
-    dil::tensor cy;
-    dil::lstm_forward::compute({output_size.cbegin(), output_size.cend()}, x, hx, cx, w1, w2, b, y, hy, cy, reverse, aprop_kind);
-    return {dbl::comm::gen_aten_tensor_by(std::move(y)), dbl::comm::gen_aten_tensor_by(std::move(hy)).reshape(hx_.sizes()), dbl::comm::gen_aten_tensor_by(std::move(cy)).reshape(cx_.sizes())};
-  } else if (_rnn_kind == dil::rnn_kind::GRU) {
-    dil::lbr_gru_forward::compute({output_size.cbegin(), output_size.cend()}, x, hx, w1, w2, b, y, hy, reverse);
-    return {dbl::comm::gen_aten_tensor_by(std::move(y)), dbl::comm::gen_aten_tensor_by(std::move(hy)).reshape(hx_.sizes()), at::zeros(hx_.sizes(), hx_.options())};
+  if (_rnn_kind == dil::rnn_kind::LSTM || _rnn_kind == dil::rnn_kind::GRU) {
+    std::vector<at::Tensor> outputs;
+    if (_rnn_kind == dil::rnn_kind::LSTM) {
+      dil::tensor cy;
+      dil::lstm_forward::compute({output_size.cbegin(), output_size.cend()}, x, hx, cx, w1, w2, b, y, hy, cy, reverse, aprop_kind);
+      outputs = {dbl::comm::gen_aten_tensor_by(std::move(y)), dbl::comm::gen_aten_tensor_by(std::move(hy)).reshape(hx_.sizes()), dbl::comm::gen_aten_tensor_by(std::move(cy)).reshape(cx_.sizes())};
+    } else {
+      dil::lbr_gru_forward::compute({output_size.cbegin(), output_size.cend()}, x, hx, w1, w2, b, y, hy, reverse);
+      outputs = {dbl::comm::gen_aten_tensor_by(std::move(y)), dbl::comm::gen_aten_tensor_by(std::move(hy)).reshape(hx_.sizes()), at::zeros(hx_.sizes(), hx_.options())};
+    }
+    if (int8_calibration) {
+      auto op_name = int8_rnn_op_name(_rnn_kind);
+      insert_or_updata_observer({input, hx_}, {outputs[0], outputs[1]}, op_name,
+                                Int8OptConfig::fetch_and_add_ops_id(op_name));
+    }
+    return outputs;
   } else {
     TORCH_CHECK(_rnn_kind == dil::rnn_kind::RNN_RELU || _rnn_kind == dil::rnn_kind::RNN_TANH,
                 "mkldnn_rnn: unsuppored rnn mode: ", rnn.mode);
@@ -309,8 +591,9 @@ std::vector<at::Tensor> mkldnn_rnn_layer_backward(const at::Tensor& input, const
   RNNParams rnn(input, batch_sizes, mode, hidden_size, num_layers, bidirectional, train);
   auto output_size = _output_size</*is_single_direction*/true>(rnn);
 
-  auto weight_ih = _shuffle_weight(weight1, rnn.mode);
-  auto weight_hh = _shuffle_weight(weight2, rnn.mode);
+  // the gru weights are shuffled into the oneDNN gate order when they are reordered
+  auto weight_ih = weight1.contiguous();
+  auto weight_hh = weight2.contiguous();
   auto bias = has_biases ? _shuffle_bias(weight3, weight4, rnn.mode)
                        : at::zeros({rnn.num_bias_gates * rnn.hidden_size}, weight_ih.options());
 
@@ -340,8 +623,9 @@ std::vector<at::Tensor> mkldnn_rnn_layer_backward(const at::Tensor& input, const
   auto x = dbl::comm::try_gen_dil_tensor(input, {rnn.seq_length, rnn.mini_batch, input_size}, dil::format_tag::tnc);
   auto hx = dbl::comm::try_gen_dil_tensor(hx_, {1, 1, rnn.mini_batch, rnn.hidden_size}, dil::format_tag::ldnc);
 
-  auto w1 = dbl::comm::try_gen_dil_tensor(weight_ih, {1, 1, input_size, rnn.num_gates, rnn.hidden_size}, dil::format_tag::ldgoi);
-  auto w2 = dbl::comm::try_gen_dil_tensor(weight_hh, {1, 1, rnn.hidden_size, rnn.num_gates, rnn.hidden_size}, dil::format_tag::ldgoi);
+  // the descs only depend on the shape and type of the weights, which the gru shuffle keeps
+  auto plain_w1 = dbl::comm::try_gen_dil_tensor(weight_ih, {1, 1, input_size, rnn.num_gates, rnn.hidden_size}, dil::format_tag::ldgoi);
+  auto plain_w2 = dbl::comm::try_gen_dil_tensor(weight_hh, {1, 1, rnn.hidden_size, rnn.num_gates, rnn.hidden_size}, dil::format_tag::ldgoi);
 
   auto b = dbl::comm::try_gen_dil_tensor(bias, {1, 1, rnn.num_bias_gates, rnn.hidden_size}, dil::format_tag::ldgo);
   auto y = dbl::comm::try_gen_dil_tensor(output, {rnn.seq_length, rnn.mini_batch, rnn.hidden_size}, dil::format_tag::tnc);
@@ -349,17 +633,31 @@ std::vector<at::Tensor> mkldnn_rnn_layer_backward(const at::Tensor& input, const
   auto diff_y = dbl::comm::try_gen_dil_tensor(grad_output, {rnn.seq_length, rnn.mini_batch, rnn.hidden_size}, dil::format_tag::tnc);
   auto diff_hy = dbl::comm::try_gen_dil_tensor(grad_hy_, {1, 1, rnn.mini_batch, rnn.hidden_size}, dil::format_tag::ldnc);
   dil::tensor diff_x, diff_hx, diff_cx, diff_w1, diff_w2, diff_b;
+  dil::tensor w1, w2;
+  dil::tensor::desc expected_weights_layer_desc, expected_weights_iter_desc;
   auto _rnn_kind = static_cast<dil::rnn_kind>(rnn.mode);
   if (_rnn_kind == dil::rnn_kind::LSTM) {
     auto cx = dbl::comm::try_gen_dil_tensor(cx_, {1, 1, rnn.mini_batch, rnn.hidden_size}, dil::format_tag::ldnc);
     auto cy = dbl::comm::try_gen_dil_tensor(cy_, {1, 1, rnn.mini_batch, rnn.hidden_size}, dil::format_tag::ldnc);
     auto diff_cy = dbl::comm::try_gen_dil_tensor(grad_cy_, {1, 1, rnn.mini_batch, rnn.hidden_size}, dil::format_tag::ldnc);
+    std::tie(expected_weights_layer_desc, expected_weights_iter_desc) = dil::lstm_backward::expected_weights_desc(
+        x, hx, cx, plain_w1, plain_w2, b, y, hy, cy, reverse);
+    std::tie(w1, w2) = get_reordered_rnn_weights(
+        weight1, weight2, rnn, input_size, expected_weights_layer_desc, expected_weights_iter_desc);
     dil::lstm_backward::compute(x, hx, cx, w1, w2, b, y, hy, cy, diff_y, diff_hy, diff_cy, diff_x, diff_hx, diff_cx, diff_w1, diff_w2, diff_b, reverse);
   } else if (_rnn_kind == dil::rnn_kind::GRU) {
+    std::tie(expected_weights_layer_desc, expected_weights_iter_desc) = dil::lbr_gru_backward::expected_weights_desc(
+        x, hx, plain_w1, plain_w2, b, y, hy, reverse);
+    std::tie(w1, w2) = get_reordered_rnn_weights(
+        weight1, weight2, rnn, input_size, expected_weights_layer_desc, expected_weights_iter_desc);
     dil::lbr_gru_backward::compute(x, hx, w1, w2, b, y, hy, diff_y, diff_hy, diff_x, diff_hx, diff_w1, diff_w2, diff_b, reverse);
   } else {
     TORCH_CHECK(_rnn_kind == dil::rnn_kind::RNN_RELU || _rnn_kind == dil::rnn_kind::RNN_TANH,
                 "mkldnn_rnn: unsuppored rnn mode: ", rnn.mode);
+    std::tie(expected_weights_layer_desc, expected_weights_iter_desc) = dil::rnn_backward::expected_weights_desc(
+        x, hx, plain_w1, plain_w2, b, y, hy, _rnn_kind, reverse);
+    std::tie(w1, w2) = get_reordered_rnn_weights(
+        weight1, weight2, rnn, input_size, expected_weights_layer_desc, expected_weights_iter_desc);
     dil::rnn_backward::compute(x, hx, w1, w2, b, y, hy, diff_y, diff_hy, diff_x, diff_hx, diff_w1, diff_w2, diff_b, rnn.mode, reverse);
   }
 
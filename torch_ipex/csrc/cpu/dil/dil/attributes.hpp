@@ -150,6 +150,28 @@ struct attr_t : public dnnl::primitive_attr {
   }
 };
 
+/// Quantization parameters of an int8 rnn. The src/dst layer and iter are u8
+/// with u8 = data_scale * f32 + data_shift, and the weights layer and iter
+/// are s8 with one scale per gate and output channel, or a single one.
+struct rnn_qparams_t {
+  float data_scale = 1.f;
+  float data_shift = 0.f;
+  scale_t weights_scales;
+
+  bool empty() const { return weights_scales.empty(); }
+
+  attr_t to_attr() const {
+    attr_t attr;
+    if (!empty()) {
+      attr.set_rnn_data_qparams(data_scale, data_shift);
+      // the g and o dims of ldigo
+      int mask = weights_scales.size() > 1 ? (1 << 3) + (1 << 4) : 0;
+      attr.set_rnn_weights_qparams(mask, weights_scales);
+    }
+    return attr;
+  }
+};
+
 }  // namespace dil
 
 #endif
\ No newline at end of file
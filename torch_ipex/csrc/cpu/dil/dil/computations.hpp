@@ -1,6 +1,7 @@
 #ifndef DIL_COMPUTATIONS_HPP
 #define DIL_COMPUTATIONS_HPP
 
+#include "lru_cache.hpp"
 #include "operators/batchnorm.hpp"
 #include "operators/binary.hpp"
 #include "operators/channel_shuffle.hpp"
@@ -9,6 +10,7 @@
 #include "operators/deconv.hpp"
 #include "operators/direct_copy.hpp"
 #include "operators/dropout.hpp"
+#include "operators/attention.hpp"
 #include "operators/eltwise.hpp"
 #include "operators/inner_product.hpp"
 #include "operators/layernorm.hpp"
@@ -0,0 +1,263 @@
+#ifndef DIL_LRU_CACHE_HPP
+#define DIL_LRU_CACHE_HPP
+
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include <type_traits>
+#include "tensor.hpp"
+
+namespace dil {
+namespace utils {
+
+/// Thread-safe, bounded LRU map. Lookups and insertions take a single mutex,
+/// value creation is done by the caller outside of the lock.
+template <class key_type, class value_type>
+class lru_cache {
+ public:
+  struct stats_t {
+    size_t capacity;
+    size_t size;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+  };
+
+  explicit lru_cache(size_t capacity) : capacity_(capacity) {}
+
+  lru_cache(const lru_cache&) = delete;
+  lru_cache& operator=(const lru_cache&) = delete;
+
+  /// Returns true and fills @p value on a hit, bumping the entry to the front.
+  bool find(const key_type& key, value_type& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = map_.find(key);
+    if (it == map_.end()) {
+      misses_++;
+      return false;
+    }
+    list_.splice(list_.begin(), list_, it->second);
+    value = it->second->second;
+    hits_++;
+    return true;
+  }
+
+  /// Inserts @p value unless another thread did it first, in which case the
+  /// existing value is returned through @p value.
+  void insert(const key_type& key, value_type& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capacity_ == 0)
+      return;
+    auto it = map_.find(key);
+    if (it != map_.end()) {
+      list_.splice(list_.begin(), list_, it->second);
+      value = it->second->second;
+      return;
+    }
+    list_.emplace_front(key, value);
+    map_.emplace(key, list_.begin());
+    evict_to(capacity_);
+  }
+
+  void set_capacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    evict_to(capacity_);
+  }
+
+  size_t get_capacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    map_.clear();
+    list_.clear();
+    hits_ = misses_ = evictions_ = 0;
+  }
+
+  stats_t get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {capacity_, map_.size(), hits_, misses_, evictions_};
+  }
+
+ private:
+  void evict_to(size_t capacity) {
+    while (map_.size() > capacity) {
+      map_.erase(list_.back().first);
+      list_.pop_back();
+      evictions_++;
+    }
+  }
+
+  using node_t = std::pair<key_type, value_type>;
+
+  mutable std::mutex mutex_;
+  size_t capacity_;
+  std::list<node_t> list_;
+  std::unordered_map<key_type, typename std::list<node_t>::iterator> map_;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t evictions_ = 0;
+};
+
+// Serialization of primitive creation arguments into a cache key. Every
+// overload appends a fixed-size or length-prefixed record, so concatenating
+// them never makes two different argument lists collide.
+
+template <typename T,
+          typename = typename std::enable_if<std::is_arithmetic<T>::value ||
+                                             std::is_enum<T>::value>::type>
+inline void to_bytes(key_t& bytes, const T arg) {
+  bytes.append(reinterpret_cast<const char*>(&arg), sizeof(T));
+}
+
+template <typename T>
+inline void to_bytes(key_t& bytes, const T* arg, size_t size) {
+  to_bytes(bytes, size);
+  bytes.append(reinterpret_cast<const char*>(arg), size * sizeof(T));
+}
+
+inline void to_bytes(key_t& bytes, const char* arg) {
+  to_bytes(bytes, arg, std::strlen(arg));
+}
+
+inline void to_bytes(key_t& bytes, const dims& arg) {
+  to_bytes(bytes, arg.data(), arg.size());
+}
+
+inline void to_bytes(key_t& bytes, const scale_t& arg) {
+  to_bytes(bytes, arg.data(), arg.size());
+}
+
+inline void to_bytes(key_t& bytes, const std::vector<int32_t>& arg) {
+  to_bytes(bytes, arg.data(), arg.size());
+}
+
+inline void to_bytes(key_t& bytes, const tensor::desc& adesc) {
+  // Only serialize the fields that are meaningful for this descriptor, the
+  // unused tails of the arrays are not guaranteed to be zeroed.
+  const auto& md = adesc.data;
+  auto ndims = md.ndims;
+  to_bytes(bytes, ndims);
+  to_bytes(bytes, md.data_type);
+  to_bytes(bytes, md.format_kind);
+  to_bytes(bytes, md.dims, ndims);
+  to_bytes(bytes, md.padded_dims, ndims);
+  to_bytes(bytes, md.padded_offsets, ndims);
+  to_bytes(bytes, md.offset0);
+  if (md.format_kind == dnnl_blocked) {
+    const auto& blk = md.format_desc.blocking;
+    to_bytes(bytes, blk.strides, ndims);
+    to_bytes(bytes, blk.inner_blks, blk.inner_nblks);
+    to_bytes(bytes, blk.inner_idxs, blk.inner_nblks);
+  } else if (md.format_kind != dnnl_format_kind_any &&
+             md.format_kind != dnnl_format_kind_undef) {
+    // opaque formats (wino, rnn_packed) are produced by the library itself
+    to_bytes(bytes, reinterpret_cast<const char*>(&md.format_desc),
+             sizeof(md.format_desc));
+  }
+  to_bytes(bytes, md.extra.flags);
+  if (md.extra.flags & dnnl_memory_extra_flag_compensation_conv_s8s8)
+    to_bytes(bytes, md.extra.compensation_mask);
+  if (md.extra.flags & dnnl_memory_extra_flag_scale_adjust)
+    to_bytes(bytes, md.extra.scale_adjust);
+}
+
+inline void to_bytes(key_t& bytes, const attr_t& attr) {
+  scale_t scales;
+  int mask;
+  std::tie(scales, mask) = attr.get_output_scales();
+  to_bytes(bytes, mask);
+  to_bytes(bytes, scales);
+
+  for (auto arg : {DNNL_ARG_SRC, DNNL_ARG_WEIGHTS, DNNL_ARG_DST}) {
+    std::vector<int32_t> zero_points;
+    attr.get_zero_points(arg, mask, zero_points);
+    to_bytes(bytes, mask);
+    to_bytes(bytes, zero_points);
+  }
+
+  to_bytes(bytes, attr.get_scratchpad_mode());
+
+  auto po = attr.get_post_ops();
+  to_bytes(bytes, po.len());
+  for (int i = 0; i < po.len(); i++) {
+    auto akind = po.kind(i);
+    to_bytes(bytes, akind);
+    if (akind == kind::sum || akind == kind::eltwise) {
+      kind op_kind;
+      float scale, alpha, beta;
+      algorithm alg;
+      std::tie(op_kind, scale, alpha, beta, alg) = attr.get_params(i);
+      to_bytes(bytes, scale);
+      to_bytes(bytes, alpha);
+      to_bytes(bytes, beta);
+      to_bytes(bytes, alg);
+    }
+  }
+}
+
+// the rnn qparams are not readable back from a dnnl::primitive_attr, the rnn
+// operators key on them instead of on the attr
+inline void to_bytes(key_t& bytes, const rnn_qparams_t& arg) {
+  to_bytes(bytes, arg.data_scale);
+  to_bytes(bytes, arg.data_shift);
+  to_bytes(bytes, arg.weights_scales);
+}
+
+inline void create_key_impl(key_t& key) {}
+
+template <typename T, typename... Ts>
+inline void create_key_impl(key_t& key, const T& arg, const Ts&... args) {
+  to_bytes(key, arg);
+  create_key_impl(key, args...);
+}
+
+/// Builds a cache key out of every argument that affects primitive creation.
+/// By convention the first argument is a string naming the operator, so
+/// entries of different primitive kinds never alias.
+template <typename... Ts>
+inline key_t create_key(const Ts&... args) {
+  key_t key;
+  key.reserve(256);
+  create_key_impl(key, args...);
+  return key;
+}
+
+}  // namespace utils
+
+/// Process-wide cache of primitive descriptors and primitives shared by the
+/// dil operators. Capacity comes from DIL_PRIMITIVE_CACHE_CAPACITY (default
+/// 1024), and a capacity of 0 disables caching.
+struct primitive_cache : public utils::lru_cache<key_t, std::shared_ptr<void>> {
+  using super = utils::lru_cache<key_t, std::shared_ptr<void>>;
+
+  static constexpr size_t default_capacity = 1024;
+
+  explicit primitive_cache(size_t capacity) : super(capacity) {}
+
+  static DIL_EXPORT primitive_cache& get();
+
+  /// Returns the cached value for @p key, or calls @p creator and caches
+  /// its result. Keys always start with the operator name, so one key is
+  /// always bound to the same @p value_t.
+  template <typename value_t, typename creator_t>
+  static value_t fetch_or_create(const key_t& key, creator_t&& creator) {
+    auto& cache = get();
+    std::shared_ptr<void> entry;
+    if (cache.find(key, entry)) {
+      return *std::static_pointer_cast<value_t>(entry);
+    }
+    entry = std::make_shared<value_t>(creator());
+    cache.insert(key, entry);
+    return *std::static_pointer_cast<value_t>(entry);
+  }
+};
+
+}  // namespace dil
+
+#endif
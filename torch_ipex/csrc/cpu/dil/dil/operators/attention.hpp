@@ -0,0 +1,266 @@
+#ifndef DIL_OPERATORS_ATTENTION_HPP
+#define DIL_OPERATORS_ATTENTION_HPP
+
+namespace dil {
+
+// Scaled dot product attention of [B, H, S, D] query, key and value:
+//
+//   dst = softmax(query * key^T * scale + mask) * value
+//
+// A head is usually a block of D channels of a [B, S, H * D] projection, so
+// the operands are read through their strides and only D has to be dense.
+//
+// Each query tile walks the keys tile by tile with an online softmax: it keeps
+// the running max and the running sum of exponentials of its rows and an
+// unnormalized output that is rescaled whenever the max grows. The scores
+// never exceed a q_block x k_block tile and all the buffers of a tile stay in
+// the L2 cache.
+struct attention_forward {
+  static constexpr dim q_block = 64;
+  static constexpr dim k_block = 64;
+
+  // query, key and value are f32, bf16, s8 or u8. There is no int8 compute,
+  // s8 and u8 operands are only dequantized to f32 as they are read. mask is
+  // empty or an f32 tensor of rank <= 4 broadcastable to [B, H, Sq, Sk]. dst
+  // is a contiguous [B, H, Sq, D], or [B, H, Sq, D] laid out as [B, Sq, H * D]
+  // if interleave_heads is set, bf16 if query is bf16 and f32 otherwise.
+  static void compute(const tensor& query, const tensor& key,
+                      const tensor& value, const tensor& mask, float scale,
+                      tensor& dst, bool interleave_heads = false) {
+    const auto q_dims = query.get_dims();
+    const auto k_dims = key.get_dims();
+    DIL_ENFORCE(q_dims.size() == 4 && k_dims.size() == 4 &&
+                    value.get_dims() == k_dims,
+                "Attention expects [B, H, S, D] query, key and value");
+    DIL_ENFORCE(q_dims[0] == k_dims[0] && q_dims[1] == k_dims[1] &&
+                    q_dims[3] == k_dims[3],
+                "Attention query and key do not match");
+    const dim B = q_dims[0], H = q_dims[1], Sq = q_dims[2], D = q_dims[3];
+    const dim Sk = k_dims[2];
+
+    const operand q(query, scale), k(key), v(value);
+    dims mask_strides(4, 0);
+    const float* mask_data = nullptr;
+    if (!mask.is_empty()) {
+      DIL_ENFORCE(mask.get_data_type() == data_type::f32 &&
+                      mask.is_public_format(),
+                  "Attention mask should be a plain f32 tensor");
+      const auto m_dims = mask.get_dims();
+      const auto m_strides = mask.get_strides();
+      const dims full {B, H, Sq, Sk};
+      const int ndims = static_cast<int>(m_dims.size());
+      DIL_ENFORCE(ndims <= 4, "Attention mask should have at most 4 dims");
+      for (int i = 0; i < ndims; i++) {
+        const int d = 4 - ndims + i;
+        DIL_ENFORCE(m_dims[i] == full[d] || m_dims[i] == 1,
+                    "Attention mask is not broadcastable to the scores");
+        mask_strides[d] = m_dims[i] == 1 ? 0 : m_strides[i];
+      }
+      mask_data = static_cast<const float*>(mask.get_data_handle());
+    }
+
+    const auto dst_type = query.get_data_type() == data_type::bf16
+                              ? data_type::bf16
+                              : data_type::f32;
+    const dims dst_strides = interleave_heads
+                                 ? dims {Sq * H * D, D, H * D, 1}
+                                 : dims {H * Sq * D, Sq * D, D, 1};
+    dst.reinit_if_possible({{B, H, Sq, D}, dst_type, dst_strides});
+    const operand out(dst);
+    const store_fn store = dst_type == data_type::bf16 ? store_row<uint16_t>
+                                                       : store_row<float>;
+
+    const dim nq = (Sq + q_block - 1) / q_block;
+    const dim nwork = B * H * nq;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      std::vector<float> q_buf(q_block * D), kt_buf(D * k_block),
+          v_buf(k_block * D), s_buf(q_block * k_block), acc(q_block * D),
+          row_max(q_block), row_sum(q_block);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (dim w = 0; w < nwork; w++) {
+        const dim b = w / (H * nq);
+        const dim h = w / nq % H;
+        const dim q0 = w % nq * q_block;
+        const dim bq = std::min(Sq - q0, static_cast<dim>(q_block));
+        for (dim i = 0; i < bq; i++) {
+          q.load(q.row(b, h, q0 + i), D, q_buf.data() + i * D);
+        }
+        std::fill(acc.begin(), acc.end(), 0.f);
+        std::fill(row_max.begin(), row_max.end(),
+                  -std::numeric_limits<float>::infinity());
+        std::fill(row_sum.begin(), row_sum.end(), 0.f);
+
+        for (dim k0 = 0; k0 < Sk; k0 += k_block) {
+          const dim bk = std::min(Sk - k0, static_cast<dim>(k_block));
+          // the key tile is transposed so that a score row is a sum of
+          // D axpys over the keys
+          for (dim j = 0; j < bk; j++) {
+            auto row = v_buf.data();
+            k.load(k.row(b, h, k0 + j), D, row);
+            for (dim d = 0; d < D; d++) {
+              kt_buf[d * k_block + j] = row[d];
+            }
+          }
+          for (dim j = 0; j < bk; j++) {
+            v.load(v.row(b, h, k0 + j), D, v_buf.data() + j * D);
+          }
+
+          for (dim i = 0; i < bq; i++) {
+            auto s = s_buf.data() + i * k_block;
+            const auto qi = q_buf.data() + i * D;
+            std::fill(s, s + bk, 0.f);
+            for (dim d = 0; d < D; d++) {
+              const float qd = qi[d];
+              const auto kt = kt_buf.data() + d * k_block;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+              for (dim j = 0; j < bk; j++) {
+                s[j] += qd * kt[j];
+              }
+            }
+            if (mask_data) {
+              const auto m = mask_data + b * mask_strides[0] +
+                             h * mask_strides[1] +
+                             (q0 + i) * mask_strides[2] + k0 * mask_strides[3];
+              const dim ms = mask_strides[3];
+              for (dim j = 0; j < bk; j++) {
+                s[j] += m[j * ms];
+              }
+            }
+
+            float tile_max = -std::numeric_limits<float>::infinity();
+            for (dim j = 0; j < bk; j++) {
+              tile_max = std::max(tile_max, s[j]);
+            }
+            const float new_max = std::max(row_max[i], tile_max);
+            if (new_max == -std::numeric_limits<float>::infinity()) {
+              // the keys of the tile are all masked out so far
+              continue;
+            }
+            const float correction = std::exp(row_max[i] - new_max);
+            float tile_sum = 0.f;
+#ifdef _OPENMP
+#pragma omp simd reduction(+ : tile_sum)
+#endif
+            for (dim j = 0; j < bk; j++) {
+              s[j] = std::exp(s[j] - new_max);
+              tile_sum += s[j];
+            }
+            row_sum[i] = row_sum[i] * correction + tile_sum;
+            row_max[i] = new_max;
+
+            auto a = acc.data() + i * D;
+            if (correction != 1.f) {
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+              for (dim d = 0; d < D; d++) {
+                a[d] *= correction;
+              }
+            }
+            for (dim j = 0; j < bk; j++) {
+              const float p = s[j];
+              const auto vj = v_buf.data() + j * D;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+              for (dim d = 0; d < D; d++) {
+                a[d] += p * vj[d];
+              }
+            }
+          }
+        }
+
+        for (dim i = 0; i < bq; i++) {
+          // a fully masked row is 0 / 0 as in softmax
+          store(acc.data() + i * D, D, 1.f / row_sum[i],
+                const_cast<char*>(out.row(b, h, q0 + i)));
+        }
+      }
+    }
+  }
+
+ private:
+  using load_fn = void (*)(const void*, dim, float, float*);
+  using store_fn = void (*)(const float*, dim, float, void*);
+
+  template <typename T>
+  static void load_row(const void* src, dim len, float mul, float* dst) {
+    const auto data = static_cast<const T*>(src);
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+    for (dim i = 0; i < len; i++) {
+      dst[i] = utils::io<T>::load(data[i]) * mul;
+    }
+  }
+
+  template <typename T>
+  static void store_row(const float* src, dim len, float mul, void* dst) {
+    const auto data = static_cast<T*>(dst);
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+    for (dim i = 0; i < len; i++) {
+      data[i] = utils::io<T>::store(src[i] * mul);
+    }
+  }
+
+  // A strided [B, H, S, D] operand, its rows are loaded as f32 multiplied by
+  // `mul` and by the dequantization scale of an int8 tensor
+  struct operand {
+    const char* data;
+    dims strides;
+    dim item_size;
+    float mul;
+    load_fn loader;
+
+    operand(const tensor& t, float scale = 1.f)
+        : data(static_cast<const char*>(t.get_data_handle())),
+          item_size(t.get_item_size()),
+          mul(scale) {
+      DIL_ENFORCE(t.is_public_format(), "Attention expects plain tensors");
+      strides = t.get_strides();
+      DIL_ENFORCE(strides[3] == 1, "Attention expects a dense head dim");
+      switch (t.get_data_type()) {
+        case data_type::f32:
+          loader = load_row<float>;
+          break;
+        case data_type::bf16:
+          loader = load_row<uint16_t>;
+          break;
+        case data_type::s8:
+          loader = load_row<int8_t>;
+          break;
+        case data_type::u8:
+          loader = load_row<uint8_t>;
+          break;
+        default:
+          throw error(dnnl_invalid_arguments, "Unsupported dnnl data type");
+      }
+      if (t.has_scale() && utils::one_of(t.get_data_type(), data_type::s8,
+                                         data_type::u8)) {
+        mul /= t.get_scale()[0];
+      }
+    }
+
+    const char* row(dim b, dim h, dim s) const {
+      return data + (b * strides[0] + h * strides[1] + s * strides[2]) *
+                        item_size;
+    }
+
+    void load(const char* src, dim len, float* dst) const {
+      loader(src, len, mul, dst);
+    }
+  };
+};
+
+}  // namespace dil
+
+#endif
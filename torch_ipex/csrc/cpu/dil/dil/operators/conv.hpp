@@ -5,6 +5,7 @@ namespace dil {
 
 struct convolution_forward_params {
   dnnl::convolution_forward::primitive_desc pd;
+  dnnl::convolution_forward primitive;
   // bias_attr contains requantization scales for bias
   attr_t bias_attr;
   scale_t dst_scales;
@@ -337,6 +338,13 @@ private:
         op_attr = attr_t::fuse_relu();
       }
       op_attr.set_output_scales(utils::op_scale_mask(scale_size), op_scales);
+      // asymmetric u8 src, DNNL compensates the zero point in the kernel
+      if (src.has_zero_point()) {
+        DIL_ENFORCE(src.get_zero_point().size() == 1,
+                    "DNNL only support 1-dim zero_point");
+        op_attr.set_zero_points(
+            DNNL_ARG_SRC, utils::tensor_zp_mask(1), src.get_zero_point());
+      }
 
       src_desc = {src.get_dims(),
                   alowp_kind == u8s8 ? data_type::u8 : data_type::s8, tag::any};
@@ -390,14 +398,23 @@ private:
                         ? dst.get_desc()
                         : tensor::desc(dst_dims, dst_data_type);
 
-    auto pd = get_primitive_desc<with_bias>(
-        src_desc, weights_desc, bias_desc, dst_desc, strides, dilates_,
-        padding_l, padding_r, op_attr, aalgorithm, aprop_kind, aengine);
+    auto key = utils::create_key(
+        "convolution_forward", with_bias, src_desc, weights_desc, bias_desc,
+        dst_desc, strides, dilates_, padding_l, padding_r, op_attr,
+        aalgorithm, aprop_kind);
+    auto cached = primitive_cache::fetch_or_create<
+        std::pair<primitive_desc, super>>(key, [&]() {
+      auto pd = get_primitive_desc<with_bias>(
+          src_desc, weights_desc, bias_desc, dst_desc, strides, dilates_,
+          padding_l, padding_r, op_attr, aalgorithm, aprop_kind, aengine);
+      return std::make_pair(pd, super(pd));
+    });
+    auto& pd = cached.first;
 
     // allocate scratchpad
     tensor scratchpad(pd.scratchpad_desc());
 
-    param = {pd, bias_attr, dst_scales, groups, scratchpad};
+    param = {pd, cached.second, bias_attr, dst_scales, groups, scratchpad};
   }
 
   template <bool with_bias>
@@ -418,18 +435,18 @@ private:
     if (with_bias) {
       auto expected_bias =
           bias.reorder_if_differ_in(pd.bias_desc(), param.bias_attr);
-      super(pd).execute(stream::default_stream(), 
-                        {{DNNL_ARG_SRC, expected_src},
-                         {DNNL_ARG_WEIGHTS, expected_weights},
-                         {DNNL_ARG_BIAS, expected_bias},
-                         {DNNL_ARG_DST, dst},
-                         {DNNL_ARG_SCRATCHPAD, scratchpad}});
+      param.primitive.execute(stream::default_stream(),
+                              {{DNNL_ARG_SRC, expected_src},
+                               {DNNL_ARG_WEIGHTS, expected_weights},
+                               {DNNL_ARG_BIAS, expected_bias},
+                               {DNNL_ARG_DST, dst},
+                               {DNNL_ARG_SCRATCHPAD, scratchpad}});
     } else {
-      super(pd).execute(stream::default_stream(), 
-                        {{DNNL_ARG_SRC, expected_src},
-                         {DNNL_ARG_WEIGHTS, expected_weights},
-                         {DNNL_ARG_DST, dst},
-                         {DNNL_ARG_SCRATCHPAD, scratchpad}});
+      param.primitive.execute(stream::default_stream(),
+                              {{DNNL_ARG_SRC, expected_src},
+                               {DNNL_ARG_WEIGHTS, expected_weights},
+                               {DNNL_ARG_DST, dst},
+                               {DNNL_ARG_SCRATCHPAD, scratchpad}});
     }
   }
 };
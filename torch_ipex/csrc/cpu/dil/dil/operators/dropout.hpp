@@ -3,21 +3,104 @@
 
 namespace dil {
 
-struct dropout_forward {
-  static void compute(const tensor& src, float ratio, tensor& dst,
-                      tensor& mask) {
+// The dropout mask keeps one bit per element: bit (i % 8) of byte (i / 8) is
+// set if element i is kept. The elements are indexed in the order of the src
+// buffer, so src, dst and diff_dst are expected to share one desc.
+//
+// Element i is kept if the i-th number of the counter based Philox4x32-10
+// stream keyed by `seed` is below (1 - ratio) * 2^32. Each counter value gives
+// the numbers of 4 elements, so any range of elements can be drawn on its own
+// and the mask of a seed does not depend on the number of threads.
+struct dropout_utils {
+  static constexpr dim block_size = 512;
+
+  static dim get_mask_size(dim nelems) { return (nelems + 7) / 8; }
+
+  static tensor::desc get_mask_desc(dim nelems) {
+    return {{get_mask_size(nelems)}, data_type::u8, format_tag::a};
+  }
+
+  static inline void philox4x32_10(uint64_t counter, uint32_t k0, uint32_t k1,
+                                   uint32_t* out) {
+    uint32_t c0 = static_cast<uint32_t>(counter);
+    uint32_t c1 = static_cast<uint32_t>(counter >> 32);
+    uint32_t c2 = 0, c3 = 0;
+    for (int r = 0; r < 10; r++) {
+      const uint64_t p0 = static_cast<uint64_t>(0xD2511F53) * c0;
+      const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57) * c2;
+      c0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+      c1 = static_cast<uint32_t>(p1);
+      c2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+      c3 = static_cast<uint32_t>(p0);
+      k0 += 0x9E3779B9;
+      k1 += 0xBB67AE85;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+  }
+
+  // Draws the numbers of the elements [start, start + len) into `rnd`, start
+  // is a multiple of 4 and rnd holds len rounded up to 4 numbers.
+  static inline void generate(uint64_t seed, dim start, dim len,
+                              uint32_t* rnd) {
+    const uint32_t k0 = static_cast<uint32_t>(seed);
+    const uint32_t k1 = static_cast<uint32_t>(seed >> 32);
+    const uint64_t first = static_cast<uint64_t>(start / 4);
+    const dim n = (len + 3) / 4;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+    for (dim c = 0; c < n; c++) {
+      philox4x32_10(first + c, k0, k1, rnd + 4 * c);
+    }
+  }
+
+  static inline uint64_t keep_threshold(float ratio) {
+    return static_cast<uint64_t>((1.0 - ratio) * 4294967296.0);
+  }
+
+  template <typename T>
+  using io = utils::io<T>;
+};
+
+struct dropout_forward : public dropout_utils {
+  // dst = dropout(src)
+  static void compute(const tensor& src, float ratio, uint64_t seed,
+                      tensor& dst, tensor& mask) {
     switch (src.get_data_type()) {
       case data_type::f32:
-        compute_impl<float>(src, ratio, dst, mask);
+        compute_impl<float, false>(src, src, ratio, seed, dst, mask);
+        break;
+      case data_type::bf16:
+        compute_impl<uint16_t, false>(src, src, ratio, seed, dst, mask);
         break;
       case data_type::s32:
-        compute_impl<int32_t>(src, ratio, dst, mask);
+        compute_impl<int32_t, false>(src, src, ratio, seed, dst, mask);
         break;
       case data_type::s8:
-        compute_impl<int8_t>(src, ratio, dst, mask);
+        compute_impl<int8_t, false>(src, src, ratio, seed, dst, mask);
         break;
       case data_type::u8:
-        compute_impl<uint8_t>(src, ratio, dst, mask);
+        compute_impl<uint8_t, false>(src, src, ratio, seed, dst, mask);
+        break;
+      default:
+        throw error(dnnl_invalid_arguments, "Unsupported dnnl data type");
+    }
+  }
+
+  // dst = dropout(src) + residual, residual has the desc of src
+  static void compute(const tensor& src, const tensor& residual, float ratio,
+                      uint64_t seed, tensor& dst, tensor& mask) {
+    DIL_ENFORCE(residual.get_desc() == src.get_desc(),
+                "Dropout residual should have the desc of src");
+    switch (src.get_data_type()) {
+      case data_type::f32:
+        compute_impl<float, true>(src, residual, ratio, seed, dst, mask);
+        break;
+      case data_type::bf16:
+        compute_impl<uint16_t, true>(src, residual, ratio, seed, dst, mask);
         break;
       default:
         throw error(dnnl_invalid_arguments, "Unsupported dnnl data type");
@@ -25,52 +108,81 @@ struct dropout_forward {
   }
 
  private:
-  template <typename T>
-  static void compute_impl(const tensor& src, float ratio, tensor& dst,
+  template <typename T, bool with_residual>
+  static void compute_impl(const tensor& src, const tensor& residual,
+                           float ratio, uint64_t seed, tensor& dst,
                            tensor& mask) {
-    mask.reinit_if_possible(src.get_desc());
+    const auto nelems = src.get_nelems();
+    mask.reinit_if_possible(get_mask_desc(nelems));
     dst.reinit_if_possible(src.get_desc());
-    if (src.has_scale()) {
+    if (!with_residual && src.has_scale()) {
       dst.set_scale(src.get_scale());
     }
 
-    const auto scale = 1.0 / (1.0 - ratio);
-    const auto size = src.get_size() / sizeof(T);
-    std::unique_ptr<int[]> bernouli_nums(new int[size]);
-    utils::bernoulli_generate(size, 1.0 - ratio, bernouli_nums.get());
-
-    const auto src_data = static_cast<T*>(src.get_data_handle());
-    const auto mask_data = static_cast<T*>(mask.get_data_handle());
+    const float scale = 1.0f / (1.0f - ratio);
+    const uint64_t threshold = keep_threshold(ratio);
+    const auto src_data = static_cast<const T*>(src.get_data_handle());
+    const auto res_data = static_cast<const T*>(residual.get_data_handle());
     const auto dst_data = static_cast<T*>(dst.get_data_handle());
+    const auto mask_data = static_cast<uint8_t*>(mask.get_data_handle());
+    const dim nblocks = (nelems + block_size - 1) / block_size;
 #ifdef _OPENMP
-#if (_OPENMP >= 201307)
-# pragma omp parallel for simd
-#else
-# pragma omp parallel for schedule(static)
+#pragma omp parallel for schedule(static)
 #endif
+    for (dim b = 0; b < nblocks; b++) {
+      const dim start = b * block_size;
+      const dim len = std::min(nelems - start, static_cast<dim>(block_size));
+      uint32_t rnd[block_size];
+      uint8_t keep[block_size];
+      generate(seed, start, len, rnd);
+#ifdef _OPENMP
+#pragma omp simd
 #endif
-    for (auto i = 0; i < size; i++) {
-      mask_data[i] = bernouli_nums[i] * scale;
-      dst_data[i] = mask_data[i] * src_data[i];
+      for (dim i = 0; i < len; i++) {
+        keep[i] = rnd[i] < threshold;
+        float v = keep[i] ? io<T>::load(src_data[start + i]) * scale : 0.f;
+        if (with_residual) {
+          v += io<T>::load(res_data[start + i]);
+        }
+        dst_data[start + i] = io<T>::store(v);
+      }
+      const dim nbytes = get_mask_size(len);
+      for (dim i = len; i < nbytes * 8; i++) {
+        keep[i] = 0;
+      }
+      auto block_mask = mask_data + start / 8;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+      for (dim j = 0; j < nbytes; j++) {
+        uint8_t bits = 0;
+        for (int k = 0; k < 8; k++) {
+          bits |= keep[8 * j + k] << k;
+        }
+        block_mask[j] = bits;
+      }
     }
   }
 };
 
-struct dropout_backward {
-  static void compute(const tensor& mask, const tensor& diff_dst,
+struct dropout_backward : public dropout_utils {
+  static void compute(const tensor& mask, float ratio, const tensor& diff_dst,
                       tensor& diff_src) {
     switch (diff_dst.get_data_type()) {
       case data_type::f32:
-        compute_impl<float>(mask, diff_dst, diff_src);
+        compute_impl<float>(mask, ratio, diff_dst, diff_src);
+        break;
+      case data_type::bf16:
+        compute_impl<uint16_t>(mask, ratio, diff_dst, diff_src);
         break;
       case data_type::s32:
-        compute_impl<int32_t>(mask, diff_dst, diff_src);
+        compute_impl<int32_t>(mask, ratio, diff_dst, diff_src);
         break;
       case data_type::s8:
-        compute_impl<int8_t>(mask, diff_dst, diff_src);
+        compute_impl<int8_t>(mask, ratio, diff_dst, diff_src);
         break;
       case data_type::u8:
-        compute_impl<uint8_t>(mask, diff_dst, diff_src);
+        compute_impl<uint8_t>(mask, ratio, diff_dst, diff_src);
         break;
       default:
         throw error(dnnl_invalid_arguments, "Unsupported dnnl data type!");
@@ -79,23 +191,35 @@ struct dropout_backward {
 
  private:
   template <typename T>
-  static void compute_impl(const tensor& mask, const tensor& diff_dst,
-                           tensor& diff_src) {
+  static void compute_impl(const tensor& mask, float ratio,
+                           const tensor& diff_dst, tensor& diff_src) {
+    const auto nelems = diff_dst.get_nelems();
+    DIL_ENFORCE(mask.get_nelems() == get_mask_size(nelems),
+                "Dropout mask does not match diff_dst");
     diff_src.reinit_if_possible(diff_dst.get_desc());
+    if (diff_dst.has_scale()) {
+      diff_src.set_scale(diff_dst.get_scale());
+    }
 
-    const auto size = mask.get_size() / sizeof(T);
-    const auto mask_data = static_cast<T*>(mask.get_data_handle());
-    const auto diff_dst_data = static_cast<T*>(diff_dst.get_data_handle());
+    const float scale = 1.0f / (1.0f - ratio);
+    const auto mask_data = static_cast<const uint8_t*>(mask.get_data_handle());
+    const auto diff_dst_data = static_cast<const T*>(diff_dst.get_data_handle());
     const auto diff_src_data = static_cast<T*>(diff_src.get_data_handle());
 #ifdef _OPENMP
-#pragma omp parallel for schedule(static)
+#if (_OPENMP >= 201307)
+# pragma omp parallel for simd
+#else
+# pragma omp parallel for schedule(static)
 #endif
-    for (auto i = 0; i < size; i++) {
-      diff_src_data[i] = mask_data[i] * diff_dst_data[i];
+#endif
+    for (dim i = 0; i < nelems; i++) {
+      const bool kept = (mask_data[i >> 3] >> (i & 7)) & 1;
+      diff_src_data[i] = io<T>::store(
+          kept ? io<T>::load(diff_dst_data[i]) * scale : 0.f);
     }
   }
 };
 
 }  // namespace dil
 
-#endif
\ No newline at end of file
+#endif
@@ -106,6 +106,12 @@ private:
     scale_t dst_scales_in;
     data_type dst_data_type;
     auto dst_dims = {src.get_dim(0), weights.get_dim(0)};
+    const bool with_sum = attr.has_op_kind(kind::sum);
+    if (with_sum) {
+      DIL_ENFORCE(dst.ndims() == 2 && dst.get_dim(0) == src.get_dim(0) &&
+                      dst.get_dim(1) == weights.get_dim(0),
+                  "Inner product sum expects a dst of the output dims");
+    }
 
     auto weights_scales_in =
         weights.has_scale() ? weights.get_scale() : weights_scales;
@@ -137,7 +143,9 @@ private:
       }
 
       // determine dst data type
-      if (dst_scales.empty() || dst_scales == DIL_DEF_SCALE) {
+      if (with_sum) {
+        dst_data_type = dst.get_data_type();
+      } else if (dst_scales.empty() || dst_scales == DIL_DEF_SCALE) {
         dst_data_type = data_type::f32;
       } else if (attr.non_negitive_output()) {
         dst_data_type = data_type::u8;
@@ -155,6 +163,24 @@ private:
         op_scales[i] = dst_scales_in[0] / bias_scales[i];
       }
       op_attr.set_output_scales(utils::op_scale_mask(scale_size), op_scales);
+      if (with_sum) {
+        // the accumulated dst is requantized to the scale of the output
+        float sum_scale =
+            dst_scales_in[0] / (dst.has_scale() ? dst.get_scale()[0] : 1.0f);
+        post_ops po;
+        for (int i = 0; i < attr.get_post_ops().len(); i++) {
+          kind akind;
+          float scale, alpha, beta;
+          algorithm alg;
+          std::tie(akind, scale, alpha, beta, alg) = attr.get_params(i);
+          if (akind == kind::sum) {
+            po.append_sum(scale * sum_scale);
+          } else {
+            po.append_eltwise(scale, alg, alpha, beta);
+          }
+        }
+        op_attr.set_post_ops(po);
+      }
 
       if (with_bias) {
         bias_desc = {bias.get_dims(), data_type::s32, format_tag::any};
@@ -188,12 +214,23 @@ private:
       }
     }
 
-    tensor::desc dst_desc(dst_dims, dst_data_type, format_tag::any);
-    auto pd = with_bias
-       ? primitive_desc({aprop_kind, src_desc, weights_desc, bias_desc,
-                         dst_desc}, op_attr, aengine)
-       : primitive_desc({aprop_kind, src_desc, weights_desc, dst_desc},
-                        op_attr, aengine);
+    // the dst of a sum post op holds the accumulator already
+    tensor::desc dst_desc = with_sum
+        ? dst.get_desc()
+        : tensor::desc(dst_dims, dst_data_type, format_tag::any);
+    auto key = utils::create_key(
+        "inner_product_forward", with_bias, src_desc, weights_desc, bias_desc,
+        dst_desc, op_attr, aprop_kind);
+    auto cached = primitive_cache::fetch_or_create<
+        std::pair<primitive_desc, super>>(key, [&]() {
+      auto pd = with_bias
+         ? primitive_desc({aprop_kind, src_desc, weights_desc, bias_desc,
+                           dst_desc}, op_attr, aengine)
+         : primitive_desc({aprop_kind, src_desc, weights_desc, dst_desc},
+                          op_attr, aengine);
+      return std::make_pair(pd, super(pd));
+    });
+    auto& pd = cached.first;
 
     auto expected_src = src.reorder_if_differ_in(pd.src_desc(), src_attr);
     auto expected_weights = weights.reorder_if_differ_in(pd.weights_desc(), weights_attr);
@@ -204,16 +241,16 @@ private:
 
     if (with_bias){
       auto expected_bias = bias.reorder_if_differ_in(pd.bias_desc(), bias_attr);
-      super(pd).execute(stream::default_stream(),
-                        {{DNNL_ARG_SRC, expected_src},
-                         {DNNL_ARG_WEIGHTS, expected_weights},
-                         {DNNL_ARG_BIAS, expected_bias},
-                         {DNNL_ARG_DST, dst}});
+      cached.second.execute(stream::default_stream(),
+                            {{DNNL_ARG_SRC, expected_src},
+                             {DNNL_ARG_WEIGHTS, expected_weights},
+                             {DNNL_ARG_BIAS, expected_bias},
+                             {DNNL_ARG_DST, dst}});
     } else {
-      super(pd).execute(stream::default_stream(),
-                        {{DNNL_ARG_SRC, expected_src},
-                         {DNNL_ARG_WEIGHTS, expected_weights},
-                         {DNNL_ARG_DST, dst}});
+      cached.second.execute(stream::default_stream(),
+                            {{DNNL_ARG_SRC, expected_src},
+                             {DNNL_ARG_WEIGHTS, expected_weights},
+                             {DNNL_ARG_DST, dst}});
     }
 
     if (attr.non_negitive_output() && dst.get_data_type() == data_type::s8) {
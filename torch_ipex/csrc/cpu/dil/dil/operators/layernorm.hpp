@@ -112,6 +112,314 @@ struct layer_normalization_backward : public dnnl::layer_normalization_backward
   }
 };
 
+// layer_norm(dropout(src) + residual) over the rows of norm_size elements of
+// plain tensors, fp32 or bf16 with fp32 scale, shift and statistics. A row is
+// read once: its sum goes to a row buffer while a vectorized Welford gathers
+// the statistics, then it is normalized from the buffer. `sum` keeps the rows
+// for the backward if keep_sum is set, `mask` the dropout bits if ratio > 0,
+// which needs norm_size to be a multiple of 8 for the rows to own their bytes.
+struct add_layer_normalization_forward : public dropout_utils {
+  static constexpr int lanes = 16;
+
+  static void compute(const tensor& src,
+                      const tensor& residual,
+                      const tensor& scale,
+                      const tensor& shift,
+                      tensor& dst,
+                      tensor& sum,
+                      tensor& mean,
+                      tensor& rstd,
+                      tensor& mask,
+                      dim norm_size,
+                      float epsilon,
+                      float ratio = 0.f,
+                      uint64_t seed = 0,
+                      bool keep_sum = false) {
+    DIL_ENFORCE(residual.get_desc() == src.get_desc(),
+                "Residual should have the desc of src");
+    DIL_ENFORCE(ratio == 0.f || norm_size % 8 == 0,
+                "Dropout needs rows of a multiple of 8 elements");
+    switch (src.get_data_type()) {
+      case data_type::f32:
+        compute_impl<float>(src, residual, scale, shift, dst, sum, mean, rstd,
+                            mask, norm_size, epsilon, ratio, seed, keep_sum);
+        break;
+      case data_type::bf16:
+        compute_impl<uint16_t>(src, residual, scale, shift, dst, sum, mean,
+                               rstd, mask, norm_size, epsilon, ratio, seed,
+                               keep_sum);
+        break;
+      default:
+        throw error(dnnl_invalid_arguments, "Unsupported dnnl data type");
+    }
+  }
+
+ private:
+  // Chan's merge of the statistics (count, mean, m2) of two sets
+  static inline void merge(float& n, float& m, float& m2,
+                           float nb, float mb, float m2b) {
+    const float total = n + nb;
+    const float delta = mb - m;
+    m += delta * nb / total;
+    m2 += m2b + delta * delta * n * nb / total;
+    n = total;
+  }
+
+  template <typename T>
+  static void compute_impl(const tensor& src, const tensor& residual,
+                           const tensor& scale, const tensor& shift,
+                           tensor& dst, tensor& sum, tensor& mean, tensor& rstd,
+                           tensor& mask, dim N, float epsilon, float ratio,
+                           uint64_t seed, bool keep_sum) {
+    const dim M = src.get_nelems() / N;
+    const tensor::desc stat_desc {{M}, data_type::f32, format_tag::a};
+    dst.reinit_if_possible(src.get_desc());
+    mean.reinit_if_possible(stat_desc);
+    rstd.reinit_if_possible(stat_desc);
+    if (keep_sum) {
+      sum.reinit_if_possible(src.get_desc());
+    }
+    const bool with_dropout = ratio > 0.f;
+    if (with_dropout) {
+      mask.reinit_if_possible(get_mask_desc(M * N));
+    }
+
+    const float drop_scale = 1.0f / (1.0f - ratio);
+    const uint64_t threshold = keep_threshold(ratio);
+    const auto src_data = static_cast<const T*>(src.get_data_handle());
+    const auto res_data = static_cast<const T*>(residual.get_data_handle());
+    const auto gamma = scale.is_empty()
+        ? nullptr : static_cast<const float*>(scale.get_data_handle());
+    const auto beta = shift.is_empty()
+        ? nullptr : static_cast<const float*>(shift.get_data_handle());
+    const auto dst_data = static_cast<T*>(dst.get_data_handle());
+    const auto sum_data = keep_sum ? static_cast<T*>(sum.get_data_handle()) : nullptr;
+    const auto mean_data = static_cast<float*>(mean.get_data_handle());
+    const auto rstd_data = static_cast<float*>(rstd.get_data_handle());
+    const auto mask_data = with_dropout
+        ? static_cast<uint8_t*>(mask.get_data_handle()) : nullptr;
+    const dim nvec = N / lanes;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      std::vector<float> row(N);
+      std::vector<uint32_t> rnd(with_dropout ? N : 0);
+      std::vector<uint8_t> keep(with_dropout ? N : 0);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (dim r = 0; r < M; r++) {
+        const dim offset = r * N;
+        if (with_dropout) {
+          generate(seed, offset, N, rnd.data());
+        }
+        auto load_sum = [&](dim j) {
+          float x = io<T>::load(src_data[offset + j]);
+          if (with_dropout) {
+            keep[j] = rnd[j] < threshold;
+            x = keep[j] ? x * drop_scale : 0.f;
+          }
+          x += io<T>::load(res_data[offset + j]);
+          row[j] = x;
+          if (keep_sum) {
+            sum_data[offset + j] = io<T>::store(x);
+          }
+          return x;
+        };
+
+        float lane_mean[lanes] = {0.f};
+        float lane_m2[lanes] = {0.f};
+        for (dim v = 0; v < nvec; v++) {
+          const float inv = 1.f / (v + 1);
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+          for (int l = 0; l < lanes; l++) {
+            const float x = load_sum(v * lanes + l);
+            const float delta = x - lane_mean[l];
+            lane_mean[l] += delta * inv;
+            lane_m2[l] += delta * (x - lane_mean[l]);
+          }
+        }
+        float n = 0.f, m = 0.f, m2 = 0.f;
+        if (nvec > 0) {
+          for (int l = 0; l < lanes; l++) {
+            merge(n, m, m2, nvec, lane_mean[l], lane_m2[l]);
+          }
+        }
+        for (dim j = nvec * lanes; j < N; j++) {
+          merge(n, m, m2, 1.f, load_sum(j), 0.f);
+        }
+
+        const float rs = 1.f / std::sqrt(m2 / N + epsilon);
+        mean_data[r] = m;
+        rstd_data[r] = rs;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+        for (dim j = 0; j < N; j++) {
+          float y = (row[j] - m) * rs;
+          if (gamma) y *= gamma[j];
+          if (beta) y += beta[j];
+          dst_data[offset + j] = io<T>::store(y);
+        }
+
+        if (with_dropout) {
+          auto row_mask = mask_data + offset / 8;
+          for (dim j = 0; j < N / 8; j++) {
+            uint8_t bits = 0;
+            for (int k = 0; k < 8; k++) {
+              bits |= keep[8 * j + k] << k;
+            }
+            row_mask[j] = bits;
+          }
+        }
+      }
+    }
+  }
+};
+
+// Backward of add_layer_normalization_forward from the sums, the statistics
+// and the mask it kept. diff_residual is the gradient of the sum, diff_src is
+// only written if ratio > 0, it is diff_residual otherwise. diff_scale and
+// diff_shift are fp32 and reduced over per thread partials.
+struct add_layer_normalization_backward : public dropout_utils {
+  static void compute(const tensor& sum,
+                      const tensor& mean,
+                      const tensor& rstd,
+                      const tensor& scale,
+                      const tensor& mask,
+                      const tensor& diff_dst,
+                      tensor& diff_src,
+                      tensor& diff_residual,
+                      tensor& diff_scale,
+                      tensor& diff_shift,
+                      dim norm_size,
+                      float ratio = 0.f) {
+    DIL_ENFORCE(diff_dst.get_desc() == sum.get_desc(),
+                "diff_dst should have the desc of the sum");
+    switch (sum.get_data_type()) {
+      case data_type::f32:
+        compute_impl<float>(sum, mean, rstd, scale, mask, diff_dst, diff_src,
+                            diff_residual, diff_scale, diff_shift, norm_size,
+                            ratio);
+        break;
+      case data_type::bf16:
+        compute_impl<uint16_t>(sum, mean, rstd, scale, mask, diff_dst,
+                               diff_src, diff_residual, diff_scale, diff_shift,
+                               norm_size, ratio);
+        break;
+      default:
+        throw error(dnnl_invalid_arguments, "Unsupported dnnl data type");
+    }
+  }
+
+ private:
+  template <typename T>
+  static void compute_impl(const tensor& sum, const tensor& mean,
+                           const tensor& rstd, const tensor& scale,
+                           const tensor& mask, const tensor& diff_dst,
+                           tensor& diff_src, tensor& diff_residual,
+                           tensor& diff_scale, tensor& diff_shift, dim N,
+                           float ratio) {
+    const dim M = sum.get_nelems() / N;
+    const bool with_dropout = ratio > 0.f;
+    const tensor::desc param_desc {{N}, data_type::f32, format_tag::a};
+    diff_residual.reinit_if_possible(sum.get_desc());
+    if (with_dropout) {
+      diff_src.reinit_if_possible(sum.get_desc());
+    }
+    diff_scale.reinit_if_possible(param_desc);
+    diff_shift.reinit_if_possible(param_desc);
+
+    const float drop_scale = 1.0f / (1.0f - ratio);
+    const auto x_data = static_cast<const T*>(sum.get_data_handle());
+    const auto mean_data = static_cast<const float*>(mean.get_data_handle());
+    const auto rstd_data = static_cast<const float*>(rstd.get_data_handle());
+    const auto gamma = scale.is_empty()
+        ? nullptr : static_cast<const float*>(scale.get_data_handle());
+    const auto mask_data = with_dropout
+        ? static_cast<const uint8_t*>(mask.get_data_handle()) : nullptr;
+    const auto dy_data = static_cast<const T*>(diff_dst.get_data_handle());
+    const auto dres_data = static_cast<T*>(diff_residual.get_data_handle());
+    const auto dsrc_data = with_dropout
+        ? static_cast<T*>(diff_src.get_data_handle()) : nullptr;
+
+#ifdef _OPENMP
+    const int nthr = omp_get_max_threads();
+#else
+    const int nthr = 1;
+#endif
+    std::vector<float> partials(static_cast<size_t>(nthr) * 2 * N, 0.f);
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthr)
+#endif
+    {
+#ifdef _OPENMP
+      const int ithr = omp_get_thread_num();
+#else
+      const int ithr = 0;
+#endif
+      float* dgamma = partials.data() + ithr * 2 * N;
+      float* dbeta = dgamma + N;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (dim r = 0; r < M; r++) {
+        const dim offset = r * N;
+        const float m = mean_data[r];
+        const float rs = rstd_data[r];
+        float sum_g = 0.f, sum_gx = 0.f;
+#ifdef _OPENMP
+#pragma omp simd reduction(+: sum_g, sum_gx)
+#endif
+        for (dim j = 0; j < N; j++) {
+          const float xhat = (io<T>::load(x_data[offset + j]) - m) * rs;
+          const float dy = io<T>::load(dy_data[offset + j]);
+          const float g = gamma ? dy * gamma[j] : dy;
+          sum_g += g;
+          sum_gx += g * xhat;
+          dgamma[j] += dy * xhat;
+          dbeta[j] += dy;
+        }
+        sum_g /= N;
+        sum_gx /= N;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+        for (dim j = 0; j < N; j++) {
+          const float xhat = (io<T>::load(x_data[offset + j]) - m) * rs;
+          const float dy = io<T>::load(dy_data[offset + j]);
+          const float g = gamma ? dy * gamma[j] : dy;
+          const float dx = rs * (g - sum_g - xhat * sum_gx);
+          dres_data[offset + j] = io<T>::store(dx);
+          if (with_dropout) {
+            const bool kept = (mask_data[(offset + j) >> 3] >> ((offset + j) & 7)) & 1;
+            dsrc_data[offset + j] = io<T>::store(kept ? dx * drop_scale : 0.f);
+          }
+        }
+      }
+    }
+
+    const auto dscale_data = static_cast<float*>(diff_scale.get_data_handle());
+    const auto dshift_data = static_cast<float*>(diff_shift.get_data_handle());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (dim j = 0; j < N; j++) {
+      float dg = 0.f, db = 0.f;
+      for (int t = 0; t < nthr; t++) {
+        dg += partials[t * 2 * N + j];
+        db += partials[t * 2 * N + N + j];
+      }
+      dscale_data[j] = dg;
+      dshift_data[j] = db;
+    }
+  }
+};
+
 }  // namespace dil
 
 #endif
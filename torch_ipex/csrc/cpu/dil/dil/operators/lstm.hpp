@@ -19,6 +19,7 @@ struct lstm_forward : public dnnl::lstm_forward {
                       tensor& dst_iter_c,
                       const bool reverse = false,
                       prop_kind aprop = prop_kind::forward,
+                      const rnn_qparams_t& qparams = rnn_qparams_t(),
                       const engine& aengine = engine::cpu_engine()) {
 
     bool with_workspace = aprop == prop_kind::forward_training;
@@ -36,25 +37,37 @@ struct lstm_forward : public dnnl::lstm_forward {
     //  use any format for weights
     //  For accuracy consideration, weight remains fp32 when doing training,
     //  so it is necessary to align weights data type with src in here.
+    //  The weights of an int8 (u8 src) lstm are s8.
+    auto weights_type = utils::rnn_weights_type(src_layer.get_data_type());
     if (weights_layer_desc.is_dense()) {
-      weights_layer_desc = weights_layer_desc.to_format_any().to_type(src_layer.get_data_type());
+      weights_layer_desc = weights_layer_desc.to_format_any().to_type(weights_type);
     }
     if (weights_iter_desc.is_dense()) {
-      weights_iter_desc = weights_iter_desc.to_format_any().to_type(src_layer.get_data_type());
+      weights_iter_desc = weights_iter_desc.to_format_any().to_type(weights_type);
     }
 
     auto bias_desc = bias.get_desc();
     tensor::desc dst_layer_desc(output_sizes, src_layer.get_data_type(), tag::tnc);
 
-    auto pd = primitive_desc(
-        {aprop, direction, src_layer_desc, src_iter_desc, src_iter_c_desc,
-         weights_layer_desc, weights_iter_desc, bias_desc,
-         dst_layer_desc, src_iter_desc, src_iter_c_desc},
-        aengine);
+    auto key = utils::create_key(
+        "lstm_forward", aprop, direction, src_layer_desc, src_iter_desc,
+        src_iter_c_desc, weights_layer_desc, weights_iter_desc, bias_desc,
+        dst_layer_desc, qparams);
+    auto cached = primitive_cache::fetch_or_create<
+        std::pair<primitive_desc, super>>(key, [&]() {
+      auto pd = primitive_desc(
+          {aprop, direction, src_layer_desc, src_iter_desc, src_iter_c_desc,
+           weights_layer_desc, weights_iter_desc, bias_desc,
+           dst_layer_desc, src_iter_desc, src_iter_c_desc},
+          qparams.to_attr(), aengine);
+      return std::make_pair(pd, super(pd));
+    });
+    auto& pd = cached.first;
 
     auto expected_src_iter = src_iter.reorder_if_differ_in(pd.src_iter_desc());
-    auto expected_weights_layer = weights_layer.reorder_if_differ_in(pd.weights_layer_desc());
-    auto expected_weights_iter = weights_iter.reorder_if_differ_in(pd.weights_iter_desc());
+    // the rnn weights are quantized by a reorder with the qparams, not with scales
+    auto expected_weights_layer = weights_layer.reorder_if_differ_in(pd.weights_layer_desc(), qparams.to_attr());
+    auto expected_weights_iter = weights_iter.reorder_if_differ_in(pd.weights_iter_desc(), qparams.to_attr());
 
     dst_layer.reinit_if_possible(pd.dst_layer_desc());
     dst_iter.reinit_if_possible(pd.dst_iter_desc());
@@ -75,7 +88,7 @@ struct lstm_forward : public dnnl::lstm_forward {
       args.insert({DNNL_ARG_WORKSPACE, dst_layer.get_workspace()});
     }
 
-    super(pd).execute(stream::default_stream(), args);
+    cached.second.execute(stream::default_stream(), args);
   }
   
   static std::tuple<tensor::desc, tensor::desc> expected_weights_desc(const dims& output_sizes,
@@ -87,6 +100,7 @@ struct lstm_forward : public dnnl::lstm_forward {
                       const tensor& bias,
                       const bool reverse = false,
                       prop_kind aprop = prop_kind::forward,
+                      const rnn_qparams_t& qparams = rnn_qparams_t(),
                       const engine& aengine = engine::cpu_engine()) {
 
     auto direction = reverse ? rnn_direction::unidirectional_right2left
@@ -96,17 +110,28 @@ struct lstm_forward : public dnnl::lstm_forward {
     auto src_iter_desc = src_iter.get_desc().to_type(src_layer.get_data_type());
     auto src_iter_c_desc = src_iter_c.get_desc();
 
-    auto weights_layer_desc = weights_layer.get_desc().to_format_any();
-    auto weights_iter_desc = weights_iter.get_desc().to_format_any();
+    auto weights_type = utils::rnn_weights_type(src_layer.get_data_type());
+    auto weights_layer_desc = weights_layer.get_desc().to_format_any().to_type(weights_type);
+    auto weights_iter_desc = weights_iter.get_desc().to_format_any().to_type(weights_type);
     
     auto bias_desc = bias.get_desc();
     tensor::desc dst_layer_desc(output_sizes, src_layer.get_data_type(), tag::tnc);
 
-    auto pd = primitive_desc(
-        {aprop, direction, src_layer_desc, src_iter_desc, src_iter_c_desc,
-         weights_layer_desc, weights_iter_desc, bias_desc,
-         dst_layer_desc, src_iter_desc, src_iter_c_desc},
-         aengine);
+    // shares the primitive of compute with plain weights, so that it's created once
+    auto key = utils::create_key(
+        "lstm_forward", aprop, direction, src_layer_desc, src_iter_desc,
+        src_iter_c_desc, weights_layer_desc, weights_iter_desc, bias_desc,
+        dst_layer_desc, qparams);
+    auto cached = primitive_cache::fetch_or_create<
+        std::pair<primitive_desc, super>>(key, [&]() {
+      auto pd = primitive_desc(
+          {aprop, direction, src_layer_desc, src_iter_desc, src_iter_c_desc,
+           weights_layer_desc, weights_iter_desc, bias_desc,
+           dst_layer_desc, src_iter_desc, src_iter_c_desc},
+          qparams.to_attr(), aengine);
+      return std::make_pair(pd, super(pd));
+    });
+    auto& pd = cached.first;
 
     auto expected_weights_layer = pd.weights_layer_desc();
     auto expected_weights_iter = pd.weights_iter_desc();
@@ -139,46 +164,9 @@ struct lstm_backward : public dnnl::lstm_backward {
                       tensor& diff_bias,
                       const bool reverse = false,
                       const engine& aengine = engine::cpu_engine()) {
-    auto aprop = prop_kind::backward;
-    auto direction = reverse ? rnn_direction::unidirectional_right2left
-                             : rnn_direction::unidirectional_left2right;
-    auto src_layer_desc = src_layer.get_desc();
-    auto src_iter_desc = src_iter.get_desc().to_type(src_layer.get_data_type());
-    auto src_iter_c_desc = src_iter_c.get_desc();
-    // use any format for weights
-    // align weights data type with src
-    auto weights_layer_desc = weights_layer.get_desc().to_format_any().to_type(src_layer.get_data_type());
-    auto weights_iter_desc = weights_iter.get_desc().to_format_any().to_type(src_layer.get_data_type());
-    auto bias_desc = bias.get_desc();
-    auto dst_layer_desc = dst_layer.get_desc();
-    auto dst_iter_desc = dst_iter.get_desc();
-    auto dst_iter_c_desc = dst_iter_c.get_desc();
-
-    auto diff_src_layer_desc = src_layer_desc.to_type(data_type::f32);
-    auto diff_src_iter_desc = src_iter_desc.to_type(data_type::f32);
-    auto diff_src_iter_c_desc = src_iter_c_desc.to_type(data_type::f32);
-    auto diff_weights_layer_desc = weights_layer_desc.to_type(data_type::f32);
-    auto diff_weights_iter_desc = weights_iter_desc.to_type(data_type::f32);
-    auto diff_bias_desc = bias_desc.to_type(data_type::f32);
-    auto diff_dst_layer_desc = dst_layer_desc.to_type(data_type::f32);
-    auto diff_dst_iter_desc = dst_iter_desc.to_type(data_type::f32);
-    auto diff_dst_iter_c_desc = dst_iter_c_desc.to_type(data_type::f32);
-
-    auto forward_hints =
-        dnnl::lstm_forward::primitive_desc(
-            {prop_kind::forward_training, direction, src_layer_desc, src_iter_desc, src_iter_c_desc,
-         weights_layer_desc, weights_iter_desc, bias_desc,
-         dst_layer_desc, dst_iter_desc, dst_iter_c_desc},
-        aengine);
-
-    auto pd = primitive_desc(
-        {aprop, direction, src_layer_desc, src_iter_desc, src_iter_c_desc,
-         weights_layer_desc, weights_iter_desc, bias_desc,
-         dst_layer_desc, dst_iter_desc, dst_iter_c_desc,
-         diff_src_layer_desc, diff_src_iter_desc, diff_src_iter_c_desc,
-         diff_weights_layer_desc, diff_weights_iter_desc, diff_bias_desc,
-         diff_dst_layer_desc, diff_dst_iter_desc, diff_dst_iter_c_desc},
-        aengine, forward_hints);
+    auto cached = fetch_or_create(src_layer, src_iter, src_iter_c, weights_layer, weights_iter,
+                                  bias, dst_layer, dst_iter, dst_iter_c, reverse, aengine);
+    auto& pd = cached.first;
 
     auto expected_src_iter = src_iter.reorder_if_differ_in(pd.src_iter_desc());
     auto expected_weights_layer = weights_layer.reorder_if_differ_in(pd.weights_layer_desc());
@@ -192,7 +180,7 @@ struct lstm_backward : public dnnl::lstm_backward {
     diff_weights_iter.zero_init(pd.diff_weights_iter_desc());
     diff_bias.zero_init(pd.diff_bias_desc());
 
-    super(pd).execute(stream::default_stream(),
+    cached.second.execute(stream::default_stream(),
                       {{DNNL_ARG_SRC_LAYER, src_layer},
                        {DNNL_ARG_SRC_ITER, expected_src_iter},
                        {DNNL_ARG_SRC_ITER_C, src_iter_c},
@@ -213,6 +201,86 @@ struct lstm_backward : public dnnl::lstm_backward {
                        {DNNL_ARG_DIFF_DST_ITER_C, diff_dst_iter_c},
                        {DNNL_ARG_WORKSPACE, dst_layer.get_workspace()}});
   }
+
+  static std::tuple<tensor::desc, tensor::desc> expected_weights_desc(
+                      const tensor& src_layer,
+                      const tensor& src_iter,
+                      const tensor& src_iter_c,
+                      const tensor& weights_layer,
+                      const tensor& weights_iter,
+                      const tensor& bias,
+                      const tensor& dst_layer,
+                      const tensor& dst_iter,
+                      const tensor& dst_iter_c,
+                      const bool reverse = false,
+                      const engine& aengine = engine::cpu_engine()) {
+    auto& pd = fetch_or_create(src_layer, src_iter, src_iter_c, weights_layer, weights_iter,
+                               bias, dst_layer, dst_iter, dst_iter_c, reverse, aengine).first;
+    return std::make_tuple(pd.weights_layer_desc(), pd.weights_iter_desc());
+  }
+
+ private:
+  static std::pair<primitive_desc, super> fetch_or_create(
+                      const tensor& src_layer,
+                      const tensor& src_iter,
+                      const tensor& src_iter_c,
+                      const tensor& weights_layer,
+                      const tensor& weights_iter,
+                      const tensor& bias,
+                      const tensor& dst_layer,
+                      const tensor& dst_iter,
+                      const tensor& dst_iter_c,
+                      const bool reverse,
+                      const engine& aengine) {
+    auto aprop = prop_kind::backward;
+    auto direction = reverse ? rnn_direction::unidirectional_right2left
+                             : rnn_direction::unidirectional_left2right;
+    auto src_layer_desc = src_layer.get_desc();
+    auto src_iter_desc = src_iter.get_desc().to_type(src_layer.get_data_type());
+    auto src_iter_c_desc = src_iter_c.get_desc();
+    // use any format for weights
+    // align weights data type with src
+    auto weights_layer_desc = weights_layer.get_desc().to_format_any().to_type(src_layer.get_data_type());
+    auto weights_iter_desc = weights_iter.get_desc().to_format_any().to_type(src_layer.get_data_type());
+    auto bias_desc = bias.get_desc();
+    auto dst_layer_desc = dst_layer.get_desc();
+    auto dst_iter_desc = dst_iter.get_desc();
+    auto dst_iter_c_desc = dst_iter_c.get_desc();
+
+    auto key = utils::create_key(
+        "lstm_backward", direction, src_layer_desc, src_iter_desc,
+        src_iter_c_desc, weights_layer_desc, weights_iter_desc, bias_desc,
+        dst_layer_desc, dst_iter_desc, dst_iter_c_desc);
+    return primitive_cache::fetch_or_create<
+        std::pair<primitive_desc, super>>(key, [&]() {
+      auto diff_src_layer_desc = src_layer_desc.to_type(data_type::f32);
+      auto diff_src_iter_desc = src_iter_desc.to_type(data_type::f32);
+      auto diff_src_iter_c_desc = src_iter_c_desc.to_type(data_type::f32);
+      auto diff_weights_layer_desc = weights_layer_desc.to_type(data_type::f32);
+      auto diff_weights_iter_desc = weights_iter_desc.to_type(data_type::f32);
+      auto diff_bias_desc = bias_desc.to_type(data_type::f32);
+      auto diff_dst_layer_desc = dst_layer_desc.to_type(data_type::f32);
+      auto diff_dst_iter_desc = dst_iter_desc.to_type(data_type::f32);
+      auto diff_dst_iter_c_desc = dst_iter_c_desc.to_type(data_type::f32);
+
+      auto forward_hints =
+          dnnl::lstm_forward::primitive_desc(
+              {prop_kind::forward_training, direction, src_layer_desc, src_iter_desc, src_iter_c_desc,
+           weights_layer_desc, weights_iter_desc, bias_desc,
+           dst_layer_desc, dst_iter_desc, dst_iter_c_desc},
+          aengine);
+
+      auto pd = primitive_desc(
+          {aprop, direction, src_layer_desc, src_iter_desc, src_iter_c_desc,
+           weights_layer_desc, weights_iter_desc, bias_desc,
+           dst_layer_desc, dst_iter_desc, dst_iter_c_desc,
+           diff_src_layer_desc, diff_src_iter_desc, diff_src_iter_c_desc,
+           diff_weights_layer_desc, diff_weights_iter_desc, diff_bias_desc,
+           diff_dst_layer_desc, diff_dst_iter_desc, diff_dst_iter_c_desc},
+          aengine, forward_hints);
+      return std::make_pair(pd, super(pd));
+    });
+  }
 };
 
 }  // namespace dil
@@ -68,6 +68,85 @@ struct matmul_forward : public dnnl::matmul {
     return pd.weights_desc();
   }
 
+  // A dynamically quantized s8 x s8 matmul of a 2D f32 src and the s8
+  // weights of a prepacked linear, transposed to [K, N], whose scales are
+  // per output channel. The src is quantized with src_scale, which changes
+  // from call to call, so the output scales are runtime arguments and one
+  // primitive serves every src scale. The bias, f32 or empty, is quantized to
+  // s32 with the src scale, the eltwise post ops of attr apply to the f32 dst.
+  static void compute_dynamic(const tensor& src,
+                              const tensor& weights,
+                              const tensor& bias,
+                              tensor& dst,
+                              float src_scale,
+                              const attr_t& attr = attr_t(),
+                              const engine& aengine = engine::cpu_engine()) {
+    DIL_ENFORCE(src.ndims() == 2 && weights.ndims() == 2 &&
+                    weights.get_data_type() == data_type::s8 &&
+                    weights.has_scale(),
+                "Dynamic matmul expects a 2D src and quantized 2D weights");
+    const bool with_bias = !bias.is_empty();
+    const auto n = weights.get_dim(1);
+    const auto& weights_scales = weights.get_scale();
+    const int scale_size = weights_scales.size() > 1 ? n : 1;
+
+    attr_t op_attr = attr;
+    op_attr.set_output_scales(utils::op_scale_mask(scale_size),
+                              {DNNL_RUNTIME_F32_VAL});
+    tensor::desc scales_desc = {{scale_size}, data_type::f32, {1}};
+    tensor scales_m;
+    scales_m.init(scales_desc, aengine);
+    auto s = static_cast<float*>(scales_m.get_data_handle());
+    for (int i = 0; i < scale_size; i++) {
+      s[i] = 1.f / (src_scale * weights_scales[i]);
+    }
+
+    tensor::desc src_desc {src.get_dims(), data_type::s8, tag::ab};
+    tensor::desc dst_desc {{src.get_dim(0), n}, data_type::f32, tag::ab};
+    tensor::desc bias_desc;
+    tensor bias_s32;
+    if (with_bias) {
+      bias_desc = {{1, n}, data_type::s32, tag::ab};
+      bias_s32.init(bias_desc, aengine);
+      auto b = bias.get_data_type() == data_type::f32 && bias.is_public_format()
+                   ? bias
+                   : bias.to_public(nullptr, data_type::f32);
+      auto b_data = static_cast<const float*>(b.get_data_handle());
+      auto b_s32 = static_cast<int32_t*>(bias_s32.get_data_handle());
+      for (dim i = 0; i < n; i++) {
+        b_s32[i] = static_cast<int32_t>(std::nearbyint(
+            b_data[i] * src_scale * weights_scales[scale_size > 1 ? i : 0]));
+      }
+    }
+
+    auto key = utils::create_key("matmul_forward_dynamic", with_bias, src_desc,
+                                 weights.get_desc(), bias_desc, dst_desc,
+                                 op_attr);
+    auto cached = primitive_cache::fetch_or_create<
+        std::pair<primitive_desc, super>>(key, [&]() {
+      auto pd = with_bias
+          ? primitive_desc({src_desc, weights.get_desc(), bias_desc, dst_desc},
+                           op_attr, aengine)
+          : primitive_desc({src_desc, weights.get_desc(), dst_desc}, op_attr,
+                           aengine);
+      return std::make_pair(pd, super(pd));
+    });
+    auto& pd = cached.first;
+
+    attr_t src_attr {0, scale_t(1, src_scale)};
+    auto expected_src = src.reorder_if_differ_in(pd.src_desc(), src_attr);
+    dst.reinit_if_possible(pd.dst_desc());
+    exec_args args {
+        {DNNL_ARG_SRC, expected_src},
+        {DNNL_ARG_WEIGHTS, weights},
+        {DNNL_ARG_DST, dst},
+        {DNNL_ARG_ATTR_OUTPUT_SCALES, scales_m}};
+    if (with_bias) {
+      args.insert({DNNL_ARG_BIAS, bias_s32});
+    }
+    cached.second.execute(stream::default_stream(), args);
+  }
+
 private:
   template <bool with_bias>
  static void compute_impl(const tensor& src,
@@ -254,11 +333,19 @@ private:
 
    dst_data_type = dst_type == data_type::undef ? dst_data_type : dst_type;   
    tensor::desc dst_desc(dst_dims, dst_data_type, tag::any);
-   auto pd = with_bias
-       ? primitive_desc({src_desc, weights_desc, bias_desc, dst_desc},
-                         op_attr, aengine)
-       : primitive_desc({src_desc, weights_desc, dst_desc},
-                         op_attr, aengine);
+   auto key = utils::create_key(
+       "matmul_forward", with_bias, src_desc, weights_desc, bias_desc,
+       dst_desc, op_attr);
+   auto cached = primitive_cache::fetch_or_create<
+       std::pair<primitive_desc, super>>(key, [&]() {
+     auto pd = with_bias
+         ? primitive_desc({src_desc, weights_desc, bias_desc, dst_desc},
+                           op_attr, aengine)
+         : primitive_desc({src_desc, weights_desc, dst_desc},
+                           op_attr, aengine);
+     return std::make_pair(pd, super(pd));
+   });
+   auto& pd = cached.first;
    auto expected_src = src.reorder_if_differ_in(pd.src_desc(), src_attr);
    auto expected_weights = weights.reorder_if_differ_in(pd.weights_desc(), weights_attr);
    dst.reinit_if_possible(pd.dst_desc());
@@ -267,24 +354,24 @@ private:
    }
    if (with_bias){
      auto expected_bias = bias.reorder_if_differ_in(pd.bias_desc(), bias_attr);
-     super(pd).execute(stream::default_stream(),
-                       {{DNNL_ARG_SRC, expected_src},
-                        {DNNL_ARG_WEIGHTS, expected_weights},
-                        {DNNL_ARG_BIAS, expected_bias},
-                        {DNNL_ARG_DST, dst},
-                        {DNNL_ARG_ATTR_OUTPUT_SCALES, scales_m},
-                        {DNNL_ARG_ATTR_ZERO_POINTS | DNNL_ARG_SRC, src_zero_point_m},
-                        {DNNL_ARG_ATTR_ZERO_POINTS | DNNL_ARG_WEIGHTS, wei_zero_point_m},
-                        {DNNL_ARG_ATTR_ZERO_POINTS | DNNL_ARG_DST, dst_zero_point_m}});
+     cached.second.execute(stream::default_stream(),
+                           {{DNNL_ARG_SRC, expected_src},
+                            {DNNL_ARG_WEIGHTS, expected_weights},
+                            {DNNL_ARG_BIAS, expected_bias},
+                            {DNNL_ARG_DST, dst},
+                            {DNNL_ARG_ATTR_OUTPUT_SCALES, scales_m},
+                            {DNNL_ARG_ATTR_ZERO_POINTS | DNNL_ARG_SRC, src_zero_point_m},
+                            {DNNL_ARG_ATTR_ZERO_POINTS | DNNL_ARG_WEIGHTS, wei_zero_point_m},
+                            {DNNL_ARG_ATTR_ZERO_POINTS | DNNL_ARG_DST, dst_zero_point_m}});
    } else {
-     super(pd).execute(stream::default_stream(),
-                       {{DNNL_ARG_SRC, expected_src},
-                        {DNNL_ARG_WEIGHTS, expected_weights},
-                        {DNNL_ARG_DST, dst},
-                        {DNNL_ARG_ATTR_OUTPUT_SCALES, scales_m},
-                        {DNNL_ARG_ATTR_ZERO_POINTS | DNNL_ARG_SRC, src_zero_point_m},
-                        {DNNL_ARG_ATTR_ZERO_POINTS | DNNL_ARG_WEIGHTS, wei_zero_point_m},
-                        {DNNL_ARG_ATTR_ZERO_POINTS | DNNL_ARG_DST, dst_zero_point_m}});
+     cached.second.execute(stream::default_stream(),
+                           {{DNNL_ARG_SRC, expected_src},
+                            {DNNL_ARG_WEIGHTS, expected_weights},
+                            {DNNL_ARG_DST, dst},
+                            {DNNL_ARG_ATTR_OUTPUT_SCALES, scales_m},
+                            {DNNL_ARG_ATTR_ZERO_POINTS | DNNL_ARG_SRC, src_zero_point_m},
+                            {DNNL_ARG_ATTR_ZERO_POINTS | DNNL_ARG_WEIGHTS, wei_zero_point_m},
+                            {DNNL_ARG_ATTR_ZERO_POINTS | DNNL_ARG_DST, dst_zero_point_m}});
    }
   }
 };
@@ -45,11 +45,20 @@ struct rnn_forward : public dnnl::vanilla_rnn_forward {
     auto bias_desc = bias.get_desc();
     tensor::desc dst_layer_desc(output_sizes, src_layer.get_data_type(), tag::tnc);
 
-    auto pd = primitive_desc(
-        {aprop, activation, direction, src_layer_desc, src_iter_desc,
-         weights_layer_desc, weights_iter_desc, bias_desc,
-         dst_layer_desc, src_iter_desc},
-        aengine);
+    auto key = utils::create_key(
+        "rnn_forward", aprop, activation, direction, src_layer_desc,
+        src_iter_desc, weights_layer_desc, weights_iter_desc, bias_desc,
+        dst_layer_desc);
+    auto cached = primitive_cache::fetch_or_create<
+        std::pair<primitive_desc, super>>(key, [&]() {
+      auto pd = primitive_desc(
+          {aprop, activation, direction, src_layer_desc, src_iter_desc,
+           weights_layer_desc, weights_iter_desc, bias_desc,
+           dst_layer_desc, src_iter_desc},
+          aengine);
+      return std::make_pair(pd, super(pd));
+    });
+    auto& pd = cached.first;
 
     auto expected_src_iter = src_iter.reorder_if_differ_in(pd.src_iter_desc()); 
     auto expected_weights_layer = weights_layer.reorder_if_differ_in(pd.weights_desc());
@@ -71,7 +80,7 @@ struct rnn_forward : public dnnl::vanilla_rnn_forward {
       args.insert({DNNL_ARG_WORKSPACE, dst_layer.get_workspace()});
     }
 
-    super(pd).execute(stream::default_stream(), args);
+    cached.second.execute(stream::default_stream(), args);
   }
   static std::tuple<tensor::desc, tensor::desc> expected_weights_desc(const dims& output_sizes,
                       const tensor& src_layer,
@@ -90,17 +99,27 @@ struct rnn_forward : public dnnl::vanilla_rnn_forward {
     auto src_layer_desc = src_layer.get_desc();
     auto src_iter_desc = src_iter.get_desc().to_type(src_layer.get_data_type());
 
-    auto weights_layer_desc = weights_layer.get_desc().to_format_any();
-    auto weights_iter_desc = weights_iter.get_desc().to_format_any();
+    auto weights_layer_desc = weights_layer.get_desc().to_format_any().to_type(src_layer.get_data_type());
+    auto weights_iter_desc = weights_iter.get_desc().to_format_any().to_type(src_layer.get_data_type());
     
     auto bias_desc = bias.get_desc();
     tensor::desc dst_layer_desc(output_sizes, src_layer.get_data_type(), tag::tnc);
 
-    auto pd = primitive_desc(
-        {aprop, activation, direction, src_layer_desc, src_iter_desc,
-         weights_layer_desc, weights_iter_desc, bias_desc,
-         dst_layer_desc, src_iter_desc},
-        aengine);
+    // shares the primitive of compute with plain weights, so that it's created once
+    auto key = utils::create_key(
+        "rnn_forward", aprop, activation, direction, src_layer_desc,
+        src_iter_desc, weights_layer_desc, weights_iter_desc, bias_desc,
+        dst_layer_desc);
+    auto cached = primitive_cache::fetch_or_create<
+        std::pair<primitive_desc, super>>(key, [&]() {
+      auto pd = primitive_desc(
+          {aprop, activation, direction, src_layer_desc, src_iter_desc,
+           weights_layer_desc, weights_iter_desc, bias_desc,
+           dst_layer_desc, src_iter_desc},
+          aengine);
+      return std::make_pair(pd, super(pd));
+    });
+    auto& pd = cached.first;
     
     auto expected_weights_layer = pd.weights_layer_desc();
     auto expected_weights_iter = pd.weights_iter_desc();
@@ -130,42 +149,9 @@ struct rnn_backward : public dnnl::vanilla_rnn_backward {
                       const rnn_kind akind,
                       const bool reverse = false,
                       const engine& aengine = engine::cpu_engine()) {
-    auto aprop = prop_kind::backward;
-    auto activation = utils::rnn_kind_to_activation(akind);
-    auto direction = reverse ? rnn_direction::unidirectional_right2left
-                             : rnn_direction::unidirectional_left2right;
-    auto src_layer_desc = src_layer.get_desc();
-    auto src_iter_desc = src_iter.get_desc().to_type(src_layer.get_data_type());
-    // use any format for weights
-    // align weights data type with src
-    auto weights_layer_desc = weights_layer.get_desc().to_format_any().to_type(src_layer.get_data_type());
-    auto weights_iter_desc = weights_iter.get_desc().to_format_any().to_type(src_layer.get_data_type());
-    auto bias_desc = bias.get_desc();
-    auto dst_layer_desc = dst_layer.get_desc();
-    auto dst_iter_desc = dst_iter.get_desc();
-    auto diff_src_layer_desc = src_layer_desc.to_type(data_type::f32);
-    auto diff_src_iter_desc = src_iter_desc.to_type(data_type::f32);
-    auto diff_weights_layer_desc = weights_layer_desc.to_type(data_type::f32);
-    auto diff_weights_iter_desc = weights_iter_desc.to_type(data_type::f32);
-    auto diff_bias_desc = bias_desc.to_type(data_type::f32);
-    auto diff_dst_layer_desc = dst_layer_desc.to_type(data_type::f32);
-    auto diff_dst_iter_desc = dst_iter_desc.to_type(data_type::f32);
-
-    auto forward_hints =
-        dnnl::vanilla_rnn_forward::primitive_desc(
-            {prop_kind::forward_training, activation, direction, src_layer_desc, src_iter_desc,
-         weights_layer_desc, weights_iter_desc, bias_desc,
-         dst_layer_desc, dst_iter_desc},
-        aengine);
-
-    auto pd = primitive_desc(
-        {aprop, activation, direction, src_layer_desc, src_iter_desc,
-         weights_layer_desc, weights_iter_desc, bias_desc,
-         dst_layer_desc, dst_iter_desc,
-         diff_src_layer_desc, diff_src_iter_desc,
-         diff_weights_layer_desc, diff_weights_iter_desc, diff_bias_desc,
-         diff_dst_layer_desc, diff_dst_iter_desc},
-        aengine, forward_hints);
+    auto cached = fetch_or_create(src_layer, src_iter, weights_layer, weights_iter,
+                                  bias, dst_layer, dst_iter, akind, reverse, aengine);
+    auto& pd = cached.first;
 
     auto expected_src_iter = src_iter.reorder_if_differ_in(pd.src_iter_desc());
     auto expected_weights_layer = weights_layer.reorder_if_differ_in(pd.weights_desc());
@@ -178,7 +164,7 @@ struct rnn_backward : public dnnl::vanilla_rnn_backward {
     diff_weights_iter.zero_init(pd.diff_weights_iter_desc());
     diff_bias.zero_init(pd.diff_bias_desc());
 
-    super(pd).execute(stream::default_stream(),
+    cached.second.execute(stream::default_stream(),
                       {{DNNL_ARG_SRC_LAYER, src_layer},
                        {DNNL_ARG_SRC_ITER, expected_src_iter},
                        {DNNL_ARG_WEIGHTS_LAYER, expected_weights_layer},
@@ -195,6 +181,81 @@ struct rnn_backward : public dnnl::vanilla_rnn_backward {
                        {DNNL_ARG_DIFF_DST_ITER, diff_dst_iter},
                        {DNNL_ARG_WORKSPACE, dst_layer.get_workspace()}});
   }
+
+  static std::tuple<tensor::desc, tensor::desc> expected_weights_desc(
+                      const tensor& src_layer,
+                      const tensor& src_iter,
+                      const tensor& weights_layer,
+                      const tensor& weights_iter,
+                      const tensor& bias,
+                      const tensor& dst_layer,
+                      const tensor& dst_iter,
+                      const rnn_kind akind,
+                      const bool reverse = false,
+                      const engine& aengine = engine::cpu_engine()) {
+    auto& pd = fetch_or_create(src_layer, src_iter, weights_layer, weights_iter,
+                               bias, dst_layer, dst_iter, akind, reverse, aengine).first;
+    return std::make_tuple(pd.weights_layer_desc(), pd.weights_iter_desc());
+  }
+
+ private:
+  static std::pair<primitive_desc, super> fetch_or_create(
+                      const tensor& src_layer,
+                      const tensor& src_iter,
+                      const tensor& weights_layer,
+                      const tensor& weights_iter,
+                      const tensor& bias,
+                      const tensor& dst_layer,
+                      const tensor& dst_iter,
+                      const rnn_kind akind,
+                      const bool reverse,
+                      const engine& aengine) {
+    auto aprop = prop_kind::backward;
+    auto activation = utils::rnn_kind_to_activation(akind);
+    auto direction = reverse ? rnn_direction::unidirectional_right2left
+                             : rnn_direction::unidirectional_left2right;
+    auto src_layer_desc = src_layer.get_desc();
+    auto src_iter_desc = src_iter.get_desc().to_type(src_layer.get_data_type());
+    // use any format for weights
+    // align weights data type with src
+    auto weights_layer_desc = weights_layer.get_desc().to_format_any().to_type(src_layer.get_data_type());
+    auto weights_iter_desc = weights_iter.get_desc().to_format_any().to_type(src_layer.get_data_type());
+    auto bias_desc = bias.get_desc();
+    auto dst_layer_desc = dst_layer.get_desc();
+    auto dst_iter_desc = dst_iter.get_desc();
+
+    auto key = utils::create_key(
+        "rnn_backward", activation, direction, src_layer_desc, src_iter_desc,
+        weights_layer_desc, weights_iter_desc, bias_desc, dst_layer_desc,
+        dst_iter_desc);
+    return primitive_cache::fetch_or_create<
+        std::pair<primitive_desc, super>>(key, [&]() {
+      auto diff_src_layer_desc = src_layer_desc.to_type(data_type::f32);
+      auto diff_src_iter_desc = src_iter_desc.to_type(data_type::f32);
+      auto diff_weights_layer_desc = weights_layer_desc.to_type(data_type::f32);
+      auto diff_weights_iter_desc = weights_iter_desc.to_type(data_type::f32);
+      auto diff_bias_desc = bias_desc.to_type(data_type::f32);
+      auto diff_dst_layer_desc = dst_layer_desc.to_type(data_type::f32);
+      auto diff_dst_iter_desc = dst_iter_desc.to_type(data_type::f32);
+
+      auto forward_hints =
+          dnnl::vanilla_rnn_forward::primitive_desc(
+              {prop_kind::forward_training, activation, direction, src_layer_desc, src_iter_desc,
+           weights_layer_desc, weights_iter_desc, bias_desc,
+           dst_layer_desc, dst_iter_desc},
+          aengine);
+
+      auto pd = primitive_desc(
+          {aprop, activation, direction, src_layer_desc, src_iter_desc,
+           weights_layer_desc, weights_iter_desc, bias_desc,
+           dst_layer_desc, dst_iter_desc,
+           diff_src_layer_desc, diff_src_iter_desc,
+           diff_weights_layer_desc, diff_weights_iter_desc, diff_bias_desc,
+           diff_dst_layer_desc, diff_dst_iter_desc},
+          aengine, forward_hints);
+      return std::make_pair(pd, super(pd));
+    });
+  }
 };
 
 }  // namespace dil
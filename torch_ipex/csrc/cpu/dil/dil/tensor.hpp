@@ -946,12 +946,20 @@ class tensor : public memory {
           utils::fmap(src_scale, [](float s) { return 1.f / s; });
       auto mask =
           utils::tensor_scale_mask(src_scale.size(), is_grouped());
-      this->reorder_to(dst, {mask, dequantize_scale});
+      attr_t dequantize_attr {mask, dequantize_scale};
+      if (has_zero_point()) {
+        dequantize_attr.set_zero_points(
+            DNNL_ARG_SRC, utils::tensor_zp_mask(1), get_zero_point());
+      }
+      this->reorder_to(dst, dequantize_attr);
     } else {
       this->reorder_to(dst);
       if (has_scale()) {
         dst.set_scale(get_scale());
       }
+      if (has_zero_point()) {
+        dst.set_zero_point(get_zero_point());
+      }
     }
 
     return dst;
@@ -986,11 +994,25 @@ class tensor : public memory {
       auto mask_dst = this->make_grouped_weights(groups, is_deconv_weights);
       auto mask_src = src.make_grouped_weights(groups, is_deconv_weights);
       int mask = utils::tensor_scale_mask(src_scale.size(), true);
-      mask_src.reorder_to(mask_dst, {mask, scales});
+      mask_src.reorder_to(mask_dst, zero_points_attr(src, {mask, scales}));
     } else {
       int mask = utils::tensor_scale_mask(src_scale.size(), false);
-      src.reorder_to(*this, {mask, scales});
+      src.reorder_to(*this, zero_points_attr(src, {mask, scales}));
+    }
+  }
+
+  /// Reorder attr of feeding from src, with the zero points of src and this
+  /// tensor, i.e. dst = scale * (src - src_zero_point) + dst_zero_point
+  attr_t zero_points_attr(const tensor &src, attr_t aattr) const {
+    if (src.has_zero_point()) {
+      aattr.set_zero_points(
+          DNNL_ARG_SRC, utils::tensor_zp_mask(1), src.get_zero_point());
+    }
+    if (has_zero_point()) {
+      aattr.set_zero_points(
+          DNNL_ARG_DST, utils::tensor_zp_mask(1), get_zero_point());
     }
+    return aattr;
   }
 
   // For backward compatibility. Will be deprecated.
@@ -1142,6 +1164,9 @@ class tensor : public memory {
     if (get_desc() != adesc) {
       auto dst = tensor(adesc);
       this->reorder_to(dst);
+      // a layout change keeps the quantization parameters
+      dst.scale_ = scale_;
+      dst.zero_point_ = zero_point_;
       *this = std::move(dst);
     }
   }
@@ -6,6 +6,8 @@
 #include <memory>
 #include <algorithm>
 #include <climits>
+#include <cmath>
+#include <limits>
 #include <random>
 #include <numeric>
 #include <atomic>
@@ -191,6 +193,11 @@ inline int tensor_zp_mask(dim zp_size) {
   return zp_size > 1 ? 1 : 0;
 }
 
+// weights data type of an rnn whose src layer is of src_type, s8 for int8
+inline data_type rnn_weights_type(data_type src_type) {
+  return src_type == data_type::u8 ? data_type::s8 : src_type;
+}
+
 inline uintptr_t mod_ptr(void *ptr, size_t bytes) {
   return reinterpret_cast<uintptr_t>(ptr) & (bytes - 1);
 }
@@ -218,6 +225,44 @@ inline void array_set(T *arr, const U &val, size_t size) {
     arr[i] = static_cast<T>(val);
 }
 
+// Element access of the hand written kernels, which compute in f32 whatever
+// the data type of their operands. f32, s32, s8 and u8 elements are stored
+// rounded and saturated.
+template <typename T>
+struct io {
+  static inline float load(T v) { return static_cast<float>(v); }
+  static inline T store(float v) {
+    const double lo = std::numeric_limits<T>::lowest();
+    const double hi = std::numeric_limits<T>::max();
+    return static_cast<T>(
+        std::nearbyint(std::min(std::max(static_cast<double>(v), lo), hi)));
+  }
+};
+
+template <>
+struct io<float> {
+  static inline float load(float v) { return v; }
+  static inline float store(float v) { return v; }
+};
+
+// bf16 elements, stored with round to nearest even
+template <>
+struct io<uint16_t> {
+  static inline float load(uint16_t v) {
+    const uint32_t bits = static_cast<uint32_t>(v) << 16;
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+  }
+  static inline uint16_t store(float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return std::isnan(v)
+        ? static_cast<uint16_t>(0x7FC0)
+        : static_cast<uint16_t>((bits + 0x7FFF + ((bits >> 16) & 1)) >> 16);
+  }
+};
+
 }
 }
 #endif
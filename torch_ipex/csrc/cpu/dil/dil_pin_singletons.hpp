@@ -15,6 +15,16 @@ engine& engine::gpu_engine() {
   return gpu_engine;
 }
 
+primitive_cache& primitive_cache::get() {
+  static primitive_cache cache([]() -> size_t {
+    auto capacity = std::getenv("DIL_PRIMITIVE_CACHE_CAPACITY");
+    if (capacity == nullptr)
+      return default_capacity;
+    return std::max(std::atoi(capacity), 0);
+  }());
+  return cache;
+}
+
 struct RegisterEngineAllocator {
   RegisterEngineAllocator(engine& eng,
                           const std::function<void*(size_t)>& malloc,
@@ -2,16 +2,95 @@
 #include "Config.h"
 #include "cpu/int8/quantization/Observer.h"
 
+#include <cmath>
+
 namespace torch_ipex {
 using namespace torch_ipex::cpu::lp::int8;
 
+namespace {
+
+void update_histograms(Observer &observer, const at::TensorList &inputs,
+                       const at::TensorList &outputs) {
+  IPEX_CHECK(inputs.size() == observer.inputs_hist.size() &&
+                 outputs.size() == observer.outputs_hist.size(),
+             "the ", observer.algorithm,
+             " observer needs the tensors of op ", observer.name);
+  for (auto i = 0; i < inputs.size(); i++) {
+    observer.inputs_hist[i].update(inputs[i]);
+  }
+  for (auto j = 0; j < outputs.size(); j++) {
+    observer.outputs_hist[j].update(outputs[j]);
+  }
+}
+
+// scale of s8, 127.5 / threshold of |x|, the threshold is the absolute
+// min/max or the one picked by the histogram
+float observer_scale(const Observer &observer, const std::vector<float> &min_max,
+                     const std::vector<Histogram> &hist, int64_t index,
+                     bool uint8_used) {
+  float threshold = std::max(std::abs(min_max[0]), min_max[1]);
+  if (observer_uses_histogram(observer.algorithm)) {
+    float hist_threshold =
+        histogram_threshold(hist[index], observer.algorithm, uint8_used);
+    if (hist_threshold > 0) {
+      threshold = hist_threshold;
+    }
+  }
+  return 127.5 / threshold;
+}
+
+// u8 scale and zero point covering [min, max], the range is widened to hold
+// 0 so that zero paddings are exact
+std::tuple<float, int32_t> asymmetric_scale(const std::vector<float> &min_max) {
+  float min = std::min(min_max[0], 0.f);
+  float max = std::max(min_max[1], 0.f);
+  if (max - min == 0) {
+    return std::make_tuple(1.f, 0);
+  }
+  float scale = 255. / (max - min);
+  int32_t zero_point = std::nearbyint(-min * scale);
+  return std::make_tuple(scale, std::min(std::max(zero_point, 0), 255));
+}
+
+struct OpScope {
+  std::string path;
+  // occurrences of each op name in the current call of the module
+  std::unordered_map<std::string, int64_t> ops_count;
+};
+
+// per thread, so that the threads running the model concurrently don't
+// disturb the op keys of each other
+thread_local std::vector<OpScope> op_scopes;
+thread_local int64_t positional_ops_id = 0;
+
+// "<module path>/<op name>.<n>" inside a scope, else "#<n>" wrapping at the
+// number of positional indicators
+std::string next_op_key(const std::string &op_name, int64_t positional_size) {
+  if (op_scopes.empty()) {
+    int64_t ops_id = positional_ops_id++;
+    if (positional_ops_id == positional_size)
+      positional_ops_id = 0;
+    return positional_op_key(ops_id);
+  }
+  auto &scope = op_scopes.back();
+  return scope.path + "/" + op_name + "." +
+         std::to_string(scope.ops_count[op_name]++);
+}
+
+} // namespace
+
 void Int8OptConfig::insert_or_updata_observer(
     std::string op_name, std::vector<std::vector<float>> i_min_max_values,
-    std::vector<std::vector<float>> o_min_max_values, int64_t ops_id) {
-  if (observers_.size() <= ops_id) {
+    std::vector<std::vector<float>> o_min_max_values, int64_t ops_id,
+    const at::TensorList &inputs, const at::TensorList &outputs) {
+  std::lock_guard<std::mutex> lock(observers_mutex_);
+  IPEX_CHECK(ops_id >= 0 && ops_id < observers_.size(),
+             "unknown int8 observer id ", ops_id, " of op ", op_name);
+  // observer_id only reserved the observer, name is set by the first update
+  if (observers_[ops_id].name.empty()) {
     // this path is that to set int8 op's configure, using default configures if
     // user not set it.
-    std::string observer_algorithm = "min_max";
+    std::string observer_algorithm = default_algorithm_;
     float averaging_constant =
         0.01; // will be enabled for moving_averager_min_max
     std::string weight_granularity = "per_channel";
@@ -20,16 +99,22 @@ void Int8OptConfig::insert_or_updata_observer(
     std::vector<bool> inputs_dtype_uint8(nums_input, false);
     std::vector<bool> outputs_dtype_uint8(nums_output, false);
     bool quantized = true;
-    if (!indicators_.empty()) {
-      observer_algorithm = indicators_[ops_id].get_indicator_algorithm();
-      weight_granularity =
-          indicators_[ops_id].get_indicator_weight_granularity();
+    std::string activation_qscheme = default_qscheme_;
+    const auto &key = observers_[ops_id].key;
+    auto configured = snapshot();
+    auto it = configured->ids.find(key);
+    if (it != configured->ids.end()) {
+      const auto &indicator = configured->indicators[it->second];
+      observer_algorithm = indicator.get_indicator_algorithm();
+      weight_granularity = indicator.get_indicator_weight_granularity();
       std::tie(inputs_dtype_uint8, outputs_dtype_uint8) =
-          indicators_[ops_id].get_indicator_uint8_status();
-      quantized = indicators_[ops_id].get_indicator_quantized_status();
+          indicator.get_indicator_uint8_status();
+      quantized = indicator.get_indicator_quantized_status();
+      activation_qscheme = indicator.get_indicator_activation_qscheme();
     }
     Observer new_observer = {ops_id,
                              op_name,
+                             key,
                              i_min_max_values,
                              o_min_max_values,
                              observer_algorithm,
@@ -37,13 +122,22 @@ void Int8OptConfig::insert_or_updata_observer(
                              weight_granularity,
                              inputs_dtype_uint8,
                              outputs_dtype_uint8,
-                             quantized};
-    observers_.push_back(new_observer);
+                             quantized,
+                             activation_qscheme};
+    if (observer_uses_histogram(observer_algorithm)) {
+      new_observer.inputs_hist.resize(i_min_max_values.size());
+      new_observer.outputs_hist.resize(o_min_max_values.size());
+      update_histograms(new_observer, inputs, outputs);
+    }
+    observers_[ops_id] = new_observer;
   } else {
     // user has set configure or have run one interation
     auto inputs_pre = observers_[ops_id].inputs_min_max_values;
     auto outputs_pre = observers_[ops_id].outputs_min_max_values;
-    if (observers_[ops_id].algorithm == "min_max") {
+    // the histogram based algorithms still track min/max, it is the fallback
+    // of a histogram that saw nothing but zeros
+    auto &algorithm = observers_[ops_id].algorithm;
+    if (algorithm == "min_max" || observer_uses_histogram(algorithm)) {
       for (auto i = 0; i < i_min_max_values.size(); i++) {
         observers_[ops_id].inputs_min_max_values[i][0] =
             std::min(inputs_pre[i][0], i_min_max_values[i][0]);
@@ -56,7 +150,7 @@ void Int8OptConfig::insert_or_updata_observer(
         observers_[ops_id].outputs_min_max_values[j][1] =
             std::max(outputs_pre[j][1], o_min_max_values[j][1]);
       }
-    } else if (observers_[ops_id].algorithm == "moving_averager_min_max") {
+    } else if (algorithm == "moving_averager_min_max") {
       auto c = observers_[ops_id].averaging_constant;
       for (auto i = 0; i < i_min_max_values.size(); i++) {
         observers_[ops_id].inputs_min_max_values[i][0] =
@@ -71,114 +165,234 @@ void Int8OptConfig::insert_or_updata_observer(
             (1 - c) * outputs_pre[j][1] + c * o_min_max_values[j][1];
       }
     }
+    if (observer_uses_histogram(algorithm)) {
+      update_histograms(observers_[ops_id], inputs, outputs);
+    }
   }
 }
 
-void Int8OptConfig::clear_indicators() { indicators_.clear(); }
+void Int8OptConfig::clear_indicators() { publish({}); }
 
 void Int8OptConfig::add_indicators() {
-  indicators_.clear();
+  std::lock_guard<std::mutex> lock(observers_mutex_);
+  std::vector<Indicator> indicators;
   // default used is s8
   for (auto i = 0; i < observers_.size(); i++) {
+    if (observers_[i].name.empty()) {
+      continue;
+    }
     std::vector<float> inputs_scale, outputs_scale;
     std::vector<std::vector<float>> inputs_values =
         observers_[i].inputs_min_max_values;
     std::vector<std::vector<float>> outputs_values =
         observers_[i].outputs_min_max_values;
 
-    for (auto i = 0; i < inputs_values.size(); i++) {
-      inputs_scale.push_back(
-          127.5 / std::max(std::abs(inputs_values[i][0]), inputs_values[i][1]));
+    // the asymmetric inputs are u8 with a zero point, their scales are the u8
+    // ones and are not swapped by get_indicator_scales
+    std::vector<int32_t> inputs_zero_point;
+    auto inputs_dtype_uint8 = observers_[i].inputs_dtype_uint8;
+    bool asymmetric = observers_[i].activation_qscheme == "asymmetric" &&
+                      observer_supports_zero_point(observers_[i].name);
+    for (auto k = 0; k < inputs_values.size(); k++) {
+      if (asymmetric) {
+        float scale;
+        int32_t zero_point;
+        std::tie(scale, zero_point) = asymmetric_scale(inputs_values[k]);
+        inputs_scale.push_back(scale);
+        inputs_zero_point.push_back(zero_point);
+        inputs_dtype_uint8[k] = true;
+      } else {
+        inputs_scale.push_back(observer_scale(
+            observers_[i], inputs_values[k], observers_[i].inputs_hist, k,
+            inputs_dtype_uint8[k]));
+      }
     }
-    for (auto j = 0; j < outputs_values.size(); j++) {
-      outputs_scale.push_back(127.5 / std::max(std::abs(outputs_values[j][0]),
-                                               outputs_values[j][1]));
+    for (auto k = 0; k < outputs_values.size(); k++) {
+      outputs_scale.push_back(observer_scale(
+          observers_[i], outputs_values[k], observers_[i].outputs_hist, k,
+          observers_[i].outputs_dtype_uint8[k]));
     }
-    // zero_points not used now, zero_points = 0 for u8 and 128 for s8.
-    // zero_point = 128;
+    // the outputs stay symmetric, the int8 consumers of an output don't
+    // handle zero points.
     Indicator new_indicator(
         observers_[i].id, observers_[i].name, observers_[i].algorithm,
         observers_[i].weight_granularity, inputs_scale, outputs_scale,
-        observers_[i].inputs_dtype_uint8, observers_[i].outputs_dtype_uint8,
-        observers_[i].quantized);
-    indicators_.push_back(new_indicator);
+        inputs_dtype_uint8, observers_[i].outputs_dtype_uint8,
+        observers_[i].quantized, observers_[i].activation_qscheme,
+        inputs_zero_point, observers_[i].key);
+    indicators.push_back(new_indicator);
   }
   observers_.clear();
+  observer_ids_.clear();
+  publish(std::move(indicators));
 }
 
 std::vector<std::vector<float>>
 Int8OptConfig::get_indicator_scales(std::vector<bool> i_uint8_used,
                                     std::vector<bool> o_uint8_used,
                                     int64_t ops_id) {
+  auto indicator = find_indicator(ops_id);
+  if (indicator == nullptr) {
+    // the op is not quantized, its scales are not used
+    return {std::vector<float>(i_uint8_used.size(), 1),
+            std::vector<float>(o_uint8_used.size(), 1)};
+  }
   std::vector<float> inputs_scale, outputs_scale;
   std::vector<bool> inputs_uint8_used, outputs_uint8_used;
   std::tie(inputs_uint8_used, outputs_uint8_used) =
-      indicators_[ops_id].get_indicator_uint8_status();
-  std::tie(inputs_scale, outputs_scale) =
-      indicators_[ops_id].get_indicator_scales();
-  bool scale_update = false;
-  for (auto i = 0; i < i_uint8_used.size(); i++) {
+      indicator->get_indicator_uint8_status();
+  std::tie(inputs_scale, outputs_scale) = indicator->get_indicator_scales();
+  // the indicator is shared by all the threads, the scales of the requested
+  // dtypes are derived from it without updating it.
+  // an asymmetric input is always u8
+  bool asymmetric_inputs = !indicator->get_indicator_zero_points().empty();
+  for (auto i = 0; i < i_uint8_used.size() && !asymmetric_inputs; i++) {
     if (!inputs_uint8_used[i] && i_uint8_used[i]) {
-      // update zero_point and scales
       inputs_scale[i] /= 127.5;
       inputs_scale[i] *= 255.5;
-      scale_update = true;
     } else if (inputs_uint8_used[i] && !i_uint8_used[i]) {
-      // update zero_point and scales
       inputs_scale[i] /= 255.5;
       inputs_scale[i] *= 127.5;
-      scale_update = true;
     }
   }
   for (auto j = 0; j < o_uint8_used.size(); j++) {
     if (!outputs_uint8_used[j] && o_uint8_used[j]) {
-      // update zero_point and scales
       outputs_scale[j] /= 127.5;
       outputs_scale[j] *= 255.5;
-      scale_update = true;
     } else if (outputs_uint8_used[j] && !o_uint8_used[j]) {
-      // update zero_point and scales
       outputs_scale[j] /= 255.5;
       outputs_scale[j] *= 127.5;
-      scale_update = true;
     }
   }
-  if (scale_update) {
-    indicators_[ops_id].set_indicator_scales(inputs_scale, outputs_scale);
-    indicators_[ops_id].set_indicator_uint8_status(inputs_uint8_used,
-                                                   outputs_uint8_used);
-  }
   std::vector<std::vector<float>> input_output_scale = {inputs_scale,
                                                         outputs_scale};
   return input_output_scale;
 }
 
 bool Int8OptConfig::get_indicator_quantized_status(int64_t ops_id) {
-  return indicators_[ops_id].get_indicator_quantized_status();
+  auto indicator = find_indicator(ops_id);
+  return indicator != nullptr && indicator->get_indicator_quantized_status();
 }
+
+std::vector<int32_t> Int8OptConfig::get_indicator_zero_points(int64_t ops_id) {
+  auto indicator = find_indicator(ops_id);
+  return indicator == nullptr ? std::vector<int32_t>()
+                              : indicator->get_indicator_zero_points();
+}
+
 void Int8OptConfig::set_indicators(std::vector<Indicator> indicators) {
-  // avoid to use copy assignment since the copy assignment for indicator with rw_mutex
-  // have not been handdled properly
-  IPEX_CHECK(indicators_.empty());
-  indicators_.reserve(indicators.size());
-  for (auto i: indicators){
-    indicators_.emplace_back(i);
-  }
+  IPEX_CHECK(snapshot()->indicators.empty());
+  publish(std::move(indicators));
 }
 
-std::vector<Indicator> Int8OptConfig::get_indicators() { return indicators_; }
+std::vector<Indicator> Int8OptConfig::get_indicators() {
+  return snapshot()->indicators;
+}
+
+int64_t Int8OptConfig::get_indicators_size() {
+  return snapshot()->indicators.size();
+}
+
+void Int8OptConfig::set_default_observer_algorithm(std::string algorithm) {
+  IPEX_CHECK(is_valid_observer_algorithm(algorithm),
+             "unknown int8 calibration algorithm ", algorithm);
+  default_algorithm_ = algorithm;
+}
+
+std::string Int8OptConfig::get_default_observer_algorithm() {
+  return default_algorithm_;
+}
 
-int64_t Int8OptConfig::get_indicators_size() { return indicators_.size(); }
+void Int8OptConfig::set_default_activation_qscheme(std::string qscheme) {
+  IPEX_CHECK(qscheme == "symmetric" || qscheme == "asymmetric",
+             "unknown int8 activation qscheme ", qscheme);
+  default_qscheme_ = qscheme;
+}
 
-void Int8OptConfig::calibration_reset() { current_ops_id = 0; }
+std::string Int8OptConfig::get_default_activation_qscheme() {
+  return default_qscheme_;
+}
+
+void Int8OptConfig::calibration_reset() {
+  positional_ops_id = 0;
+  op_scopes.clear();
+}
+
+void Int8OptConfig::push_scope(const std::string &path) {
+  op_scopes.push_back({path, {}});
+}
+
+void Int8OptConfig::pop_scope() {
+  IPEX_CHECK(!op_scopes.empty(), "pop_int8_scope without push_int8_scope");
+  op_scopes.pop_back();
+}
 
-int64_t Int8OptConfig::fetch_and_add_ops_id() {
-  int64_t ops_id = current_ops_id++;
-  int64_t indicator_size = Int8OptConfig::get_config().get_indicators_size();
-  if (current_ops_id == indicator_size)
-    current_ops_id = 0;
+int64_t Int8OptConfig::fetch_and_add_ops_id(const std::string &op_name) {
+  auto &config = Int8OptConfig::get_config();
+  auto configured = config.snapshot();
+  auto key = next_op_key(op_name, configured->positional_size);
+  if (check_int8_calibration()) {
+    return config.observer_id(key);
+  }
+  auto it = configured->ids.find(key);
+  return it == configured->ids.end() ? -1 : configured->base + it->second;
+}
+
+const Indicator *Int8OptConfig::find_indicator(int64_t ops_id) const {
+  if (ops_id < 0) {
+    return nullptr;
+  }
+  auto in = [ops_id](const IndicatorSnapshot *s) -> const Indicator * {
+    auto i = ops_id - s->base;
+    return i >= 0 && i < s->indicators.size() ? &s->indicators[i] : nullptr;
+  };
+  auto configured = snapshot();
+  if (ops_id >= configured->base) {
+    return in(configured);
+  }
+  // fetched from an older snapshot, replaced since
+  std::lock_guard<std::mutex> lock(snapshots_mutex_);
+  for (auto it = snapshots_.rbegin(); it != snapshots_.rend(); ++it) {
+    if (ops_id >= (*it)->base) {
+      return in(it->get());
+    }
+  }
+  return nullptr;
+}
+
+void Int8OptConfig::publish(std::vector<Indicator> indicators) {
+  std::unique_ptr<IndicatorSnapshot> published(new IndicatorSnapshot());
+  for (auto i = 0; i < indicators.size(); i++) {
+    const auto &key = indicators[i].get_indicator_key();
+    IPEX_CHECK(published->ids.emplace(key, i).second,
+               "duplicated int8 op key ", key);
+    if (key[0] == '#') {
+      published->positional_size++;
+    }
+  }
+  published->indicators = std::move(indicators);
+  // the old snapshots are kept alive, there is one per calibration or load
+  // so they are never worth reclaiming
+  std::lock_guard<std::mutex> lock(snapshots_mutex_);
+  published->base = next_base_;
+  next_base_ += published->indicators.size();
+  snapshot_.store(published.get(), std::memory_order_release);
+  snapshots_.push_back(std::move(published));
+}
+
+int64_t Int8OptConfig::observer_id(const std::string &key) {
+  std::lock_guard<std::mutex> lock(observers_mutex_);
+  auto it = observer_ids_.find(key);
+  if (it != observer_ids_.end()) {
+    return it->second;
+  }
+  int64_t ops_id = observers_.size();
+  Observer observer;
+  observer.id = ops_id;
+  observer.key = key;
+  observers_.push_back(observer);
+  observer_ids_.emplace(key, ops_id);
   return ops_id;
 }
 
-thread_local int64_t Int8OptConfig::current_ops_id = 0;
-} // namespace torch_ipex
\ No newline at end of file
+} // namespace torch_ipex
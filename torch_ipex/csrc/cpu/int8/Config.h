@@ -1,6 +1,11 @@
 #pragma once
 #include "cpu/int8/quantization/Observer.h"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 namespace torch_ipex {
 
 using namespace torch_ipex::cpu::lp::int8;
@@ -13,9 +18,12 @@ public:
   }
 
 public:
+  // inputs and outputs feed the histograms of the kl and percentile
+  // observers, they can be left empty for the min/max based ones.
   void insert_or_updata_observer(
       std::string op_name, std::vector<std::vector<float>> i_min_max_values,
-      std::vector<std::vector<float>> o_min_max_values, int64_t ops_id);
+      std::vector<std::vector<float>> o_min_max_values, int64_t ops_id,
+      const at::TensorList &inputs = {}, const at::TensorList &outputs = {});
 
   void clear_indicators();
 
@@ -27,26 +35,84 @@ public:
 
   bool get_indicator_quantized_status(int64_t ops_id);
 
+  std::vector<int32_t> get_indicator_zero_points(int64_t ops_id);
+
   void set_indicators(std::vector<Indicator> indicators);
 
   std::vector<Indicator> get_indicators();
 
   int64_t get_indicators_size();
 
+  // algorithm of the ops not configured by a loaded indicators file
+  void set_default_observer_algorithm(std::string algorithm);
+
+  std::string get_default_observer_algorithm();
+
+  // activation qscheme of the ops not configured by a loaded indicators file
+  void set_default_activation_qscheme(std::string qscheme);
+
+  std::string get_default_activation_qscheme();
+
+  // Resets the op counters and module scopes of the calling thread
   static void calibration_reset();
 
-  static int64_t fetch_and_add_ops_id();
+  // The ops run inside push_scope(path)/pop_scope() are identified by the
+  // module path and their occurrence in the module, see int8_op_scopes of the
+  // python package, the others by their position in the run of the thread.
+  static void push_scope(const std::string &path);
+
+  static void pop_scope();
+
+  // Id of the next op_name of the calling thread: an observer id while
+  // calibrating, else the id of its indicator in the published snapshot or
+  // -1 if it has none, i.e. it is not quantized.
+  static int64_t fetch_and_add_ops_id(const std::string &op_name);
 
 private:
-  Int8OptConfig() : observers_{}, indicators_{} {}
+  // Immutable once published, read without locking by the inference threads
+  struct IndicatorSnapshot {
+    std::vector<Indicator> indicators;
+    std::unordered_map<std::string, int64_t> ids;
+    // number of positional keys, the positional counters wrap at it
+    int64_t positional_size = 0;
+    // id of the first indicator, the ids of a snapshot follow those of the
+    // previous one, so that an id names one indicator of one snapshot
+    int64_t base = 0;
+  };
+
+  Int8OptConfig()
+      : observers_{}, default_algorithm_("min_max"),
+        default_qscheme_("symmetric") {
+    publish({});
+  }
   ~Int8OptConfig() = default;
-  Int8OptConfig(const Int8OptConfig &) = default;
-  Int8OptConfig &operator=(const Int8OptConfig &) = default;
+  Int8OptConfig(const Int8OptConfig &) = delete;
+  Int8OptConfig &operator=(const Int8OptConfig &) = delete;
+
+  const IndicatorSnapshot *snapshot() const {
+    return snapshot_.load(std::memory_order_acquire);
+  }
+
+  // nullptr for the ops without indicator, looked up in the snapshot that
+  // issued ops_id even if a newer one has been published since
+  const Indicator *find_indicator(int64_t ops_id) const;
+
+  void publish(std::vector<Indicator> indicators);
+
+  int64_t observer_id(const std::string &key);
 
 private:
+  // calibration state, guarded by observers_mutex_
+  std::mutex observers_mutex_;
   std::vector<Observer> observers_;
-  std::vector<Indicator> indicators_;
-  thread_local static int64_t current_ops_id;
+  std::unordered_map<std::string, int64_t> observer_ids_;
+  std::atomic<const IndicatorSnapshot *> snapshot_{nullptr};
+  // every published snapshot, a reader may still hold an old one
+  mutable std::mutex snapshots_mutex_;
+  std::vector<std::unique_ptr<const IndicatorSnapshot>> snapshots_;
+  int64_t next_base_ = 0;
+  std::string default_algorithm_;
+  std::string default_qscheme_;
 };
 
 } // namespace torch_ipex
@@ -0,0 +1,256 @@
+#include "Histogram.h"
+
+#include <ATen/ATen.h>
+#include <ATen/Parallel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "torch_ipex/csrc/aten_ipex_bridge.h"
+#include "torch_ipex/csrc/cpu/ShadeDataContext.h"
+#include "torch_ipex/csrc/cpu/dbl/Common.h"
+#include "torch_ipex/csrc/utils.h"
+
+namespace torch_ipex {
+namespace cpu {
+namespace lp {
+namespace int8 {
+
+namespace {
+
+constexpr int64_t kGrainSize = 1 << 16;
+constexpr float kDefaultPercentile = 99.99;
+// MXNet / TensorRT style smoothing of the empty bins
+constexpr double kSmoothEps = 1e-4;
+
+// percentile of "percentile" or "percentile_<p>", -1 if malformed
+float parse_percentile(const std::string& algorithm) {
+  const std::string prefix = "percentile";
+  if (algorithm.compare(0, prefix.size(), prefix) != 0) {
+    return -1;
+  }
+  if (algorithm.size() == prefix.size()) {
+    return kDefaultPercentile;
+  }
+  if (algorithm[prefix.size()] != '_') {
+    return -1;
+  }
+  try {
+    size_t pos = 0;
+    auto value = algorithm.substr(prefix.size() + 1);
+    float p = std::stof(value, &pos);
+    return (pos == value.size() && p > 0 && p <= 100) ? p : -1;
+  } catch (const std::exception&) {
+    return -1;
+  }
+}
+
+float finite_abs_max(const float* data, int64_t len) {
+  return at::parallel_reduce(0, len, kGrainSize, 0.f,
+      [&](int64_t begin, int64_t end, float ident) {
+        float m = ident;
+        for (int64_t i = begin; i < end; i++) {
+          float v = std::abs(data[i]);
+          if (std::isfinite(v) && v > m) {
+            m = v;
+          }
+        }
+        return m;
+      },
+      [](float a, float b) { return std::max(a, b); });
+}
+
+// Normalizes d[0, len) and moves kSmoothEps of mass to every empty bin,
+// false when all the bins are empty.
+bool smooth_distribution(std::vector<double>& d, int len) {
+  double sum = 0;
+  int zeros = 0;
+  for (int i = 0; i < len; i++) {
+    sum += d[i];
+    zeros += d[i] == 0;
+  }
+  if (sum == 0 || zeros == len) {
+    return false;
+  }
+  double eps = kSmoothEps * zeros / (len - zeros);
+  for (int i = 0; i < len; i++) {
+    d[i] = d[i] == 0 ? kSmoothEps : d[i] / sum - eps;
+  }
+  return true;
+}
+
+} // namespace
+
+void Histogram::update(const float* data, int64_t len) {
+  if (bins.empty()) {
+    bins.assign(kBins, 0);
+  }
+  float m = finite_abs_max(data, len);
+  if (m > max) {
+    if (max == 0) {
+      max = m;
+    } else {
+      // from kBins on all the bins merge into the first one, the factor is
+      // capped there so that a huge jump of the range can't overflow it
+      int64_t factor = 1;
+      while (factor < kBins && max * factor < m) {
+        factor *= 2;
+      }
+      std::vector<uint64_t> merged(kBins, 0);
+      for (int i = 0; i < kBins; i++) {
+        merged[i / factor] += bins[i];
+      }
+      bins.swap(merged);
+      // the old range fits in the first bin of [0, m)
+      max = max * factor < m ? m : max * factor;
+    }
+  }
+  if (max == 0) {
+    bins[0] += len;
+    return;
+  }
+
+  // per-thread counts, summed at the end
+  int nthreads = at::get_num_threads();
+  std::vector<std::vector<uint64_t>> counts(nthreads);
+  float inv_width = kBins / max;
+  at::parallel_for(0, len, kGrainSize, [&](int64_t begin, int64_t end) {
+    auto& local = counts[at::get_thread_num()];
+    if (local.empty()) {
+      local.assign(kBins, 0);
+    }
+    for (int64_t i = begin; i < end; i++) {
+      float v = std::abs(data[i]);
+      if (!std::isfinite(v)) {
+        continue;
+      }
+      local[std::min<int64_t>(static_cast<int64_t>(v * inv_width), kBins - 1)]++;
+    }
+  });
+  for (const auto& local : counts) {
+    for (int i = 0; i < local.size(); i++) {
+      bins[i] += local[i];
+    }
+  }
+}
+
+void Histogram::update(const at::Tensor& tensor) {
+  if (ShadeDataContext::isDilTensor(tensor)) {
+    // |x| does not depend on the layout, a blocked or non fp32 buffer is
+    // reordered into a temporary so that the activation keeps its format
+    auto dil_tensor = dbl::comm::try_gen_dil_tensor(tensor);
+    if (!dil_tensor.is_public_format() ||
+        dil_tensor.get_data_type() != dil::data_type::f32) {
+      dil_tensor = dil_tensor.to_public();
+    }
+    update(static_cast<const float*>(dil_tensor.get_data_handle()), tensor.numel());
+    return;
+  }
+  auto cpu_tensor = bridge::shallowFallbackToCPUTensor(tensor);
+  if (cpu_tensor.scalar_type() != at::kFloat) {
+    cpu_tensor = cpu_tensor.to(at::kFloat);
+  }
+  cpu_tensor = cpu_tensor.contiguous();
+  update(cpu_tensor.data_ptr<float>(), cpu_tensor.numel());
+}
+
+bool is_valid_observer_algorithm(const std::string& algorithm) {
+  return algorithm == "min_max" || algorithm == "moving_averager_min_max" ||
+      observer_uses_histogram(algorithm);
+}
+
+bool observer_uses_histogram(const std::string& algorithm) {
+  return algorithm == "kl" || parse_percentile(algorithm) > 0;
+}
+
+float kl_threshold(const Histogram& hist, int levels) {
+  const auto& bins = hist.bins;
+  int last = bins.size();
+  while (last > 0 && bins[last - 1] == 0) {
+    last--;
+  }
+  // every observed value has its own level
+  if (last <= levels) {
+    return last * hist.bin_width();
+  }
+
+  std::vector<double> p(last), q(last);
+  std::vector<uint64_t> suffix(last + 1, 0);
+  for (int i = last - 1; i >= 0; i--) {
+    suffix[i] = suffix[i + 1] + bins[i];
+  }
+
+  double best_kl = std::numeric_limits<double>::max();
+  int best = last;
+  for (int i = levels; i <= last; i++) {
+    // reference: the first i bins, the clipped outliers folded into the last
+    for (int k = 0; k < i; k++) {
+      p[k] = bins[k];
+    }
+    p[i - 1] += suffix[i];
+
+    // candidate: the first i bins merged into `levels` groups, each group
+    // spread back evenly over its non empty bins
+    for (int j = 0; j < levels; j++) {
+      int start = static_cast<int64_t>(j) * i / levels;
+      int end = static_cast<int64_t>(j + 1) * i / levels;
+      double total = 0;
+      int nonzeros = 0;
+      for (int k = start; k < end; k++) {
+        total += bins[k];
+        nonzeros += bins[k] != 0;
+      }
+      for (int k = start; k < end; k++) {
+        q[k] = (bins[k] != 0) ? total / nonzeros : 0;
+      }
+    }
+
+    if (!smooth_distribution(p, i) || !smooth_distribution(q, i)) {
+      continue;
+    }
+    double kl = 0;
+    for (int k = 0; k < i; k++) {
+      kl += p[k] * std::log(p[k] / q[k]);
+    }
+    if (kl < best_kl) {
+      best_kl = kl;
+      best = i;
+    }
+  }
+  return best * hist.bin_width();
+}
+
+float percentile_threshold(const Histogram& hist, float percentile) {
+  uint64_t total = 0;
+  for (auto count : hist.bins) {
+    total += count;
+  }
+  double target = total * (percentile / 100.);
+  uint64_t cumulative = 0;
+  for (int i = 0; i < hist.bins.size(); i++) {
+    cumulative += hist.bins[i];
+    if (cumulative >= target) {
+      return (i + 1) * hist.bin_width();
+    }
+  }
+  return hist.max;
+}
+
+float histogram_threshold(const Histogram& hist, const std::string& algorithm, bool uint8_used) {
+  if (hist.bins.empty() || hist.max == 0) {
+    return 0;
+  }
+  if (algorithm == "kl") {
+    // |x| spans 128 levels in s8 and 256 in u8
+    return kl_threshold(hist, uint8_used ? 256 : 128);
+  }
+  float percentile = parse_percentile(algorithm);
+  IPEX_CHECK(percentile > 0, "unknown histogram calibration algorithm ", algorithm);
+  return percentile_threshold(hist, percentile);
+}
+
+} // namespace int8
+} // namespace lp
+} // namespace cpu
+} // namespace torch_ipex
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <ATen/Tensor.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace torch_ipex {
+namespace cpu {
+namespace lp {
+namespace int8 {
+
+// Histogram of |x| over [0, max) in kBins equal bins, used by the "kl" and
+// "percentile" calibration algorithms. A batch with a larger |x| widens the
+// range by a power of two, so the old bins are summed in groups instead of
+// being resampled and merging stays exact and O(kBins) per batch.
+struct Histogram {
+  static constexpr int kBins = 2048;
+
+  float max = 0;
+  std::vector<uint64_t> bins;
+
+  void update(const float* data, int64_t len);
+
+  // Any fp32 IPEX or CPU tensor
+  void update(const at::Tensor& tensor);
+
+  float bin_width() const { return max / kBins; }
+};
+
+// "min_max", "moving_averager_min_max", "kl", "percentile" (99.99) or
+// "percentile_<p>"
+bool is_valid_observer_algorithm(const std::string& algorithm);
+
+bool observer_uses_histogram(const std::string& algorithm);
+
+// Clipping threshold of |x| whose quantization to `levels` levels loses the
+// least information, i.e. minimizes the KL divergence between the clipped
+// histogram and its quantized version (entropy calibration).
+float kl_threshold(const Histogram& hist, int levels);
+
+// Smallest threshold of |x| keeping `percentile` percents of the samples
+float percentile_threshold(const Histogram& hist, float percentile);
+
+// Threshold of a histogram based algorithm, 0 when nothing was observed
+float histogram_threshold(const Histogram& hist, const std::string& algorithm, bool uint8_used);
+
+} // namespace int8
+} // namespace lp
+} // namespace cpu
+} // namespace torch_ipex
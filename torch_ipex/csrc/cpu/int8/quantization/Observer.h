@@ -1,5 +1,9 @@
 #pragma once
-#include "rw_lock.h"
+#include "Histogram.h"
+
+#include <string>
+#include <tuple>
+#include <vector>
 
 namespace torch_ipex {
 namespace cpu {
@@ -9,11 +13,13 @@ namespace int8 {
 struct Observer {
   int64_t id;
   std::string name;
+  // see Int8OptConfig::fetch_and_add_ops_id
+  std::string key;
   std::vector<std::vector<float>> inputs_min_max_values;
   std::vector<std::vector<float>> outputs_min_max_values;
   // default uising min/max to compute the quantization parameters,
-  // only support min_max, MovingAverageMinMax and other none per_channel
-  // merthod
+  // support min_max, MovingAverageMinMax, kl and percentile, see
+  // is_valid_observer_algorithm, and other none per_channel merthod
   std::string algorithm = "min_max";
   float averaging_constant = 0.01; // for MovingAverage method
   // only useful for conv, onednn only support per_channel foo conv's weight,
@@ -23,68 +29,81 @@ struct Observer {
   std::vector<bool> inputs_dtype_uint8 = {false};
   std::vector<bool> outputs_dtype_uint8 = {false};
   bool quantized = true;
+  // "symmetric" or "asymmetric", the latter quantizes the inputs to u8 with a
+  // zero point, only for the ops passing it to oneDNN, see
+  // observer_supports_zero_point
+  std::string activation_qscheme = "symmetric";
+  // only filled for the histogram based algorithms, kl and percentile
+  std::vector<Histogram> inputs_hist;
+  std::vector<Histogram> outputs_hist;
 };
 
+// Ops whose inputs can be quantized asymmetrically, to u8 with a zero point
+inline bool observer_supports_zero_point(const std::string &op_name) {
+  return op_name == "Convolution" || op_name == "Convolution_Relu" ||
+         op_name == "Convolution_Sum" || op_name == "Convolution_Sum_Relu" ||
+         op_name == "Linear" || op_name == "LinearFuseEltwise" ||
+         op_name == "LinearSum";
+}
+
+// Key of the n-th int8 op of a run, used when the ops are not identified by
+// their module, and by the indicators files saved before the keys existed
+inline std::string positional_op_key(int64_t n) {
+  return "#" + std::to_string(n);
+}
+
+// Quantization parameters of one op, immutable once published by
+// Int8OptConfig so that inference threads read them without locking.
 class Indicator {
 public:
   Indicator(int64_t i = 0, std::string n = "", std::string alg = "min_max",
             std::string granu = "per_tensor", std::vector<float> i_scale = {1},
             std::vector<float> o_scale = {1},
             std::vector<bool> i_uint8_used = {false},
-            std::vector<bool> o_uint8_used = {false}, bool quant = true)
+            std::vector<bool> o_uint8_used = {false}, bool quant = true,
+            std::string qscheme = "symmetric",
+            std::vector<int32_t> i_zero_point = {}, std::string k = "")
       : id(i), name(n), algorithm(alg), weight_granularity(granu),
         inputs_scale(i_scale), outputs_scale(o_scale),
         inputs_uint8_used(i_uint8_used), outputs_uint8_used(o_uint8_used),
-        quantized(quant) {}
-
-    Indicator(const Indicator& other){
-      UniqueReadLock<ReadWriteMutex> lock(rwmutex);
-      id = other.id;
-      name = other.name;
-      algorithm = other.algorithm;
-      weight_granularity = other.weight_granularity;
-      inputs_scale = other.inputs_scale;
-      outputs_scale = other.outputs_scale;
-      inputs_uint8_used = other.inputs_uint8_used;
-      outputs_uint8_used = other.outputs_uint8_used;
-      quantized = other.quantized;
-    }
+        quantized(quant), activation_qscheme(qscheme),
+        inputs_zero_point(i_zero_point),
+        key(k.empty() ? positional_op_key(i) : k) {}
 
-  int64_t get_indicator_id() { return id; }
+  int64_t get_indicator_id() const { return id; }
 
-  std::string get_indicator_name() { return name; }
+  std::string get_indicator_name() const { return name; }
 
-  std::string get_indicator_algorithm() { return algorithm; }
+  std::string get_indicator_algorithm() const { return algorithm; }
 
-  std::string get_indicator_weight_granularity() { return weight_granularity; }
+  std::string get_indicator_weight_granularity() const {
+    return weight_granularity;
+  }
 
-  std::tuple<std::vector<float>, std::vector<float>> get_indicator_scales() {
-    UniqueReadLock<ReadWriteMutex> lock(rwmutex);
+  std::tuple<std::vector<float>, std::vector<float>>
+  get_indicator_scales() const {
     return std::make_tuple(inputs_scale, outputs_scale);
   }
 
   std::tuple<std::vector<bool>, std::vector<bool>>
-  get_indicator_uint8_status() {
-    UniqueReadLock<ReadWriteMutex> lock(rwmutex);
+  get_indicator_uint8_status() const {
     return std::make_tuple(inputs_uint8_used, outputs_uint8_used);
   }
 
-  bool get_indicator_quantized_status() { return quantized; }
+  bool get_indicator_quantized_status() const { return quantized; }
 
-  void set_indicator_scales(std::vector<float> new_inputs_scale,
-                            std::vector<float> new_outputs_scale) {
-    UniqueWriteLock<ReadWriteMutex> lock(rwmutex);
-    inputs_scale = new_inputs_scale;
-    outputs_scale = new_outputs_scale;
+  std::string get_indicator_activation_qscheme() const {
+    return activation_qscheme;
   }
 
-  void set_indicator_uint8_status(std::vector<bool> new_inputs_uint8_used,
-                                  std::vector<bool> new_outputs_uint8_used) {
-    UniqueWriteLock<ReadWriteMutex> lock(rwmutex);
-    inputs_uint8_used = new_inputs_uint8_used;
-    outputs_uint8_used = new_outputs_uint8_used;
+  // empty for the symmetric inputs
+  const std::vector<int32_t> &get_indicator_zero_points() const {
+    return inputs_zero_point;
   }
 
+  // identity of the op, see Int8OptConfig::fetch_and_add_ops_id
+  const std::string &get_indicator_key() const { return key; }
+
   void set_indicator_quantized_status(bool new_quantized) {
     quantized = new_quantized;
   }
@@ -99,7 +118,9 @@ private:
   std::vector<bool> inputs_uint8_used;
   std::vector<bool> outputs_uint8_used;
   bool quantized;
-  mutable ReadWriteMutex rwmutex;
+  std::string activation_qscheme;
+  std::vector<int32_t> inputs_zero_point;
+  std::string key;
 };
 
 } // namespace int8
@@ -6,6 +6,10 @@
 #include <algorithm>
 #include <c10/util/Exception.h>
 #include <torch/csrc/autograd/function.h>
+#include "bf16/vec/vec_kernel_dispatch.h"
+#include <immintrin.h>
+#include <cstdint>
+#include <vector>
 namespace torch_ipex {
 
 /*
@@ -13,6 +17,228 @@ namespace torch_ipex {
   MaskRCNN: bias = 1
   SSD-Resnet34: bias = 0
 */
+
+/*
+ Bitmask NMS. Boxes are taken in score order and split in words of 64. The
+ first phase computes, in parallel and without any dependency between rows,
+ the bit of every pair (i, j > i) whose IoU reaches the threshold. The second
+ phase walks the rows in order and keeps box i unless an earlier kept box
+ suppressed it, OR-ing the row of every kept box into the removed mask.
+
+ Rows are processed in blocks so that the mask stays bounded for large box
+ counts; rows already suppressed by an earlier block are not computed.
+*/
+constexpr int64_t kNmsWordBits = 64;
+// words of suppression mask computed per block, 8MB
+constexpr int64_t kNmsMaskBlockWords = 1 << 20;
+
+// Suppression bits of box (ix1, iy1, ix2, iy2) against `count` <= 64 boxes.
+template <typename scalar_t>
+inline uint64_t nms_suppress_word_scalar(const scalar_t* x1, const scalar_t* y1,
+                                         const scalar_t* x2, const scalar_t* y2,
+                                         const scalar_t* areas, int64_t count,
+                                         scalar_t ix1, scalar_t iy1, scalar_t ix2,
+                                         scalar_t iy2, scalar_t iarea,
+                                         float threshold, scalar_t bias) {
+  uint64_t bits = 0;
+#pragma omp simd reduction(|:bits)
+  for (int64_t j = 0; j < count; j++) {
+    auto xx1 = std::max(ix1, x1[j]);
+    auto yy1 = std::max(iy1, y1[j]);
+    auto xx2 = std::min(ix2, x2[j]);
+    auto yy2 = std::min(iy2, y2[j]);
+    auto w = std::max(static_cast<scalar_t>(0), xx2 - xx1 + bias);
+    auto h = std::max(static_cast<scalar_t>(0), yy2 - yy1 + bias);
+    auto inter = w * h;
+    auto ovr = inter / (iarea + areas[j] - inter);
+    bits |= static_cast<uint64_t>(ovr >= threshold) << j;
+  }
+  return bits;
+}
+
+// The file is built for the baseline ISA, this variant only runs on the hosts
+// the bf16 kernel dispatcher found AVX512 on.
+__attribute__((target("avx512f")))
+static uint64_t nms_suppress_word_avx512(const float* x1, const float* y1,
+                                         const float* x2, const float* y2,
+                                         const float* areas, int64_t count,
+                                         float ix1, float iy1, float ix2,
+                                         float iy2, float iarea,
+                                         float threshold, float bias) {
+  auto vix1 = _mm512_set1_ps(ix1);
+  auto viy1 = _mm512_set1_ps(iy1);
+  auto vix2 = _mm512_set1_ps(ix2);
+  auto viy2 = _mm512_set1_ps(iy2);
+  auto viarea = _mm512_set1_ps(iarea);
+  auto vthreshold = _mm512_set1_ps(threshold);
+  auto vbias = _mm512_set1_ps(bias);
+  auto vzero = _mm512_setzero_ps();
+  uint64_t bits = 0;
+  for (int64_t j = 0; j < count; j += 16) {
+    __mmask16 mask = count - j >= 16 ? 0xffff : (1 << (count - j)) - 1;
+    auto xx1 = _mm512_max_ps(vix1, _mm512_maskz_loadu_ps(mask, x1 + j));
+    auto yy1 = _mm512_max_ps(viy1, _mm512_maskz_loadu_ps(mask, y1 + j));
+    auto xx2 = _mm512_min_ps(vix2, _mm512_maskz_loadu_ps(mask, x2 + j));
+    auto yy2 = _mm512_min_ps(viy2, _mm512_maskz_loadu_ps(mask, y2 + j));
+    auto w = _mm512_max_ps(vzero, _mm512_add_ps(_mm512_sub_ps(xx2, xx1), vbias));
+    auto h = _mm512_max_ps(vzero, _mm512_add_ps(_mm512_sub_ps(yy2, yy1), vbias));
+    auto inter = _mm512_mul_ps(w, h);
+    auto uni = _mm512_sub_ps(_mm512_add_ps(viarea, _mm512_maskz_loadu_ps(mask, areas + j)), inter);
+    auto ovr = _mm512_div_ps(inter, uni);
+    __mmask16 hit = _mm512_mask_cmp_ps_mask(mask, ovr, vthreshold, _CMP_GE_OQ);
+    bits |= static_cast<uint64_t>(hit) << j;
+  }
+  return bits;
+}
+
+template <typename scalar_t>
+inline uint64_t nms_suppress_word(const scalar_t* x1, const scalar_t* y1,
+                                  const scalar_t* x2, const scalar_t* y2,
+                                  const scalar_t* areas, int64_t count,
+                                  scalar_t ix1, scalar_t iy1, scalar_t ix2,
+                                  scalar_t iy2, scalar_t iarea,
+                                  float threshold, scalar_t bias) {
+  return nms_suppress_word_scalar(x1, y1, x2, y2, areas, count, ix1, iy1, ix2,
+                                  iy2, iarea, threshold, bias);
+}
+
+template <>
+inline uint64_t nms_suppress_word<float>(const float* x1, const float* y1,
+                                         const float* x2, const float* y2,
+                                         const float* areas, int64_t count,
+                                         float ix1, float iy1, float ix2,
+                                         float iy2, float iarea,
+                                         float threshold, float bias) {
+  static const bool use_avx512 =
+      cpu::bf16::vec::get_vec_kernels(cpu::bf16::vec::VecISA::AVX512) != nullptr;
+  if (use_avx512) {
+    return nms_suppress_word_avx512(x1, y1, x2, y2, areas, count, ix1, iy1, ix2,
+                                    iy2, iarea, threshold, bias);
+  }
+  return nms_suppress_word_scalar(x1, y1, x2, y2, areas, count, ix1, iy1, ix2,
+                                  iy2, iarea, threshold, bias);
+}
+
+// Runs NMS over n boxes given in descending score order as structure of
+// arrays, and appends the positions (in that order) of the kept boxes to
+// `keep`. `mask` is scratch space the caller can reuse across calls.
+template <typename scalar_t>
+void nms_bitmask_kernel(const scalar_t* x1, const scalar_t* y1,
+                        const scalar_t* x2, const scalar_t* y2,
+                        const scalar_t* areas, int64_t n, float threshold,
+                        scalar_t bias, bool parallel,
+                        std::vector<uint64_t>& mask,
+                        std::vector<int64_t>& keep) {
+  if (n == 0)
+    return;
+  int64_t num_words = (n + kNmsWordBits - 1) / kNmsWordBits;
+  int64_t block_rows = std::max<int64_t>(kNmsWordBits, kNmsMaskBlockWords / num_words);
+  block_rows = std::min(block_rows, n);
+  // the removed mask lives after the rows, so that repeated calls with the
+  // same scratch do not allocate
+  mask.resize((block_rows + 1) * num_words);
+  auto removed = mask.data() + block_rows * num_words;
+  std::fill_n(removed, num_words, 0);
+  auto is_removed = [&](int64_t i) {
+    return (removed[i / kNmsWordBits] >> (i % kNmsWordBits)) & 1;
+  };
+
+  for (int64_t row_begin = 0; row_begin < n; row_begin += block_rows) {
+    int64_t row_end = std::min(row_begin + block_rows, n);
+
+    // Phase 1: suppression bits of the block rows, from the word holding
+    // the diagonal to the end of the row.
+    auto compute_rows = [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; i++) {
+        if (is_removed(i))
+          continue;
+        auto row = mask.data() + (i - row_begin) * num_words;
+        for (int64_t w = i / kNmsWordBits; w < num_words; w++) {
+          int64_t j = w * kNmsWordBits;
+          auto bits = nms_suppress_word<scalar_t>(
+              x1 + j, y1 + j, x2 + j, y2 + j, areas + j,
+              std::min(kNmsWordBits, n - j), x1[i], y1[i], x2[i], y2[i],
+              areas[i], threshold, bias);
+          if (w == i / kNmsWordBits) {
+            // only boxes after i
+            bits &= ~((uint64_t(2) << (i % kNmsWordBits)) - 1);
+          }
+          row[w] = bits;
+        }
+      }
+    };
+    if (parallel) {
+      at::parallel_for(row_begin, row_end, 16, compute_rows);
+    } else {
+      compute_rows(row_begin, row_end);
+    }
+
+    // Phase 2: serial scan
+    for (int64_t i = row_begin; i < row_end; i++) {
+      if (is_removed(i))
+        continue;
+      keep.push_back(i);
+      auto row = mask.data() + (i - row_begin) * num_words;
+      for (int64_t w = i / kNmsWordBits; w < num_words; w++) {
+        removed[w] |= row[w];
+      }
+    }
+  }
+}
+
+template <typename scalar_t>
+at::Tensor nms_bitmask_cpu_kernel(const at::Tensor& dets,
+                                  const at::Tensor& scores,
+                                  const float threshold, float bias=1) {
+  AT_ASSERTM(!dets.type().is_cuda(), "dets must be a CPU tensor");
+  AT_ASSERTM(!scores.type().is_cuda(), "scores must be a CPU tensor");
+  AT_ASSERTM(dets.type() == scores.type(), "dets should have the same type as scores");
+
+  if (dets.numel() == 0) {
+    return at::empty({0}, dets.options().dtype(at::kLong).device(at::kCPU));
+  }
+
+  auto ndets = dets.size(0);
+  auto order_t = std::get<1>(scores.sort(0, /* descending=*/true));
+  auto order = order_t.data_ptr<int64_t>();
+  auto dets_t = dets.contiguous();
+  auto dets_ptr = dets_t.data_ptr<scalar_t>();
+
+  // boxes in score order
+  std::vector<scalar_t> boxes(5 * ndets);
+  auto x1 = boxes.data();
+  auto y1 = x1 + ndets;
+  auto x2 = y1 + ndets;
+  auto y2 = x2 + ndets;
+  auto areas = y2 + ndets;
+  at::parallel_for(0, ndets, 1024, [&](int64_t begin, int64_t end) {
+    for (int64_t k = begin; k < end; k++) {
+      auto box = dets_ptr + order[k] * 4;
+      x1[k] = box[0];
+      y1[k] = box[1];
+      x2[k] = box[2];
+      y2[k] = box[3];
+      areas[k] = (x2[k] - x1[k] + bias) * (y2[k] - y1[k] + bias);
+    }
+  });
+
+  std::vector<uint64_t> mask;
+  std::vector<int64_t> keep;
+  nms_bitmask_kernel<scalar_t>(x1, y1, x2, y2, areas, ndets, threshold,
+                               static_cast<scalar_t>(bias), /*parallel*/true,
+                               mask, keep);
+
+  // same order as the serial kernel: ascending box index
+  auto keep_t = at::empty({static_cast<int64_t>(keep.size())}, dets.options().dtype(at::kLong).device(at::kCPU));
+  auto keep_ptr = keep_t.data_ptr<int64_t>();
+  for (size_t k = 0; k < keep.size(); k++) {
+    keep_ptr[k] = order[keep[k]];
+  }
+  std::sort(keep_ptr, keep_ptr + keep.size());
+  return keep_t;
+}
+
+// Serial reference kernel, kept for benchmarking against the bitmask one.
 template <typename scalar_t>
 at::Tensor nms_cpu_kernel(const at::Tensor& dets,
                           const at::Tensor& scores,
@@ -81,87 +307,225 @@ at::Tensor nms_cpu_kernel(const at::Tensor& dets,
   return at::nonzero(suppressed_t == 0).squeeze(1);
 }
 
-std::vector<at::Tensor> remove_empty(std::vector<at::Tensor>& candidate) {
-  std::vector<at::Tensor> valid_candidate;
-  for (int64_t i = 0; i < candidate.size(); i++) {
-    if (candidate[i].defined()) {
-      valid_candidate.push_back(candidate[i]);
+/*
+ Multi-image, multi-class NMS on raw buffers, as in the SSD post-processing:
+ Reference to: https://github.com/mlcommons/inference/blob/0f096a18083c3fd529c1fbf97ebda7bc3f1fda70/others/cloud/single_stage_detector/pytorch/utils.py#L163
+
+ Every (image, class) pair is an independent task: boxes scoring above
+ score_threshold are selected, the max_num best are kept and go through NMS
+ with bias 0. Tasks run in a single parallel region, each thread working in
+ its own scratch arena, so nothing is allocated per class.
+*/
+template <typename scalar_t>
+struct ScoreNmsScratch {
+  std::vector<std::pair<scalar_t, int64_t>> candidates;
+  std::vector<scalar_t> boxes;
+  std::vector<uint64_t> mask;
+  std::vector<int64_t> keep;
+};
+
+// Result of one (image, class) task: up to max_num (score, box) pairs in
+// descending score order.
+template <typename scalar_t>
+struct ScoreNmsResult {
+  std::vector<scalar_t> scores;
+  std::vector<int64_t> boxes;
+  std::vector<int64_t> counts;
+};
+
+// dets: [batch, ndets, 4], scores: [batch, ndets, nscore], both contiguous.
+// Class 0 is the background and is skipped.
+template <typename scalar_t>
+ScoreNmsResult<scalar_t> score_nms_kernel(const scalar_t* dets,
+                                          const scalar_t* scores,
+                                          int64_t batch, int64_t ndets,
+                                          int64_t nscore, float threshold,
+                                          float score_threshold,
+                                          int64_t max_num) {
+  ScoreNmsResult<scalar_t> result;
+  int64_t ntasks = batch * nscore;
+  result.scores.resize(ntasks * max_num);
+  result.boxes.resize(ntasks * max_num);
+  result.counts.assign(ntasks, 0);
+  std::vector<ScoreNmsScratch<scalar_t>> scratch(at::get_num_threads());
+
+  at::parallel_for(0, ntasks, 1, [&](int64_t begin, int64_t end) {
+    auto& arena = scratch[at::get_thread_num()];
+    for (int64_t task = begin; task < end; task++) {
+      int64_t b = task / nscore;
+      int64_t c = task % nscore;
+      if (c == 0)
+        continue;
+
+      // threshold filtering and top-k, best first, ties to the lower index
+      auto& candidates = arena.candidates;
+      candidates.clear();
+      auto score = scores + b * ndets * nscore + c;
+      for (int64_t i = 0; i < ndets; i++) {
+        if (score[i * nscore] > score_threshold)
+          candidates.emplace_back(score[i * nscore], i);
+      }
+      if (candidates.empty())
+        continue;
+      auto better = [](const std::pair<scalar_t, int64_t>& x,
+                       const std::pair<scalar_t, int64_t>& y) {
+        return x.first > y.first || (x.first == y.first && x.second < y.second);
+      };
+      int64_t n = std::min<int64_t>(candidates.size(), max_num);
+      std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end(), better);
+
+      auto& boxes = arena.boxes;
+      boxes.resize(5 * n);
+      auto x1 = boxes.data();
+      auto y1 = x1 + n;
+      auto x2 = y1 + n;
+      auto y2 = x2 + n;
+      auto areas = y2 + n;
+      for (int64_t k = 0; k < n; k++) {
+        auto box = dets + (b * ndets + candidates[k].second) * 4;
+        x1[k] = box[0];
+        y1[k] = box[1];
+        x2[k] = box[2];
+        y2[k] = box[3];
+        areas[k] = (x2[k] - x1[k]) * (y2[k] - y1[k]);
+      }
+
+      arena.keep.clear();
+      nms_bitmask_kernel<scalar_t>(x1, y1, x2, y2, areas, n, threshold,
+                                   /*bias*/0, /*parallel*/false, arena.mask,
+                                   arena.keep);
+
+      auto out_scores = result.scores.data() + task * max_num;
+      auto out_boxes = result.boxes.data() + task * max_num;
+      for (size_t k = 0; k < arena.keep.size(); k++) {
+        out_scores[k] = candidates[arena.keep[k]].first;
+        out_boxes[k] = candidates[arena.keep[k]].second;
+      }
+      result.counts[task] = arena.keep.size();
     }
-  }
-  return valid_candidate;
+  });
+  return result;
 }
 
 template <typename scalar_t>
 std::tuple<at::Tensor, at::Tensor, at::Tensor> batch_score_nms_kernel(const at::Tensor& dets,
                           const at::Tensor& scores,
                           const float threshold, int max_num=200) {
-  // Reference to: https://github.com/mlcommons/inference/blob/0f096a18083c3fd529c1fbf97ebda7bc3f1fda70/others/cloud/single_stage_detector/pytorch/utils.py#L163
   auto ndets = dets.size(0);
   auto nscore = scores.size(1);
+  auto dets_t = dets.contiguous();
+  auto scores_t = scores.contiguous();
+  auto result = score_nms_kernel<scalar_t>(
+      dets_t.data_ptr<scalar_t>(), scores_t.data_ptr<scalar_t>(), /*batch*/1,
+      ndets, nscore, threshold, /*score_threshold*/0.05, max_num);
 
-  // Make the dimension of the score is always physically dense.
-  std::vector<at::Tensor> scores_split;
-  if (scores.stride(0) == 1) {
-    scores_split = scores.split(1, 1);
-  } else {
-    scores_split = scores.t().contiguous().split(1, 0);
+  // classes one after the other, each in ascending score order
+  std::vector<int64_t> offsets(nscore + 1, 0);
+  for (int64_t c = 0; c < nscore; c++) {
+    offsets[c + 1] = offsets[c] + result.counts[c];
   }
-
-  std::vector<at::Tensor> bboxes_out(nscore);
-  std::vector<at::Tensor> scores_out(nscore);
-  std::vector<at::Tensor> labels_out(nscore);
-
-#ifdef _OPENMP
-#if (_OPENMP >= 201307)
-# pragma omp parallel for simd
-#else
-# pragma omp parallel for schedule(static)
-#endif
-#endif
-  // skip background (i = 0)
-  for (int64_t i = 1; i < nscore; i++) {
-    at::Tensor score = scores_split[i].squeeze();
-
-    at::Tensor mask_index = at::nonzero(score > 0.05).squeeze(1);
-    at::Tensor bboxes = at::index_select(dets, /*dim*/0, mask_index);
-    score = at::index_select(score, /*dim*/0, mask_index);
-    
-    if (score.size(0) == 0) {
-      continue;
+  auto total = offsets[nscore];
+  auto bboxes_out = at::empty({total, 4}, dets.options());
+  auto labels_out = at::empty({total}, dets.options().dtype(at::kFloat));
+  auto scores_out = at::empty({total}, scores.options());
+  auto bboxes_ptr = bboxes_out.data_ptr<scalar_t>();
+  auto labels_ptr = labels_out.data_ptr<float>();
+  auto scores_ptr = scores_out.data_ptr<scalar_t>();
+  auto dets_ptr = dets_t.data_ptr<scalar_t>();
+  at::parallel_for(1, nscore, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; c++) {
+      auto count = result.counts[c];
+      for (int64_t k = 0; k < count; k++) {
+        auto src = c * max_num + count - 1 - k;
+        auto dst = offsets[c] + k;
+        std::copy_n(dets_ptr + result.boxes[src] * 4, 4, bboxes_ptr + dst * 4);
+        labels_ptr[dst] = c;
+        scores_ptr[dst] = result.scores[src];
+      }
     }
+  });
+  return std::make_tuple(bboxes_out, labels_out, scores_out);
+}
 
-    at::Tensor score_sorted, score_idx_sorted;
-    std::tie(score_sorted, score_idx_sorted) = score.sort(0);
-
-    // # select max_num indices
-    score_idx_sorted = score_idx_sorted.slice(/*dim*/0, /*start*/std::max(score.size(0) - max_num, static_cast<int64_t>(0)), /*end*/score.size(0));
-
-    at::Tensor keep = nms_cpu_kernel<scalar_t>(at::index_select(bboxes, /*dim*/0, score_idx_sorted), at::index_select(score, /*dim*/0, score_idx_sorted), threshold, /*bias*/0);
-    at::Tensor candidates = at::index_select(score_idx_sorted, /*dim*/0, keep);
-
-    bboxes_out[i] = at::index_select(bboxes, /*dim*/0, candidates);
-    scores_out[i] = at::index_select(score, /*dim*/0, candidates);
-    // TODO optimize the fill_
-    labels_out[i] = at::empty({candidates.sizes()}).fill_(i);
-  }
-
-  std::vector<at::Tensor> valid_bboxes_out = remove_empty(bboxes_out);
-  std::vector<at::Tensor> valid_scores_out = remove_empty(scores_out);
-  std::vector<at::Tensor> valid_labels_out = remove_empty(labels_out);
+// Same as above for a batch of images, merged over classes and padded: the
+// max_output best detections of every image come first, in descending score
+// order, followed by zeros.
+template <typename scalar_t>
+std::vector<at::Tensor> batch_score_nms_padded_kernel(const at::Tensor& dets,
+                          const at::Tensor& scores,
+                          const float threshold, const int64_t max_num,
+                          const int64_t max_output, const float score_threshold) {
+  auto batch = dets.size(0);
+  auto ndets = dets.size(1);
+  auto nscore = scores.size(2);
+  auto dets_t = dets.contiguous();
+  auto scores_t = scores.contiguous();
+  auto dets_ptr = dets_t.data_ptr<scalar_t>();
+  auto result = score_nms_kernel<scalar_t>(
+      dets_ptr, scores_t.data_ptr<scalar_t>(), batch, ndets, nscore,
+      threshold, score_threshold, max_num);
 
-  at::Tensor bboxes_out_ = at::cat(valid_bboxes_out, 0);
-  at::Tensor labels_out_ = at::cat(valid_labels_out, 0);
-  at::Tensor scores_out_ = at::cat(valid_scores_out, 0);
+  auto bboxes_out = at::zeros({batch, max_output, 4}, dets.options());
+  auto labels_out = at::zeros({batch, max_output}, dets.options().dtype(at::kLong));
+  auto scores_out = at::zeros({batch, max_output}, scores.options());
+  auto counts_out = at::empty({batch}, dets.options().dtype(at::kLong));
+  auto bboxes_ptr = bboxes_out.data_ptr<scalar_t>();
+  auto labels_ptr = labels_out.data_ptr<int64_t>();
+  auto scores_ptr = scores_out.data_ptr<scalar_t>();
+  auto counts_ptr = counts_out.data_ptr<int64_t>();
 
-  return std::make_tuple(bboxes_out_, labels_out_, scores_out_);
+  at::parallel_for(0, batch, 1, [&](int64_t begin, int64_t end) {
+    // (score, class, position in the class result)
+    std::vector<std::tuple<scalar_t, int64_t, int64_t>> merged;
+    for (int64_t b = begin; b < end; b++) {
+      merged.clear();
+      for (int64_t c = 1; c < nscore; c++) {
+        auto task = b * nscore + c;
+        for (int64_t k = 0; k < result.counts[task]; k++) {
+          merged.emplace_back(result.scores[task * max_num + k], c, k);
+        }
+      }
+      int64_t n = std::min<int64_t>(merged.size(), max_output);
+      std::partial_sort(merged.begin(), merged.begin() + n, merged.end(),
+                        [](const std::tuple<scalar_t, int64_t, int64_t>& x,
+                           const std::tuple<scalar_t, int64_t, int64_t>& y) {
+                          return std::get<0>(x) > std::get<0>(y) ||
+                                 (std::get<0>(x) == std::get<0>(y) &&
+                                  std::make_pair(std::get<1>(x), std::get<2>(x)) <
+                                      std::make_pair(std::get<1>(y), std::get<2>(y)));
+                        });
+      for (int64_t k = 0; k < n; k++) {
+        auto c = std::get<1>(merged[k]);
+        auto src = (b * nscore + c) * max_num + std::get<2>(merged[k]);
+        auto dst = b * max_output + k;
+        std::copy_n(dets_ptr + (b * ndets + result.boxes[src]) * 4, 4, bboxes_ptr + dst * 4);
+        labels_ptr[dst] = c;
+        scores_ptr[dst] = std::get<0>(merged[k]);
+      }
+      counts_ptr[b] = n;
+    }
+  });
+  return {bboxes_out, labels_out, scores_out, counts_out};
 }
 
 at::Tensor nms_cpu(const at::Tensor& dets,
                const at::Tensor& scores,
-               const float threshold) {
+               const float threshold,
+               const float bias) {
   at::Tensor result;
   AT_DISPATCH_FLOATING_TYPES(dets.type(), "nms", [&] {
-    result = nms_cpu_kernel<scalar_t>(dets, scores, threshold);
+    result = nms_bitmask_cpu_kernel<scalar_t>(dets, scores, threshold, bias);
+  });
+  return result;
+}
+
+at::Tensor nms_serial_cpu(const at::Tensor& dets,
+               const at::Tensor& scores,
+               const float threshold,
+               const float bias) {
+  at::Tensor result;
+  AT_DISPATCH_FLOATING_TYPES(dets.type(), "nms_serial", [&] {
+    result = nms_cpu_kernel<scalar_t>(dets, scores, threshold, bias);
   });
   return result;
 }
@@ -176,9 +540,23 @@ std::tuple<at::Tensor, at::Tensor, at::Tensor> batch_score_nms_cpu(const at::Ten
   return result;
 }
 
+std::vector<at::Tensor> batch_score_nms_padded_cpu(const at::Tensor& dets,
+               const at::Tensor& scores,
+               const float threshold,
+               const int64_t max_num,
+               const int64_t max_output,
+               const float score_threshold) {
+  std::vector<at::Tensor> result;
+  AT_DISPATCH_FLOATING_TYPES(dets.type(), "batch_score_nms_padded", [&] {
+    result = batch_score_nms_padded_kernel<scalar_t>(dets, scores, threshold, max_num, max_output, score_threshold);
+  });
+  return result;
+}
+
 at::Tensor IpexExternal::nms(const at::Tensor& dets,
                const at::Tensor& scores,
-               const float threshold) {
+               const float threshold,
+               const float bias) {
 #if defined(IPEX_DISP_OP)
   printf("IpexExternal::nms\n");
 #endif
@@ -189,11 +567,23 @@ at::Tensor IpexExternal::nms(const at::Tensor& dets,
   TORCH_INTERNAL_ASSERT_DEBUG_ONLY(scores.layout() == c10::kStrided);
   auto&& _ipex_dets = bridge::shallowFallbackToCPUTensor(dets);
   auto&& _ipex_scores = bridge::shallowFallbackToCPUTensor(scores);
-  auto&& _ipex_result = nms_cpu(_ipex_dets, _ipex_scores, threshold);
+  auto&& _ipex_result = nms_cpu(_ipex_dets, _ipex_scores, threshold, bias);
   static_cast<void>(_ipex_result); // Avoid warnings in case not used
   return bridge::shallowUpgradeToDPCPPTensor(_ipex_result);
 }
 
+at::Tensor IpexExternal::nms_serial(const at::Tensor& dets,
+               const at::Tensor& scores,
+               const float threshold,
+               const float bias) {
+  TORCH_INTERNAL_ASSERT_DEBUG_ONLY(dets.layout() == c10::kStrided);
+  TORCH_INTERNAL_ASSERT_DEBUG_ONLY(scores.layout() == c10::kStrided);
+  auto&& _ipex_dets = bridge::shallowFallbackToCPUTensor(dets);
+  auto&& _ipex_scores = bridge::shallowFallbackToCPUTensor(scores);
+  auto&& _ipex_result = nms_serial_cpu(_ipex_dets, _ipex_scores, threshold, bias);
+  return bridge::shallowUpgradeToDPCPPTensor(_ipex_result);
+}
+
 std::tuple<at::Tensor, at::Tensor, at::Tensor> IpexExternal::batch_score_nms(const at::Tensor& dets,
                const at::Tensor& scores,
                const float threshold) {
@@ -211,4 +601,31 @@ std::tuple<at::Tensor, at::Tensor, at::Tensor> IpexExternal::batch_score_nms(con
   static_cast<void>(_ipex_result); // Avoid warnings in case not used
   return std::tuple<at::Tensor,at::Tensor,at::Tensor>(bridge::shallowUpgradeToDPCPPTensor(std::get<0>(_ipex_result)), bridge::shallowUpgradeToDPCPPTensor(std::get<1>(_ipex_result)), bridge::shallowUpgradeToDPCPPTensor(std::get<2>(_ipex_result)));
 }
+
+std::vector<at::Tensor> IpexExternal::batch_score_nms_padded(const at::Tensor& dets,
+               const at::Tensor& scores,
+               const float threshold,
+               const int64_t max_num,
+               const int64_t max_output,
+               const float score_threshold) {
+#if defined(IPEX_DISP_OP)
+  printf("IpexExternal::batch_score_nms_padded\n");
+#endif
+#if defined(IPEX_PROFILE_OP)
+  RECORD_FUNCTION("IpexExternal::batch_score_nms_padded", std::vector<c10::IValue>({dets, scores}), torch::autograd::Node::peek_at_next_sequence_nr());
+#endif
+  TORCH_CHECK(dets.dim() == 3 && dets.size(2) == 4, "batch_score_nms_padded: dets should be [batch, boxes, 4]");
+  TORCH_CHECK(scores.dim() == 3 && scores.size(0) == dets.size(0) && scores.size(1) == dets.size(1),
+              "batch_score_nms_padded: scores should be [batch, boxes, classes]");
+  TORCH_CHECK(dets.scalar_type() == scores.scalar_type(), "batch_score_nms_padded: dets should have the same type as scores");
+  TORCH_CHECK(max_num > 0 && max_output > 0, "batch_score_nms_padded: max_num and max_output should be positive");
+  auto&& _ipex_dets = bridge::shallowFallbackToCPUTensor(dets);
+  auto&& _ipex_scores = bridge::shallowFallbackToCPUTensor(scores);
+  auto&& _ipex_result = batch_score_nms_padded_cpu(_ipex_dets, _ipex_scores, threshold, max_num, max_output, score_threshold);
+  std::vector<at::Tensor> result;
+  for (auto& t : _ipex_result) {
+    result.push_back(bridge::shallowUpgradeToDPCPPTensor(t));
+  }
+  return result;
+}
 }
\ No newline at end of file
@@ -22,8 +22,11 @@
 
 #include "cpu/dil/dil.hpp"
 #include "cpu/dbl/Common.h"
+#include "cpu/dbl/Linear.h"
 #include "cpu/ShadeDataContext.h"
 #include "cpu/ExtendOPs.h"
+#include "cpu/aten/aten.hpp"
+#include "cpu/bf16/vec/vec_kernel_dispatch.h"
 #include "cpu/MlpOPs.h"
 #include "cpu/ExternalOPs.h"
 #include "cpu/FusionOPs.h"
@@ -106,6 +109,62 @@ dil::dims getDilStorageStrides(const at::Tensor &tensor) {
 void reorder_to_float32(at::Tensor &tensor){
   cpu::dbl::comm::reorder_to_dtype(tensor, at::kFloat);
 }
+
+// Runs one bf16 vector kernel of the given ISA on plain CPU tensors. bf16
+// arguments are 2-byte tensors holding the raw bits.
+void runBF16VecKernel(const std::string &isa_name, const std::string &kernel,
+                      const std::vector<at::Tensor> &args, float alpha) {
+  const cpu::bf16::vec::VecKernels *kernels = nullptr;
+  cpu::bf16::vec::VecISA isas[cpu::bf16::vec::kNumVecISAs];
+  int num_isas = cpu::bf16::vec::get_supported_vec_isas(isas);
+  for (int i = 0; i < num_isas; i++) {
+    if (isa_name == cpu::bf16::vec::vec_isa_name(isas[i]))
+      kernels = cpu::bf16::vec::get_vec_kernels(isas[i]);
+  }
+  IPEX_CHECK(kernels != nullptr, "bf16 vector kernels for ", isa_name, " are not available");
+  for (auto &arg : args) {
+    IPEX_CHECK(arg.device().is_cpu() && arg.is_contiguous() && arg.numel() == args[0].numel(),
+               "expect contiguous CPU tensors of the same size");
+  }
+  auto len = args[0].numel();
+  auto f32 = [&](size_t i) {
+    IPEX_CHECK(i < args.size() && args[i].scalar_type() == at::kFloat, kernel, ": argument ", i, " should be float");
+    return args[i].data_ptr<float>();
+  };
+  auto b16 = [&](size_t i) {
+    IPEX_CHECK(i < args.size() && args[i].element_size() == 2, kernel, ": argument ", i, " should be 2-byte");
+    return static_cast<uint16_t *>(args[i].data_ptr());
+  };
+  if (kernel == "bf16_to_fp32") {
+    kernels->bf16_to_fp32(f32(0), b16(1), len);
+  } else if (kernel == "fp32_to_bf16") {
+    kernels->fp32_to_bf16(b16(0), f32(1), len);
+  } else if (kernel == "add_bf16") {
+    kernels->add_bf16(b16(0), b16(1), len);
+  } else if (kernel == "add_fp32") {
+    kernels->add_fp32(f32(0), f32(1), len);
+  } else if (kernel == "add_fp32_bf16") {
+    kernels->add_fp32_bf16(f32(0), b16(1), len);
+  } else if (kernel == "move_bf16") {
+    kernels->move_bf16(b16(0), b16(1), len);
+  } else if (kernel == "move_fp32") {
+    kernels->move_fp32(f32(0), f32(1), len);
+  } else if (kernel == "zero_bf16") {
+    kernels->zero_bf16(b16(0), len);
+  } else if (kernel == "zero_fp32") {
+    kernels->zero_fp32(f32(0), len);
+  } else if (kernel == "packed_bf16_add") {
+    kernels->packed_bf16_add(b16(0), b16(1), b16(2), len, alpha);
+  } else if (kernel == "packed_bf16_add_fp32") {
+    kernels->packed_bf16_add_fp32(b16(0), b16(1), f32(2), len, alpha);
+  } else if (kernel == "madd_fp32") {
+    kernels->madd_fp32(f32(0), f32(1), len, alpha);
+  } else if (kernel == "madd_fp32_bf16") {
+    kernels->madd_fp32_bf16(f32(0), b16(1), len, alpha);
+  } else {
+    IPEX_CHECK(false, "unknown bf16 vector kernel ", kernel);
+  }
+}
 /// ****************************
 
 void InitIpexModuleBindings(py::module m) {
@@ -121,6 +180,17 @@ void InitIpexModuleBindings(py::module m) {
            const at::Tensor &grad, float alpha) {
           AtenIpexTypeExt::packed_add_(top_half, bot_half, grad, alpha);
         });
+  m.def("embedding_bag_backward_update_",
+        [](const at::Tensor &grad, at::Tensor &weight,
+           const c10::optional<at::Tensor> &bot_half,
+           const c10::optional<at::Tensor> &momentum,
+           const at::Tensor &indices, const at::Tensor &offsets, int64_t mode,
+           const c10::optional<at::Tensor> &per_sample_weights, double lr,
+           double eps) {
+          AtenIpexTypeExt::embedding_bag_backward_update_(
+              grad, weight, bot_half, momentum, indices, offsets, mode,
+              per_sample_weights, lr, eps);
+        });
   m.def("mlp_forward", &AtenIpexTypeMLPExt::forward);
   m.def("mlp_backward", &AtenIpexTypeMLPExt::backward);
   m.def("mlp_create_handle", &AtenIpexTypeMLPExt::create_handle);
@@ -135,12 +205,55 @@ void InitIpexModuleBindings(py::module m) {
   m.def("set_parameter_tensor", &setParameterTensor);
   m.def("is_parameter_tensor", &isParameterTensor);
   m.def("reorder_to_float32", &reorder_to_float32);
+  m.def("get_bf16_vec_isa", []() { return std::string(cpu::bf16::vec::get_vec_kernels().name); });
+  m.def("get_supported_bf16_vec_isas", []() {
+      std::vector<std::string> names;
+      cpu::bf16::vec::VecISA isas[cpu::bf16::vec::kNumVecISAs];
+      int num_isas = cpu::bf16::vec::get_supported_vec_isas(isas);
+      for (int i = 0; i < num_isas; i++)
+        names.push_back(cpu::bf16::vec::vec_isa_name(isas[i]));
+      return names; });
+  m.def("run_bf16_vec_kernel", &runBF16VecKernel,
+        py::arg("isa"), py::arg("kernel"), py::arg("args"), py::arg("alpha") = 0.0f);
   m.def("enable_jit_opt", []() { AutoOptConfig::singleton().set_jit_fuse(true); });
   m.def("disable_jit_opt", []() { AutoOptConfig::singleton().set_jit_fuse(false); });
   m.def("get_jit_opt", []() { return AutoOptConfig::singleton().get_jit_fuse(); });
   m.def("set_execution_mode", [](bool train) { AutoOptConfig::singleton().set_train(train); }, py::arg("train"));
   m.def("get_train", []() { return AutoOptConfig::singleton().get_train(); });
 
+  // primitive cache
+  m.def("get_primitive_cache_stats", []() {
+      auto stats = dil::primitive_cache::get().get_stats();
+      py::dict d;
+      d["capacity"] = stats.capacity;
+      d["size"] = stats.size;
+      d["hits"] = stats.hits;
+      d["misses"] = stats.misses;
+      d["evictions"] = stats.evictions;
+      return d; });
+  m.def("set_primitive_cache_capacity",
+        [](size_t capacity) { dil::primitive_cache::get().set_capacity(capacity); });
+  m.def("clear_primitive_cache", []() { dil::primitive_cache::get().clear(); });
+
+  // embedding_bag
+  m.def("set_embedding_bag_prefetch_distance",
+        [](int64_t distance) { AutoOptConfig::singleton().set_embedding_bag_prefetch_distance(distance); });
+  m.def("get_embedding_bag_prefetch_distance",
+        []() { return AutoOptConfig::singleton().get_embedding_bag_prefetch_distance(); });
+  m.def("enable_embedding_bag_hot_row_cache",
+        [](const at::Tensor& weight, const at::Tensor& indices, int64_t num_hot_rows) {
+          cpu::aten::embedding_bag::embedding_bag_enable_hot_row_cache(weight, indices, num_hot_rows);
+        });
+  m.def("disable_embedding_bag_hot_row_cache",
+        [](const at::Tensor& weight) { cpu::aten::embedding_bag::embedding_bag_disable_hot_row_cache(weight); });
+  m.def("get_embedding_bag_hot_row_cache_stats", [](const at::Tensor& weight) {
+      auto stats = cpu::aten::embedding_bag::embedding_bag_hot_row_cache_stats(weight);
+      py::dict d;
+      d["rows"] = stats[0];
+      d["hits"] = stats[1];
+      d["misses"] = stats[2];
+      return d; });
+
   // int8 path
 
   m.def("enable_mix_int8_fp32", []() { AutoOptConfig::singleton().set_mix_int8_fp32(true); });
@@ -151,10 +264,36 @@ void InitIpexModuleBindings(py::module m) {
   m.def("get_int8_calibration",
         []() { AutoOptConfig::singleton().get_int8_calibration(); });
   m.def("calibration_reset", []() { Int8OptConfig::calibration_reset(); });
+  m.def("push_int8_scope",
+        [](const std::string &path) { Int8OptConfig::push_scope(path); });
+  m.def("pop_int8_scope", []() { Int8OptConfig::pop_scope(); });
+  m.def("prepack_dynamic_int8_linear_weight", [](const at::Tensor &weight) {
+    cpu::dbl::linear::prepack_dynamic_int8_weights(weight);
+  });
+  m.def("is_dynamic_int8_weight", [](const at::Tensor &weight) {
+    return cpu::ShadeDataContext::isDynamicInt8Tensor(weight);
+  });
+  m.def("drop_reordered_weights", [](const at::Tensor &weight) {
+    cpu::ShadeDataContext::dropReorderedWeights(weight);
+  });
   m.def("add_indicators",
         []() { Int8OptConfig::get_config().add_indicators(); });
   m.def("clear_indicators",
         []() { Int8OptConfig::get_config().clear_indicators(); });
+  // min_max, moving_averager_min_max, kl, percentile or percentile_<p>
+  m.def("set_int8_calibration_algorithm", [](const std::string &algorithm) {
+    Int8OptConfig::get_config().set_default_observer_algorithm(algorithm);
+  });
+  m.def("get_int8_calibration_algorithm", []() {
+    return Int8OptConfig::get_config().get_default_observer_algorithm();
+  });
+  // symmetric or asymmetric
+  m.def("set_int8_activation_qscheme", [](const std::string &qscheme) {
+    Int8OptConfig::get_config().set_default_activation_qscheme(qscheme);
+  });
+  m.def("get_int8_activation_qscheme", []() {
+    return Int8OptConfig::get_config().get_default_activation_qscheme();
+  });
   // clear indicators for case having many scopes which have different structure
   m.def("get_int8_configures", []() {
       py::list output_list;
@@ -164,6 +303,7 @@ void InitIpexModuleBindings(py::module m) {
         py::dict d;
         d["id"] = indicator.get_indicator_id();
         d["name"] = indicator.get_indicator_name();
+        d["key"] = indicator.get_indicator_key();
         d["algorithm"] = indicator.get_indicator_algorithm();
         d["weight_granularity"] = indicator.get_indicator_weight_granularity();
         std::vector<float> i_scale, o_scale;
@@ -175,6 +315,8 @@ void InitIpexModuleBindings(py::module m) {
         d["inputs_uint8_used"] = i_uint8_used;
         d["outputs_uint8_used"] = o_uint8_used;
         d["quantized"] = indicator.get_indicator_quantized_status();
+        d["activation_qscheme"] = indicator.get_indicator_activation_qscheme();
+        d["inputs_zero_point"] = indicator.get_indicator_zero_points();
         output_list.append(d);
       }
       return output_list; } );
@@ -187,6 +329,9 @@ void InitIpexModuleBindings(py::module m) {
       int64_t id = py::cast<std::int64_t>(i["id"]);
       std::string op_name = py::cast<std::string>(i["name"]);
       std::string algorithm = py::cast<std::string>(i["algorithm"]);
+      IPEX_CHECK(is_valid_observer_algorithm(algorithm),
+                 "unknown int8 calibration algorithm ", algorithm, " of ",
+                 op_name);
       std::string weight_granularity =
           py::cast<std::string>(i["weight_granularity"]);
       std::vector<float> i_scale =
@@ -198,8 +343,20 @@ void InitIpexModuleBindings(py::module m) {
       std::vector<bool> o_uint8_used =
           py::cast<std::vector<bool>>(i["outputs_uint8_used"]);
       bool quantized = py::cast<bool>(i["quantized"]);
+      // optional, the configures saved before zero points are symmetric
+      auto configure = py::reinterpret_borrow<py::dict>(i);
+      std::string qscheme = configure.contains("activation_qscheme")
+          ? py::cast<std::string>(i["activation_qscheme"]) : "symmetric";
+      IPEX_CHECK(qscheme == "symmetric" || qscheme == "asymmetric",
+                 "unknown int8 activation qscheme ", qscheme, " of ", op_name);
+      std::vector<int32_t> i_zero_point = configure.contains("inputs_zero_point")
+          ? py::cast<std::vector<int32_t>>(i["inputs_zero_point"]) : std::vector<int32_t>();
+      // the configures saved before the op keys are positional
+      std::string key = configure.contains("key")
+          ? py::cast<std::string>(i["key"]) : positional_op_key(id);
       Indicator temp(id, op_name, algorithm, weight_granularity, i_scale,
-                     o_scale, i_uint8_used, o_uint8_used, quantized);
+                     o_scale, i_uint8_used, o_uint8_used, quantized, qscheme,
+                     i_zero_point, key);
       indicators.push_back(temp);
     }
     Int8OptConfig::get_config().set_indicators(indicators);
@@ -222,8 +379,24 @@ void InitIpexModuleBindings(py::module m) {
   // external OPs
   m.def("roi_align_forward", &IpexExternal::ROIAlign_forward);
   m.def("roi_align_backward", &IpexExternal::ROIAlign_backward);
-  m.def("nms", &IpexExternal::nms);
+  m.def("_roi_align_backward_with_policy", &IpexExternal::ROIAlign_backward_with_policy);
+  m.def("roi_align_forward_multilevel", &IpexExternal::ROIAlign_forward_multilevel,
+        py::arg("features"), py::arg("rois"), py::arg("spatial_scales"), py::arg("pooled_height"),
+        py::arg("pooled_width"), py::arg("sampling_ratio"), py::arg("canonical_scale") = 224,
+        py::arg("canonical_level") = 4);
+  m.def("roi_align_backward_multilevel", &IpexExternal::ROIAlign_backward_multilevel,
+        py::arg("grad"), py::arg("rois"), py::arg("spatial_scales"), py::arg("pooled_height"),
+        py::arg("pooled_width"), py::arg("batch_size"), py::arg("channels"), py::arg("heights"),
+        py::arg("widths"), py::arg("sampling_ratio"), py::arg("canonical_scale") = 224,
+        py::arg("canonical_level") = 4);
+  m.def("nms", &IpexExternal::nms,
+        py::arg("dets"), py::arg("scores"), py::arg("threshold"), py::arg("bias") = 1.0f);
+  m.def("_nms_serial", &IpexExternal::nms_serial,
+        py::arg("dets"), py::arg("scores"), py::arg("threshold"), py::arg("bias") = 1.0f);
   m.def("batch_score_nms", &IpexExternal::batch_score_nms);
+  m.def("batch_score_nms_padded", &IpexExternal::batch_score_nms_padded,
+        py::arg("dets"), py::arg("scores"), py::arg("threshold"), py::arg("max_num") = 200,
+        py::arg("max_output") = 200, py::arg("score_threshold") = 0.05f);
   m.def("linear_relu", &AtenIpexTypeExt::linear_relu);
 }
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <string>
 #include "fusion_pass.h"
 #include "graph_rewrite.h"
@@ -8,6 +9,7 @@
 #include <torch/csrc/jit/runtime/operator.h>
 #include <torch/csrc/jit/passes/subgraph_rewrite.h>
 #include <torch/csrc/jit/ir/alias_analysis.h>
+#include <torch/csrc/jit/ir/constants.h>
 #include <torch/csrc/jit/passes/constant_propagation.h>
 #include <torch/csrc/jit/frontend/error_report.h>
 
@@ -30,16 +32,76 @@ namespace torch { namespace jit {
 //
 // The main goal of MKL-DNN fusion is to limit bandwidth wasting.
 // MKL-DNN provided post ops to fuse ops in its output stage
-// What we could do is listed inside RuleTab.
+// What we could do is listed inside dnnlChains.
 //
 class OpFuser {
   Block* block_;
   std::unique_ptr<AliasDb> aliasDb_;
   std::shared_ptr<Graph> graph_;
   using Symbols = std::vector<Symbol>;
-  using RuleTab = std::unordered_map<::std::pair<Symbol, Symbol>, Symbol>;
-  using Rule = RuleTab::iterator;
-  static RuleTab dnnlRules;
+  // Whether the node of an op could be fused, e.g. on its scalar arguments
+  using Filter = bool (*)(const Node*);
+
+  // One op of a chain and the op the chain is fused to up to it
+  struct Link {
+    Symbol kind;
+    Symbol fused;
+    Filter filter = nullptr;
+  };
+
+  //
+  // A fusion chain is a base op followed by the ops fused into its output
+  // stage, written in their outplace form. The inplace variants of the ops
+  // (relu_, add_ ...) are fused as the ops. Each link gives the op the chain
+  // is fused to so far, so a chain of N ops is fused by N - 1 pairwise steps
+  // and the alias checks of every step are the ones of a two-op fusion.
+  //
+  // The fused node takes the inputs of the base op followed by the inputs of
+  // the post ops (without the fused path), so a fused op whose post ops only
+  // differ in their scalar arguments is described by its chain alone.
+  //
+  // Chains may fuse the same two ops to different ops. The candidates are
+  // tried in the order of the chains and the first one passing its filter and
+  // the alias checks is taken, e.g. linear + add is fused to linear_sum, which
+  // writes its accumulator, and otherwise to linear_add if the add is the one
+  // of a module attribute, which is folded into the bias.
+  //
+  struct Chain {
+    Symbol base;
+    std::vector<Link> links;
+  };
+
+  using RuleTab = std::unordered_map<::std::pair<Symbol, Symbol>, std::vector<Link>>;
+  using Rule = const Link*;
+  static const std::vector<Chain> dnnlChains;
+  static const RuleTab dnnlRules;
+
+  static RuleTab buildRules(const std::vector<Chain>& chains) {
+    RuleTab rules;
+    for (auto& chain : chains) {
+      auto prev = chain.base;
+      for (auto& link : chain.links) {
+        auto& links = rules[std::make_pair(prev, link.kind)];
+        auto same = std::find_if(links.begin(), links.end(),
+            [&](const Link& l) { return l.fused == link.fused; });
+        if (same == links.end())
+          links.push_back(link);
+        prev = link.fused;
+      }
+    }
+    return rules;
+  }
+
+  static Symbol outplaceKind(Symbol kind) {
+    if (!kind.is_aten())
+      return kind;
+    std::string name = kind.toUnqualString();
+    // relu_ but not __and__
+    if (name.size() < 2 || name.back() != '_' || name[name.size() - 2] == '_')
+      return kind;
+    name.pop_back();
+    return Symbol::aten(name);
+  }
 
 public:
   OpFuser(Block* block, std::shared_ptr<Graph> graph)
@@ -66,16 +128,21 @@ public:
     }
   }
 
-  c10::optional<Rule> isFusable(Node *curr, Node *prev) const {
+  std::vector<Rule> isFusable(Node *curr, Node *prev) const {
+    std::vector<Rule> candidates;
     // Is it happening in our case ???
     if (curr->owningBlock() != block_)
-      return c10::nullopt;
+      return candidates;
 
-    auto choice = dnnlRules.find({prev->kind(), curr->kind()});
-    if (choice != dnnlRules.end())
-      return choice;
+    auto choice = dnnlRules.find({prev->kind(), outplaceKind(curr->kind())});
+    if (choice == dnnlRules.end())
+      return candidates;
 
-    return c10::nullopt;
+    for (auto& link : choice->second) {
+      if (!link.filter || link.filter(curr))
+        candidates.push_back(&link);
+    }
+    return candidates;
   }
 
   void refreshAliasDb() {
@@ -113,7 +180,7 @@ public:
   }
 
   Node* fuseNodes(Node *curr, Value *path, Rule rule) {
-    return fuseOpsWithNewKind(curr, path, curr->owningGraph(), rule->second);
+    return fuseOpsWithNewKind(curr, path, curr->owningGraph(), rule->fused);
   }
 
   bool aliasIsSafeForSquashingValue(Node *node, Value *v) {
@@ -128,17 +195,72 @@ public:
     return safe;
   }
 
+  //
+  // The input a view (or an inplace op) returns, by the alias annotations of
+  // its schema, nullptr if v is a new tensor or comes from a node without
+  // schema
+  //
+  static Value* viewBase(Value *v) {
+    auto schema = v->node()->maybeSchema();
+    if (!schema || v->offset() >= schema->returns().size())
+      return nullptr;
+    auto ret_info = schema->returns()[v->offset()].alias_info();
+    if (!ret_info)
+      return nullptr;
+    auto& args = schema->arguments();
+    for (size_t i = 0; i < args.size() && i < v->node()->inputs().size(); ++i) {
+      auto arg_info = args[i].alias_info();
+      if (arg_info && arg_info->beforeSets() == ret_info->beforeSets())
+        return v->node()->input(i);
+    }
+    return nullptr;
+  }
+
+  // The tensor v is a view of, through any number of views
+  static Value* aliasRoot(Value *v) {
+    while (auto base = viewBase(v))
+      v = base;
+    return v;
+  }
+
+  // Whether v, or a view of v, is used topologically after node
+  static bool isUsedAfter(Node *node, Value *v) {
+    for (auto use : v->uses()) {
+      if (use.user == node)
+        continue;
+      if (use.user->isAfter(node))
+        return true;
+      for (auto out : use.user->outputs())
+        if (viewBase(out) == v && isUsedAfter(node, out))
+          return true;
+    }
+    return false;
+  }
+
+  // Whether v shares the tensor of an input of op, which can't be written by
+  // op while it reads its inputs
+  static bool sharesInputOf(Node *op, Value *v) {
+    auto root = aliasRoot(v);
+    for (auto input : op->inputs())
+      if (aliasRoot(input) == root)
+        return true;
+    return false;
+  }
+
   //
   // Check whether we could change specific input to be inplace with output
-  // Any use topologically after node will fail it.
+  // Any use of the tensor of the input, or of a view of it, topologically
+  // after node will fail it, so will a tensor the graph did not compute by an
+  // op: a graph input, a module attribute, a constant, or a value out of
+  // control flow or a tuple, which the caller may hold.
   // XXX: haven't considered loop
   //
   bool aliasIsSafeForInplaceValue(Node *node, Value *v) {
-    for (auto use : v->uses())
-      if (use.user->isAfter(node))
-        return false;
+    auto root = aliasRoot(v);
+    if (!root->node()->maybeSchema())
+      return false;
 
-    return true;
+    return !isUsedAfter(node, root);
   }
 
   const FunctionSchema &matchSchemaForFusion(c10::Symbol symbol,
@@ -171,7 +293,7 @@ public:
     throw er;
   }
 
-  bool aliasIsSafeForFusion(Node *node, Value *v, c10::optional<Rule> r) {
+  bool aliasIsSafeForFusion(Node *node, Value *v, Rule rule) {
     bool safe = false;
     // Returns false if the two nodes to be fused do not have the same owning block
     if (node->owningBlock() != v->node()->owningBlock()) {
@@ -222,9 +344,7 @@ public:
     // Y-merge like case
     //
     if (safe && node->inputs().size() > 1) {
-      TORCH_INTERNAL_ASSERT_DEBUG_ONLY(r);
-      auto rule = *r.value();
-      auto& schema = matchSchemaForFusion(rule.second, v->node(), node);
+      auto& schema = matchSchemaForFusion(rule->fused, v->node(), node);
       auto o_schema = node->schema();
 
       auto pos = v->node()->inputs().size();
@@ -238,8 +358,11 @@ public:
           if (!aliasInfo)
             continue;
 
-          // Introdued new alias write to
           if (aliasInfo->isWrite()) {
+            // The fused op writes the input while reading the inputs of prev
+            safe = safe && !sharesInputOf(v->node(), node->input(i));
+
+            // Introdued new alias write to
             auto old_info = o_schema.arguments()[i].alias_info();
             if (!old_info || !old_info->isWrite()) {
               // Introduced new written to alias
@@ -249,7 +372,20 @@ public:
         }
       }
 
-      // XXX: Do we have to handle output alias change case?
+      //
+      // Output alias change: a node returning one of its inputs (add_) is
+      // only replaced by a fused op returning a new tensor when the returned
+      // input is the path, which the fused op squashes.
+      //
+      auto ret_info = o_schema.returns()[0].alias_info();
+      if (ret_info && !schema.returns()[0].alias_info()) {
+        for (size_t i = 0; i < node->inputs().size(); ++i) {
+          auto arg_info = o_schema.arguments()[i].alias_info();
+          if (arg_info && arg_info->beforeSets() == ret_info->beforeSets()
+              && node->input(i) != v)
+            safe = false;
+        }
+      }
     }
     return safe;
   }
@@ -264,54 +400,106 @@ public:
     //
     for (auto *v : node->inputs()) {
       auto prev = v->node();
-      auto fuseRule = isFusable(node, prev);
+
+      for (auto fuseRule : isFusable(node, prev)) {
+        if (aliasIsSafeForFusion(node, v, fuseRule)) {
+          pos = fuseNodes(node, v, fuseRule);
+          changed = true;
+          break;
+        }
+      }
 
       // We can fuse only one path
-      if (fuseRule && aliasIsSafeForFusion(node, v, fuseRule)) {
-        pos = fuseNodes(node, v, fuseRule.value());
-        changed = true;
+      if (changed)
         break;
-      }
     }
     return std::make_pair(++pos->iterator(), changed);
   }
 
 };
 
-// TODO: These rules should be more scalable
-OpFuser::RuleTab OpFuser::dnnlRules = {
-  {{aten::conv2d, aten::relu}, ipex::conv2d_relu},
-  {{aten::conv2d, Symbol::fromQualString("aten::relu_")}, ipex::conv2d_relu},
-  {{aten::conv2d, aten::add}, ipex::conv2d_sum},
-  {{aten::conv2d, aten::add_}, ipex::conv2d_sum},
-  {{ipex::conv2d_sum, aten::relu}, ipex::conv2d_sum_relu},
-  {{ipex::conv2d_sum, Symbol::fromQualString("aten::relu_")}, ipex::conv2d_sum_relu},
+namespace {
+
+// add(Tensor, Tensor), not add(Tensor, Scalar)
+bool isTensorAdd(const Node* node) {
+  return node->input(1)->type()->isSubtypeOf(TensorType::get());
+}
+
+// add(Tensor, Tensor) of alpha 1, the fused op scales the other input of
+// the add, which is not the path when the path is the second input
+bool isUnitTensorAdd(const Node* node) {
+  auto alpha = toIValue(node->input(2));
+  return isTensorAdd(node) && alpha && alpha->isScalar() &&
+      alpha->toScalar().to<double>() == 1.0;
+}
 
-  {{Symbol::fromQualString("torch_ipex::linear"), aten::relu}, ipex::linear_relu},
-  {{Symbol::fromQualString("torch_ipex::linear"), aten::gelu}, ipex::linear_gelu},
-  {{Symbol::fromQualString("torch_ipex::linear"), Symbol::fromQualString("aten::relu_")}, ipex::linear_relu},
+// An outplace isUnitTensorAdd, add_ writes its self input
+bool isUnitTensorOutplaceAdd(const Node* node) {
+  return node->kind() == aten::add && isUnitTensorAdd(node);
+}
+
+// An isUnitTensorOutplaceAdd of a module attribute or a constant, the other
+// input of linear_add, which only fuses the add of a row folded into the bias
+bool isUnitTensorOutplaceAttrAdd(const Node* node) {
+  auto isAttr = [](const Value* v) {
+    return v->node()->kind() == prim::GetAttr || v->node()->kind() == prim::Constant;
+  };
+  return isUnitTensorOutplaceAdd(node) && (isAttr(node->input(0)) || isAttr(node->input(1)));
+}
+
+// dnnl elu has no input scale
+bool isEluWithoutInputScale(const Node* node) {
+  auto input_scale = toIValue(node->input(3));
+  return input_scale && input_scale->isScalar() &&
+      input_scale->toScalar().to<double>() == 1.0;
+}
+
+const auto ipex_linear = Symbol::fromQualString("torch_ipex::linear");
+
+} // namespace
+
+const std::vector<OpFuser::Chain> OpFuser::dnnlChains = {
+  {aten::conv2d, {{aten::relu, ipex::conv2d_relu}}},
+  {aten::conv2d, {{aten::sigmoid, ipex::conv2d_sigmoid}}},
+  {aten::conv2d, {{aten::hardtanh, ipex::conv2d_clamp}}},
+  {aten::conv2d, {{aten::elu, ipex::conv2d_elu, isEluWithoutInputScale}}},
+  {aten::conv2d, {{aten::add, ipex::conv2d_sum, isUnitTensorAdd},
+                  {aten::relu, ipex::conv2d_sum_relu}}},
+
+  {ipex_linear, {{aten::relu, ipex::linear_relu}}},
+  {ipex_linear, {{aten::gelu, ipex::linear_gelu}}},
+  {ipex_linear, {{aten::add, ipex::linear_sum, isUnitTensorAdd},
+                 {aten::relu, ipex::linear_sum_relu}}},
+  {ipex_linear, {{aten::add, ipex::linear_add, isUnitTensorOutplaceAttrAdd}}},
 
   // 3d ops
-  {{aten::conv3d, aten::relu}, ipex::conv3d_relu},
-  {{aten::conv3d, Symbol::fromQualString("aten::relu_")}, ipex::conv3d_relu},
-  {{aten::conv3d, aten::add}, ipex::conv3d_sum},
-  {{aten::conv3d, aten::add_}, ipex::conv3d_sum},
-  {{ipex::conv3d_sum, aten::relu}, ipex::conv3d_sum_relu},
-  {{ipex::conv3d_sum, Symbol::fromQualString("aten::relu_")}, ipex::conv3d_sum_relu},
-
-  //{{dnnl::conv2d_relu, aten::add}, dnnl::conv2d_relu_sum}
+  {aten::conv3d, {{aten::relu, ipex::conv3d_relu}}},
+  {aten::conv3d, {{aten::add, ipex::conv3d_sum, isUnitTensorAdd},
+                  {aten::relu, ipex::conv3d_sum_relu}}},
 };
 
+const OpFuser::RuleTab OpFuser::dnnlRules = OpFuser::buildRules(OpFuser::dnnlChains);
+
 void FusionPass(std::shared_ptr<Graph> &graph) {
   // Replace _convolution with conv2d or conv3d
   graph_rewrite::replaceConvolutionWithAtenConv(graph);
 
-  // Fuse conv with eltwise operator
+  // Fuse conv with swish
   graph_rewrite::FuseConvolutionWithEltwise(graph);
 
   // Fuse operators as shuffle
   graph_rewrite::FuseShuffle(graph);
 
+  // Fuse the scaled dot product attention, before its dropout is taken by the
+  // residual add fusion
+  graph_rewrite::FuseAttention(graph);
+
+  // Fuse dropout with the residual add
+  graph_rewrite::FuseDropoutWithAdd(graph);
+
+  // Fuse the residual add (and dropout) with layer_norm
+  graph_rewrite::FuseAddLayerNorm(graph);
+
   // Pattern based fusion was lack of alias analysis
   // ??? It may either be too conservative or too aggressive ???
   // getSubgraphRewriter().runOnGraph(graph);
@@ -144,6 +144,8 @@ void FuseShuffle(std::shared_ptr<Graph>& graph) {
   rewriter_shuffle_2d.runOnGraph(graph);
 }
 
+// swish reads the conv output twice, which is not a chain of OpFuser, so it is
+// fused by pattern. The other eltwise ops are fused by OpFuser.
 void FuseConvolutionWithEltwise(std::shared_ptr<Graph>& graph) {
   std::string conv2d_swish_fusion = R"(
       graph(%a, %w, %b, %stride:int[], %padding:int[], %dilation:int[], %groups:int):
@@ -164,113 +166,224 @@ void FuseConvolutionWithEltwise(std::shared_ptr<Graph>& graph) {
         %t = aten::mul_(%r, %s)
         return (%t) )";
 
-  std::string conv2d_sigmoid_fusion = R"(
-      graph(%a, %w, %b, %stride:int[], %padding:int[], %dilation:int[], %groups:int):
-        %r = ipex::conv2d_sigmoid(%a, %w, %b, %stride, %padding, %dilation, %groups)
+  // Fuse conv2d + swish
+  SubgraphRewriter rewriter_conv_swish_outplace;
+  rewriter_conv_swish_outplace.RegisterRewritePattern(
+    conv2d_sigmoid_mul_outplace,
+    conv2d_swish_fusion);
+  rewriter_conv_swish_outplace.runOnGraph(graph);
+  SubgraphRewriter rewriter_conv_swish_inplace;
+  rewriter_conv_swish_inplace.RegisterRewritePattern(
+    conv2d_sigmoid_mul_inplace,
+    conv2d_swish_fusion);
+  rewriter_conv_swish_inplace.runOnGraph(graph);
+}
+
+void FuseDropoutWithAdd(std::shared_ptr<Graph>& graph) {
+  // F.dropout is routed to torch_ipex::dropout by the python extension, a
+  // traced graph keeps aten::dropout
+  std::string ipex_dropout_add = R"(
+      graph(%input, %residual, %p:float, %train:bool, %alpha):
+        %d = torch_ipex::dropout(%input, %p, %train)
+        %r = aten::add(%d, %residual, %alpha)
         return (%r) )";
 
-  std::string conv2d_sigmoid_outplace = R"(
-      graph(%a, %w, %b, %stride:int[], %padding:int[], %dilation:int[], %groups:int):
-        %r = aten::conv2d(%a, %w, %b, %stride, %padding, %dilation, %groups)
-        %s = aten::sigmoid(%r)
-        return (%s) )";
+  std::string ipex_add_dropout = R"(
+      graph(%input, %residual, %p:float, %train:bool, %alpha):
+        %d = torch_ipex::dropout(%input, %p, %train)
+        %r = aten::add(%residual, %d, %alpha)
+        return (%r) )";
 
-  std::string conv2d_sigmoid_inplace = R"(
-      graph(%a, %w, %b, %stride:int[], %padding:int[], %dilation:int[], %groups:int):
-        %r = aten::conv2d(%a, %w, %b, %stride, %padding, %dilation, %groups)
-        %s = aten::sigmoid_(%r)
-        return (%s) )";
+  std::string aten_dropout_add = R"(
+      graph(%input, %residual, %p:float, %train:bool, %alpha):
+        %d = aten::dropout(%input, %p, %train)
+        %r = aten::add(%d, %residual, %alpha)
+        return (%r) )";
 
-  std::string conv2d_hardtanh_fusion = R"(
-      graph(%a, %w, %b, %stride:int[], %padding:int[], %dilation:int[], %groups:int, %min:float, %max:float):
-        %r = ipex::conv2d_clamp(%a, %w, %b, %stride, %padding, %dilation, %groups, %min, %max)
+  std::string aten_add_dropout = R"(
+      graph(%input, %residual, %p:float, %train:bool, %alpha):
+        %d = aten::dropout(%input, %p, %train)
+        %r = aten::add(%residual, %d, %alpha)
         return (%r) )";
 
-  std::string conv2d_hardtanh_inplace = R"(
-      graph(%a, %w, %b, %stride:int[], %padding:int[], %dilation:int[], %groups:int, %min, %max):
-        %r = aten::conv2d(%a, %w, %b, %stride, %padding, %dilation, %groups)
-        %s = aten::hardtanh_(%r, %min, %max)
-        return (%s) )";
+  std::string dropout_add_fusion = R"(
+      graph(%input, %residual, %p:float, %train:bool, %alpha):
+        %r = ipex::dropout_add(%input, %residual, %p, %train)
+        return (%r) )";
 
-  std::string conv2d_hardtanh_outplace = R"(
-      graph(%a, %w, %b, %stride:int[], %padding:int[], %dilation:int[], %groups:int, %min, %max):
-        %r = aten::conv2d(%a, %w, %b, %stride, %padding, %dilation, %groups)
-        %s = aten::hardtanh(%r, %min, %max)
-        return (%s) )";
+  auto filter_dropout_add = [] (
+      const Match& match,
+      const std::unordered_map<std::string, Value*>& vmap) {
+    const auto& match_vmap = match.values_map;
+    auto alpha = getIValue("alpha", match_vmap, vmap);
+    if (!alpha.has_value()) {
+      return false;
+    }
+    return alpha->isDouble() ? (alpha->toDouble() == 1.0) : (alpha->toInt() == 1);
+  };
 
-  std::string conv2d_elu_fusion = R"(
-      graph(%a, %w, %b, %stride:int[], %padding:int[], %dilation:int[], %groups:int, %alpha:float, %scale, %input_scale):
-        %r = ipex::conv2d_elu(%a, %w, %b, %stride, %padding, %dilation, %groups, %alpha, %scale, %input_scale)
+  // Fuse dropout + residual add. aten::add_ is left alone, the dropout of
+  // inference returns its input, which add_ writes and dropout_add would not
+  for (auto& pattern : {ipex_dropout_add, ipex_add_dropout, aten_dropout_add, aten_add_dropout}) {
+    SubgraphRewriter rewriter_dropout_add;
+    rewriter_dropout_add.RegisterRewritePattern(pattern, dropout_add_fusion);
+    rewriter_dropout_add.runOnGraph(graph, filter_dropout_add);
+  }
+}
+
+void FuseAddLayerNorm(std::shared_ptr<Graph>& graph) {
+  std::string add_layer_norm = R"(
+      graph(%input, %residual, %alpha, %shape:int[], %weight, %bias, %eps:float, %cudnn_enable:bool):
+        %s = aten::add(%input, %residual, %alpha)
+        %r = aten::layer_norm(%s, %shape, %weight, %bias, %eps, %cudnn_enable)
         return (%r) )";
 
-  std::string conv2d_elu_inplace = R"(
-      graph(%a, %w, %b, %stride:int[], %padding:int[], %dilation:int[], %groups:int, %alpha:float, %scale, %input_scale):
-        %r = aten::conv2d(%a, %w, %b, %stride, %padding, %dilation, %groups)
-        %s = aten::elu_(%r, %alpha, %scale, %input_scale)
-        return (%s) )";
+  std::string add_layer_norm_fusion = R"(
+      graph(%input, %residual, %alpha, %shape:int[], %weight, %bias, %eps:float, %cudnn_enable:bool):
+        %p : float = prim::Constant[value=0.]()
+        %train : bool = prim::Constant[value=0]()
+        %r = ipex::add_layer_norm(%input, %residual, %shape, %weight, %bias, %eps, %p, %train)
+        return (%r) )";
 
-  std::string conv2d_elu_outplace = R"(
-      graph(%a, %w, %b, %stride:int[], %padding:int[], %dilation:int[], %groups:int, %alpha:float, %scale, %input_scale):
-        %r = aten::conv2d(%a, %w, %b, %stride, %padding, %dilation, %groups)
-        %s = aten::elu(%r, %alpha, %scale, %input_scale)
-        return (%s) )";
+  // dropout + add is fused first by FuseDropoutWithAdd
+  std::string dropout_add_layer_norm = R"(
+      graph(%input, %residual, %p:float, %train:bool, %shape:int[], %weight, %bias, %eps:float, %cudnn_enable:bool):
+        %s = ipex::dropout_add(%input, %residual, %p, %train)
+        %r = aten::layer_norm(%s, %shape, %weight, %bias, %eps, %cudnn_enable)
+        return (%r) )";
 
-  auto filter_conv2d_elu = [] (
+  std::string dropout_add_layer_norm_fusion = R"(
+      graph(%input, %residual, %p:float, %train:bool, %shape:int[], %weight, %bias, %eps:float, %cudnn_enable:bool):
+        %r = ipex::add_layer_norm(%input, %residual, %shape, %weight, %bias, %eps, %p, %train)
+        return (%r) )";
+
+  auto filter_add_layer_norm = [] (
       const Match& match,
       const std::unordered_map<std::string, Value*>& vmap) {
     const auto& match_vmap = match.values_map;
-    auto input_scale_value = getIValue("input_scale", match_vmap, vmap).value();
-    bool no_input_scale = input_scale_value.isDouble() ? (input_scale_value.toDouble() == 1.0) : (input_scale_value.toInt() == 1);
-    return no_input_scale;
+    // aten::add(Tensor, Scalar, Scalar) has the same pattern
+    auto residual = getValue("residual", match_vmap, vmap);
+    if (!residual->type()->isSubtypeOf(TensorType::get())) {
+      return false;
+    }
+    auto alpha = getIValue("alpha", match_vmap, vmap);
+    if (!alpha.has_value()) {
+      return false;
+    }
+    return alpha->isDouble() ? (alpha->toDouble() == 1.0) : (alpha->toInt() == 1);
   };
 
-  // Fuse conv2d + swish
-  SubgraphRewriter rewriter_conv_swish_outplace;
-  rewriter_conv_swish_outplace.RegisterRewritePattern(
-    conv2d_sigmoid_mul_outplace,
-    conv2d_swish_fusion);
-  rewriter_conv_swish_outplace.runOnGraph(graph);
-  SubgraphRewriter rewriter_conv_swish_inplace;
-  rewriter_conv_swish_inplace.RegisterRewritePattern(
-    conv2d_sigmoid_mul_inplace,
-    conv2d_swish_fusion);
-  rewriter_conv_swish_inplace.runOnGraph(graph);
+  // Fuse residual add + layer_norm
+  SubgraphRewriter rewriter_add_layer_norm;
+  rewriter_add_layer_norm.RegisterRewritePattern(
+    add_layer_norm,
+    add_layer_norm_fusion);
+  rewriter_add_layer_norm.runOnGraph(graph, filter_add_layer_norm);
+
+  // Fuse dropout + residual add + layer_norm
+  SubgraphRewriter rewriter_dropout_add_layer_norm;
+  rewriter_dropout_add_layer_norm.RegisterRewritePattern(
+    dropout_add_layer_norm,
+    dropout_add_layer_norm_fusion);
+  rewriter_dropout_add_layer_norm.runOnGraph(graph);
+}
+
+void FuseAttention(std::shared_ptr<Graph>& graph) {
+  // The scores of the HuggingFace self attention:
+  //   softmax(q @ k.transpose(-1, -2) / divisor + mask) -> dropout -> @ v
+  // the dropout is torch_ipex::dropout in a scripted graph, aten::dropout in
+  // a traced one, and is gone once the graph is frozen in eval mode
+  std::string scores = R"(
+        %kt = aten::transpose(%k, %t0, %t1)
+        %qk = aten::matmul(%q, %kt)
+        %scores = aten::div(%qk, %divisor) )";
+  std::string masked_scores = scores + R"(
+        %masked = aten::add(%scores, %mask, %alpha)
+        %probs = aten::softmax(%masked, %dim, %dtype) )";
+  std::string unmasked_scores = scores + R"(
+        %probs = aten::softmax(%scores, %dim, %dtype) )";
+
+  std::string mask_inputs = R"(
+      graph(%q, %k, %v, %mask, %divisor, %p:float, %train:bool, %t0:int, %t1:int, %alpha, %dim:int, %dtype):)";
+  std::string no_mask_inputs = R"(
+      graph(%q, %k, %v, %divisor, %p:float, %train:bool, %t0:int, %t1:int, %dim:int, %dtype):)";
+  std::string no_dropout_mask_inputs = R"(
+      graph(%q, %k, %v, %mask, %divisor, %t0:int, %t1:int, %alpha, %dim:int, %dtype):)";
+  std::string no_dropout_no_mask_inputs = R"(
+      graph(%q, %k, %v, %divisor, %t0:int, %t1:int, %dim:int, %dtype):)";
+
+  std::string ipex_dropout = R"(
+        %d = torch_ipex::dropout(%probs, %p, %train)
+        %r = aten::matmul(%d, %v)
+        return (%r) )";
+  std::string aten_dropout = R"(
+        %d = aten::dropout(%probs, %p, %train)
+        %r = aten::matmul(%d, %v)
+        return (%r) )";
+  std::string no_dropout = R"(
+        %r = aten::matmul(%probs, %v)
+        return (%r) )";
+
+  std::string attention = R"(
+        %r = ipex::attention(%q, %k, %v, %mask, %divisor, %p, %train)
+        return (%r) )";
+  std::string no_mask = R"(
+        %mask : NoneType = prim::Constant() )";
+  std::string no_dropout_args = R"(
+        %p : float = prim::Constant[value=0.]()
+        %train : bool = prim::Constant[value=0]() )";
+
+  auto filter_attention = [] (
+      const Match& match,
+      const std::unordered_map<std::string, Value*>& vmap) {
+    const auto& match_vmap = match.values_map;
+    auto t0 = getIValue("t0", match_vmap, vmap);
+    auto t1 = getIValue("t1", match_vmap, vmap);
+    auto dim = getIValue("dim", match_vmap, vmap);
+    auto dtype = getIValue("dtype", match_vmap, vmap);
+    // the rank of q and k is unknown, only the last two dims are transposed
+    if (!t0.has_value() || !t1.has_value() || t0->toInt() >= 0 || t1->toInt() >= 0 ||
+        t0->toInt() + t1->toInt() != -3 ||
+        !dim.has_value() || dim->toInt() != -1 || !dtype.has_value() || !dtype->isNone()) {
+      return false;
+    }
+    // a traced python number is a 0-dim constant tensor
+    auto divisor = getValue("divisor", match_vmap, vmap);
+    if (divisor->type()->isSubtypeOf(TensorType::get())) {
+      auto divisor_value = toIValue(divisor);
+      if (!divisor_value.has_value() || divisor_value->toTensor().numel() != 1) {
+        return false;
+      }
+    }
+    if (vmap.count("mask")) {
+      if (!getValue("mask", match_vmap, vmap)->type()->isSubtypeOf(TensorType::get())) {
+        return false;
+      }
+      auto alpha = getIValue("alpha", match_vmap, vmap);
+      if (!alpha.has_value() ||
+          (alpha->isDouble() ? alpha->toDouble() != 1.0 : alpha->toInt() != 1)) {
+        return false;
+      }
+    }
+    return true;
+  };
 
-  // Fuse conv2d + sigmoid
-  SubgraphRewriter rewriter_conv_sigmoid_outplace;
-  rewriter_conv_sigmoid_outplace.RegisterRewritePattern(
-    conv2d_sigmoid_outplace,
-    conv2d_sigmoid_fusion);
-  rewriter_conv_sigmoid_outplace.runOnGraph(graph);
-  SubgraphRewriter rewriter_conv_sigmoid_inplace;
-  rewriter_conv_sigmoid_inplace.RegisterRewritePattern(
-    conv2d_sigmoid_inplace,
-    conv2d_sigmoid_fusion);
-  rewriter_conv_sigmoid_inplace.runOnGraph(graph);
-
-  // Fuse conv2d + hardtanh
-  SubgraphRewriter rewriter_conv_hardtanh_outplace;
-  rewriter_conv_hardtanh_outplace.RegisterRewritePattern(
-    conv2d_hardtanh_outplace,
-    conv2d_hardtanh_fusion);
-  rewriter_conv_hardtanh_outplace.runOnGraph(graph);
-  SubgraphRewriter rewriter_conv_hardtanh_inplace;
-  rewriter_conv_hardtanh_inplace.RegisterRewritePattern(
-    conv2d_hardtanh_inplace,
-    conv2d_hardtanh_fusion);
-  rewriter_conv_hardtanh_inplace.runOnGraph(graph);
-
-  // Fuse conv2d + elu
-  SubgraphRewriter rewriter_conv_elu_outplace;
-  rewriter_conv_elu_outplace.RegisterRewritePattern(
-    conv2d_elu_outplace,
-    conv2d_elu_fusion);
-  rewriter_conv_elu_outplace.runOnGraph(graph, filter_conv2d_elu);
-  SubgraphRewriter rewriter_conv_elu_inplace;
-  rewriter_conv_elu_inplace.RegisterRewritePattern(
-    conv2d_elu_inplace,
-    conv2d_elu_fusion);
-  rewriter_conv_elu_inplace.runOnGraph(graph, filter_conv2d_elu);
+  std::vector<std::pair<std::string, std::string>> patterns = {
+    {mask_inputs + masked_scores + ipex_dropout, mask_inputs + attention},
+    {mask_inputs + masked_scores + aten_dropout, mask_inputs + attention},
+    {no_dropout_mask_inputs + masked_scores + no_dropout,
+     no_dropout_mask_inputs + no_dropout_args + attention},
+    {no_mask_inputs + unmasked_scores + ipex_dropout, no_mask_inputs + no_mask + attention},
+    {no_mask_inputs + unmasked_scores + aten_dropout, no_mask_inputs + no_mask + attention},
+    {no_dropout_no_mask_inputs + unmasked_scores + no_dropout,
+     no_dropout_no_mask_inputs + no_mask + no_dropout_args + attention}};
+
+  // Fuse q @ k^T, scale, mask, softmax, dropout and @ v
+  for (auto& pattern : patterns) {
+    SubgraphRewriter rewriter_attention;
+    rewriter_attention.RegisterRewritePattern(pattern.first, pattern.second);
+    rewriter_attention.runOnGraph(graph, filter_attention);
+  }
 }
 
 void replaceConvolutionWithAtenConv(std::shared_ptr<Graph>& graph) {
@@ -22,6 +22,9 @@ c10::optional<IValue> getIValue(
 void replaceConvolutionWithAtenConv(std::shared_ptr<Graph>& graph);
 void FuseConvolutionWithEltwise(std::shared_ptr<Graph>& graph);
 void FuseShuffle(std::shared_ptr<Graph>& graph);
+void FuseDropoutWithAdd(std::shared_ptr<Graph>& graph);
+void FuseAddLayerNorm(std::shared_ptr<Graph>& graph);
+void FuseAttention(std::shared_ptr<Graph>& graph);
 
 } // namespace graph_rewrite_helper
 } // namespace jit
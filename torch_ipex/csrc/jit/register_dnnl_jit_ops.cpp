@@ -6,6 +6,7 @@
 #include "torch_ipex/csrc/utils.h"
 #include "torch_ipex/csrc/cpu/FusionOPs.h"
 #include "torch_ipex/csrc/cpu/DevOPs.h"
+#include "torch_ipex/csrc/cpu/ExtendOPs.h"
 
 namespace torch {
 namespace jit {
@@ -23,6 +24,93 @@ at::Tensor toOptionalTensor(const IValue& v) {
 
 using namespace torch_ipex::cpu;
 
+// A convolution fused with the post ops of its output stage. The fused node
+// takes the inputs of the convolution followed by the scalar arguments of the
+// post ops, which are built into a single dil attr.
+Operator convolutionFusion(const char* schema, std::vector<PostOp> post_ops) {
+  return Operator(
+    schema,
+    [post_ops] (const Node* node) ->Operation {
+      if (torch_ipex::check_auto_dnnl()) {
+        const size_t num_inputs = node->inputs().size();
+        return [post_ops, num_inputs] (Stack* stack) {
+          auto inputs = last(*stack, num_inputs);
+          auto result = AtenIpexJITDev::dil_convolution_fuse_eltwise(
+              inputs[0].toTensor(),
+              inputs[1].toTensor(),
+              toOptionalTensor(inputs[2]),
+              inputs[3].toIntVector(),
+              inputs[4].toIntVector(),
+              inputs[5].toIntVector(),
+              inputs[6].toInt(),
+              make_post_ops_attr(post_ops, inputs.slice(7)));
+          drop(stack, num_inputs);
+          pack(stack, std::move(result));
+          return 0;
+        };
+      } else {
+        TORCH_CHECK(false, "PyTorch native path not support ", node->kind().toQualString(), " fusion now");
+      }
+    },
+    aliasAnalysisFromSchema());
+}
+
+// A linear fused with the post ops of its output stage, see convolutionFusion
+Operator linearFusion(const char* schema, std::vector<PostOp> post_ops) {
+  return Operator(
+    schema,
+    [post_ops] (const Node* node) ->Operation {
+      if (torch_ipex::check_auto_dnnl()) {
+        const size_t num_inputs = node->inputs().size();
+        return [post_ops, num_inputs] (Stack* stack) {
+          auto inputs = last(*stack, num_inputs);
+          auto result = AtenIpexJITDev::dil_linear_fuse_eltwise(
+              inputs[0].toTensor(),
+              inputs[1].toTensor(),
+              toOptionalTensor(inputs[2]),
+              make_post_ops_attr(post_ops, inputs.slice(3)));
+          drop(stack, num_inputs);
+          pack(stack, std::move(result));
+          return 0;
+        };
+      } else {
+        TORCH_CHECK(false, "PyTorch native path not support ", node->kind().toQualString(), " fusion now");
+      }
+    },
+    aliasAnalysisFromSchema());
+}
+
+// A linear accumulated into its accumu input by a sum post op, optionally
+// followed by eltwise post ops. The accumu and the scale of the sum are the
+// arguments of PostOp::sum. The op may write accumu and reuse its buffer for
+// the output, or return a new tensor, so the output is not declared to alias
+// accumu and the fuser only passes an accumu that is dead after the op.
+Operator linearSumFusion(const char* schema, std::vector<PostOp> post_ops) {
+  return Operator(
+    schema,
+    [post_ops] (const Node* node) ->Operation {
+      if (torch_ipex::check_auto_dnnl()) {
+        const size_t num_inputs = node->inputs().size();
+        return [post_ops, num_inputs] (Stack* stack) {
+          auto inputs = last(*stack, num_inputs);
+          auto accumu = inputs[3].toTensor();
+          auto result = AtenIpexJITDev::dil_linear_sum(
+              inputs[0].toTensor(),
+              inputs[1].toTensor(),
+              toOptionalTensor(inputs[2]),
+              accumu,
+              make_post_ops_attr(post_ops, inputs.slice(3)));
+          drop(stack, num_inputs);
+          pack(stack, std::move(result));
+          return 0;
+        };
+      } else {
+        TORCH_CHECK(false, "PyTorch native path not support ", node->kind().toQualString(), " fusion now");
+      }
+    },
+    aliasAnalysisFromSchema());
+}
+
 RegisterOperators op({
     Operator(
       "ipex::shuffle_2d(Tensor input, int[5] view_shape, int trans_dim0, int trans_dim1) -> Tensor",
@@ -44,150 +132,24 @@ RegisterOperators op({
       },
       aliasAnalysisFromSchema()
       ),
-    Operator(
+    convolutionFusion(
       "ipex::conv2d_relu(Tensor input, Tensor weight, Tensor? bias=None, int[2] stride=1, int[2] padding=0, int[2] dilation=1, int groups=1) -> Tensor",
-      [] (const Node* node) ->Operation {
-        if (torch_ipex::check_auto_dnnl()) {
-          return [] (Stack* stack) {
-            auto result = AtenIpexJITDev::dil_convolution_relu(
-                (std::move(peek(stack, 0, 7))).toTensor(),
-                (std::move(peek(stack, 1, 7))).toTensor(),
-                toOptionalTensor(std::move(peek(stack, 2, 7))),
-                (std::move(peek(stack, 3, 7))).toIntVector(),
-                (std::move(peek(stack, 4, 7))).toIntVector(),
-                (std::move(peek(stack, 5, 7))).toIntVector(),
-                (std::move(peek(stack, 6, 7))).toInt());
-            drop(stack, 7);
-            pack(stack, std::move(result));
-            return 0;
-          };
-        } else {
-          TORCH_CHECK(false, "PyTorch native path not support convolution relu fusion now for 2d case");
-        }
-      },
-      aliasAnalysisFromSchema()
-      ),
-    Operator(
+      {PostOp::relu}),
+    convolutionFusion(
       "ipex::conv2d_sigmoid(Tensor input, Tensor weight, Tensor? bias=None, int[2] stride=1, int[2] padding=0, int[2] dilation=1, int groups=1) -> Tensor",
-      [] (const Node* node) ->Operation {
-        if (torch_ipex::check_auto_dnnl()) {
-          return [] (Stack* stack) {
-            auto result = AtenIpexJITDev::dil_convolution_sigmoid(
-                (std::move(peek(stack, 0, 7))).toTensor(),
-                (std::move(peek(stack, 1, 7))).toTensor(),
-                toOptionalTensor(std::move(peek(stack, 2, 7))),
-                (std::move(peek(stack, 3, 7))).toIntVector(),
-                (std::move(peek(stack, 4, 7))).toIntVector(),
-                (std::move(peek(stack, 5, 7))).toIntVector(),
-                (std::move(peek(stack, 6, 7))).toInt());
-            drop(stack, 7);
-            pack(stack, std::move(result));
-            return 0;
-          };
-        } else {
-          TORCH_CHECK(false, "PyTorch native path not support conv2d_sigmoid fusion now for 2d case");
-        }
-      },
-      aliasAnalysisFromSchema()
-      ),
-    Operator(
+      {PostOp::sigmoid}),
+    convolutionFusion(
       "ipex::conv2d_clamp(Tensor input, Tensor weight, Tensor? bias=None, int[2] stride=1, int[2] padding=0, int[2] dilation=1, int groups=1, float lower_bound=-1.0, float upper_bound=1.0) -> Tensor",
-      [] (const Node* node) ->Operation {
-        if (torch_ipex::check_auto_dnnl()) {
-          return [] (Stack* stack) {
-            // std::cout << ((std::move(peek(stack, 8, 9))).tagKind()) << std::endl;
-            auto result = AtenIpexJITDev::dil_convolution_clamp(
-                (std::move(peek(stack, 0, 9))).toTensor(),
-                (std::move(peek(stack, 1, 9))).toTensor(),
-                toOptionalTensor(std::move(peek(stack, 2, 9))),
-                (std::move(peek(stack, 3, 9))).toIntVector(),
-                (std::move(peek(stack, 4, 9))).toIntVector(),
-                (std::move(peek(stack, 5, 9))).toIntVector(),
-                (std::move(peek(stack, 6, 9))).toInt(),
-                (std::move(peek(stack, 7, 9))).toDouble(),
-                (std::move(peek(stack, 8, 9))).toDouble());
-            drop(stack, 9);
-            pack(stack, std::move(result));
-            return 0;
-          };
-        } else {
-          TORCH_CHECK(false, "PyTorch native path not support conv2d_sigmoid fusion now for 2d case");
-        }
-      },
-      aliasAnalysisFromSchema()
-      ),
-    Operator(
+      {PostOp::clamp}),
+    convolutionFusion(
       "ipex::conv2d_swish(Tensor input, Tensor weight, Tensor? bias=None, int[2] stride=1, int[2] padding=0, int[2] dilation=1, int groups=1) -> Tensor",
-      [] (const Node* node) ->Operation {
-        if (torch_ipex::check_auto_dnnl()) {
-          return [] (Stack* stack) {
-            auto result = AtenIpexJITDev::dil_convolution_swish(
-                (std::move(peek(stack, 0, 7))).toTensor(),
-                (std::move(peek(stack, 1, 7))).toTensor(),
-                toOptionalTensor(std::move(peek(stack, 2, 7))),
-                (std::move(peek(stack, 3, 7))).toIntVector(),
-                (std::move(peek(stack, 4, 7))).toIntVector(),
-                (std::move(peek(stack, 5, 7))).toIntVector(),
-                (std::move(peek(stack, 6, 7))).toInt());
-            drop(stack, 7);
-            pack(stack, std::move(result));
-            return 0;
-          };
-        } else {
-          TORCH_CHECK(false, "PyTorch native path not support convolution+swish fusion now for 2d case");
-        }
-      },
-      aliasAnalysisFromSchema()
-      ),
-    Operator(
+      {PostOp::swish}),
+    convolutionFusion(
       "ipex::conv2d_elu(Tensor input, Tensor weight, Tensor? bias=None, int[2] stride=1, int[2] padding=0, int[2] dilation=1, int groups=1, float alpha=1.0, Scalar scale=1.0, Scalar input_scale=1.0) -> Tensor",
-      [] (const Node* node) ->Operation {
-        if (torch_ipex::check_auto_dnnl()) {
-          return [] (Stack* stack) {
-            auto result = AtenIpexJITDev::dil_convolution_elu(
-                (std::move(peek(stack, 0, 10))).toTensor(),
-                (std::move(peek(stack, 1, 10))).toTensor(),
-                toOptionalTensor(std::move(peek(stack, 2, 10))),
-                (std::move(peek(stack, 3, 10))).toIntVector(),
-                (std::move(peek(stack, 4, 10))).toIntVector(),
-                (std::move(peek(stack, 5, 10))).toIntVector(),
-                (std::move(peek(stack, 6, 10))).toInt(),
-                (std::move(peek(stack, 7, 10))).toDouble(),
-                (std::move(peek(stack, 8, 10))).toScalar(),
-                (std::move(peek(stack, 9, 10))).toScalar());
-            drop(stack, 10);
-            pack(stack, std::move(result));
-            return 0;
-          };
-        } else {
-          TORCH_CHECK(false, "PyTorch native path not support convolution+elu fusion now for 2d case");
-        }
-      },
-      aliasAnalysisFromSchema()
-      ),
-    Operator(
+      {PostOp::elu}),
+    convolutionFusion(
       "ipex::conv3d_relu(Tensor input, Tensor weight, Tensor? bias=None, int[3] stride=1, int[3] padding=0, int[3] dilation=1, int groups=1) -> Tensor",
-      [] (const Node* node) ->Operation {
-        if (torch_ipex::check_auto_dnnl()) {
-          return [] (Stack* stack) {
-            auto result = AtenIpexJITDev::dil_convolution_relu(
-                (std::move(peek(stack, 0, 7))).toTensor(),
-                (std::move(peek(stack, 1, 7))).toTensor(),
-                toOptionalTensor(std::move(peek(stack, 2, 7))),
-                (std::move(peek(stack, 3, 7))).toIntVector(),
-                (std::move(peek(stack, 4, 7))).toIntVector(),
-                (std::move(peek(stack, 5, 7))).toIntVector(),
-                (std::move(peek(stack, 6, 7))).toInt());
-            drop(stack, 7);
-            pack(stack, std::move(result));
-            return 0;
-          };
-        } else {
-          TORCH_CHECK(false, "PyTorch native path not support convolution relu fusion now for 3d case");
-        }
-      },
-      aliasAnalysisFromSchema()
-      ),
+      {PostOp::relu}),
     Operator(
       "ipex::conv2d_sum(Tensor input, Tensor weight, Tensor? bias, int[2] stride, int[2] padding, int[2] dilation, int groups, Tensor(a!) accumu, *, Scalar alpha) -> Tensor(a!)",
       [] (const Node* node) ->Operation {
@@ -309,45 +271,116 @@ RegisterOperators op({
       },
       aliasAnalysisFromSchema()
       ),
-    Operator(
+    linearFusion(
       "ipex::linear_relu(Tensor input, Tensor weight, Tensor? bias=None) -> Tensor",
+      {PostOp::relu}),
+    linearFusion(
+      "ipex::linear_gelu(Tensor input, Tensor weight, Tensor? bias=None) -> Tensor",
+      {PostOp::gelu}),
+    linearSumFusion(
+      "ipex::linear_sum(Tensor input, Tensor weight, Tensor? bias, Tensor(a!) accumu, *, Scalar alpha) -> Tensor",
+      {PostOp::sum}),
+    linearSumFusion(
+      "ipex::linear_sum_relu(Tensor input, Tensor weight, Tensor? bias, Tensor(a!) accumu, *, Scalar alpha) -> Tensor",
+      {PostOp::sum, PostOp::relu}),
+    Operator(
+      "ipex::linear_add(Tensor input, Tensor weight, Tensor? bias, Tensor other, *, Scalar alpha) -> Tensor",
       [] (const Node* node) ->Operation {
         if (torch_ipex::check_auto_dnnl()) {
-          return [] (Stack* stack) {
-            auto result = AtenIpexJITDev::dil_linear_fuse_eltwise(
-                (std::move(peek(stack, 0, 3))).toTensor(),
-                (std::move(peek(stack, 1, 3))).toTensor(),
-                toOptionalTensor(std::move(peek(stack, 2, 3))),
-                dil::attr_t::fuse_relu()
-            );
-            drop(stack, 3);
+          // the node folds its bias with other once per version of them
+          auto folded_bias = std::make_shared<FoldedLinearBias>();
+          return [folded_bias] (Stack* stack) {
+            auto result = AtenIpexJITDev::dil_linear_add(
+                (std::move(peek(stack, 0, 5))).toTensor(),
+                (std::move(peek(stack, 1, 5))).toTensor(),
+                toOptionalTensor(std::move(peek(stack, 2, 5))),
+                (std::move(peek(stack, 3, 5))).toTensor(),
+                (std::move(peek(stack, 4, 5))).toScalar(),
+                folded_bias.get());
+            drop(stack, 5);
             pack(stack, std::move(result));
             return 0;
           };
         } else {
-          TORCH_CHECK(false, "PyTorch native path not support linear relu fusion now");
+          TORCH_CHECK(false, "PyTorch native path not support linear add fusion now");
         }
       },
       aliasAnalysisFromSchema()
       ),
     Operator(
-      "ipex::linear_gelu(Tensor input, Tensor weight, Tensor? bias=None) -> Tensor",
+      "ipex::dropout_add(Tensor input, Tensor residual, float p, bool train) -> Tensor",
       [] (const Node* node) ->Operation {
-        if (torch_ipex::check_auto_dnnl()) {
-          return [] (Stack* stack) {
-            auto result = AtenIpexJITDev::dil_linear_fuse_eltwise(
-                (std::move(peek(stack, 0, 3))).toTensor(),
-                (std::move(peek(stack, 1, 3))).toTensor(),
-                toOptionalTensor(std::move(peek(stack, 2, 3))),
-                dil::attr_t::fuse_gelu()
-            );
-            drop(stack, 3);
-            pack(stack, std::move(result));
-            return 0;
-          };
-        } else {
-          TORCH_CHECK(false, "PyTorch native path not support linear gelu fusion now");
-        }
+        // Falls back to aten dropout and add out of the dnnl path
+        return [] (Stack* stack) {
+          auto result = torch_ipex::AtenIpexTypeExt::dropout_add(
+              (std::move(peek(stack, 0, 4))).toTensor(),
+              (std::move(peek(stack, 1, 4))).toTensor(),
+              (std::move(peek(stack, 2, 4))).toDouble(),
+              (std::move(peek(stack, 3, 4))).toBool());
+          drop(stack, 4);
+          pack(stack, std::move(result));
+          return 0;
+        };
+      },
+      aliasAnalysisFromSchema()
+      ),
+    Operator(
+      "ipex::add_layer_norm(Tensor input, Tensor residual, int[] normalized_shape, Tensor? weight, Tensor? bias, float eps, float p, bool train) -> Tensor",
+      [] (const Node* node) ->Operation {
+        // Falls back to aten add and layer_norm out of the dnnl path
+        return [] (Stack* stack) {
+          auto result = torch_ipex::AtenIpexTypeExt::add_layer_norm(
+              (std::move(peek(stack, 0, 8))).toTensor(),
+              (std::move(peek(stack, 1, 8))).toTensor(),
+              (std::move(peek(stack, 2, 8))).toIntVector(),
+              toOptionalTensor(std::move(peek(stack, 3, 8))),
+              toOptionalTensor(std::move(peek(stack, 4, 8))),
+              (std::move(peek(stack, 5, 8))).toDouble(),
+              (std::move(peek(stack, 6, 8))).toDouble(),
+              (std::move(peek(stack, 7, 8))).toBool());
+          drop(stack, 8);
+          pack(stack, std::move(result));
+          return 0;
+        };
+      },
+      aliasAnalysisFromSchema()
+      ),
+    Operator(
+      "ipex::attention(Tensor query, Tensor key, Tensor value, Tensor? attn_mask, Scalar divisor, float p, bool train) -> Tensor",
+      [] (const Node* node) ->Operation {
+        return [] (Stack* stack) {
+          auto result = torch_ipex::AtenIpexTypeExt::scaled_dot_product_attention(
+              (std::move(peek(stack, 0, 7))).toTensor(),
+              (std::move(peek(stack, 1, 7))).toTensor(),
+              (std::move(peek(stack, 2, 7))).toTensor(),
+              toOptionalTensor(std::move(peek(stack, 3, 7))),
+              1.0 / (std::move(peek(stack, 4, 7))).toScalar().toDouble(),
+              (std::move(peek(stack, 5, 7))).toDouble(),
+              (std::move(peek(stack, 6, 7))).toBool());
+          drop(stack, 7);
+          pack(stack, std::move(result));
+          return 0;
+        };
+      },
+      aliasAnalysisFromSchema()
+      ),
+    Operator(
+      // a traced graph divides the scores by a 0-dim tensor
+      "ipex::attention.Tensor(Tensor query, Tensor key, Tensor value, Tensor? attn_mask, Tensor divisor, float p, bool train) -> Tensor",
+      [] (const Node* node) ->Operation {
+        return [] (Stack* stack) {
+          auto result = torch_ipex::AtenIpexTypeExt::scaled_dot_product_attention(
+              (std::move(peek(stack, 0, 7))).toTensor(),
+              (std::move(peek(stack, 1, 7))).toTensor(),
+              (std::move(peek(stack, 2, 7))).toTensor(),
+              toOptionalTensor(std::move(peek(stack, 3, 7))),
+              1.0 / (std::move(peek(stack, 4, 7))).toTensor().item<double>(),
+              (std::move(peek(stack, 5, 7))).toDouble(),
+              (std::move(peek(stack, 6, 7))).toBool());
+          drop(stack, 7);
+          pack(stack, std::move(result));
+          return 0;
+        };
       },
       aliasAnalysisFromSchema()
       )
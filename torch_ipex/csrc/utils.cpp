@@ -134,13 +134,14 @@ void insert_or_updata_observer(const at::TensorList &inputs,
                                std::string op_name, int64_t ops_id) {
   std::vector<std::vector<float>> inputs_min_max_values, outputs_min_max_values;
   for (auto i = 0; i < inputs.size(); i++) {
-    inputs_min_max_values.push_back({inputs[i].abs().min().item<float>(), inputs[i].abs().max().item<float>()});
+    inputs_min_max_values.push_back({inputs[i].min().item<float>(), inputs[i].max().item<float>()});
   }
   for (auto j = 0; j < outputs.size(); j++) {
-    outputs_min_max_values.push_back({outputs[j].abs().min().item<float>(), outputs[j].abs().max().item<float>()});
+    outputs_min_max_values.push_back({outputs[j].min().item<float>(), outputs[j].max().item<float>()});
   }
   Int8OptConfig::get_config().insert_or_updata_observer(
-      op_name, inputs_min_max_values, outputs_min_max_values, ops_id);
+      op_name, inputs_min_max_values, outputs_min_max_values, ops_id, inputs,
+      outputs);
 }
 
 std::vector<std::vector<float>>
@@ -154,6 +155,10 @@ bool get_indicator_quantized_status(const int64_t ops_id) {
   return Int8OptConfig::get_config().get_indicator_quantized_status(ops_id);
 }
 
+std::vector<int32_t> get_indicator_zero_points(const int64_t ops_id) {
+  return Int8OptConfig::get_config().get_indicator_zero_points(ops_id);
+}
+
 bool check_tensor_own_whole_storage(const at::Tensor& tensor) {
   if (!(tensor.defined()))
     return false;
@@ -33,6 +33,7 @@ std::vector<std::vector<float>>
 get_indicator_scales(std::vector<bool> i_uint8_used,
                      std::vector<bool> o_uint8_used, const int64_t ops_id);
 bool get_indicator_quantized_status(const int64_t ops_id);
+std::vector<int32_t> get_indicator_zero_points(const int64_t ops_id);
 bool check_tensor_own_whole_storage(const at::Tensor& tensor);
 bool check_tensor_own_shade_context(const at::Tensor& tensor);
 bool check_aten_dil_shape_info(const at::Tensor& ipex_tensor, const dil::tensor &dil_tensor);